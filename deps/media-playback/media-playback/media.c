@@ -396,6 +396,31 @@ void mp_media_next_audio(mp_media_t *m)
 	m->a_cb(m->opaque, &audio);
 }
 
+static void mp_media_release_frame(void *param)
+{
+	AVFrame *f = param;
+	av_frame_free(&f);
+}
+
+/* hands the decoded frame over without copying.  only done for software
+ * decoding without scaling, where every decoded frame gets its own
+ * reference-counted buffers */
+static bool mp_media_output_nocopy(mp_media_t *m, AVFrame *f,
+				   struct obs_source_frame *frame)
+{
+	AVFrame *ref;
+
+	if (!m->v_nocopy_cb || m->swscale || m->v.hw)
+		return false;
+
+	ref = av_frame_clone(f);
+	if (!ref)
+		return false;
+
+	m->v_nocopy_cb(m->opaque, frame, mp_media_release_frame, ref);
+	return true;
+}
+
 void mp_media_next_video(mp_media_t *m, bool preload)
 {
 	struct mp_decode *d = &m->v;
@@ -521,7 +546,7 @@ void mp_media_next_video(mp_media_t *m, bool preload)
 		} else if (!m->request_preload) {
 			m->v_preload_cb(m->opaque, frame);
 		}
-	} else {
+	} else if (!mp_media_output_nocopy(m, f, frame)) {
 		m->v_cb(m->opaque, frame);
 	}
 }
@@ -925,6 +950,7 @@ bool mp_media_init(mp_media_t *media, const struct mp_media_info *info)
 	pthread_mutex_init_value(&media->mutex);
 	media->opaque = info->opaque;
 	media->v_cb = info->v_cb;
+	media->v_nocopy_cb = info->v_nocopy_cb;
 	media->a_cb = info->a_cb;
 	media->stop_cb = info->stop_cb;
 	media->ffmpeg_options = info->ffmpeg_options;
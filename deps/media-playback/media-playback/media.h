@@ -45,6 +45,7 @@ struct mp_media {
 	mp_video_cb v_seek_cb;
 	mp_stop_cb stop_cb;
 	mp_video_cb v_cb;
+	mp_video_nocopy_cb v_nocopy_cb;
 	mp_audio_cb a_cb;
 	void *opaque;
 
@@ -9,6 +9,7 @@ target_sources(
           gl-helpers.h
           gl-indexbuffer.c
           gl-shader.c
+          gl-shadercache.c
           gl-shaderparser.c
           gl-shaderparser.h
           gl-stagesurf.c
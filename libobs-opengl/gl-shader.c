@@ -189,9 +189,8 @@ static inline bool gl_process_attribs(struct gs_shader *shader,
 	return true;
 }
 
-static bool gl_shader_init(struct gs_shader *shader,
-			   struct gl_shader_parser *glsp, const char *file,
-			   char **error_string)
+static bool gl_shader_compile(struct gs_shader *shader, const char *source,
+			      const char *file, char **error_string)
 {
 	GLenum type = convert_shader_type(shader->type);
 	int compiled = 0;
@@ -201,8 +200,7 @@ static bool gl_shader_init(struct gs_shader *shader,
 	if (!gl_success("glCreateShader") || !shader->obj)
 		return false;
 
-	glShaderSource(shader->obj, 1, (const GLchar **)&glsp->gl_string.array,
-		       0);
+	glShaderSource(shader->obj, 1, (const GLchar **)&source, 0);
 	if (!gl_success("glShaderSource"))
 		return false;
 
@@ -214,7 +212,7 @@ static bool gl_shader_init(struct gs_shader *shader,
 	blog(LOG_DEBUG, "+++++++++++++++++++++++++++++++++++");
 	blog(LOG_DEBUG, "  GL shader string for: %s", file);
 	blog(LOG_DEBUG, "-----------------------------------");
-	blog(LOG_DEBUG, "%s", glsp->gl_string.array);
+	blog(LOG_DEBUG, "%s", source);
 	blog(LOG_DEBUG, "+++++++++++++++++++++++++++++++++++");
 #endif
 
@@ -242,6 +240,71 @@ static bool gl_shader_init(struct gs_shader *shader,
 	}
 
 	gl_get_shader_info(shader->obj, file, error_string);
+	return success;
+}
+
+/* compiles a shader whose compile was deferred on creation */
+static bool gl_shader_compile_deferred(struct gs_shader *shader)
+{
+	char *error_string = NULL;
+	bool success;
+
+	if (shader->obj)
+		return true;
+
+	/* the deferred compile already failed */
+	if (!shader->source)
+		return false;
+
+	success = gl_shader_compile(shader, shader->source, shader->file,
+				    &error_string);
+
+	if (!success) {
+		/* it compiled with this driver before, but no longer does,
+		 * so it is compiled on creation again from now on */
+		blog(LOG_ERROR, "Deferred compile of shader '%s' failed: %s",
+		     shader->file ? shader->file : "(unknown)",
+		     error_string ? error_string : "(no error log)");
+		gl_shader_cache_remove_compiled(shader->device, shader->hash);
+
+		if (shader->obj) {
+			glDeleteShader(shader->obj);
+			gl_success("glDeleteShader");
+			shader->obj = 0;
+		}
+	}
+
+	bfree(error_string);
+	bfree(shader->source);
+	bfree(shader->file);
+	shader->source = NULL;
+	shader->file = NULL;
+	return success;
+}
+
+static bool gl_shader_init(struct gs_shader *shader,
+			   struct gl_shader_parser *glsp, const char *file,
+			   char **error_string)
+{
+	struct gs_device *device = shader->device;
+	const char *source = glsp->gl_string.array;
+	bool success = true;
+
+	shader->hash = gl_shader_cache_hash(GL_SHADER_CACHE_HASH_INIT, source,
+					    glsp->gl_string.len);
+
+	/* a shader that compiled before with this driver is only compiled
+	 * if a program using it isn't in the shader cache */
+	if (gl_shader_cache_is_compiled(device, shader->hash)) {
+		shader->source = bstrdup(source);
+		shader->file = bstrdup(file);
+		device->shader_cache.stats.shaders_deferred++;
+	} else {
+		success = gl_shader_compile(shader, source, file,
+					    error_string);
+		if (success)
+			gl_shader_cache_add_compiled(device, shader->hash);
+	}
 
 	if (success)
 		success = gl_add_params(shader, glsp);
@@ -352,6 +415,8 @@ void gs_shader_destroy(gs_shader_t *shader)
 	da_free(shader->samplers);
 	da_free(shader->params);
 	da_free(shader->attribs);
+	bfree(shader->source);
+	bfree(shader->file);
 	bfree(shader);
 }
 
@@ -637,51 +702,71 @@ static inline bool assign_program_params(struct gs_program *program)
 	return true;
 }
 
-struct gs_program *gs_program_create(struct gs_device *device)
+static bool link_program(struct gs_program *program)
 {
-	struct gs_program *program = bzalloc(sizeof(*program));
+	struct gs_shader *vs = program->vertex_shader;
+	struct gs_shader *ps = program->pixel_shader;
 	int linked = false;
 
-	program->device = device;
-	program->vertex_shader = device->cur_vertex_shader;
-	program->pixel_shader = device->cur_pixel_shader;
+	if (!gl_shader_compile_deferred(vs) || !gl_shader_compile_deferred(ps))
+		return false;
 
-	program->obj = glCreateProgram();
-	if (!gl_success("glCreateProgram"))
-		goto error_detach_neither;
+	gl_shader_cache_prepare_program(program);
 
-	glAttachShader(program->obj, program->vertex_shader->obj);
+	glAttachShader(program->obj, vs->obj);
 	if (!gl_success("glAttachShader (vertex)"))
-		goto error_detach_neither;
+		return false;
 
-	glAttachShader(program->obj, program->pixel_shader->obj);
+	glAttachShader(program->obj, ps->obj);
 	if (!gl_success("glAttachShader (pixel)"))
-		goto error_detach_vertex;
+		goto detach_vertex;
 
 	glLinkProgram(program->obj);
-	if (!gl_success("glLinkProgram"))
-		goto error;
+	if (gl_success("glLinkProgram")) {
+		glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
+		if (!gl_success("glGetProgramiv"))
+			linked = false;
+		else if (linked == GL_FALSE)
+			print_link_errors(program->obj);
+	}
+
+	glDetachShader(program->obj, ps->obj);
+	gl_success("glDetachShader (pixel)");
 
-	glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
-	if (!gl_success("glGetProgramiv"))
+detach_vertex:
+	glDetachShader(program->obj, vs->obj);
+	gl_success("glDetachShader (vertex)");
+
+	if (linked == GL_FALSE)
+		return false;
+
+	program->device->shader_cache.stats.program_misses++;
+	gl_shader_cache_save_program(program);
+	return true;
+}
+
+struct gs_program *gs_program_create(struct gs_device *device,
+				     struct gs_shader *vertex_shader,
+				     struct gs_shader *pixel_shader)
+{
+	struct gs_program *program = bzalloc(sizeof(*program));
+
+	program->device = device;
+	program->vertex_shader = vertex_shader;
+	program->pixel_shader = pixel_shader;
+
+	program->obj = glCreateProgram();
+	if (!gl_success("glCreateProgram"))
 		goto error;
 
-	if (linked == GL_FALSE) {
-		print_link_errors(program->obj);
+	if (!gl_shader_cache_load_program(program) && !link_program(program))
 		goto error;
-	}
 
 	if (!assign_program_attribs(program))
 		goto error;
 	if (!assign_program_params(program))
 		goto error;
 
-	glDetachShader(program->obj, program->vertex_shader->obj);
-	gl_success("glDetachShader (vertex)");
-
-	glDetachShader(program->obj, program->pixel_shader->obj);
-	gl_success("glDetachShader (pixel)");
-
 	program->next = device->first_program;
 	program->prev_next = &device->first_program;
 	device->first_program = program;
@@ -691,14 +776,6 @@ struct gs_program *gs_program_create(struct gs_device *device)
 	return program;
 
 error:
-	glDetachShader(program->obj, program->pixel_shader->obj);
-	gl_success("glDetachShader (pixel)");
-
-error_detach_vertex:
-	glDetachShader(program->obj, program->vertex_shader->obj);
-	gl_success("glDetachShader (vertex)");
-
-error_detach_neither:
 	gs_program_destroy(program);
 	return NULL;
 }
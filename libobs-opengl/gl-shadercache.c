@@ -0,0 +1,416 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <stdlib.h>
+#include <util/platform.h>
+#include <util/dstr.h>
+#include "gl-subsystem.h"
+
+/*
+ * On-disk cache of linked shader programs.
+ *
+ *   Programs are stored with glGetProgramBinary, keyed by the hashes of the
+ * GLSL sources of their two shaders, in a directory named after the hash of
+ * the driver identity, so a driver update starts with an empty cache.  The
+ * cache also records which shaders compiled successfully with this driver;
+ * those aren't compiled on creation anymore, only when a program using them
+ * isn't found in the cache.
+ */
+
+/* increment if the on-disk format changes */
+#define CACHE_VERSION 1
+#define CACHE_MAGIC 0x50474C4F /* "OLGP" */
+#define CACHE_MAX_BINARY_SIZE (64 * 1024 * 1024)
+#define COMPILED_INDEX "compiled.idx"
+
+struct program_header {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t vertex_hash;
+	uint64_t pixel_hash;
+	uint32_t format;
+	uint32_t size;
+};
+
+uint64_t gl_shader_cache_hash(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (uint64_t)bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static inline uint64_t hash_string(uint64_t hash, const char *str)
+{
+	if (!str)
+		return hash;
+	return gl_shader_cache_hash(hash, str, strlen(str));
+}
+
+static int compare_hash(const void *a, const void *b)
+{
+	uint64_t val_a = *(const uint64_t *)a;
+	uint64_t val_b = *(const uint64_t *)b;
+	return val_a < val_b ? -1 : (val_a > val_b ? 1 : 0);
+}
+
+static void load_compiled_index(struct gl_shader_cache *cache)
+{
+	struct dstr path = {0};
+	uint64_t hash;
+	FILE *file;
+
+	dstr_printf(&path, "%s/%s", cache->path, COMPILED_INDEX);
+	file = os_fopen(path.array, "rb");
+	dstr_free(&path);
+
+	if (!file)
+		return;
+
+	while (fread(&hash, sizeof(hash), 1, file) == 1)
+		da_push_back(cache->compiled, &hash);
+	fclose(file);
+
+	qsort(cache->compiled.array, cache->compiled.num, sizeof(uint64_t),
+	      compare_hash);
+}
+
+static uint64_t driver_hash(void)
+{
+	uint64_t hash = GL_SHADER_CACHE_HASH_INIT;
+	uint32_t version = CACHE_VERSION;
+
+	hash = gl_shader_cache_hash(hash, &version, sizeof(version));
+	hash = hash_string(hash, (const char *)glGetString(GL_VENDOR));
+	hash = hash_string(hash, (const char *)glGetString(GL_RENDERER));
+	hash = hash_string(hash, (const char *)glGetString(GL_VERSION));
+	return hash;
+}
+
+void gl_shader_cache_init(struct gs_device *device)
+{
+	struct gl_shader_cache *cache = &device->shader_cache;
+	GLint formats = 0;
+	struct dstr path = {0};
+	char *base;
+
+	if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary) {
+		blog(LOG_INFO, "Shader cache: Program binaries not supported");
+		return;
+	}
+
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (!gl_success("glGetIntegerv") || formats <= 0) {
+		blog(LOG_INFO, "Shader cache: No program binary formats");
+		return;
+	}
+
+	base = os_get_config_path_ptr("obs-studio/shader-cache/opengl");
+	if (!base)
+		return;
+
+	dstr_printf(&path, "%s/%016llx", base,
+		    (unsigned long long)driver_hash());
+	bfree(base);
+
+	if (os_mkdirs(path.array) == MKDIR_ERROR) {
+		blog(LOG_WARNING, "Shader cache: Failed to create '%s'",
+		     path.array);
+		dstr_free(&path);
+		return;
+	}
+
+	cache->path = path.array;
+	load_compiled_index(cache);
+
+	blog(LOG_INFO, "Shader cache: %zu known shaders in '%s'",
+	     cache->compiled.num, cache->path);
+}
+
+void gl_shader_cache_free(struct gs_device *device)
+{
+	struct gl_shader_cache *cache = &device->shader_cache;
+	struct gs_shader_cache_stats *stats = &cache->stats;
+
+	if (cache->path)
+		blog(LOG_INFO,
+		     "Shader cache: %u programs loaded, %u compiled, "
+		     "%u rejected, %u shader compiles deferred",
+		     stats->program_hits, stats->program_misses,
+		     stats->program_rejected, stats->shaders_deferred);
+
+	da_free(cache->compiled);
+	bfree(cache->path);
+	cache->path = NULL;
+}
+
+bool gl_shader_cache_is_compiled(struct gs_device *device, uint64_t hash)
+{
+	struct gl_shader_cache *cache = &device->shader_cache;
+
+	if (!cache->path || !cache->compiled.num)
+		return false;
+
+	return bsearch(&hash, cache->compiled.array, cache->compiled.num,
+		       sizeof(uint64_t), compare_hash) != NULL;
+}
+
+void gl_shader_cache_add_compiled(struct gs_device *device, uint64_t hash)
+{
+	struct gl_shader_cache *cache = &device->shader_cache;
+	struct dstr path = {0};
+	size_t idx = 0;
+	FILE *file;
+
+	if (!cache->path || gl_shader_cache_is_compiled(device, hash))
+		return;
+
+	while (idx < cache->compiled.num && cache->compiled.array[idx] < hash)
+		idx++;
+	da_insert(cache->compiled, idx, &hash);
+
+	dstr_printf(&path, "%s/%s", cache->path, COMPILED_INDEX);
+	file = os_fopen(path.array, "ab");
+	dstr_free(&path);
+
+	if (file) {
+		fwrite(&hash, sizeof(hash), 1, file);
+		fclose(file);
+	}
+}
+
+static bool write_compiled_index(const char *path,
+				 const struct gl_shader_cache *cache)
+{
+	bool success;
+	FILE *file;
+
+	file = os_fopen(path, "wb");
+	if (!file)
+		return false;
+
+	success = fwrite(cache->compiled.array, sizeof(uint64_t),
+			 cache->compiled.num, file) == cache->compiled.num;
+
+	if (fclose(file) != 0)
+		success = false;
+	return success;
+}
+
+void gl_shader_cache_remove_compiled(struct gs_device *device, uint64_t hash)
+{
+	struct gl_shader_cache *cache = &device->shader_cache;
+	struct dstr path = {0};
+	struct dstr temp_path = {0};
+	uint64_t *entry;
+
+	if (!cache->path || !cache->compiled.num)
+		return;
+
+	entry = bsearch(&hash, cache->compiled.array, cache->compiled.num,
+			sizeof(uint64_t), compare_hash);
+	if (!entry)
+		return;
+
+	da_erase(cache->compiled, entry - cache->compiled.array);
+
+	/* rewritten next to the index and moved in place, like the programs */
+	dstr_printf(&path, "%s/%s", cache->path, COMPILED_INDEX);
+	dstr_printf(&temp_path, "%s.tmp", path.array);
+
+	if (!write_compiled_index(temp_path.array, cache) ||
+	    os_safe_replace(path.array, temp_path.array, NULL) != 0) {
+		blog(LOG_WARNING, "Shader cache: Failed to write '%s'",
+		     path.array);
+		os_unlink(temp_path.array);
+	}
+
+	dstr_free(&temp_path);
+	dstr_free(&path);
+}
+
+static inline void get_program_path(struct dstr *path,
+				    struct gs_program *program)
+{
+	dstr_printf(path, "%s/%016llx%016llx.bin",
+		    program->device->shader_cache.path,
+		    (unsigned long long)program->vertex_shader->hash,
+		    (unsigned long long)program->pixel_shader->hash);
+}
+
+void gl_shader_cache_prepare_program(struct gs_program *program)
+{
+	if (!program->device->shader_cache.path)
+		return;
+
+	glProgramParameteri(program->obj, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+			    GL_TRUE);
+	gl_success("glProgramParameteri");
+}
+
+static bool read_program(FILE *file, struct gs_program *program,
+			 struct program_header *header, uint8_t **binary)
+{
+	uint64_t checksum;
+
+	if (fread(header, sizeof(*header), 1, file) != 1)
+		return false;
+
+	if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION ||
+	    header->vertex_hash != program->vertex_shader->hash ||
+	    header->pixel_hash != program->pixel_shader->hash ||
+	    !header->size || header->size > CACHE_MAX_BINARY_SIZE)
+		return false;
+
+	*binary = bmalloc(header->size);
+	if (fread(*binary, header->size, 1, file) != 1)
+		return false;
+	if (fread(&checksum, sizeof(checksum), 1, file) != 1)
+		return false;
+
+	return checksum == gl_shader_cache_hash(GL_SHADER_CACHE_HASH_INIT,
+						*binary, header->size);
+}
+
+bool gl_shader_cache_load_program(struct gs_program *program)
+{
+	struct gl_shader_cache *cache = &program->device->shader_cache;
+	struct program_header header;
+	struct dstr path = {0};
+	uint8_t *binary = NULL;
+	GLint linked = GL_FALSE;
+	bool success;
+	FILE *file;
+
+	if (!cache->path)
+		return false;
+
+	get_program_path(&path, program);
+
+	file = os_fopen(path.array, "rb");
+	if (!file) {
+		dstr_free(&path);
+		return false;
+	}
+
+	success = read_program(file, program, &header, &binary);
+	fclose(file);
+
+	if (success) {
+		glProgramBinary(program->obj, header.format, binary,
+				header.size);
+		success = gl_success("glProgramBinary");
+	}
+	if (success) {
+		glGetProgramiv(program->obj, GL_LINK_STATUS, &linked);
+		success = gl_success("glGetProgramiv") && linked != GL_FALSE;
+	}
+
+	if (success) {
+		cache->stats.program_hits++;
+	} else {
+		/* corrupt, or no longer accepted by the driver */
+		blog(LOG_DEBUG, "Shader cache: Rejected '%s'", path.array);
+		cache->stats.program_rejected++;
+		os_unlink(path.array);
+	}
+
+	bfree(binary);
+	dstr_free(&path);
+	return success;
+}
+
+static bool write_program(const char *path, const struct program_header *header,
+			  const uint8_t *binary)
+{
+	uint64_t checksum = gl_shader_cache_hash(GL_SHADER_CACHE_HASH_INIT,
+						 binary, header->size);
+	bool success;
+	FILE *file;
+
+	file = os_fopen(path, "wb");
+	if (!file)
+		return false;
+
+	success = fwrite(header, sizeof(*header), 1, file) == 1 &&
+		  fwrite(binary, header->size, 1, file) == 1 &&
+		  fwrite(&checksum, sizeof(checksum), 1, file) == 1;
+
+	if (fclose(file) != 0)
+		success = false;
+	return success;
+}
+
+void gl_shader_cache_save_program(struct gs_program *program)
+{
+	struct gl_shader_cache *cache = &program->device->shader_cache;
+	struct program_header header = {0};
+	struct dstr path = {0};
+	struct dstr temp_path = {0};
+	GLint size = 0;
+	GLsizei written = 0;
+	GLenum format = 0;
+	uint8_t *binary;
+
+	if (!cache->path)
+		return;
+
+	glGetProgramiv(program->obj, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (!gl_success("glGetProgramiv") || size <= 0 ||
+	    size > CACHE_MAX_BINARY_SIZE)
+		return;
+
+	binary = bmalloc(size);
+	glGetProgramBinary(program->obj, size, &written, &format, binary);
+	if (!gl_success("glGetProgramBinary") || written <= 0)
+		goto free;
+
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.vertex_hash = program->vertex_shader->hash;
+	header.pixel_hash = program->pixel_shader->hash;
+	header.format = format;
+	header.size = (uint32_t)written;
+
+	/* written next to the entry and moved in place, so that concurrent
+	 * readers never see a partial file */
+	get_program_path(&path, program);
+	dstr_printf(&temp_path, "%s.tmp", path.array);
+
+	if (!write_program(temp_path.array, &header, binary) ||
+	    os_safe_replace(path.array, temp_path.array, NULL) != 0) {
+		blog(LOG_WARNING, "Shader cache: Failed to write '%s'",
+		     path.array);
+		os_unlink(temp_path.array);
+	}
+
+	dstr_free(&temp_path);
+	dstr_free(&path);
+free:
+	bfree(binary);
+}
+
+bool device_get_shader_cache_stats(gs_device_t *device,
+				   struct gs_shader_cache_stats *stats)
+{
+	*stats = device->shader_cache.stats;
+	return device->shader_cache.path != NULL;
+}
@@ -254,6 +254,8 @@ int device_create(gs_device_t **p_device, uint32_t adapter)
 	     "language %s",
 	     glVersion, glShadingLanguage);
 
+	gl_shader_cache_init(device);
+
 	gl_enable(GL_CULL_FACE);
 	gl_gen_vertex_arrays(1, &device->empty_vao);
 
@@ -295,6 +297,8 @@ void device_destroy(gs_device_t *device)
 		while (device->first_program)
 			gs_program_destroy(device->first_program);
 
+		gl_shader_cache_free(device);
+
 		samplerstate_release(device->raw_load_sampler);
 		gl_delete_vertex_arrays(1, &device->empty_vao);
 
@@ -1074,13 +1078,14 @@ static void update_viewproj_matrix(struct gs_device *device)
 		gs_shader_set_matrix4(vs->viewproj, &device->cur_viewproj);
 }
 
-static inline struct gs_program *find_program(const struct gs_device *device)
+static inline struct gs_program *find_program(const struct gs_device *device,
+					     const struct gs_shader *vs,
+					     const struct gs_shader *ps)
 {
 	struct gs_program *program = device->first_program;
 
 	while (program) {
-		if (program->vertex_shader == device->cur_vertex_shader &&
-		    program->pixel_shader == device->cur_pixel_shader)
+		if (program->vertex_shader == vs && program->pixel_shader == ps)
 			return program;
 
 		program = program->next;
@@ -1089,16 +1094,33 @@ static inline struct gs_program *find_program(const struct gs_device *device)
 	return NULL;
 }
 
-static inline struct gs_program *get_shader_program(struct gs_device *device)
+static inline struct gs_program *get_program(struct gs_device *device,
+					    struct gs_shader *vs,
+					    struct gs_shader *ps)
 {
-	struct gs_program *program = find_program(device);
+	struct gs_program *program = find_program(device, vs, ps);
 
 	if (!program)
-		program = gs_program_create(device);
+		program = gs_program_create(device, vs, ps);
 
 	return program;
 }
 
+static inline struct gs_program *get_shader_program(struct gs_device *device)
+{
+	return get_program(device, device->cur_vertex_shader,
+			   device->cur_pixel_shader);
+}
+
+bool device_shader_prewarm(gs_device_t *device, gs_shader_t *vertshader,
+			   gs_shader_t *pixelshader)
+{
+	if (!vertshader || !pixelshader)
+		return false;
+
+	return get_program(device, vertshader, pixelshader) != NULL;
+}
+
 void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
 		 uint32_t start_vert, uint32_t num_verts)
 {
@@ -487,6 +487,12 @@ struct gs_shader {
 	DARRAY(struct shader_attrib) attribs;
 	DARRAY(struct gs_shader_param) params;
 	DARRAY(gs_samplerstate_t *) samplers;
+
+	/* hash of the GLSL source, if the compile was deferred the source is
+	 * kept until it is attempted */
+	uint64_t hash;
+	char *source;
+	char *file;
 };
 
 struct program_param {
@@ -507,10 +513,38 @@ struct gs_program {
 	struct gs_program *next;
 };
 
-extern struct gs_program *gs_program_create(struct gs_device *device);
+extern struct gs_program *gs_program_create(struct gs_device *device,
+					    struct gs_shader *vertex_shader,
+					    struct gs_shader *pixel_shader);
 extern void gs_program_destroy(struct gs_program *program);
 extern void program_update_params(struct gs_program *shader);
 
+#define GL_SHADER_CACHE_HASH_INIT 14695981039346656037ULL
+
+struct gl_shader_cache {
+	/* NULL if program binaries can't be cached */
+	char *path;
+
+	/* sorted hashes of the shaders known to compile */
+	DARRAY(uint64_t) compiled;
+
+	struct gs_shader_cache_stats stats;
+};
+
+extern void gl_shader_cache_init(struct gs_device *device);
+extern void gl_shader_cache_free(struct gs_device *device);
+extern uint64_t gl_shader_cache_hash(uint64_t hash, const void *data,
+				     size_t size);
+extern bool gl_shader_cache_is_compiled(struct gs_device *device,
+					uint64_t hash);
+extern void gl_shader_cache_add_compiled(struct gs_device *device,
+					 uint64_t hash);
+extern void gl_shader_cache_remove_compiled(struct gs_device *device,
+					    uint64_t hash);
+extern void gl_shader_cache_prepare_program(struct gs_program *program);
+extern bool gl_shader_cache_load_program(struct gs_program *program);
+extern void gl_shader_cache_save_program(struct gs_program *program);
+
 struct gs_vertex_buffer {
 	GLuint vao;
 	GLuint vertex_buffer;
@@ -656,6 +690,7 @@ struct gs_device {
 	enum gs_color_space cur_color_space;
 
 	struct gs_program *first_program;
+	struct gl_shader_cache shader_cache;
 
 	enum gs_cull_mode cur_cull_mode;
 	struct gs_rect cur_viewport;
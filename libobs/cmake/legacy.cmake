@@ -148,6 +148,8 @@ target_sources(
   libobs
   PRIVATE media-io/audio-io.c
           media-io/audio-io.h
+          media-io/audio-kernels.c
+          media-io/audio-kernels.h
           media-io/audio-math.h
           media-io/audio-resampler.h
           media-io/audio-resampler-ffmpeg.c
@@ -156,6 +158,8 @@ target_sources(
           media-io/frame-rate.h
           media-io/media-remux.c
           media-io/media-remux.h
+          media-io/mp4-recover.c
+          media-io/mp4-recover.h
           media-io/video-fourcc.c
           media-io/video-frame.c
           media-io/video-frame.h
@@ -193,6 +197,7 @@ target_sources(
           util/file-serializer.h
           util/lexer.c
           util/lexer.h
+          util/merge-queue.h
           util/platform.c
           util/platform.h
           util/profiler.c
@@ -206,6 +211,8 @@ target_sources(
           util/task.h
           util/text-lookup.c
           util/text-lookup.h
+          util/thread-pool.c
+          util/thread-pool.h
           util/threading.h
           util/utf8.c
           util/utf8.h
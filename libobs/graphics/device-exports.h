@@ -182,6 +182,10 @@ EXPORT bool device_is_monitor_hdr(gs_device_t *device, void *monitor);
 EXPORT bool device_shared_texture_available(void);
 EXPORT bool device_nv12_available(gs_device_t *device);
 EXPORT bool device_p010_available(gs_device_t *device);
+EXPORT bool device_shader_prewarm(gs_device_t *device, gs_shader_t *vertshader,
+				  gs_shader_t *pixelshader);
+EXPORT bool device_get_shader_cache_stats(gs_device_t *device,
+					  struct gs_shader_cache_stats *stats);
 
 #ifdef __APPLE__
 EXPORT gs_texture_t *device_texture_create_from_iosurface(gs_device_t *device,
@@ -274,6 +274,11 @@ struct gs_exports {
 
 	bool (*device_nv12_available)(gs_device_t *device);
 	bool (*device_p010_available)(gs_device_t *device);
+	bool (*device_shader_prewarm)(gs_device_t *device,
+				      gs_shader_t *vertshader,
+				      gs_shader_t *pixelshader);
+	bool (*device_get_shader_cache_stats)(
+		gs_device_t *device, struct gs_shader_cache_stats *stats);
 	bool (*device_texture_create_nv12)(gs_device_t *device,
 					   gs_texture_t **tex_y,
 					   gs_texture_t **tex_uv,
@@ -870,6 +870,34 @@ gs_effect_t *gs_effect_create(const char *effect_string, const char *filename,
 	return effect;
 }
 
+bool gs_effect_prewarm(gs_effect_t *effect)
+{
+	graphics_t *graphics = thread_graphics;
+	bool success = true;
+
+	if (!gs_valid_p("gs_effect_prewarm", effect))
+		return false;
+
+	/* renderers without one have nothing to prepare ahead of time */
+	if (!graphics->exports.device_shader_prewarm)
+		return true;
+
+	for (size_t i = 0; i < effect->techniques.num; i++) {
+		struct gs_effect_technique *tech = effect->techniques.array + i;
+
+		for (size_t j = 0; j < tech->passes.num; j++) {
+			struct gs_effect_pass *pass = tech->passes.array + j;
+
+			if (!graphics->exports.device_shader_prewarm(
+				    graphics->device, pass->vertshader,
+				    pass->pixelshader))
+				success = false;
+		}
+	}
+
+	return success;
+}
+
 gs_shader_t *gs_vertexshader_create_from_file(const char *file,
 					      char **error_string)
 {
@@ -2870,6 +2898,18 @@ bool gs_is_monitor_hdr(void *monitor)
 		thread_graphics->device, monitor);
 }
 
+bool gs_get_shader_cache_stats(struct gs_shader_cache_stats *stats)
+{
+	if (!gs_valid_p("gs_get_shader_cache_stats", stats))
+		return false;
+
+	if (!thread_graphics->exports.device_get_shader_cache_stats)
+		return false;
+
+	return thread_graphics->exports.device_get_shader_cache_stats(
+		thread_graphics->device, stats);
+}
+
 void gs_debug_marker_begin(const float color[4], const char *markername)
 {
 	if (!gs_valid("gs_debug_marker_begin"))
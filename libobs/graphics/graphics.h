@@ -576,6 +576,13 @@ EXPORT gs_effect_t *gs_effect_create_from_file(const char *file,
 EXPORT gs_effect_t *gs_effect_create(const char *effect_string,
 				     const char *filename, char **error_string);
 
+/**
+ * Prepares the shader programs of all passes of an effect ahead of their
+ * first use, which also stores them in the shader cache where the renderer
+ * has one.
+ */
+EXPORT bool gs_effect_prewarm(gs_effect_t *effect);
+
 EXPORT gs_shader_t *gs_vertexshader_create_from_file(const char *file,
 						     char **error_string);
 EXPORT gs_shader_t *gs_pixelshader_create_from_file(const char *file,
@@ -867,6 +874,19 @@ EXPORT bool gs_texture_create_p010(gs_texture_t **tex_y, gs_texture_t **tex_uv,
 
 EXPORT bool gs_is_monitor_hdr(void *monitor);
 
+struct gs_shader_cache_stats {
+	/* shader programs loaded from the cache */
+	uint32_t program_hits;
+	/* shader programs compiled and linked, then added to the cache */
+	uint32_t program_misses;
+	/* cache entries that could not be used, e.g. after a driver update */
+	uint32_t program_rejected;
+	/* shaders not compiled on creation, as they are known to compile */
+	uint32_t shaders_deferred;
+};
+
+EXPORT bool gs_get_shader_cache_stats(struct gs_shader_cache_stats *stats);
+
 #define GS_USE_DEBUG_MARKERS 0
 #if GS_USE_DEBUG_MARKERS
 static const float GS_DEBUG_COLOR_DEFAULT[] = {0.5f, 0.5f, 0.5f, 1.0f};
@@ -0,0 +1,290 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "audio-kernels.h"
+
+/* x86 gets the SSE and AVX intrinsics natively, everything else gets the SSE
+ * ones through simde; including both collides on the simde native aliases */
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+     defined(_M_IX86)) &&                                            \
+	!defined(_M_ARM64EC)
+#define AUDIO_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX_TARGET
+#else
+#define AVX_TARGET __attribute__((target("avx")))
+#endif
+#else
+#include "../util/sse-intrin.h"
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* scalar reference                                                          */
+
+static void accumulate_scalar(float *dst, const float *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i];
+}
+
+static void scale_scalar(float *data, float vol, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] *= vol;
+}
+
+static void scale_ramp_scalar(float *data, const float *vol, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		data[i] *= vol[i];
+}
+
+static void clamp_scalar(float *data, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		float val = data[i];
+		val = (val == val) ? val : 0.0f;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		data[i] = val;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* SSE2 (simde maps these to NEON on ARM)                                    */
+
+static void accumulate_sse2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_loadu_ps(dst + i);
+		__m128 a1 = _mm_loadu_ps(dst + i + 4);
+		__m128 b0 = _mm_loadu_ps(src + i);
+		__m128 b1 = _mm_loadu_ps(src + i + 4);
+		_mm_storeu_ps(dst + i, _mm_add_ps(a0, b0));
+		_mm_storeu_ps(dst + i + 4, _mm_add_ps(a1, b1));
+	}
+
+	accumulate_scalar(dst + i, src + i, count - i);
+}
+
+static void scale_sse2(float *data, float vol, size_t count)
+{
+	const __m128 v = _mm_set1_ps(vol);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_loadu_ps(data + i);
+		__m128 a1 = _mm_loadu_ps(data + i + 4);
+		_mm_storeu_ps(data + i, _mm_mul_ps(a0, v));
+		_mm_storeu_ps(data + i + 4, _mm_mul_ps(a1, v));
+	}
+
+	scale_scalar(data + i, vol, count - i);
+}
+
+static void scale_ramp_sse2(float *data, const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_loadu_ps(data + i);
+		__m128 a1 = _mm_loadu_ps(data + i + 4);
+		__m128 v0 = _mm_loadu_ps(vol + i);
+		__m128 v1 = _mm_loadu_ps(vol + i + 4);
+		_mm_storeu_ps(data + i, _mm_mul_ps(a0, v0));
+		_mm_storeu_ps(data + i + 4, _mm_mul_ps(a1, v1));
+	}
+
+	scale_ramp_scalar(data + i, vol + i, count - i);
+}
+
+static void clamp_sse2(float *data, size_t count)
+{
+	const __m128 max_val = _mm_set1_ps(1.0f);
+	const __m128 min_val = _mm_set1_ps(-1.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(data + i);
+		/* zero NaNs first so min/max operand order doesn't matter */
+		val = _mm_and_ps(val, _mm_cmpord_ps(val, val));
+		val = _mm_min_ps(val, max_val);
+		val = _mm_max_ps(val, min_val);
+		_mm_storeu_ps(data + i, val);
+	}
+
+	clamp_scalar(data + i, count - i);
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVX (only float ops are used, so AVX2 is not required)                    */
+
+#ifdef AUDIO_KERNELS_X86
+AVX_TARGET
+static void accumulate_avx(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256 a0 = _mm256_loadu_ps(dst + i);
+		__m256 a1 = _mm256_loadu_ps(dst + i + 8);
+		__m256 b0 = _mm256_loadu_ps(src + i);
+		__m256 b1 = _mm256_loadu_ps(src + i + 8);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(a0, b0));
+		_mm256_storeu_ps(dst + i + 8, _mm256_add_ps(a1, b1));
+	}
+
+	accumulate_scalar(dst + i, src + i, count - i);
+}
+
+AVX_TARGET
+static void scale_avx(float *data, float vol, size_t count)
+{
+	const __m256 v = _mm256_set1_ps(vol);
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256 a0 = _mm256_loadu_ps(data + i);
+		__m256 a1 = _mm256_loadu_ps(data + i + 8);
+		_mm256_storeu_ps(data + i, _mm256_mul_ps(a0, v));
+		_mm256_storeu_ps(data + i + 8, _mm256_mul_ps(a1, v));
+	}
+
+	scale_scalar(data + i, vol, count - i);
+}
+
+AVX_TARGET
+static void scale_ramp_avx(float *data, const float *vol, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		__m256 a0 = _mm256_loadu_ps(data + i);
+		__m256 a1 = _mm256_loadu_ps(data + i + 8);
+		__m256 v0 = _mm256_loadu_ps(vol + i);
+		__m256 v1 = _mm256_loadu_ps(vol + i + 8);
+		_mm256_storeu_ps(data + i, _mm256_mul_ps(a0, v0));
+		_mm256_storeu_ps(data + i + 8, _mm256_mul_ps(a1, v1));
+	}
+
+	scale_ramp_scalar(data + i, vol + i, count - i);
+}
+
+AVX_TARGET
+static void clamp_avx(float *data, size_t count)
+{
+	const __m256 max_val = _mm256_set1_ps(1.0f);
+	const __m256 min_val = _mm256_set1_ps(-1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(data + i);
+		val = _mm256_and_ps(val, _mm256_cmp_ps(val, val, _CMP_ORD_Q));
+		val = _mm256_min_ps(val, max_val);
+		val = _mm256_max_ps(val, min_val);
+		_mm256_storeu_ps(data + i, val);
+	}
+
+	clamp_scalar(data + i, count - i);
+}
+
+static bool cpu_has_avx(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 1);
+
+	/* AVX support plus OS support for saving the YMM registers */
+	const int osxsave_avx = (1 << 27) | (1 << 28);
+	if ((info[2] & osxsave_avx) != osxsave_avx)
+		return false;
+
+	return (_xgetbv(0) & 0x6) == 0x6;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static const struct audio_kernels kernels_scalar = {
+	.type = AUDIO_KERNEL_SCALAR,
+	.name = "scalar",
+	.accumulate = accumulate_scalar,
+	.scale = scale_scalar,
+	.scale_ramp = scale_ramp_scalar,
+	.clamp = clamp_scalar,
+};
+
+static const struct audio_kernels kernels_sse2 = {
+	.type = AUDIO_KERNEL_SSE2,
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+	.name = "neon",
+#else
+	.name = "sse2",
+#endif
+	.accumulate = accumulate_sse2,
+	.scale = scale_sse2,
+	.scale_ramp = scale_ramp_sse2,
+	.clamp = clamp_sse2,
+};
+
+#ifdef AUDIO_KERNELS_X86
+static const struct audio_kernels kernels_avx = {
+	.type = AUDIO_KERNEL_AVX,
+	.name = "avx",
+	.accumulate = accumulate_avx,
+	.scale = scale_avx,
+	.scale_ramp = scale_ramp_avx,
+	.clamp = clamp_avx,
+};
+#endif
+
+const struct audio_kernels *audio_kernels_get(enum audio_kernel_type type)
+{
+	switch (type) {
+	case AUDIO_KERNEL_SCALAR:
+		return &kernels_scalar;
+	case AUDIO_KERNEL_SSE2:
+		return &kernels_sse2;
+	case AUDIO_KERNEL_AVX:
+#ifdef AUDIO_KERNELS_X86
+		return cpu_has_avx() ? &kernels_avx : NULL;
+#else
+		return NULL;
+#endif
+	}
+
+	return NULL;
+}
+
+const struct audio_kernels *audio_kernels_get_best(void)
+{
+	const struct audio_kernels *kernels;
+
+	kernels = audio_kernels_get(AUDIO_KERNEL_AVX);
+	if (!kernels)
+		kernels = audio_kernels_get(AUDIO_KERNEL_SSE2);
+	return kernels;
+}
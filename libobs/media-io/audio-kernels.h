@@ -0,0 +1,64 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Float sample kernels used by the audio mixer.  Each implementation works
+ * on unaligned buffers of any length; the vector paths fall back to scalar
+ * code for the remaining tail samples.
+ */
+
+enum audio_kernel_type {
+	AUDIO_KERNEL_SCALAR,
+	AUDIO_KERNEL_SSE2, /* NEON on ARM, via simde */
+	AUDIO_KERNEL_AVX,
+};
+
+struct audio_kernels {
+	enum audio_kernel_type type;
+	const char *name;
+
+	/* dst[i] += src[i] */
+	void (*accumulate)(float *dst, const float *src, size_t count);
+	/* data[i] *= vol */
+	void (*scale)(float *data, float vol, size_t count);
+	/* data[i] *= vol[i] */
+	void (*scale_ramp)(float *data, const float *vol, size_t count);
+	/* NaN becomes 0.0, everything else is clamped to -1.0..1.0 */
+	void (*clamp)(float *data, size_t count);
+};
+
+/**
+ * Returns the kernel set of the specified type, or NULL if it was not
+ * compiled in or is not supported by the running CPU.
+ */
+EXPORT const struct audio_kernels *
+audio_kernels_get(enum audio_kernel_type type);
+
+/** Returns the fastest kernel set supported by the running CPU */
+EXPORT const struct audio_kernels *audio_kernels_get_best(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,1234 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "mp4-recover.h"
+
+#include "../util/base.h"
+#include "../util/bmem.h"
+#include "../util/darray.h"
+#include "../util/platform.h"
+#include "../util/array-serializer.h"
+#include "../util/util_uint64.h"
+
+#include <inttypes.h>
+
+#define do_log(level, format, ...) \
+	blog(level, "mp4_recover: " format, ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define BOX(a, b, c, d)                                                  \
+	((uint32_t)(a) << 24 | (uint32_t)(b) << 16 | (uint32_t)(c) << 8 | \
+	 (uint32_t)(d))
+
+/* moov and moof boxes are small, anything larger is not a valid file */
+#define MAX_INDEX_BOX_SIZE (64 * 1024 * 1024)
+
+/* trun flags */
+#define TRUN_DATA_OFFSET 0x1
+#define TRUN_FIRST_SAMPLE_FLAGS 0x4
+#define TRUN_SAMPLE_DURATION 0x100
+#define TRUN_SAMPLE_SIZE 0x200
+#define TRUN_SAMPLE_FLAGS 0x400
+#define TRUN_SAMPLE_CTS 0x800
+
+/* tfhd flags */
+#define TFHD_BASE_DATA_OFFSET 0x1
+#define TFHD_SAMPLE_DESC 0x2
+#define TFHD_SAMPLE_DURATION 0x8
+#define TFHD_SAMPLE_SIZE 0x10
+#define TFHD_SAMPLE_FLAGS 0x20
+#define TFHD_DEFAULT_BASE_IS_MOOF 0x20000
+
+#define SAMPLE_IS_NON_SYNC 0x10000
+
+struct mp4_sample {
+	uint32_t duration;
+	uint32_t size;
+	int32_t cts;
+	bool sync;
+};
+
+struct mp4_chunk {
+	uint64_t offset;
+	uint32_t samples;
+	uint32_t desc;
+};
+
+struct mp4_track {
+	uint32_t id;
+	uint32_t timescale;
+
+	/* defaults from the trex box */
+	uint32_t def_desc;
+	uint32_t def_duration;
+	uint32_t def_size;
+	uint32_t def_flags;
+
+	DARRAY(struct mp4_sample) samples;
+	DARRAY(struct mp4_chunk) chunks;
+
+	/* samples of the current fragment are only kept once its data has
+	 * been found to be complete */
+	size_t committed_samples;
+	size_t committed_chunks;
+	uint64_t duration;
+	uint64_t pending_gap;
+};
+
+struct mp4_file {
+	FILE *file;
+	int64_t size;
+
+	uint8_t *moov;
+	size_t moov_size;
+	int64_t moov_offset;
+	uint32_t movie_timescale;
+
+	DARRAY(struct mp4_track) tracks;
+
+	/* fragment boxes to turn into free space */
+	DARRAY(int64_t) fragments;
+	int64_t moof_offset;
+	uint64_t data_end;
+	size_t num_fragments;
+
+	/* end of the last box that is kept */
+	int64_t end;
+};
+
+/* ------------------------------------------------------------------------- */
+
+static inline uint32_t rb32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+	       (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static inline uint64_t rb64(const uint8_t *p)
+{
+	return (uint64_t)rb32(p) << 32 | rb32(p + 4);
+}
+
+static inline void wb32(uint8_t *p, uint32_t val)
+{
+	p[0] = (uint8_t)(val >> 24);
+	p[1] = (uint8_t)(val >> 16);
+	p[2] = (uint8_t)(val >> 8);
+	p[3] = (uint8_t)val;
+}
+
+static inline void wb64(uint8_t *p, uint64_t val)
+{
+	wb32(p, (uint32_t)(val >> 32));
+	wb32(p + 4, (uint32_t)val);
+}
+
+struct mp4_box {
+	uint32_t type;
+	/* the whole box, including the header */
+	const uint8_t *start;
+	size_t total;
+	/* the contents */
+	const uint8_t *data;
+	size_t size;
+};
+
+/* reads the next child box from a buffer */
+static bool next_box(const uint8_t **pos, const uint8_t *end,
+		     struct mp4_box *box)
+{
+	const uint8_t *p = *pos;
+	size_t avail = (size_t)(end - p);
+	size_t header = 8;
+	uint64_t size;
+
+	if (avail < 8)
+		return false;
+
+	size = rb32(p);
+	box->type = rb32(p + 4);
+
+	if (size == 1) {
+		if (avail < 16)
+			return false;
+		size = rb64(p + 8);
+		header = 16;
+	} else if (size == 0) {
+		size = avail;
+	}
+
+	if (size < header || size > avail)
+		return false;
+
+	box->start = p;
+	box->total = (size_t)size;
+	box->data = p + header;
+	box->size = (size_t)size - header;
+	*pos = p + size;
+	return true;
+}
+
+/* fields of full boxes that have a 32-bit and a 64-bit version */
+static inline bool read_versioned(const uint8_t **p, const uint8_t *end,
+				  uint8_t version, uint64_t *val)
+{
+	size_t size = version == 1 ? 8 : 4;
+	if ((size_t)(end - *p) < size)
+		return false;
+
+	*val = version == 1 ? rb64(*p) : rb32(*p);
+	*p += size;
+	return true;
+}
+
+static inline bool read32(const uint8_t **p, const uint8_t *end,
+			  uint32_t *val)
+{
+	if (end - *p < 4)
+		return false;
+
+	*val = rb32(*p);
+	*p += 4;
+	return true;
+}
+
+static inline bool read64(const uint8_t **p, const uint8_t *end,
+			  uint64_t *val)
+{
+	if (end - *p < 8)
+		return false;
+
+	*val = rb64(*p);
+	*p += 8;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* moov parsing                                                              */
+
+static struct mp4_track *find_track(struct mp4_file *mp4, uint32_t id)
+{
+	for (size_t i = 0; i < mp4->tracks.num; i++) {
+		if (mp4->tracks.array[i].id == id)
+			return &mp4->tracks.array[i];
+	}
+
+	return NULL;
+}
+
+/* returns the timescale of an mvhd or mdhd box */
+static uint32_t get_timescale(const struct mp4_box *box)
+{
+	size_t offset = box->size && box->data[0] == 1 ? 20 : 12;
+	if (box->size < offset + 4)
+		return 0;
+
+	return rb32(box->data + offset);
+}
+
+static uint32_t get_track_id(const struct mp4_box *tkhd)
+{
+	size_t offset = tkhd->size && tkhd->data[0] == 1 ? 20 : 12;
+	if (tkhd->size < offset + 4)
+		return 0;
+
+	return rb32(tkhd->data + offset);
+}
+
+static bool parse_trak(struct mp4_file *mp4, const struct mp4_box *trak)
+{
+	const uint8_t *pos = trak->data;
+	const uint8_t *end = trak->data + trak->size;
+	struct mp4_track *track = da_push_back_new(mp4->tracks);
+	struct mp4_box box;
+
+	while (next_box(&pos, end, &box)) {
+		if (box.type == BOX('t', 'k', 'h', 'd')) {
+			track->id = get_track_id(&box);
+
+		} else if (box.type == BOX('m', 'd', 'i', 'a')) {
+			const uint8_t *mdia = box.data;
+			const uint8_t *mdia_end = box.data + box.size;
+			struct mp4_box child;
+
+			while (next_box(&mdia, mdia_end, &child)) {
+				if (child.type == BOX('m', 'd', 'h', 'd'))
+					track->timescale =
+						get_timescale(&child);
+			}
+		}
+	}
+
+	return track->id && track->timescale;
+}
+
+static bool parse_trex(struct mp4_file *mp4, const struct mp4_box *trex)
+{
+	const uint8_t *p = trex->data + 4;
+	const uint8_t *end = trex->data + trex->size;
+	struct mp4_track *track;
+	uint32_t id;
+
+	if (trex->size < 4 || !read32(&p, end, &id))
+		return false;
+
+	track = find_track(mp4, id);
+	if (!track)
+		return false;
+
+	return read32(&p, end, &track->def_desc) &&
+	       read32(&p, end, &track->def_duration) &&
+	       read32(&p, end, &track->def_size) &&
+	       read32(&p, end, &track->def_flags);
+}
+
+static bool parse_moov(struct mp4_file *mp4)
+{
+	const uint8_t *pos = mp4->moov;
+	const uint8_t *end = mp4->moov + mp4->moov_size;
+	const uint8_t *mvex = NULL;
+	size_t mvex_size = 0;
+	struct mp4_box box;
+
+	while (next_box(&pos, end, &box)) {
+		if (box.type == BOX('m', 'v', 'h', 'd')) {
+			mp4->movie_timescale = get_timescale(&box);
+
+		} else if (box.type == BOX('t', 'r', 'a', 'k')) {
+			if (!parse_trak(mp4, &box)) {
+				warn("Invalid track");
+				return false;
+			}
+
+		} else if (box.type == BOX('m', 'v', 'e', 'x')) {
+			mvex = box.data;
+			mvex_size = box.size;
+		}
+	}
+
+	if (!mvex) {
+		warn("File is not fragmented");
+		return false;
+	}
+	if (!mp4->movie_timescale || !mp4->tracks.num) {
+		warn("Invalid movie header");
+		return false;
+	}
+
+	/* tracks come first, so the defaults can be assigned to them */
+	pos = mvex;
+	end = mvex + mvex_size;
+
+	while (next_box(&pos, end, &box)) {
+		if (box.type == BOX('t', 'r', 'e', 'x') &&
+		    !parse_trex(mp4, &box)) {
+			warn("Invalid track defaults");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* moof parsing                                                              */
+
+struct traf_state {
+	struct mp4_track *track;
+	uint64_t base;
+	uint32_t desc;
+	uint32_t duration;
+	uint32_t size;
+	uint32_t flags;
+};
+
+static bool parse_trun(struct mp4_file *mp4, struct traf_state *traf,
+		       const struct mp4_box *box, uint64_t *next_data)
+{
+	struct mp4_track *track = traf->track;
+	const uint8_t *p = box->data + 4;
+	const uint8_t *end = box->data + box->size;
+	struct mp4_chunk chunk = {.desc = traf->desc};
+	uint32_t first_flags = 0;
+	uint32_t vflags;
+	uint32_t count;
+	uint64_t data_size = 0;
+
+	if (box->size < 4)
+		return false;
+
+	vflags = rb32(box->data);
+	if (!read32(&p, end, &count))
+		return false;
+
+	chunk.offset = *next_data;
+	if (vflags & TRUN_DATA_OFFSET) {
+		uint32_t offset;
+		if (!read32(&p, end, &offset))
+			return false;
+		chunk.offset = traf->base + (int64_t)(int32_t)offset;
+	}
+
+	if ((vflags & TRUN_FIRST_SAMPLE_FLAGS) &&
+	    !read32(&p, end, &first_flags))
+		return false;
+
+	for (uint32_t i = 0; i < count; i++) {
+		struct mp4_sample sample;
+		uint32_t flags = traf->flags;
+		uint32_t cts = 0;
+
+		sample.duration = traf->duration;
+		sample.size = traf->size;
+
+		if ((vflags & TRUN_SAMPLE_DURATION) &&
+		    !read32(&p, end, &sample.duration))
+			return false;
+		if ((vflags & TRUN_SAMPLE_SIZE) &&
+		    !read32(&p, end, &sample.size))
+			return false;
+		if ((vflags & TRUN_SAMPLE_FLAGS) && !read32(&p, end, &flags))
+			return false;
+		if ((vflags & TRUN_SAMPLE_CTS) && !read32(&p, end, &cts))
+			return false;
+
+		if (i == 0 && (vflags & TRUN_FIRST_SAMPLE_FLAGS))
+			flags = first_flags;
+
+		sample.cts = (int32_t)cts;
+		sample.sync = (flags & SAMPLE_IS_NON_SYNC) == 0;
+		data_size += sample.size;
+
+		da_push_back(track->samples, &sample);
+		track->duration += sample.duration;
+	}
+
+	chunk.samples = count;
+	if (count)
+		da_push_back(track->chunks, &chunk);
+
+	*next_data = chunk.offset + data_size;
+	if (*next_data > mp4->data_end)
+		mp4->data_end = *next_data;
+	return true;
+}
+
+static bool parse_traf(struct mp4_file *mp4, const struct mp4_box *traf_box,
+		       uint64_t *next_data)
+{
+	const uint8_t *pos = traf_box->data;
+	const uint8_t *end = traf_box->data + traf_box->size;
+	struct traf_state traf = {0};
+	struct mp4_box box;
+
+	/* tfhd is always the first box */
+	if (!next_box(&pos, end, &box) || box.type != BOX('t', 'f', 'h', 'd') ||
+	    box.size < 8)
+		return false;
+
+	const uint8_t *p = box.data + 4;
+	const uint8_t *tfhd_end = box.data + box.size;
+	uint32_t flags = rb32(box.data) & 0xFFFFFF;
+	uint32_t id;
+
+	if (!read32(&p, tfhd_end, &id))
+		return false;
+
+	traf.track = find_track(mp4, id);
+	if (!traf.track)
+		return false;
+
+	traf.desc = traf.track->def_desc;
+	traf.duration = traf.track->def_duration;
+	traf.size = traf.track->def_size;
+	traf.flags = traf.track->def_flags;
+
+	if (flags & TFHD_BASE_DATA_OFFSET) {
+		if (!read64(&p, tfhd_end, &traf.base))
+			return false;
+	} else if (flags & TFHD_DEFAULT_BASE_IS_MOOF) {
+		traf.base = (uint64_t)mp4->moof_offset;
+	} else {
+		traf.base = *next_data;
+	}
+
+	if ((flags & TFHD_SAMPLE_DESC) && !read32(&p, tfhd_end, &traf.desc))
+		return false;
+	if ((flags & TFHD_SAMPLE_DURATION) &&
+	    !read32(&p, tfhd_end, &traf.duration))
+		return false;
+	if ((flags & TFHD_SAMPLE_SIZE) && !read32(&p, tfhd_end, &traf.size))
+		return false;
+	if ((flags & TFHD_SAMPLE_FLAGS) && !read32(&p, tfhd_end, &traf.flags))
+		return false;
+
+	*next_data = traf.base;
+
+	while (next_box(&pos, end, &box)) {
+		struct mp4_track *track = traf.track;
+
+		if (box.type == BOX('t', 'f', 'd', 't')) {
+			const uint8_t *tfdt = box.data + 4;
+			uint64_t time;
+
+			if (box.size < 4 ||
+			    !read_versioned(&tfdt, box.data + box.size,
+					    box.data[0], &time))
+				return false;
+
+			/* gaps between fragments extend the last sample */
+			if (track->samples.num == track->committed_samples &&
+			    time > track->duration)
+				track->pending_gap = time - track->duration;
+
+		} else if (box.type == BOX('t', 'r', 'u', 'n')) {
+			if (!parse_trun(mp4, &traf, &box, next_data))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool parse_moof(struct mp4_file *mp4, const uint8_t *moof, size_t size)
+{
+	const uint8_t *pos = moof;
+	const uint8_t *end = moof + size;
+	uint64_t next_data = (uint64_t)mp4->moof_offset;
+	struct mp4_box box;
+
+	while (next_box(&pos, end, &box)) {
+		if (box.type == BOX('t', 'r', 'a', 'f') &&
+		    !parse_traf(mp4, &box, &next_data))
+			return false;
+	}
+
+	return true;
+}
+
+static void rollback_fragment(struct mp4_file *mp4)
+{
+	for (size_t i = 0; i < mp4->tracks.num; i++) {
+		struct mp4_track *track = &mp4->tracks.array[i];
+
+		for (size_t j = track->committed_samples;
+		     j < track->samples.num; j++)
+			track->duration -= track->samples.array[j].duration;
+
+		da_resize(track->samples, track->committed_samples);
+		da_resize(track->chunks, track->committed_chunks);
+		track->pending_gap = 0;
+	}
+
+	mp4->moof_offset = 0;
+}
+
+/* a fragment index without any data, followed by more data */
+static void drop_fragment(struct mp4_file *mp4)
+{
+	da_push_back(mp4->fragments, &mp4->moof_offset);
+	rollback_fragment(mp4);
+}
+
+static void commit_fragment(struct mp4_file *mp4, int64_t end)
+{
+	for (size_t i = 0; i < mp4->tracks.num; i++) {
+		struct mp4_track *track = &mp4->tracks.array[i];
+		size_t last = track->committed_samples;
+
+		if (track->pending_gap && last &&
+		    track->pending_gap <= UINT32_MAX) {
+			track->samples.array[last - 1].duration +=
+				(uint32_t)track->pending_gap;
+			track->duration += track->pending_gap;
+		}
+
+		track->committed_samples = track->samples.num;
+		track->committed_chunks = track->chunks.num;
+		track->pending_gap = 0;
+	}
+
+	da_push_back(mp4->fragments, &mp4->moof_offset);
+	mp4->moof_offset = 0;
+	mp4->num_fragments++;
+	mp4->end = end;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint8_t *read_box(struct mp4_file *mp4, int64_t offset, uint64_t size)
+{
+	uint8_t *data;
+
+	if (size > MAX_INDEX_BOX_SIZE)
+		return NULL;
+
+	data = bmalloc((size_t)size);
+	if (os_fseeki64(mp4->file, offset, SEEK_SET) != 0 ||
+	    fread(data, 1, (size_t)size, mp4->file) != size) {
+		bfree(data);
+		return NULL;
+	}
+
+	return data;
+}
+
+/* walks the top level boxes, stopping at the first incomplete one */
+static bool scan_file(struct mp4_file *mp4)
+{
+	int64_t pos = 0;
+
+	while (pos + 8 <= mp4->size) {
+		uint8_t header[16];
+		size_t header_size = 8;
+		uint64_t size;
+		uint32_t type;
+
+		if (os_fseeki64(mp4->file, pos, SEEK_SET) != 0 ||
+		    fread(header, 1, 8, mp4->file) != 8)
+			break;
+
+		size = rb32(header);
+		type = rb32(header + 4);
+
+		if (size == 1) {
+			if (fread(header + 8, 1, 8, mp4->file) != 8)
+				break;
+			size = rb64(header + 8);
+			header_size = 16;
+		} else if (size == 0) {
+			size = (uint64_t)(mp4->size - pos);
+		}
+
+		if (size < header_size || size > (uint64_t)(mp4->size - pos))
+			break;
+
+		int64_t end = pos + (int64_t)size;
+
+		if (type == BOX('m', 'o', 'o', 'v')) {
+			if (mp4->moov) {
+				warn("File has more than one movie header");
+				return false;
+			}
+
+			mp4->moov = read_box(mp4, pos + header_size,
+					     size - header_size);
+			mp4->moov_size = (size_t)(size - header_size);
+			mp4->moov_offset = pos;
+			if (!mp4->moov || !parse_moov(mp4))
+				return false;
+			mp4->end = end;
+
+		} else if (type == BOX('m', 'o', 'o', 'f')) {
+			uint8_t *moof;
+
+			if (mp4->moof_offset)
+				drop_fragment(mp4);
+			if (!mp4->moov)
+				break;
+
+			size_t moof_size = (size_t)(size - header_size);
+
+			moof = read_box(mp4, pos + header_size, moof_size);
+			mp4->moof_offset = pos;
+			mp4->data_end = 0;
+
+			bool success = moof && parse_moof(mp4, moof, moof_size);
+			bfree(moof);
+
+			if (!success) {
+				rollback_fragment(mp4);
+				break;
+			}
+
+		} else if (type == BOX('m', 'd', 'a', 't')) {
+			if (mp4->moof_offset) {
+				/* the sample data has to be complete */
+				if (mp4->data_end > (uint64_t)end) {
+					rollback_fragment(mp4);
+					break;
+				}
+
+				commit_fragment(mp4, end);
+			} else {
+				mp4->end = end;
+			}
+
+		} else {
+			if (mp4->moof_offset)
+				drop_fragment(mp4);
+
+			/* the fragment index at the end is out of date */
+			if (type == BOX('m', 'f', 'r', 'a'))
+				da_push_back(mp4->fragments, &pos);
+			mp4->end = end;
+		}
+
+		pos = end;
+	}
+
+	if (mp4->moof_offset)
+		rollback_fragment(mp4);
+
+	if (!mp4->moov) {
+		warn("File has no movie header");
+		return false;
+	}
+	if (!mp4->num_fragments) {
+		warn("File has no complete fragments");
+		return false;
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* moov writing                                                              */
+
+struct moov_writer {
+	struct mp4_file *mp4;
+	struct serializer s;
+	struct array_output_data out;
+	size_t track_idx;
+};
+
+static size_t begin_box(struct moov_writer *w, uint32_t type)
+{
+	size_t pos = w->out.bytes.num;
+	s_wb32(&w->s, 0);
+	s_wb32(&w->s, type);
+	return pos;
+}
+
+static void end_box(struct moov_writer *w, size_t pos)
+{
+	wb32(w->out.bytes.array + pos, (uint32_t)(w->out.bytes.num - pos));
+}
+
+static inline void begin_full_box(struct moov_writer *w, size_t *pos,
+				  uint32_t type, uint8_t version)
+{
+	*pos = begin_box(w, type);
+	s_wb32(&w->s, (uint32_t)version << 24);
+}
+
+static inline uint64_t rescale(uint64_t val, uint32_t from, uint32_t to)
+{
+	return from ? util_mul_div64(val, to, from) : 0;
+}
+
+/* overwrites the duration field of mvhd, tkhd and mdhd boxes */
+static void copy_with_duration(struct moov_writer *w,
+			       const struct mp4_box *box, size_t v0_offset,
+			       size_t v1_offset, uint64_t duration)
+{
+	size_t pos = w->out.bytes.num;
+	bool v1 = box->size && box->data[0] == 1;
+	size_t header = (size_t)(box->data - box->start);
+	size_t offset = header + (v1 ? v1_offset : v0_offset);
+
+	s_write(&w->s, box->start, box->total);
+
+	if (offset + (v1 ? 8 : 4) > box->total)
+		return;
+
+	uint8_t *p = w->out.bytes.array + pos + offset;
+	if (v1)
+		wb64(p, duration);
+	else
+		wb32(p, duration > UINT32_MAX ? UINT32_MAX
+					      : (uint32_t)duration);
+}
+
+static uint64_t movie_duration(struct mp4_track *track, uint32_t timescale)
+{
+	return rescale(track->duration, track->timescale, timescale);
+}
+
+/* the edit that plays the media lasts until the end of the track now */
+static void copy_elst(struct moov_writer *w, const struct mp4_box *box,
+		      struct mp4_track *track)
+{
+	size_t pos = w->out.bytes.num;
+	size_t header = (size_t)(box->data - box->start);
+	bool v1 = box->size && box->data[0] == 1;
+	size_t entry_size = v1 ? 20 : 12;
+	uint32_t count;
+	size_t last = SIZE_MAX;
+
+	s_write(&w->s, box->start, box->total);
+
+	if (box->size < 8)
+		return;
+
+	count = rb32(box->data + 4);
+	if ((uint64_t)count * entry_size > box->size - 8)
+		return;
+
+	for (uint32_t i = 0; i < count; i++) {
+		const uint8_t *entry = box->data + 8 + i * entry_size;
+		int64_t media_time = v1 ? (int64_t)rb64(entry + 8)
+					: (int32_t)rb32(entry + 4);
+
+		if (media_time != -1) {
+			/* leave more complex edit lists alone */
+			if (last != SIZE_MAX)
+				return;
+			last = i;
+		}
+	}
+
+	if (last == SIZE_MAX)
+		return;
+
+	const uint8_t *entry = box->data + 8 + last * entry_size;
+	uint64_t media_time = v1 ? rb64(entry + 8) : rb32(entry + 4);
+	uint64_t duration = track->duration > media_time
+				    ? track->duration - media_time
+				    : 0;
+	duration = rescale(duration, track->timescale,
+			   w->mp4->movie_timescale);
+
+	uint8_t *p = w->out.bytes.array + pos + header + 8 + last * entry_size;
+	if (v1)
+		wb64(p, duration);
+	else
+		wb32(p, duration > UINT32_MAX ? UINT32_MAX
+					      : (uint32_t)duration);
+}
+
+static void write_stts(struct moov_writer *w, struct mp4_track *track)
+{
+	size_t box, count_pos;
+	uint32_t entries = 0;
+
+	begin_full_box(w, &box, BOX('s', 't', 't', 's'), 0);
+	count_pos = w->out.bytes.num;
+	s_wb32(&w->s, 0);
+
+	for (size_t i = 0; i < track->samples.num;) {
+		uint32_t duration = track->samples.array[i].duration;
+		uint32_t run = 0;
+
+		while (i < track->samples.num &&
+		       track->samples.array[i].duration == duration) {
+			run++;
+			i++;
+		}
+
+		s_wb32(&w->s, run);
+		s_wb32(&w->s, duration);
+		entries++;
+	}
+
+	wb32(w->out.bytes.array + count_pos, entries);
+	end_box(w, box);
+}
+
+static void write_ctts(struct moov_writer *w, struct mp4_track *track)
+{
+	bool needed = false;
+	bool negative = false;
+	size_t box, count_pos;
+	uint32_t entries = 0;
+
+	for (size_t i = 0; i < track->samples.num; i++) {
+		int32_t cts = track->samples.array[i].cts;
+		needed |= cts != 0;
+		negative |= cts < 0;
+	}
+
+	if (!needed)
+		return;
+
+	begin_full_box(w, &box, BOX('c', 't', 't', 's'), negative ? 1 : 0);
+	count_pos = w->out.bytes.num;
+	s_wb32(&w->s, 0);
+
+	for (size_t i = 0; i < track->samples.num;) {
+		int32_t cts = track->samples.array[i].cts;
+		uint32_t run = 0;
+
+		while (i < track->samples.num &&
+		       track->samples.array[i].cts == cts) {
+			run++;
+			i++;
+		}
+
+		s_wb32(&w->s, run);
+		s_wb32(&w->s, (uint32_t)cts);
+		entries++;
+	}
+
+	wb32(w->out.bytes.array + count_pos, entries);
+	end_box(w, box);
+}
+
+static void write_stss(struct moov_writer *w, struct mp4_track *track)
+{
+	size_t box, count_pos;
+	uint32_t entries = 0;
+
+	/* no table means that every sample is a sync sample */
+	for (size_t i = 0; i < track->samples.num; i++) {
+		if (!track->samples.array[i].sync)
+			goto write;
+	}
+
+	return;
+
+write:
+	begin_full_box(w, &box, BOX('s', 't', 's', 's'), 0);
+	count_pos = w->out.bytes.num;
+	s_wb32(&w->s, 0);
+
+	for (size_t i = 0; i < track->samples.num; i++) {
+		if (track->samples.array[i].sync) {
+			s_wb32(&w->s, (uint32_t)(i + 1));
+			entries++;
+		}
+	}
+
+	wb32(w->out.bytes.array + count_pos, entries);
+	end_box(w, box);
+}
+
+static void write_stsc(struct moov_writer *w, struct mp4_track *track)
+{
+	size_t box, count_pos;
+	uint32_t entries = 0;
+
+	begin_full_box(w, &box, BOX('s', 't', 's', 'c'), 0);
+	count_pos = w->out.bytes.num;
+	s_wb32(&w->s, 0);
+
+	for (size_t i = 0; i < track->chunks.num; i++) {
+		struct mp4_chunk *chunk = &track->chunks.array[i];
+		struct mp4_chunk *prev = i ? chunk - 1 : NULL;
+
+		if (prev && prev->samples == chunk->samples &&
+		    prev->desc == chunk->desc)
+			continue;
+
+		s_wb32(&w->s, (uint32_t)(i + 1));
+		s_wb32(&w->s, chunk->samples);
+		s_wb32(&w->s, chunk->desc);
+		entries++;
+	}
+
+	wb32(w->out.bytes.array + count_pos, entries);
+	end_box(w, box);
+}
+
+static void write_stsz(struct moov_writer *w, struct mp4_track *track)
+{
+	uint32_t size = track->samples.num ? track->samples.array[0].size : 0;
+	size_t box;
+
+	for (size_t i = 1; i < track->samples.num; i++) {
+		if (track->samples.array[i].size != size) {
+			size = 0;
+			break;
+		}
+	}
+
+	begin_full_box(w, &box, BOX('s', 't', 's', 'z'), 0);
+	s_wb32(&w->s, size);
+	s_wb32(&w->s, (uint32_t)track->samples.num);
+
+	if (!size) {
+		for (size_t i = 0; i < track->samples.num; i++)
+			s_wb32(&w->s, track->samples.array[i].size);
+	}
+
+	end_box(w, box);
+}
+
+static void write_stco(struct moov_writer *w, struct mp4_track *track)
+{
+	bool co64 = false;
+	size_t box;
+
+	for (size_t i = 0; i < track->chunks.num; i++)
+		co64 |= track->chunks.array[i].offset > UINT32_MAX;
+
+	begin_full_box(w, &box,
+		       co64 ? BOX('c', 'o', '6', '4') : BOX('s', 't', 'c', 'o'),
+		       0);
+	s_wb32(&w->s, (uint32_t)track->chunks.num);
+
+	for (size_t i = 0; i < track->chunks.num; i++) {
+		uint64_t offset = track->chunks.array[i].offset;
+		if (co64)
+			s_wb64(&w->s, offset);
+		else
+			s_wb32(&w->s, (uint32_t)offset);
+	}
+
+	end_box(w, box);
+}
+
+static bool is_sample_table(uint32_t type)
+{
+	return type == BOX('s', 't', 't', 's') ||
+	       type == BOX('c', 't', 't', 's') ||
+	       type == BOX('s', 't', 's', 's') ||
+	       type == BOX('s', 't', 's', 'c') ||
+	       type == BOX('s', 't', 's', 'z') ||
+	       type == BOX('s', 't', 'z', '2') ||
+	       type == BOX('s', 't', 'c', 'o') ||
+	       type == BOX('c', 'o', '6', '4') ||
+	       type == BOX('s', 'd', 't', 'p') ||
+	       type == BOX('s', 'b', 'g', 'p') ||
+	       type == BOX('s', 't', 'p', 's');
+}
+
+static void write_container(struct moov_writer *w, const struct mp4_box *box,
+			    struct mp4_track *track);
+
+static void write_stbl(struct moov_writer *w, const struct mp4_box *stbl,
+		       struct mp4_track *track)
+{
+	const uint8_t *pos = stbl->data;
+	const uint8_t *end = stbl->data + stbl->size;
+	size_t box = begin_box(w, stbl->type);
+	struct mp4_box child;
+
+	/* keeps the sample descriptions and anything else that does not
+	 * describe individual samples */
+	while (next_box(&pos, end, &child)) {
+		if (!is_sample_table(child.type))
+			s_write(&w->s, child.start, child.total);
+	}
+
+	write_stts(w, track);
+	write_ctts(w, track);
+	write_stss(w, track);
+	write_stsc(w, track);
+	write_stsz(w, track);
+	write_stco(w, track);
+
+	end_box(w, box);
+}
+
+static void write_child(struct moov_writer *w, const struct mp4_box *box,
+			struct mp4_track *track)
+{
+	struct mp4_file *mp4 = w->mp4;
+	uint64_t duration;
+
+	switch (box->type) {
+	case BOX('m', 'v', 'e', 'x'):
+		/* the file is not fragmented anymore */
+		break;
+
+	case BOX('t', 'r', 'a', 'k'):
+		track = &mp4->tracks.array[w->track_idx++];
+		write_container(w, box, track);
+		break;
+
+	case BOX('m', 'd', 'i', 'a'):
+	case BOX('m', 'i', 'n', 'f'):
+	case BOX('e', 'd', 't', 's'):
+		write_container(w, box, track);
+		break;
+
+	case BOX('s', 't', 'b', 'l'):
+		write_stbl(w, box, track);
+		break;
+
+	case BOX('m', 'v', 'h', 'd'):
+		duration = 0;
+		for (size_t i = 0; i < mp4->tracks.num; i++) {
+			uint64_t val = movie_duration(&mp4->tracks.array[i],
+						      mp4->movie_timescale);
+			if (val > duration)
+				duration = val;
+		}
+
+		copy_with_duration(w, box, 16, 24, duration);
+		break;
+
+	case BOX('t', 'k', 'h', 'd'):
+		duration = track ? movie_duration(track, mp4->movie_timescale)
+				 : 0;
+		copy_with_duration(w, box, 20, 28, duration);
+		break;
+
+	case BOX('m', 'd', 'h', 'd'):
+		copy_with_duration(w, box, 16, 24,
+				   track ? track->duration : 0);
+		break;
+
+	case BOX('e', 'l', 's', 't'):
+		if (track)
+			copy_elst(w, box, track);
+		else
+			s_write(&w->s, box->start, box->total);
+		break;
+
+	default:
+		s_write(&w->s, box->start, box->total);
+	}
+}
+
+static void write_container(struct moov_writer *w, const struct mp4_box *box,
+			    struct mp4_track *track)
+{
+	const uint8_t *pos = box->data;
+	const uint8_t *end = box->data + box->size;
+	size_t start = begin_box(w, box->type);
+	struct mp4_box child;
+
+	while (next_box(&pos, end, &child))
+		write_child(w, &child, track);
+
+	end_box(w, start);
+}
+
+static void build_moov(struct moov_writer *w)
+{
+	struct mp4_box moov = {
+		.type = BOX('m', 'o', 'o', 'v'),
+		.data = w->mp4->moov,
+		.size = w->mp4->moov_size,
+	};
+
+	array_output_serializer_init(&w->s, &w->out);
+	write_container(w, &moov, NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool write_at(FILE *file, int64_t offset, const void *data, size_t size)
+{
+	return os_fseeki64(file, offset, SEEK_SET) == 0 &&
+	       fwrite(data, 1, size, file) == size;
+}
+
+static bool write_free_box(FILE *file, int64_t offset, uint64_t size)
+{
+	uint8_t header[16];
+
+	if (size <= UINT32_MAX) {
+		wb32(header, (uint32_t)size);
+		wb32(header + 4, BOX('f', 'r', 'e', 'e'));
+		return write_at(file, offset, header, 8);
+	}
+
+	wb32(header, 1);
+	wb32(header + 4, BOX('f', 'r', 'e', 'e'));
+	wb64(header + 8, size);
+	return write_at(file, offset, header, 16);
+}
+
+static bool write_moov(struct mp4_file *mp4, struct moov_writer *w)
+{
+	int64_t moov_end = mp4->end + (int64_t)w->out.bytes.num;
+	int64_t left = mp4->size - moov_end;
+
+	/* the file cannot be truncated portably, so whatever is left of the
+	 * incomplete fragment is covered with a free box */
+	if (left > 0 && left < 8) {
+		size_t box = begin_box(w, BOX('f', 'r', 'e', 'e'));
+		end_box(w, box);
+		moov_end += 8;
+		left = 0;
+	}
+
+	if (!write_at(mp4->file, mp4->end, w->out.bytes.array,
+		      w->out.bytes.num))
+		return false;
+	if (left > 0 && !write_free_box(mp4->file, moov_end, (uint64_t)left))
+		return false;
+
+	return fflush(mp4->file) == 0;
+}
+
+static bool free_box(FILE *file, int64_t offset)
+{
+	uint8_t type[4];
+	wb32(type, BOX('f', 'r', 'e', 'e'));
+	return write_at(file, offset + 4, type, 4);
+}
+
+static bool rewrite_file(struct mp4_file *mp4, struct moov_writer *w)
+{
+	/* the new index goes first, the file stays readable as long as the
+	 * old one still comes before it */
+	if (!write_moov(mp4, w))
+		return false;
+	if (!free_box(mp4->file, mp4->moov_offset))
+		return false;
+
+	for (size_t i = 0; i < mp4->fragments.num; i++) {
+		if (!free_box(mp4->file, mp4->fragments.array[i]))
+			return false;
+	}
+
+	return fflush(mp4->file) == 0;
+}
+
+static void mp4_file_free(struct mp4_file *mp4)
+{
+	for (size_t i = 0; i < mp4->tracks.num; i++) {
+		da_free(mp4->tracks.array[i].samples);
+		da_free(mp4->tracks.array[i].chunks);
+	}
+
+	da_free(mp4->tracks);
+	da_free(mp4->fragments);
+	bfree(mp4->moov);
+
+	if (mp4->file)
+		fclose(mp4->file);
+}
+
+bool mp4_recover_fragmented(const char *path)
+{
+	struct mp4_file mp4 = {0};
+	struct moov_writer w = {.mp4 = &mp4};
+	bool success = false;
+
+	mp4.file = os_fopen(path, "r+b");
+	if (!mp4.file) {
+		warn("Could not open '%s'", path);
+		return false;
+	}
+
+	mp4.size = os_fgetsize(mp4.file);
+	if (!scan_file(&mp4))
+		goto fail;
+
+	build_moov(&w);
+
+	if (!rewrite_file(&mp4, &w)) {
+		warn("Failed to write to '%s'", path);
+		goto fail;
+	}
+
+	info("Recovered %zu fragments of '%s', dropped %" PRId64 " bytes",
+	     mp4.num_fragments, path, mp4.size - mp4.end);
+	success = true;
+
+fail:
+	array_output_serializer_free(&w.out);
+	mp4_file_free(&mp4);
+	return success;
+}
@@ -0,0 +1,45 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+/*
+ * Fragmented MP4/MOV recovery
+ *
+ *   Turns a fragmented MP4 or MOV file into a regular one in place.  Only the
+ * box headers and fragment indexes are read, the sample data is left where it
+ * is: a complete sample table is appended to the end of the file, and the
+ * fragment boxes are turned into free space.  A fragment that was only
+ * partially written, for example because the recording crashed, is dropped.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Rewrites a fragmented MP4/MOV file as a regular one.  Returns false if the
+ * file is not a fragmented MP4/MOV file or contains no complete fragment,
+ * in which case the file is left untouched.
+ */
+EXPORT bool mp4_recover_fragmented(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
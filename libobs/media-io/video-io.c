@@ -33,6 +33,7 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 #define MAX_CONVERT_BUFFERS 3
 #define MAX_CACHE_SIZE 16
+#define MAX_DISPATCH_THREADS 3
 
 struct cached_frame_info {
 	struct video_data frame;
@@ -40,11 +41,24 @@ struct cached_frame_info {
 	int count;
 };
 
-struct video_input {
-	struct video_scale_info conversion;
+/* inputs with identical conversion parameters share one scaler, so every
+ * distinct conversion is only done once per frame */
+struct video_conversion {
+	struct video_scale_info info;
 	video_scaler_t *scaler;
 	struct video_frame frame[MAX_CONVERT_BUFFERS];
 	int cur_frame;
+	long refs;
+
+	/* result for the frame currently being output */
+	struct video_data output;
+	bool queued;
+	bool success;
+};
+
+struct video_input {
+	struct video_scale_info conversion;
+	struct video_conversion *scale;
 
 	// allow outputting at fractions of main composition FPS,
 	// e.g. 60 FPS with frame_rate_divisor = 1 turns into 30 FPS
@@ -58,14 +72,27 @@ struct video_input {
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
+
+	/* frame for the current output, and whether it was disconnected from
+	 * inside of a callback */
+	struct video_data frame;
+	bool fire;
+	bool removed;
+
+	/* protected by the dispatch mutex while the callbacks run */
+	bool running;
+	struct video_input *waiting_for;
 };
 
-static inline void video_input_free(struct video_input *input)
-{
-	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
-}
+struct video_dispatch_worker {
+	struct video_output *video;
+	pthread_t thread;
+	os_sem_t *start;
+	const char *profile_name;
+	bool initialized;
+};
+
+typedef void (*video_job_t)(struct video_output *video, void *item);
 
 struct video_output {
 	struct video_output_info info;
@@ -81,6 +108,24 @@ struct video_output {
 
 	pthread_mutex_t input_mutex;
 	DARRAY(struct video_input) inputs;
+	DARRAY(struct video_conversion *) conversions;
+
+	/* scaling and input callbacks are spread over the dispatch workers,
+	 * the video thread takes its share of the work as well */
+	struct video_dispatch_worker workers[MAX_DISPATCH_THREADS];
+	size_t num_workers;
+	os_sem_t *workers_finished;
+	volatile bool workers_stop;
+
+	DARRAY(void *) jobs;
+	video_job_t job_func;
+	volatile long next_job;
+
+	/* inputs connected from inside of a callback, which are added once
+	 * all callbacks are done, and the running state of the inputs */
+	pthread_mutex_t dispatch_mutex;
+	pthread_cond_t dispatch_cond;
+	DARRAY(struct video_input) pending_inputs;
 
 	size_t available_frames;
 	size_t first_added;
@@ -95,37 +140,186 @@ struct video_output {
 
 /* ------------------------------------------------------------------------- */
 
-static inline bool scale_video_output(struct video_input *input,
-				      struct video_data *data)
+static THREAD_LOCAL struct video_output *dispatching_video = NULL;
+static THREAD_LOCAL struct video_input *dispatching_input = NULL;
+
+static void video_conversion_release(struct video_output *video,
+				     struct video_conversion *scale)
 {
-	bool success = true;
+	if (!scale || --scale->refs > 0)
+		return;
 
-	if (input->scaler) {
-		struct video_frame *frame;
+	da_erase_item(video->conversions, &scale);
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		video_frame_free(&scale->frame[i]);
+	video_scaler_destroy(scale->scaler);
+	bfree(scale);
+}
 
-		frame = &input->frame[input->cur_frame];
+static inline void video_input_free(struct video_output *video,
+				    struct video_input *input)
+{
+	video_conversion_release(video, input->scale);
+	input->scale = NULL;
+}
 
-		success = video_scaler_scale(input->scaler, frame->data,
-					     frame->linesize,
-					     (const uint8_t *const *)data->data,
-					     data->linesize);
+/* ------------------------------------------------------------------------- */
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i] = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
-			}
-		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
+static void run_jobs(struct video_output *video)
+{
+	long num = (long)video->jobs.num;
+	long idx;
+
+	while ((idx = os_atomic_inc_long(&video->next_job) - 1) < num)
+		video->job_func(video, video->jobs.array[idx]);
+}
+
+static void *video_dispatch_thread(void *param)
+{
+	struct video_dispatch_worker *worker = param;
+	struct video_output *video = worker->video;
+
+	os_set_thread_name("video-io: dispatch worker");
+
+	for (;;) {
+		os_sem_wait(worker->start);
+		if (os_atomic_load_bool(&video->workers_stop))
+			break;
+
+		profile_start(worker->profile_name);
+		run_jobs(video);
+		profile_end(worker->profile_name);
+
+		profile_reenable_thread();
+		os_sem_post(video->workers_finished);
+	}
+
+	return NULL;
+}
+
+static void video_dispatch_workers_free(struct video_output *video)
+{
+	os_atomic_set_bool(&video->workers_stop, true);
+
+	for (size_t i = 0; i < video->num_workers; i++) {
+		struct video_dispatch_worker *worker = &video->workers[i];
+
+		if (worker->initialized) {
+			os_sem_post(worker->start);
+			pthread_join(worker->thread, NULL);
 		}
+		os_sem_destroy(worker->start);
 	}
 
-	return success;
+	video->num_workers = 0;
 }
 
+/* one worker per input beyond the first, the video thread itself handles
+ * one input */
+static void video_dispatch_workers_update(struct video_output *video)
+{
+	size_t wanted = video->inputs.num ? video->inputs.num - 1 : 0;
+	if (wanted > MAX_DISPATCH_THREADS)
+		wanted = MAX_DISPATCH_THREADS;
+
+	while (video->num_workers < wanted) {
+		struct video_dispatch_worker *worker =
+			&video->workers[video->num_workers];
+
+		worker->video = video;
+		worker->profile_name = profile_store_name(
+			obs_get_profiler_name_store(),
+			"video_dispatch_worker(%s:%d)", video->info.name,
+			(int)video->num_workers);
+
+		if (os_sem_init(&worker->start, 0) != 0)
+			break;
+		if (pthread_create(&worker->thread, NULL,
+				   video_dispatch_thread, worker) != 0) {
+			os_sem_destroy(worker->start);
+			break;
+		}
+
+		worker->initialized = true;
+		video->num_workers++;
+	}
+}
+
+static void process_jobs(struct video_output *video, video_job_t func)
+{
+	size_t helpers = video->jobs.num ? video->jobs.num - 1 : 0;
+	if (helpers > video->num_workers)
+		helpers = video->num_workers;
+
+	video->job_func = func;
+	video->next_job = 0;
+
+	for (size_t i = 0; i < helpers; i++)
+		os_sem_post(video->workers[i].start);
+
+	run_jobs(video);
+
+	for (size_t i = 0; i < helpers; i++)
+		os_sem_wait(video->workers_finished);
+}
+
+static void scale_job(struct video_output *video, void *item)
+{
+	struct video_conversion *scale = item;
+	struct video_frame *frame;
+
+	if (++scale->cur_frame == MAX_CONVERT_BUFFERS)
+		scale->cur_frame = 0;
+
+	frame = &scale->frame[scale->cur_frame];
+
+	scale->success = video_scaler_scale(
+		scale->scaler, frame->data, frame->linesize,
+		(const uint8_t *const *)scale->output.data,
+		scale->output.linesize);
+
+	if (scale->success) {
+		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+			scale->output.data[i] = frame->data[i];
+			scale->output.linesize[i] = frame->linesize[i];
+		}
+	} else {
+		blog(LOG_WARNING, "video-io: Could not scale frame!");
+	}
+
+	UNUSED_PARAMETER(video);
+}
+
+static void dispatch_job(struct video_output *video, void *item)
+{
+	struct video_input *input = item;
+	bool removed;
+
+	pthread_mutex_lock(&video->dispatch_mutex);
+	removed = input->removed;
+	input->running = !removed;
+	pthread_mutex_unlock(&video->dispatch_mutex);
+
+	/* disconnected by another callback of this frame */
+	if (removed)
+		return;
+
+	dispatching_video = video;
+	dispatching_input = input;
+	input->callback(input->param, &input->frame);
+	dispatching_video = NULL;
+	dispatching_input = NULL;
+
+	pthread_mutex_lock(&video->dispatch_mutex);
+	input->running = false;
+	pthread_cond_broadcast(&video->dispatch_cond);
+	pthread_mutex_unlock(&video->dispatch_mutex);
+}
+
+static void remove_input(struct video_output *video, size_t idx);
+static void add_input(struct video_output *video, struct video_input *input);
+
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
@@ -144,9 +338,11 @@ static inline bool video_output_cur_frame(struct video_output *video)
 
 	pthread_mutex_lock(&video->input_mutex);
 
+	da_resize(video->jobs, 0);
+
 	for (size_t i = 0; i < video->inputs.num; i++) {
 		struct video_input *input = video->inputs.array + i;
-		struct video_data frame = frame_info->frame;
+		struct video_conversion *scale = input->scale;
 
 		// an explicit counter is used instead of remainder calculation
 		// to allow multiple encoders started at the same time to start on
@@ -156,13 +352,64 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		    input->frame_rate_divisor)
 			input->frame_rate_divisor_counter = 0;
 
+		input->fire = !skip;
 		if (skip)
 			continue;
 
-		if (scale_video_output(input, &frame))
-			input->callback(input->param, &frame);
+		input->frame = frame_info->frame;
+
+		/* each conversion is only scaled once, however many inputs
+		 * use it */
+		if (scale && !scale->queued) {
+			scale->output = frame_info->frame;
+			scale->queued = true;
+			da_push_back(video->jobs, &scale);
+		}
 	}
 
+	if (video->jobs.num)
+		process_jobs(video, scale_job);
+
+	da_resize(video->jobs, 0);
+
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		struct video_input *input = video->inputs.array + i;
+		struct video_conversion *scale = input->scale;
+		void *job = input;
+
+		if (!input->fire)
+			continue;
+
+		if (scale) {
+			if (!scale->success)
+				continue;
+
+			for (size_t j = 0; j < MAX_AV_PLANES; j++) {
+				input->frame.data[j] = scale->output.data[j];
+				input->frame.linesize[j] =
+					scale->output.linesize[j];
+			}
+		}
+
+		da_push_back(video->jobs, &job);
+	}
+
+	if (video->jobs.num)
+		process_jobs(video, dispatch_job);
+
+	for (size_t i = 0; i < video->conversions.num; i++)
+		video->conversions.array[i]->queued = false;
+
+	/* inputs disconnected or connected from inside of a callback */
+	for (size_t i = video->inputs.num; i > 0; i--) {
+		if (video->inputs.array[i - 1].removed)
+			remove_input(video, i - 1);
+	}
+
+	for (size_t i = 0; i < video->pending_inputs.num; i++)
+		add_input(video, video->pending_inputs.array + i);
+	da_resize(video->pending_inputs, 0);
+
 	pthread_mutex_unlock(&video->input_mutex);
 
 	/* -------------------------------- */
@@ -264,14 +511,26 @@ int video_output_open(video_t **video, struct video_output_info *info)
 		goto fail1;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
 		goto fail2;
-	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
+	if (os_sem_init(&out->workers_finished, 0) != 0)
 		goto fail3;
+	if (pthread_mutex_init(&out->dispatch_mutex, NULL) != 0)
+		goto fail4;
+	if (pthread_cond_init(&out->dispatch_cond, NULL) != 0)
+		goto fail5;
+	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
+		goto fail6;
 
 	init_cache(out);
 
 	*video = out;
 	return VIDEO_OUTPUT_SUCCESS;
 
+fail6:
+	pthread_cond_destroy(&out->dispatch_cond);
+fail5:
+	pthread_mutex_destroy(&out->dispatch_mutex);
+fail4:
+	os_sem_destroy(out->workers_finished);
 fail3:
 	os_sem_destroy(out->update_semaphore);
 fail2:
@@ -289,17 +548,26 @@ void video_output_close(video_t *video)
 		return;
 
 	video_output_stop(video);
+	video_dispatch_workers_free(video);
 
 	pthread_mutex_lock(&video->input_mutex);
 
 	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
+		video_input_free(video, &video->inputs.array[i]);
+	for (size_t i = 0; i < video->pending_inputs.num; i++)
+		video_input_free(video, &video->pending_inputs.array[i]);
 	da_free(video->inputs);
+	da_free(video->pending_inputs);
+	da_free(video->conversions);
+	da_free(video->jobs);
 
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame *)&video->cache[i]);
 
 	pthread_mutex_unlock(&video->input_mutex);
+	pthread_cond_destroy(&video->dispatch_cond);
+	pthread_mutex_destroy(&video->dispatch_mutex);
+	os_sem_destroy(video->workers_finished);
 	os_sem_destroy(video->update_semaphore);
 	pthread_mutex_destroy(&video->data_mutex);
 	pthread_mutex_destroy(&video->input_mutex);
@@ -314,6 +582,21 @@ static size_t video_get_input_idx(const video_t *video,
 {
 	for (size_t i = 0; i < video->inputs.num; i++) {
 		struct video_input *input = video->inputs.array + i;
+		if (input->callback == callback && input->param == param &&
+		    !input->removed)
+			return i;
+	}
+
+	return DARRAY_INVALID;
+}
+
+static size_t video_get_pending_idx(const video_t *video,
+				    void (*callback)(void *param,
+						     struct video_data *frame),
+				    void *param)
+{
+	for (size_t i = 0; i < video->pending_inputs.num; i++) {
+		struct video_input *input = video->pending_inputs.array + i;
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -348,6 +631,60 @@ static bool match_space(enum video_colorspace a, enum video_colorspace b)
 	       (collapse_space(a) == collapse_space(b));
 }
 
+static inline bool match_conversion(const struct video_scale_info *a,
+				    const struct video_scale_info *b)
+{
+	return a->format == b->format && a->width == b->width &&
+	       a->height == b->height && a->range == b->range &&
+	       a->colorspace == b->colorspace;
+}
+
+static struct video_conversion *
+video_conversion_get(struct video_output *video,
+		     const struct video_scale_info *info)
+{
+	struct video_conversion *scale;
+
+	for (size_t i = 0; i < video->conversions.num; i++) {
+		scale = video->conversions.array[i];
+		if (match_conversion(&scale->info, info)) {
+			scale->refs++;
+			return scale;
+		}
+	}
+
+	struct video_scale_info from = {.format = video->info.format,
+					.width = video->info.width,
+					.height = video->info.height,
+					.range = video->info.range,
+					.colorspace = video->info.colorspace};
+
+	scale = bzalloc(sizeof(*scale));
+	scale->info = *info;
+	scale->refs = 1;
+
+	int ret = video_scaler_create(&scale->scaler, info, &from,
+				      VIDEO_SCALE_FAST_BILINEAR);
+	if (ret != VIDEO_SCALER_SUCCESS) {
+		if (ret == VIDEO_SCALER_BAD_CONVERSION)
+			blog(LOG_ERROR, "video_input_init: Bad "
+					"scale conversion type");
+		else
+			blog(LOG_ERROR, "video_input_init: Failed to "
+					"create scaler");
+
+		bfree(scale);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		video_frame_init(&scale->frame[i], info->format, info->width,
+				 info->height);
+
+	da_push_back(video->conversions, &scale);
+	return scale;
+}
+
 static inline bool video_input_init(struct video_input *input,
 				    struct video_output *video)
 {
@@ -357,32 +694,9 @@ static inline bool video_input_init(struct video_input *input,
 	    !match_range(input->conversion.range, video->info.range) ||
 	    !match_space(input->conversion.colorspace,
 			 video->info.colorspace)) {
-		struct video_scale_info from = {.format = video->info.format,
-						.width = video->info.width,
-						.height = video->info.height,
-						.range = video->info.range,
-						.colorspace =
-							video->info.colorspace};
-
-		int ret = video_scaler_create(&input->scaler,
-					      &input->conversion, &from,
-					      VIDEO_SCALE_FAST_BILINEAR);
-		if (ret != VIDEO_SCALER_SUCCESS) {
-			if (ret == VIDEO_SCALER_BAD_CONVERSION)
-				blog(LOG_ERROR, "video_input_init: Bad "
-						"scale conversion type");
-			else
-				blog(LOG_ERROR, "video_input_init: Failed to "
-						"create scaler");
-
+		input->scale = video_conversion_get(video, &input->conversion);
+		if (!input->scale)
 			return false;
-		}
-
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i],
-					 input->conversion.format,
-					 input->conversion.width,
-					 input->conversion.height);
 	}
 
 	return true;
@@ -415,6 +729,74 @@ bool video_output_connect(
 	return video_output_connect2(video, conversion, 1, callback, param);
 }
 
+static void add_input(struct video_output *video, struct video_input *input)
+{
+	if (video->inputs.num == 0) {
+		if (!os_atomic_load_long(&video->gpu_refs)) {
+			reset_frames(video);
+		}
+		os_atomic_set_bool(&video->raw_active, true);
+	}
+	da_push_back(video->inputs, input);
+	video_dispatch_workers_update(video);
+}
+
+static bool input_init(struct video_output *video, struct video_input *input,
+		       const struct video_scale_info *conversion,
+		       uint32_t frame_rate_divisor,
+		       void (*callback)(void *param, struct video_data *frame),
+		       void *param)
+{
+	memset(input, 0, sizeof(*input));
+
+	input->callback = callback;
+	input->param = param;
+
+	input->frame_rate_divisor = frame_rate_divisor;
+
+	if (conversion) {
+		input->conversion = *conversion;
+	} else {
+		input->conversion.format = video->info.format;
+		input->conversion.width = video->info.width;
+		input->conversion.height = video->info.height;
+		input->conversion.range = video->info.range;
+		input->conversion.colorspace = video->info.colorspace;
+	}
+
+	if (input->conversion.width == 0)
+		input->conversion.width = video->info.width;
+	if (input->conversion.height == 0)
+		input->conversion.height = video->info.height;
+
+	return video_input_init(input, video);
+}
+
+/* the video thread holds the input mutex while the callbacks run on the
+ * dispatch workers, so inputs connected from inside of a callback are added
+ * by the video thread once all callbacks are done */
+static bool connect_from_callback(
+	struct video_output *video, const struct video_scale_info *conversion,
+	uint32_t frame_rate_divisor,
+	void (*callback)(void *param, struct video_data *frame), void *param)
+{
+	struct video_input input;
+	bool success = false;
+
+	pthread_mutex_lock(&video->dispatch_mutex);
+
+	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID &&
+	    video_get_pending_idx(video, callback, param) == DARRAY_INVALID) {
+		success = input_init(video, &input, conversion,
+				     frame_rate_divisor, callback, param);
+		if (success)
+			da_push_back(video->pending_inputs, &input);
+	}
+
+	pthread_mutex_unlock(&video->dispatch_mutex);
+	return success;
+}
+
 bool video_output_connect2(
 	video_t *video, const struct video_scale_info *conversion,
 	uint32_t frame_rate_divisor,
@@ -427,42 +809,20 @@ bool video_output_connect2(
 	if (!video || !callback || frame_rate_divisor == 0)
 		return false;
 
+	if (dispatching_video == video)
+		return connect_from_callback(video, conversion,
+					     frame_rate_divisor, callback,
+					     param);
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
 		struct video_input input;
-		memset(&input, 0, sizeof(input));
 
-		input.callback = callback;
-		input.param = param;
-
-		input.frame_rate_divisor = frame_rate_divisor;
-
-		if (conversion) {
-			input.conversion = *conversion;
-		} else {
-			input.conversion.format = video->info.format;
-			input.conversion.width = video->info.width;
-			input.conversion.height = video->info.height;
-			input.conversion.range = video->info.range;
-			input.conversion.colorspace = video->info.colorspace;
-		}
-
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
-
-		success = video_input_init(&input, video);
-		if (success) {
-			if (video->inputs.num == 0) {
-				if (!os_atomic_load_long(&video->gpu_refs)) {
-					reset_frames(video);
-				}
-				os_atomic_set_bool(&video->raw_active, true);
-			}
-			da_push_back(video->inputs, &input);
-		}
+		success = input_init(video, &input, conversion,
+				     frame_rate_divisor, callback, param);
+		if (success)
+			add_input(video, &input);
 	}
 
 	pthread_mutex_unlock(&video->input_mutex);
@@ -487,6 +847,83 @@ static void log_skipped(video_t *video)
 		     percentage_skipped);
 }
 
+static void remove_input(struct video_output *video, size_t idx)
+{
+	video_input_free(video, video->inputs.array + idx);
+	da_erase(video->inputs, idx);
+
+	if (video->inputs.num == 0) {
+		os_atomic_set_bool(&video->raw_active, false);
+		if (!os_atomic_load_long(&video->gpu_refs)) {
+			log_skipped(video);
+		}
+	}
+}
+
+static bool input_waits_for(const struct video_input *input,
+			    const struct video_input *target)
+{
+	for (; input; input = input->waiting_for) {
+		if (input == target)
+			return true;
+	}
+
+	return false;
+}
+
+/* the video thread holds the input mutex while the callbacks run, so an
+ * input disconnected from inside of a callback is only flagged here and
+ * removed by the video thread.  Its own callback may still be running on
+ * another dispatch worker though, which has to finish before the caller can
+ * release the input's data.
+ *
+ * callbacks that disconnect each other, directly or through other
+ * callbacks, would wait for each other forever, and the data of one of them
+ * can't be released safely, so that isn't allowed. */
+static void disconnect_from_callback(
+	struct video_output *video,
+	void (*callback)(void *param, struct video_data *frame), void *param)
+{
+	struct video_input *self = dispatching_input;
+	struct video_input *input;
+	size_t idx;
+
+	pthread_mutex_lock(&video->dispatch_mutex);
+
+	idx = video_get_pending_idx(video, callback, param);
+	if (idx != DARRAY_INVALID) {
+		video_input_free(video, video->pending_inputs.array + idx);
+		da_erase(video->pending_inputs, idx);
+		goto unlock;
+	}
+
+	idx = video_get_input_idx(video, callback, param);
+	if (idx == DARRAY_INVALID)
+		goto unlock;
+
+	input = video->inputs.array + idx;
+	input->removed = true;
+
+	if (input == self)
+		goto unlock;
+
+	if (input_waits_for(input, self)) {
+		blog(LOG_ERROR, "video_output_disconnect: Raw video callbacks "
+				"disconnecting each other");
+		assert(false && "Callbacks disconnecting each other");
+		goto unlock;
+	}
+
+	self->waiting_for = input;
+	while (input->running)
+		pthread_cond_wait(&video->dispatch_cond,
+				  &video->dispatch_mutex);
+	self->waiting_for = NULL;
+
+unlock:
+	pthread_mutex_unlock(&video->dispatch_mutex);
+}
+
 void video_output_disconnect(video_t *video,
 			     void (*callback)(void *param,
 					      struct video_data *frame),
@@ -497,20 +934,16 @@ void video_output_disconnect(video_t *video,
 
 	video = get_root(video);
 
+	if (dispatching_video == video) {
+		disconnect_from_callback(video, callback, param);
+		return;
+	}
+
 	pthread_mutex_lock(&video->input_mutex);
 
 	size_t idx = video_get_input_idx(video, callback, param);
-	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array + idx);
-		da_erase(video->inputs, idx);
-
-		if (video->inputs.num == 0) {
-			os_atomic_set_bool(&video->raw_active, false);
-			if (!os_atomic_load_long(&video->gpu_refs)) {
-				log_skipped(video);
-			}
-		}
-	}
+	if (idx != DARRAY_INVALID)
+		remove_input(video, idx);
 
 	pthread_mutex_unlock(&video->input_mutex);
 }
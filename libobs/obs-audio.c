@@ -46,12 +46,19 @@ static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
 }
 
 static inline void mix_audio(struct audio_output_data *mixes,
-			     obs_source_t *source, size_t channels,
-			     size_t sample_rate, struct ts_info *ts)
+			     obs_source_t *source, uint32_t mixers,
+			     size_t channels, size_t sample_rate,
+			     struct ts_info *ts)
 {
 	size_t total_floats = AUDIO_OUTPUT_FRAMES;
 	size_t start_point = 0;
 
+	/* mixes that are inactive, disabled for the source, or known to be
+	 * silent would only add zeros */
+	mixers &= source->audio_mixers & ~source->audio_silent_mixes;
+	if (!mixers)
+		return;
+
 	if (source->audio_ts < ts->start || ts->end <= source->audio_ts)
 		return;
 
@@ -65,17 +72,14 @@ static inline void mix_audio(struct audio_output_data *mixes,
 	}
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud =
-				source->audio_output_buf[mix_idx][ch];
-			register float *end;
+		if ((mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			mix += start_point;
-			end = aud + total_floats;
+		for (size_t ch = 0; ch < channels; ch++) {
+			float *mix = mixes[mix_idx].data[ch] + start_point;
+			float *aud = source->audio_output_buf[mix_idx][ch];
 
-			while (aud < end)
-				*(mix++) += *(aud++);
+			obs->audio.kernels->accumulate(mix, aud, total_floats);
 		}
 	}
 }
@@ -515,6 +519,252 @@ static inline void execute_audio_tasks(void)
 	}
 }
 
+static void render_audio_source(struct obs_core_audio *audio,
+				obs_source_t *source, uint32_t mixers,
+				size_t channels, size_t sample_rate,
+				size_t audio_size, uint64_t start_ts)
+{
+	obs_source_audio_render(source, mixers, channels, sample_rate,
+				audio_size);
+
+	/* if a source has gone backward in time and we can no
+	 * longer buffer, drop some or all of its audio */
+	if (audio_buffering_maxed(audio) && source->audio_ts != 0 &&
+	    source->audio_ts < start_ts) {
+		if (source->info.audio_render) {
+			blog(LOG_DEBUG,
+			     "render audio source %s timestamp has "
+			     "gone backwards",
+			     obs_source_get_name(source));
+
+			/* just avoid further damage */
+			source->audio_pending = true;
+#if DEBUG_AUDIO == 1
+			/* this should really be fixed */
+			assert(false);
+#endif
+		} else {
+			pthread_mutex_lock(&source->audio_buf_mutex);
+			bool rerender = ignore_audio(source, channels,
+						     sample_rate, start_ts);
+			pthread_mutex_unlock(&source->audio_buf_mutex);
+
+			/* if we (potentially) recovered, re-render */
+			if (rerender)
+				obs_source_audio_render(source, mixers,
+							channels, sample_rate,
+							audio_size);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* parallel rendering of leaf audio sources                                  */
+
+struct audio_render_pool;
+
+struct audio_render_worker {
+	struct audio_render_pool *pool;
+	pthread_t thread;
+	os_sem_t *start;
+	const char *profile_name;
+	bool initialized;
+};
+
+struct audio_render_pool {
+	struct obs_core_audio *audio;
+	struct audio_render_worker workers[MAX_AUDIO_RENDER_THREADS];
+	size_t num_workers;
+	os_sem_t *finished;
+	volatile bool stop;
+
+	/* parameters of the tick currently being rendered */
+	DARRAY(obs_source_t *) leaves;
+	volatile long next_leaf;
+	uint32_t mixers;
+	size_t channels;
+	size_t sample_rate;
+	size_t audio_size;
+	uint64_t start_ts;
+};
+
+/* sources that don't mix other sources (scenes, transitions) and don't run
+ * plugin code on the audio thread only touch their own buffers */
+static inline bool is_leaf_audio_source(const obs_source_t *source)
+{
+	return !source->info.audio_render && !source->info.audio_mix;
+}
+
+static void render_audio_leaves(struct audio_render_pool *pool)
+{
+	size_t num = pool->leaves.num;
+	long idx;
+
+	while ((idx = os_atomic_inc_long(&pool->next_leaf) - 1) < (long)num) {
+		render_audio_source(pool->audio, pool->leaves.array[idx],
+				    pool->mixers, pool->channels,
+				    pool->sample_rate, pool->audio_size,
+				    pool->start_ts);
+	}
+}
+
+static void *audio_render_thread(void *param)
+{
+	struct audio_render_worker *worker = param;
+	struct audio_render_pool *pool = worker->pool;
+
+	os_set_thread_name("libobs: audio render worker");
+
+	for (;;) {
+		os_sem_wait(worker->start);
+		if (os_atomic_load_bool(&pool->stop))
+			break;
+
+		profile_start(worker->profile_name);
+		render_audio_leaves(pool);
+		profile_end(worker->profile_name);
+
+		profile_reenable_thread();
+		os_sem_post(pool->finished);
+	}
+
+	return NULL;
+}
+
+#define MIN_PARALLEL_AUDIO_SOURCES 4
+
+static const char *render_audio_parallel_name = "render_audio_parallel";
+
+static void render_audio_sources_parallel(struct obs_core_audio *audio,
+					  uint32_t mixers, size_t channels,
+					  size_t sample_rate, size_t audio_size,
+					  uint64_t start_ts)
+{
+	struct audio_render_pool *pool = audio->render_pool;
+	size_t num_composites = 0;
+
+	da_resize(pool->leaves, 0);
+
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+		if (is_leaf_audio_source(source))
+			da_push_back(pool->leaves, &source);
+		else
+			audio->render_order.array[num_composites++] = source;
+	}
+
+	/* keep the composites in render order at the front, and the leaves
+	 * after them so they are still released with the rest */
+	memcpy(audio->render_order.array + num_composites, pool->leaves.array,
+	       pool->leaves.num * sizeof(obs_source_t *));
+
+	profile_start(render_audio_parallel_name);
+
+	if (pool->leaves.num >= MIN_PARALLEL_AUDIO_SOURCES) {
+		pool->mixers = mixers;
+		pool->channels = channels;
+		pool->sample_rate = sample_rate;
+		pool->audio_size = audio_size;
+		pool->start_ts = start_ts;
+		pool->next_leaf = 0;
+
+		for (size_t i = 0; i < pool->num_workers; i++)
+			os_sem_post(pool->workers[i].start);
+
+		/* the audio thread takes its share of the work as well */
+		render_audio_leaves(pool);
+
+		for (size_t i = 0; i < pool->num_workers; i++)
+			os_sem_wait(pool->finished);
+	} else {
+		for (size_t i = 0; i < pool->leaves.num; i++)
+			render_audio_source(audio, pool->leaves.array[i],
+					    mixers, channels, sample_rate,
+					    audio_size, start_ts);
+	}
+
+	profile_end(render_audio_parallel_name);
+
+	/* composites depend on their children, which are all rendered now */
+	for (size_t i = 0; i < num_composites; i++)
+		render_audio_source(audio, audio->render_order.array[i],
+				    mixers, channels, sample_rate, audio_size,
+				    start_ts);
+}
+
+void audio_render_pool_free(struct obs_core_audio *audio)
+{
+	struct audio_render_pool *pool = audio->render_pool;
+	if (!pool)
+		return;
+
+	os_atomic_set_bool(&pool->stop, true);
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct audio_render_worker *worker = &pool->workers[i];
+
+		if (worker->initialized) {
+			os_sem_post(worker->start);
+			pthread_join(worker->thread, NULL);
+		}
+		os_sem_destroy(worker->start);
+	}
+
+	os_sem_destroy(pool->finished);
+	da_free(pool->leaves);
+	bfree(pool);
+
+	audio->render_pool = NULL;
+}
+
+bool audio_render_pool_init(struct obs_core_audio *audio, uint32_t threads)
+{
+	struct audio_render_pool *pool;
+
+	if (!threads)
+		return true;
+
+	if (threads > MAX_AUDIO_RENDER_THREADS)
+		threads = MAX_AUDIO_RENDER_THREADS;
+
+	pool = bzalloc(sizeof(*pool));
+	pool->audio = audio;
+	pool->num_workers = threads;
+	audio->render_pool = pool;
+
+	if (os_sem_init(&pool->finished, 0) != 0)
+		goto fail;
+
+	for (size_t i = 0; i < threads; i++) {
+		struct audio_render_worker *worker = &pool->workers[i];
+
+		worker->pool = pool;
+		worker->profile_name =
+			profile_store_name(obs_get_profiler_name_store(),
+					   "audio_render_worker(%d)", (int)i);
+
+		if (os_sem_init(&worker->start, 0) != 0)
+			goto fail;
+		if (pthread_create(&worker->thread, NULL, audio_render_thread,
+				   worker) != 0)
+			goto fail;
+
+		worker->initialized = true;
+	}
+
+	blog(LOG_INFO, "Parallel audio rendering enabled with %u worker(s)",
+	     threads);
+	return true;
+
+fail:
+	blog(LOG_WARNING, "Failed to create audio render workers, "
+			  "falling back to serial audio rendering");
+	audio_render_pool_free(audio);
+	return false;
+}
+
+/* ------------------------------------------------------------------------- */
+
 bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 		    uint64_t *out_ts, uint32_t mixers,
 		    struct audio_output_data *mixes)
@@ -583,42 +833,15 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	/* ------------------------------------------------ */
 	/* render audio data */
-	for (size_t i = 0; i < audio->render_order.num; i++) {
-		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate,
-					audio_size);
-
-		/* if a source has gone backward in time and we can no
-		 * longer buffer, drop some or all of its audio */
-		if (audio_buffering_maxed(audio) && source->audio_ts != 0 &&
-		    source->audio_ts < ts.start) {
-			if (source->info.audio_render) {
-				blog(LOG_DEBUG,
-				     "render audio source %s timestamp has "
-				     "gone backwards",
-				     obs_source_get_name(source));
-
-				/* just avoid further damage */
-				source->audio_pending = true;
-#if DEBUG_AUDIO == 1
-				/* this should really be fixed */
-				assert(false);
-#endif
-			} else {
-				pthread_mutex_lock(&source->audio_buf_mutex);
-				bool rerender = ignore_audio(source, channels,
-							     sample_rate,
-							     ts.start);
-				pthread_mutex_unlock(&source->audio_buf_mutex);
-
-				/* if we (potentially) recovered, re-render */
-				if (rerender)
-					obs_source_audio_render(source, mixers,
-								channels,
-								sample_rate,
-								audio_size);
-			}
-		}
+	if (audio->render_pool) {
+		render_audio_sources_parallel(audio, mixers, channels,
+					      sample_rate, audio_size,
+					      ts.start);
+	} else {
+		for (size_t i = 0; i < audio->render_order.num; i++)
+			render_audio_source(audio, audio->render_order.array[i],
+					    mixers, channels, sample_rate,
+					    audio_size, ts.start);
 	}
 
 	/* ------------------------------------------------ */
@@ -650,8 +873,8 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 			pthread_mutex_lock(&source->audio_buf_mutex);
 
 			if (source->audio_output_buf[0][0] && source->audio_ts)
-				mix_audio(mixes, source, channels, sample_rate,
-					  &ts);
+				mix_audio(mixes, source, mixers, channels,
+					  sample_rate, &ts);
 
 			pthread_mutex_unlock(&source->audio_buf_mutex);
 		}
@@ -1283,6 +1283,7 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 				    struct encoder_packet *packet)
 {
 	struct encoder_packet first_packet;
+	struct encoder_packet shared;
 	DARRAY(uint8_t) data;
 	uint8_t *sei;
 	size_t size;
@@ -1306,10 +1307,13 @@ static void send_first_video_packet(struct obs_encoder *encoder,
 	first_packet.data = data.array;
 	first_packet.size = data.num;
 
-	cb->new_packet(cb->param, &first_packet);
+	obs_encoder_packet_create_instance(&shared, &first_packet);
+	da_free(data);
+
+	cb->new_packet(cb->param, &shared);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&shared);
 }
 
 static const char *send_packet_name = "send_packet";
@@ -1377,10 +1381,18 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success,
 
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
-		for (size_t i = encoder->callbacks.num; i > 0; i--) {
-			struct encoder_callback *cb;
-			cb = encoder->callbacks.array + (i - 1);
-			send_packet(encoder, cb, pkt);
+		/* copied once, every output shares the same payload */
+		if (encoder->callbacks.num) {
+			struct encoder_packet shared;
+			obs_encoder_packet_create_instance(&shared, pkt);
+
+			for (size_t i = encoder->callbacks.num; i > 0; i--) {
+				struct encoder_callback *cb;
+				cb = encoder->callbacks.array + (i - 1);
+				send_packet(encoder, cb, &shared);
+			}
+
+			obs_encoder_packet_release(&shared);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
@@ -1764,15 +1776,191 @@ void obs_encoder_remove_output(struct obs_encoder *encoder,
 	pthread_mutex_unlock(&encoder->outputs_mutex);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Packet buffer pool */
+
+/* Packet payloads are immutable once created and shared between all outputs
+ * of an encoder by reference count.  Freed payloads are cached in power of
+ * two size classes so that steady-state encoding doesn't hit the allocator.
+ * Pool hits and misses show up as profiler nodes wherever packets are
+ * created.
+ *
+ * Packet data used to be allocated by whoever created the packet, with a
+ * bare long reference count in front of it.  The reference count stays
+ * right in front of the data, and pooled buffers are told apart by a flag
+ * in the count, so that such packets are still released correctly. */
+
+#define PACKET_POOL_MIN_SHIFT 10
+#define PACKET_POOL_CLASSES 15
+#define PACKET_POOL_MAX_PER_CLASS 64
+#define PACKET_POOL_MAX_BYTES (64 * 1024 * 1024)
+#define PACKET_BUFFER_POOLED 0x40000000L
+
+struct packet_buffer {
+	struct packet_buffer *next;
+	int size_class;
+	volatile long refs;
+};
+
+struct packet_pool_class {
+	struct packet_buffer *free;
+	size_t num_free;
+};
+
+static pthread_mutex_t packet_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct packet_pool_class packet_pool[PACKET_POOL_CLASSES];
+static size_t packet_pool_bytes = 0;
+static uint64_t packet_pool_hits = 0;
+static uint64_t packet_pool_misses = 0;
+
+static const char *packet_pool_hit_name = "packet_pool_hit";
+static const char *packet_pool_miss_name = "packet_pool_miss";
+
+static inline size_t packet_class_size(int size_class)
+{
+	return (size_t)1 << (size_class + PACKET_POOL_MIN_SHIFT);
+}
+
+static int get_packet_class(size_t size)
+{
+	size += sizeof(struct packet_buffer);
+
+	for (int i = 0; i < PACKET_POOL_CLASSES; i++) {
+		if (size <= packet_class_size(i))
+			return i;
+	}
+
+	return -1;
+}
+
+static inline long *get_packet_refs(uint8_t *data)
+{
+	return (long *)data - 1;
+}
+
+static inline struct packet_buffer *get_packet_buffer(uint8_t *data)
+{
+	uint8_t *refs = (uint8_t *)get_packet_refs(data);
+	return (struct packet_buffer *)(refs -
+					offsetof(struct packet_buffer, refs));
+}
+
+static uint8_t *packet_buffer_alloc(size_t size)
+{
+	int size_class = get_packet_class(size);
+	struct packet_buffer *buf = NULL;
+
+	if (size_class >= 0) {
+		struct packet_pool_class *pc = &packet_pool[size_class];
+
+		pthread_mutex_lock(&packet_pool_mutex);
+		buf = pc->free;
+		if (buf) {
+			pc->free = buf->next;
+			pc->num_free--;
+			packet_pool_bytes -= packet_class_size(size_class);
+			packet_pool_hits++;
+		} else {
+			packet_pool_misses++;
+		}
+		pthread_mutex_unlock(&packet_pool_mutex);
+	}
+
+	if (buf) {
+		profile_start(packet_pool_hit_name);
+		profile_end(packet_pool_hit_name);
+	} else {
+		size_t alloc_size = sizeof(struct packet_buffer) + size;
+		if (size_class >= 0)
+			alloc_size = packet_class_size(size_class);
+
+		profile_start(packet_pool_miss_name);
+		buf = bmalloc(alloc_size);
+		buf->size_class = size_class;
+		profile_end(packet_pool_miss_name);
+	}
+
+	buf->next = NULL;
+	buf->refs = PACKET_BUFFER_POOLED + 1;
+	return (uint8_t *)(&buf->refs + 1);
+}
+
+static void packet_buffer_free(struct packet_buffer *buf)
+{
+	int size_class = buf->size_class;
+
+	if (size_class >= 0) {
+		struct packet_pool_class *pc = &packet_pool[size_class];
+		size_t size = packet_class_size(size_class);
+		bool cached = false;
+
+		pthread_mutex_lock(&packet_pool_mutex);
+		if (pc->num_free < PACKET_POOL_MAX_PER_CLASS &&
+		    packet_pool_bytes + size <= PACKET_POOL_MAX_BYTES) {
+			buf->next = pc->free;
+			pc->free = buf;
+			pc->num_free++;
+			packet_pool_bytes += size;
+			cached = true;
+		}
+		pthread_mutex_unlock(&packet_pool_mutex);
+
+		if (cached)
+			return;
+	}
+
+	bfree(buf);
+}
+
+void obs_free_encoder_packet_pool(void)
+{
+	struct packet_buffer *list = NULL;
+	uint64_t hits, misses;
+
+	pthread_mutex_lock(&packet_pool_mutex);
+	for (size_t i = 0; i < PACKET_POOL_CLASSES; i++) {
+		struct packet_buffer *buf = packet_pool[i].free;
+		while (buf) {
+			struct packet_buffer *next = buf->next;
+			buf->next = list;
+			list = buf;
+			buf = next;
+		}
+
+		packet_pool[i].free = NULL;
+		packet_pool[i].num_free = 0;
+	}
+	hits = packet_pool_hits;
+	misses = packet_pool_misses;
+	packet_pool_bytes = 0;
+	packet_pool_hits = 0;
+	packet_pool_misses = 0;
+	pthread_mutex_unlock(&packet_pool_mutex);
+
+	while (list) {
+		struct packet_buffer *next = list->next;
+		bfree(list);
+		list = next;
+	}
+
+	if (hits + misses)
+		blog(LOG_INFO,
+		     "Encoder packet pool: %" PRIu64 " hits, %" PRIu64
+		     " misses (%.1f%% hit rate)",
+		     hits, misses,
+		     (double)hits * 100.0 / (double)(hits + misses));
+}
+
+uint8_t *obs_encoder_packet_alloc(size_t size)
+{
+	return packet_buffer_alloc(size);
+}
+
 void obs_encoder_packet_create_instance(struct encoder_packet *dst,
 					const struct encoder_packet *src)
 {
-	long *p_refs;
-
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void *)(p_refs + 1);
-	*p_refs = 1;
+	dst->data = packet_buffer_alloc(src->size);
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1795,10 +1983,8 @@ void obs_encoder_packet_ref(struct encoder_packet *dst,
 	if (!src)
 		return;
 
-	if (src->data) {
-		long *p_refs = ((long *)src->data) - 1;
-		os_atomic_inc_long(p_refs);
-	}
+	if (src->data)
+		os_atomic_inc_long(get_packet_refs(src->data));
 
 	*dst = *src;
 }
@@ -1809,8 +1995,12 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 		return;
 
 	if (pkt->data) {
-		long *p_refs = ((long *)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
+		long *p_refs = get_packet_refs(pkt->data);
+		long refs = os_atomic_dec_long(p_refs);
+
+		if (refs == PACKET_BUFFER_POOLED)
+			packet_buffer_free(get_packet_buffer(pkt->data));
+		else if (refs == 0)
 			bfree(p_refs);
 	}
 
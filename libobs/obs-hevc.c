@@ -98,17 +98,17 @@ void obs_parse_hevc_packet(struct encoder_packet *hevc_packet,
 {
 	struct array_output_data output;
 	struct serializer s;
-	long ref = 1;
 
 	array_output_serializer_init(&s, &output);
 	*hevc_packet = *src;
 
-	serialize(&s, &ref, sizeof(ref));
 	serialize_hevc_data(&s, src->data, src->size, &hevc_packet->keyframe,
 			    &hevc_packet->priority);
 
-	hevc_packet->data = output.bytes.array + sizeof(ref);
-	hevc_packet->size = output.bytes.num - sizeof(ref);
+	hevc_packet->size = output.bytes.num;
+	hevc_packet->data = obs_encoder_packet_alloc(hevc_packet->size);
+	memcpy(hevc_packet->data, output.bytes.array, hevc_packet->size);
+	array_output_serializer_free(&output);
 	hevc_packet->drop_priority = hevc_packet->priority;
 }
 
@@ -20,11 +20,13 @@
 #include "util/c99defs.h"
 #include "util/darray.h"
 #include "util/deque.h"
+#include "util/merge-queue.h"
 #include "util/dstr.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/profiler.h"
 #include "util/task.h"
+#include "util/thread-pool.h"
 #include "util/uthash.h"
 #include "callback/signal.h"
 #include "callback/proc.h"
@@ -35,6 +37,7 @@
 #include "media-io/audio-resampler.h"
 #include "media-io/video-io.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-kernels.h"
 
 #include "obs.h"
 
@@ -48,10 +51,12 @@
 	HASH_ADD(hh_uuid, head, uuid_field[0], UUID_STR_LENGTH, add)
 
 #define NUM_TEXTURES 2
+#define MAX_TEXTURES 4
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 10
 #define NUM_ENCODE_TEXTURE_FRAMES_TO_WAIT 1
+#define NUM_FRAME_TIMINGS 300
 
 static inline int64_t packet_dts_usec(struct encoder_packet *packet)
 {
@@ -248,6 +253,11 @@ struct obs_vframe_info {
 	int count;
 };
 
+struct obs_readback {
+	int texture;
+	struct obs_vframe_info info;
+};
+
 struct obs_tex_frame {
 	gs_texture_t *tex;
 	gs_texture_t *tex_uv;
@@ -266,25 +276,42 @@ struct obs_task_info {
 struct obs_core_video_mix {
 	struct obs_view *view;
 
-	gs_stagesurf_t *active_copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
-	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *active_copy_surfaces[MAX_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *copy_surfaces[MAX_TEXTURES][NUM_CHANNELS];
 	gs_texture_t *convert_textures[NUM_CHANNELS];
 	gs_texture_t *convert_textures_encode[NUM_CHANNELS];
 #ifdef _WIN32
-	gs_stagesurf_t *copy_surfaces_encode[NUM_TEXTURES];
+	gs_stagesurf_t *copy_surfaces_encode[MAX_TEXTURES];
 #endif
+	int num_textures;
 	gs_texture_t *render_texture;
 	gs_texture_t *output_texture;
 	enum gs_color_space render_space;
 	bool texture_rendered;
-	bool textures_copied[NUM_TEXTURES];
+	bool texture_staged;
+	/* the rendered texture only has static video and is still up to
+	 * date as long as the video damage counter hasn't changed */
+	bool texture_static;
+	long texture_damage;
 	bool texture_converted;
 	bool using_nv12_tex;
 	bool using_p010_tex;
 	struct deque vframe_info_buffer;
 	struct deque vframe_info_buffer_gpu;
-	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
 	int cur_texture;
+
+	/* raw frames are mapped and copied on the readback thread, staged
+	 * frames are handed to it once they are num_textures - 1 frames old */
+	struct deque readback_staged;
+	pthread_mutex_t readback_mutex;
+	struct deque readback_queue;
+	os_sem_t *readback_semaphore;
+	pthread_t readback_thread;
+	bool readback_thread_initialized;
+	volatile bool readback_stop;
+	volatile bool readback_busy[MAX_TEXTURES];
+	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
+
 	volatile long raw_active;
 	volatile long gpu_encoder_active;
 	bool gpu_was_active;
@@ -319,6 +346,9 @@ extern struct obs_core_video_mix *
 obs_create_video_mix(struct obs_video_info *ovi);
 extern void obs_free_video_mix(struct obs_core_video_mix *video);
 
+extern bool init_readback_thread(struct obs_core_video_mix *video);
+extern void stop_readback_thread(struct obs_core_video_mix *video);
+
 struct obs_core_video {
 	graphics_t *graphics;
 	gs_effect_t *default_effect;
@@ -342,8 +372,14 @@ struct obs_core_video {
 	pthread_t video_thread;
 	uint32_t total_frames;
 	uint32_t lagged_frames;
+	uint32_t reused_frames;
 	bool thread_initialized;
 
+	/* incremented on any change that may affect static video, see
+	 * OBS_SOURCE_STATIC_VIDEO */
+	volatile long damage;
+	bool rendered_dynamic;
+
 	gs_texture_t *transparent_texture;
 
 	gs_effect_t *deinterlace_discard_effect;
@@ -367,6 +403,25 @@ struct obs_core_video {
 	pthread_mutex_t mixes_mutex;
 	DARRAY(struct obs_core_video_mix *) mixes;
 	struct obs_core_video_mix *main_mix;
+
+	/* profiler traces saved on missed frames, kept across video resets */
+	pthread_mutex_t lag_trace_mutex;
+	char *lag_trace_dir;
+	uint64_t lag_trace_duration_ns;
+	uint64_t last_lag_trace_time;
+	volatile bool lag_trace_enabled;
+	volatile bool lag_trace_pending;
+
+	/* number of staging surfaces of new mixes, 0 for the default */
+	volatile long readback_depth;
+
+	/* timings of the most recent frames, the current frame is only
+	 * touched by the graphics thread */
+	struct obs_frame_timing frame_timing;
+	pthread_mutex_t frame_timings_mutex;
+	struct obs_frame_timing frame_timings[NUM_FRAME_TIMINGS];
+	size_t frame_timings_pos;
+	size_t num_frame_timings;
 };
 
 extern void add_ready_encoder_group(obs_encoder_t *encoder);
@@ -375,6 +430,7 @@ struct audio_monitor;
 
 struct obs_core_audio {
 	audio_t *audio;
+	const struct audio_kernels *kernels;
 
 	DARRAY(struct obs_source *) render_order;
 	DARRAY(struct obs_source *) root_nodes;
@@ -393,6 +449,8 @@ struct obs_core_audio {
 
 	pthread_mutex_t task_mutex;
 	struct deque tasks;
+
+	struct audio_render_pool *render_pool;
 };
 
 /* user sources, output channels, and displays */
@@ -429,6 +487,10 @@ struct obs_core_data {
 
 	DARRAY(char *) protocols;
 	DARRAY(obs_source_t *) sources_to_tick;
+
+	/* sources that need to be ticked, see obs_source_request_tick */
+	pthread_mutex_t tick_sources_mutex;
+	DARRAY(struct obs_source *) tick_sources;
 };
 
 /* user hotkeys */
@@ -497,12 +559,23 @@ struct obs_core {
 	struct obs_core_hotkeys hotkeys;
 
 	os_task_queue_t *destruction_task_thread;
+	os_thread_pool_t *thread_pool;
+
+	/* kept outside of obs_core_audio, which is reset with the audio */
+	uint32_t audio_render_threads;
 
 	obs_task_handler_t ui_task_handler;
 };
 
 extern struct obs_core *obs;
 
+/* invalidates the static video of all mixes, can be called from any thread */
+static inline void obs_video_damage(void)
+{
+	if (obs)
+		os_atomic_inc_long(&obs->video.damage);
+}
+
 struct obs_graphics_context {
 	uint64_t last_time;
 	uint64_t interval;
@@ -522,6 +595,12 @@ obs_graphics_thread_loop_autorelease(struct obs_graphics_context *context);
 
 extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 
+#define MAX_AUDIO_RENDER_THREADS 8
+
+extern bool audio_render_pool_init(struct obs_core_audio *audio,
+				   uint32_t threads);
+extern void audio_render_pool_free(struct obs_core_audio *audio);
+
 extern bool audio_callback(void *param, uint64_t start_ts_in,
 			   uint64_t end_ts_in, uint64_t *out_ts,
 			   uint32_t mixers, struct audio_output_data *mixes);
@@ -660,6 +739,10 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+
+	/* set for frames owned by the caller */
+	obs_source_frame_release_t release;
+	void *release_param;
 };
 
 enum audio_action_type {
@@ -732,6 +815,9 @@ struct obs_source {
 	/* ensures activate/deactivate are only called once */
 	volatile long activate_refs;
 
+	/* source is in the tick set (protected by tick_sources_mutex) */
+	bool tick_listed;
+
 	/* source is in the process of being destroyed */
 	volatile long destroying;
 
@@ -777,6 +863,9 @@ struct obs_source {
 	DARRAY(struct audio_action) audio_actions;
 	float *audio_output_buf[MAX_AUDIO_MIXES][MAX_AUDIO_CHANNELS];
 	float *audio_mix_buf[MAX_AUDIO_CHANNELS];
+	/* mixes whose output buffers are known to be all zero, so rendering
+	 * and mixing them can be skipped entirely */
+	uint32_t audio_silent_mixes;
 	struct resample_info sample_info;
 	audio_resampler_t *resampler;
 	pthread_mutex_t audio_actions_mutex;
@@ -821,6 +910,10 @@ struct obs_source {
 	uint32_t async_height;
 	uint32_t async_cache_width;
 	uint32_t async_cache_height;
+	size_t async_pool_size;
+	uint64_t async_frames_reused;
+	uint64_t async_frames_dropped;
+	uint64_t async_cache_overflows;
 	uint32_t async_convert_width[MAX_AV_PLANES];
 	uint32_t async_convert_height[MAX_AV_PLANES];
 
@@ -1021,6 +1114,10 @@ extern void obs_source_set_texcoords_centered(obs_source_t *source,
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+extern void obs_source_request_tick(obs_source_t *source);
+extern bool obs_source_needs_tick(const obs_source_t *source);
+extern void obs_source_drop_tick(obs_source_t *source);
+extern bool obs_source_video_static(const obs_source_t *source);
 extern float obs_source_get_target_volume(obs_source_t *source,
 					  obs_source_t *target);
 
@@ -1135,7 +1232,7 @@ struct obs_output {
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
 	pthread_mutex_t interleaved_mutex;
-	DARRAY(struct encoder_packet) interleaved_packets;
+	struct merge_queue interleaved_packets;
 	int stop_code;
 
 	int reconnect_retry_sec;
@@ -1226,6 +1323,7 @@ extern void obs_output_remove_encoder(struct obs_output *output,
 extern void
 obs_encoder_packet_create_instance(struct encoder_packet *dst,
 				   const struct encoder_packet *src);
+extern void obs_free_encoder_packet_pool(void);
 void obs_output_destroy(obs_output_t *output);
 
 /* ------------------------------------------------------------------------- */
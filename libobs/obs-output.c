@@ -166,6 +166,34 @@ static bool init_output_handlers(struct obs_output *output, const char *name,
 	return true;
 }
 
+/* interleaved packets are queued per track, video tracks come first */
+#define NUM_INTERLEAVE_LANES \
+	(MAX_OUTPUT_VIDEO_ENCODERS + MAX_OUTPUT_AUDIO_ENCODERS)
+
+static inline size_t packet_lane(enum obs_encoder_type type, size_t track_idx)
+{
+	if (type == OBS_ENCODER_VIDEO)
+		return track_idx;
+	return MAX_OUTPUT_VIDEO_ENCODERS + track_idx;
+}
+
+/* sorts by DTS; on equal DTS, video goes first and video tracks are sorted
+ * by track index to prevent the pruning logic from removing additional
+ * video tracks */
+static int interleaved_packet_compare(const void *a, const void *b)
+{
+	const struct encoder_packet *pa = a;
+	const struct encoder_packet *pb = b;
+
+	if (pa->dts_usec != pb->dts_usec)
+		return pa->dts_usec < pb->dts_usec ? -1 : 1;
+	if (pa->type != pb->type)
+		return pa->type == OBS_ENCODER_VIDEO ? -1 : 1;
+	if (pa->track_idx != pb->track_idx)
+		return pa->track_idx < pb->track_idx ? -1 : 1;
+	return 0;
+}
+
 obs_output_t *obs_output_create(const char *id, const char *name,
 				obs_data_t *settings, obs_data_t *hotkey_data)
 {
@@ -174,6 +202,9 @@ obs_output_t *obs_output_create(const char *id, const char *name,
 	int ret;
 
 	output = bzalloc(sizeof(struct obs_output));
+	merge_queue_init(&output->interleaved_packets,
+			 sizeof(struct encoder_packet), NUM_INTERLEAVE_LANES,
+			 interleaved_packet_compare);
 	pthread_mutex_init_value(&output->interleaved_mutex);
 	pthread_mutex_init_value(&output->delay_mutex);
 	pthread_mutex_init_value(&output->pause.mutex);
@@ -238,10 +269,15 @@ fail:
 
 static inline void free_packets(struct obs_output *output)
 {
-	for (size_t i = 0; i < output->interleaved_packets.num; i++)
-		obs_encoder_packet_release(output->interleaved_packets.array +
-					   i);
-	da_free(output->interleaved_packets);
+	struct merge_queue *mq = &output->interleaved_packets;
+
+	for (size_t lane = 0; lane < mq->num_lanes; lane++) {
+		for (size_t i = 0; i < merge_queue_lane_size(mq, lane); i++)
+			obs_encoder_packet_release(
+				merge_queue_lane_item(mq, lane, i));
+	}
+
+	merge_queue_clear(mq);
 }
 
 static inline void clear_raw_audio_buffers(obs_output_t *output)
@@ -285,6 +321,7 @@ void obs_output_destroy(obs_output_t *output)
 			output->info.destroy(output->context.data);
 
 		free_packets(output);
+		merge_queue_free(&output->interleaved_packets);
 
 		for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
 			if (output->video_encoders[i]) {
@@ -1534,7 +1571,6 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	sei_t sei;
 	uint8_t *data = NULL;
 	size_t size;
-	long ref = 1;
 	bool avc = false;
 	bool hevc = false;
 	bool av1 = false;
@@ -1595,7 +1631,6 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 	sei_init(&sei, 0.0);
 
 	da_init(out_data);
-	da_push_back_array(out_data, (uint8_t *)&ref, sizeof(ref));
 	da_push_back_array(out_data, out->data, out->size);
 
 	if (ctrack->caption_data.size > 0) {
@@ -1716,24 +1751,28 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 		obs_encoder_packet_release(out);
 
 		*out = backup;
-		out->data = (uint8_t *)out_data.array + sizeof(ref);
-		out->size = out_data.num - sizeof(ref);
+		out->data = obs_encoder_packet_alloc(out_data.num);
+		out->size = out_data.num;
+		memcpy(out->data, out_data.array, out_data.num);
 	}
+	da_free(out_data);
 	sei_free(&sei);
 	return avc || hevc || av1;
 }
 
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct merge_queue *mq = &output->interleaved_packets;
+	struct encoder_packet *first = merge_queue_peek(mq);
+	struct encoder_packet out;
 
 	/* do not send an interleaved packet if there's no packet of the
 	 * opposing type of a higher timestamp in the interleave buffer.
 	 * this ensures that the timestamps are monotonic */
-	if (!has_higher_opposing_ts(output, &out))
+	if (!first || !has_higher_opposing_ts(output, first))
 		return;
 
-	da_erase(output->interleaved_packets, 0);
+	merge_queue_pop(mq, &out);
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -1791,39 +1830,59 @@ static inline void set_higher_ts(struct obs_output *output,
 
 static inline struct encoder_packet *
 find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
-		       size_t audio_idx);
-static int find_first_packet_type_idx(struct obs_output *output,
-				      enum obs_encoder_type type,
-				      size_t audio_idx);
+		       size_t idx)
+{
+	return merge_queue_lane_front(&output->interleaved_packets,
+				      packet_lane(type, idx));
+}
+
+static inline struct encoder_packet *
+find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
+		      size_t idx)
+{
+	return merge_queue_lane_back(&output->interleaved_packets,
+				     packet_lane(type, idx));
+}
 
 /* gets the point where audio and video are closest together */
-static size_t get_interleaved_start_idx(struct obs_output *output)
+static bool get_interleaved_start(struct obs_output *output,
+				  struct encoder_packet *start)
 {
+	struct merge_queue *mq = &output->interleaved_packets;
 	int64_t closest_diff = 0x7FFFFFFFFFFFFFFFLL;
 	struct encoder_packet *first_video =
 		find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
-	size_t video_idx = DARRAY_INVALID;
-	size_t idx = 0;
-
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		int64_t diff;
+	struct encoder_packet *closest = NULL;
 
-		if (packet->type != OBS_ENCODER_AUDIO) {
-			if (packet == first_video)
-				video_idx = i;
-			continue;
-		}
+	if (!first_video)
+		return false;
 
-		diff = llabs(packet->dts_usec - first_video->dts_usec);
-		if (diff < closest_diff) {
-			closest_diff = diff;
-			idx = i;
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		size_t lane = packet_lane(OBS_ENCODER_AUDIO, i);
+
+		for (size_t j = 0; j < merge_queue_lane_size(mq, lane); j++) {
+			struct encoder_packet *packet =
+				merge_queue_lane_item(mq, lane, j);
+			int64_t diff =
+				llabs(packet->dts_usec - first_video->dts_usec);
+
+			if (diff < closest_diff ||
+			    (diff == closest_diff &&
+			     interleaved_packet_compare(packet, closest) < 0)) {
+				closest_diff = diff;
+				closest = packet;
+			}
 		}
 	}
 
-	return video_idx < idx ? video_idx : idx;
+	if (!closest)
+		return false;
+
+	if (interleaved_packet_compare(first_video, closest) < 0)
+		*start = *first_video;
+	else
+		*start = *closest;
+	return true;
 }
 
 static int64_t get_encoder_duration(struct obs_encoder *encoder)
@@ -1832,43 +1891,41 @@ static int64_t get_encoder_duration(struct obs_encoder *encoder)
 	       encoder->framesize;
 }
 
-static int prune_premature_packets(struct obs_output *output)
+/* returns -1 if not all tracks have packets yet, 1 if everything up to and
+ * including prune_to is premature, 0 otherwise */
+static int prune_premature_packets(struct obs_output *output,
+				   struct encoder_packet *prune_to)
 {
 	struct encoder_packet *video;
-	int video_idx;
-	int max_idx;
+	struct encoder_packet *last;
 	int64_t duration_usec, max_audio_duration_usec = 0;
 	int64_t max_diff = 0;
 	int64_t diff = 0;
 	int audio_encoders = 0;
 
-	video_idx = find_first_packet_type_idx(output, OBS_ENCODER_VIDEO, 0);
-	if (video_idx == -1)
+	video = find_first_packet_type(output, OBS_ENCODER_VIDEO, 0);
+	if (!video)
 		return -1;
 
-	max_idx = video_idx;
-	video = &output->interleaved_packets.array[video_idx];
+	last = video;
 	duration_usec = video->timebase_num * 1000000LL / video->timebase_den;
 
 	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
 		struct encoder_packet *audio;
-		int audio_idx;
 		int64_t audio_duration_usec = 0;
 
 		if (!output->audio_encoders[i])
 			continue;
 		audio_encoders++;
 
-		audio_idx = find_first_packet_type_idx(output,
-						       OBS_ENCODER_AUDIO, i);
-		if (audio_idx == -1) {
+		audio = find_first_packet_type(output, OBS_ENCODER_AUDIO, i);
+		if (!audio) {
 			output->received_audio = false;
 			return -1;
 		}
 
-		audio = &output->interleaved_packets.array[audio_idx];
-		if (audio_idx > max_idx)
-			max_idx = audio_idx;
+		if (interleaved_packet_compare(audio, last) > 0)
+			last = audio;
 
 		diff = audio->dts_usec - video->dts_usec;
 		if (diff > max_diff)
@@ -1890,97 +1947,73 @@ static int prune_premature_packets(struct obs_output *output)
 		duration_usec = max_audio_duration_usec;
 	}
 
-	return diff > duration_usec ? max_idx + 1 : 0;
+	if (diff > duration_usec) {
+		*prune_to = *last;
+		return 1;
+	}
+	return 0;
 }
 
-static void discard_to_idx(struct obs_output *output, size_t idx)
+/* discards every packet sorted before (or up to and including) end */
+static void discard_interleaved_packets(struct obs_output *output,
+					const struct encoder_packet *end,
+					bool inclusive)
 {
-	for (size_t i = 0; i < idx; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		obs_encoder_packet_release(packet);
-	}
+	struct merge_queue *mq = &output->interleaved_packets;
+	struct encoder_packet key = *end;
+	struct encoder_packet packet;
 
-	da_erase_range(output->interleaved_packets, 0, idx);
+	for (size_t lane = 0; lane < mq->num_lanes; lane++) {
+		while (merge_queue_lane_size(mq, lane)) {
+			int cmp = interleaved_packet_compare(
+				merge_queue_lane_front(mq, lane), &key);
+			if (cmp > 0 || (cmp == 0 && !inclusive))
+				break;
+
+			merge_queue_pop_lane(mq, lane, &packet);
+			obs_encoder_packet_release(&packet);
+		}
+	}
 }
 
 #define DEBUG_STARTING_PACKETS 0
 
 static bool prune_interleaved_packets(struct obs_output *output)
 {
-	size_t start_idx = 0;
-	int prune_start = prune_premature_packets(output);
+	struct encoder_packet start;
+	int prune_start = prune_premature_packets(output, &start);
 
 #if DEBUG_STARTING_PACKETS == 1
+	struct merge_queue *mq = &output->interleaved_packets;
+
 	blog(LOG_DEBUG, "--------- Pruning! %d ---------", prune_start);
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
-		     packet->type == OBS_ENCODER_AUDIO ? "audio" : "video",
-		     (int)packet->track_idx, packet->dts_usec,
-		     (int)i < prune_start ? "true" : "false");
+	for (size_t lane = 0; lane < mq->num_lanes; lane++) {
+		for (size_t i = 0; i < merge_queue_lane_size(mq, lane); i++) {
+			struct encoder_packet *packet =
+				merge_queue_lane_item(mq, lane, i);
+			bool pruned = prune_start == 1 &&
+				      interleaved_packet_compare(packet,
+								 &start) <= 0;
+			blog(LOG_DEBUG, "packet: %s %d, ts: %lld, pruned = %s",
+			     packet->type == OBS_ENCODER_AUDIO ? "audio"
+							       : "video",
+			     (int)packet->track_idx, packet->dts_usec,
+			     pruned ? "true" : "false");
+		}
 	}
 #endif
 
 	/* prunes the first video packet if it's too far away from audio */
 	if (prune_start == -1)
 		return false;
-	else if (prune_start != 0)
-		start_idx = (size_t)prune_start;
-	else
-		start_idx = get_interleaved_start_idx(output);
-
-	if (start_idx)
-		discard_to_idx(output, start_idx);
+	else if (prune_start == 1)
+		discard_interleaved_packets(output, &start, true);
+	else if (get_interleaved_start(output, &start))
+		discard_interleaved_packets(output, &start, false);
 
 	return true;
 }
 
-static int find_first_packet_type_idx(struct obs_output *output,
-				      enum obs_encoder_type type, size_t idx)
-{
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)i;
-	}
-
-	return -1;
-}
-
-static int find_last_packet_type_idx(struct obs_output *output,
-				     enum obs_encoder_type type, size_t idx)
-{
-	for (size_t i = output->interleaved_packets.num; i > 0; i--) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i - 1];
-
-		if (packet->type == type && packet->track_idx == idx)
-			return (int)(i - 1);
-	}
-
-	return -1;
-}
-
-static inline struct encoder_packet *
-find_first_packet_type(struct obs_output *output, enum obs_encoder_type type,
-		       size_t audio_idx)
-{
-	int idx = find_first_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
-static inline struct encoder_packet *
-find_last_packet_type(struct obs_output *output, enum obs_encoder_type type,
-		      size_t audio_idx)
-{
-	int idx = find_last_packet_type_idx(output, type, audio_idx);
-	return (idx != -1) ? &output->interleaved_packets.array[idx] : NULL;
-}
-
 static bool get_audio_and_video_packets(struct obs_output *output,
 					struct encoder_packet **video,
 					struct encoder_packet **audio)
@@ -2018,7 +2051,8 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	struct encoder_packet *video[MAX_OUTPUT_VIDEO_ENCODERS] = {0};
 	struct encoder_packet *audio[MAX_OUTPUT_AUDIO_ENCODERS] = {0};
 	struct encoder_packet *last_audio[MAX_OUTPUT_AUDIO_ENCODERS] = {0};
-	size_t start_idx;
+	struct merge_queue *mq = &output->interleaved_packets;
+	struct encoder_packet start;
 	size_t first_audio_idx;
 	size_t first_video_idx;
 
@@ -2049,9 +2083,8 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	}
 
 	/* clear out excess starting audio if it hasn't been already */
-	start_idx = get_interleaved_start_idx(output);
-	if (start_idx) {
-		discard_to_idx(output, start_idx);
+	if (get_interleaved_start(output, &start)) {
+		discard_interleaved_packets(output, &start, false);
 		if (!get_audio_and_video_packets(output, video, audio))
 			return false;
 	}
@@ -2082,75 +2115,51 @@ static bool initialize_interleaved_packets(struct obs_output *output)
 	output->highest_audio_ts -= audio[first_audio_idx]->dts_usec;
 
 	/* apply new offsets to all existing packet DTS/PTS values */
-	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
-		struct encoder_packet *packet =
-			&output->interleaved_packets.array[i];
-		apply_interleaved_packet_offset(output, packet);
+	for (size_t lane = 0; lane < mq->num_lanes; lane++) {
+		for (size_t i = 0; i < merge_queue_lane_size(mq, lane); i++)
+			apply_interleaved_packet_offset(
+				output, merge_queue_lane_item(mq, lane, i));
 	}
 
+	merge_queue_rebuild(mq);
 	return true;
 }
 
 static inline void insert_interleaved_packet(struct obs_output *output,
 					     struct encoder_packet *out)
 {
-	size_t idx;
-	for (idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *cur_packet;
-		cur_packet = output->interleaved_packets.array + idx;
-
-		// sort video packets with same DTS by track index,
-		// to prevent the pruning logic from removing additional
-		// video tracks
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO &&
-		    cur_packet->type == OBS_ENCODER_VIDEO &&
-		    out->track_idx > cur_packet->track_idx)
-			continue;
-
-		if (out->dts_usec == cur_packet->dts_usec &&
-		    out->type == OBS_ENCODER_VIDEO) {
-			break;
-		} else if (out->dts_usec < cur_packet->dts_usec) {
-			break;
-		}
-	}
-
-	da_insert(output->interleaved_packets, idx, out);
+	merge_queue_push(&output->interleaved_packets,
+			 packet_lane(out->type, out->track_idx), out);
 }
 
 static void resort_interleaved_packets(struct obs_output *output)
 {
-	DARRAY(struct encoder_packet) old_array;
-
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0,
-	       sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++) {
-		set_higher_ts(output, &old_array.array[i]);
+	struct merge_queue *mq = &output->interleaved_packets;
 
-		insert_interleaved_packet(output, &old_array.array[i]);
+	for (size_t lane = 0; lane < mq->num_lanes; lane++) {
+		for (size_t i = 0; i < merge_queue_lane_size(mq, lane); i++)
+			set_higher_ts(output,
+				      merge_queue_lane_item(mq, lane, i));
 	}
 
-	da_free(old_array);
+	merge_queue_rebuild(mq);
 }
 
 static void discard_unused_audio_packets(struct obs_output *output,
 					 int64_t dts_usec)
 {
-	size_t idx = 0;
+	struct merge_queue *mq = &output->interleaved_packets;
+	struct encoder_packet packet;
 
-	for (; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *p =
-			&output->interleaved_packets.array[idx];
+	for (size_t lane = 0; lane < mq->num_lanes; lane++) {
+		struct encoder_packet *p;
 
-		if (p->dts_usec >= dts_usec)
-			break;
+		while ((p = merge_queue_lane_front(mq, lane)) &&
+		       p->dts_usec < dts_usec) {
+			merge_queue_pop_lane(mq, lane, &packet);
+			obs_encoder_packet_release(&packet);
+		}
 	}
-
-	if (idx)
-		discard_to_idx(output, idx);
 }
 
 static bool purge_encoder_group_keyframe_data(obs_output_t *output, size_t idx)
@@ -2271,7 +2280,7 @@ static void interleave_packets(void *data, struct encoder_packet *packet)
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_encoder_packet_create_instance(&out, packet);
+		obs_encoder_packet_ref(&out, packet);
 
 	if (was_started)
 		apply_interleaved_packet_offset(output, &out);
@@ -317,6 +317,7 @@ static inline void detach_sceneitem(struct obs_scene_item *item)
 		item->next->prev = item->prev;
 
 	item->parent = NULL;
+	obs_video_damage();
 }
 
 static inline void attach_sceneitem(struct obs_scene *parent,
@@ -325,6 +326,7 @@ static inline void attach_sceneitem(struct obs_scene *parent,
 {
 	item->prev = prev;
 	item->parent = parent;
+	obs_video_damage();
 
 	if (prev) {
 		item->next = prev->next;
@@ -504,6 +506,8 @@ static void update_item_transform(struct obs_scene_item *item, bool update_tex)
 	if (os_atomic_load_long(&item->defer_update) > 0)
 		return;
 
+	obs_video_damage();
+
 	/* Reset bounds crop */
 	memset(&item->bounds_crop, 0, sizeof(item->bounds_crop));
 
@@ -587,6 +591,13 @@ static inline bool source_size_changed(struct obs_scene_item *item)
 	return item->last_width != width || item->last_height != height;
 }
 
+/* the transform is applied on the next render, which must not be skipped */
+static inline void set_update_transform(struct obs_scene_item *item)
+{
+	os_atomic_set_bool(&item->update_transform, true);
+	obs_video_damage();
+}
+
 static inline bool crop_enabled(const struct obs_sceneitem_crop *crop)
 {
 	return crop->left || crop->right || crop->top || crop->bottom;
@@ -906,6 +917,32 @@ cleanup:
 	GS_DEBUG_MARKER_END();
 }
 
+/* assumes video lock */
+static bool scene_needs_update(obs_scene_t *scene)
+{
+	struct obs_scene_item *item = scene->first_item;
+	bool needs_update = false;
+
+	while (item && !needs_update) {
+		if (obs_source_removed(item->source) ||
+		    os_atomic_load_bool(&item->update_transform) ||
+		    source_size_changed(item)) {
+			needs_update = true;
+
+		} else if (item->is_group) {
+			obs_scene_t *group_scene = item->source->context.data;
+
+			video_lock(group_scene);
+			needs_update = scene_needs_update(group_scene);
+			video_unlock(group_scene);
+		}
+
+		item = item->next;
+	}
+
+	return needs_update;
+}
+
 static void scene_video_tick(void *data, float seconds)
 {
 	struct obs_scene *scene = data;
@@ -918,6 +955,10 @@ static void scene_video_tick(void *data, float seconds)
 			gs_texrender_reset(item->item_render);
 		item = item->next;
 	}
+
+	/* removed sources and new sizes are only picked up while rendering */
+	if (!scene->is_group && scene_needs_update(scene))
+		obs_video_damage();
 	video_unlock(scene);
 
 	UNUSED_PARAMETER(seconds);
@@ -1022,6 +1063,7 @@ static void set_visibility(struct obs_scene_item *item, bool vis)
 	os_atomic_set_long(&item->active_refs, vis ? 1 : 0);
 	item->visible = vis;
 	item->user_visible = vis;
+	obs_video_damage();
 
 	pthread_mutex_unlock(&item->actions_mutex);
 }
@@ -1391,6 +1433,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item,
 		da_erase(item->audio_actions, i--);
 
 		item->visible = action.visible;
+		obs_video_damage();
 		if (!item->visible)
 			deref_count++;
 
@@ -1573,6 +1616,8 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 			if ((mixers & (1 << mix)) == 0)
 				continue;
+			if ((source->audio_silent_mixes & (1 << mix)) != 0)
+				continue;
 
 			for (size_t ch = 0; ch < channels; ch++) {
 				float *out = audio_output->output[mix].data[ch];
@@ -1619,7 +1664,7 @@ const struct obs_source_info scene_info = {
 	.type = OBS_SOURCE_TYPE_SCENE,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
 			OBS_SOURCE_COMPOSITE | OBS_SOURCE_DO_NOT_DUPLICATE |
-			OBS_SOURCE_SRGB,
+			OBS_SOURCE_SRGB | OBS_SOURCE_STATIC_VIDEO,
 	.get_name = scene_getname,
 	.create = scene_create,
 	.destroy = scene_destroy,
@@ -1639,7 +1684,8 @@ const struct obs_source_info group_info = {
 	.id = "group",
 	.type = OBS_SOURCE_TYPE_SCENE,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-			OBS_SOURCE_COMPOSITE | OBS_SOURCE_SRGB,
+			OBS_SOURCE_COMPOSITE | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = group_getname,
 	.create = scene_create,
 	.destroy = scene_destroy,
@@ -1786,7 +1832,7 @@ static inline void duplicate_item_data(struct obs_scene_item *dst,
 	obs_sceneitem_set_locked(dst, src->locked);
 
 	if (defer_texture_update) {
-		os_atomic_set_bool(&dst->update_transform, true);
+		set_update_transform(dst);
 	}
 
 	obs_data_apply(dst->private_settings, src->private_settings);
@@ -2592,7 +2638,7 @@ bool obs_sceneitem_selected(const obs_sceneitem_t *item)
 #define do_update_transform(item)                                          \
 	do {                                                               \
 		if (!item->parent || item->parent->is_group)               \
-			os_atomic_set_bool(&item->update_transform, true); \
+			set_update_transform(item);                        \
 		else                                                       \
 			update_item_transform(item, false);                \
 	} while (false)
@@ -2636,6 +2682,7 @@ static inline void signal_reorder(struct obs_scene_item *item)
 	uint8_t stack[128];
 
 	command = "reorder";
+	obs_video_damage();
 
 	calldata_init_fixed(&params, stack, sizeof(stack));
 	signal_parent(item->parent, command, &params);
@@ -2648,6 +2695,7 @@ static inline void signal_refresh(obs_scene_t *scene)
 	uint8_t stack[128];
 
 	command = "refresh";
+	obs_video_damage();
 
 	calldata_init_fixed(&params, stack, sizeof(stack));
 	signal_parent(scene, command, &params);
@@ -3124,7 +3172,7 @@ void obs_sceneitem_set_crop(obs_sceneitem_t *item,
 	if (item->crop.bottom < 0)
 		item->crop.bottom = 0;
 
-	os_atomic_set_bool(&item->update_transform, true);
+	set_update_transform(item);
 }
 
 void obs_sceneitem_get_crop(const obs_sceneitem_t *item,
@@ -3146,7 +3194,7 @@ void obs_sceneitem_set_scale_filter(obs_sceneitem_t *item,
 
 	item->scale_filter = filter;
 
-	os_atomic_set_bool(&item->update_transform, true);
+	set_update_transform(item);
 }
 
 enum obs_scale_type obs_sceneitem_get_scale_filter(obs_sceneitem_t *item)
@@ -3163,6 +3211,7 @@ void obs_sceneitem_set_blending_method(obs_sceneitem_t *item,
 		return;
 
 	item->blend_method = method;
+	obs_video_damage();
 }
 
 enum obs_blending_method
@@ -3181,7 +3230,7 @@ void obs_sceneitem_set_blending_mode(obs_sceneitem_t *item,
 
 	item->blend_type = type;
 
-	os_atomic_set_bool(&item->update_transform, true);
+	set_update_transform(item);
 }
 
 enum obs_blending_type obs_sceneitem_get_blending_mode(obs_sceneitem_t *item)
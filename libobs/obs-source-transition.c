@@ -270,6 +270,8 @@ set_source(obs_source_t *transition, enum obs_transition_target target,
 
 	unlock_transition(transition);
 
+	obs_video_damage();
+
 	if (add_success) {
 		if (transition->transition_cx == 0 ||
 		    transition->transition_cy == 0) {
@@ -350,6 +352,7 @@ static bool activate_transition(obs_source_t *transition, size_t idx,
 
 	transition->transitioning_video = true;
 	transition->transitioning_audio = true;
+	obs_video_damage();
 	return true;
 }
 
@@ -407,6 +410,7 @@ bool obs_transition_start(obs_source_t *transition,
 	if (dest == NULL && same_as_dest && !same_as_source) {
 		transition->transitioning_video = true;
 		transition->transitioning_audio = true;
+		obs_video_damage();
 	}
 
 	obs_source_dosignal(transition, "source_transition_start",
@@ -459,6 +463,8 @@ void obs_transition_set(obs_source_t *transition, obs_source_t *source)
 	transition->transition_manual_target = 0.0f;
 	unlock_transition(transition);
 
+	obs_video_damage();
+
 	for (size_t i = 0; i < 2; i++) {
 		if (s[i] && active[i])
 			obs_source_remove_active_child(transition, s[i]);
@@ -1113,6 +1119,7 @@ copy_source_state(obs_source_t *tr_dest, obs_source_t *tr_source, size_t idx)
 
 	tr_dest->transition_sources[idx] = new_child;
 	tr_dest->transition_source_active[idx] = active;
+	obs_video_damage();
 
 	if (active && new_child)
 		obs_source_add_active_child(tr_dest, new_child);
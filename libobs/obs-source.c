@@ -232,6 +232,66 @@ static bool obs_source_init(struct obs_source *source)
 	return true;
 }
 
+/* sources that have to be ticked every frame no matter if they are shown,
+ * everything else only needs a tick while shown or when something changed */
+static inline bool always_ticks(const struct obs_source *source)
+{
+	return source->info.video_tick ||
+	       source->info.type == OBS_SOURCE_TYPE_FILTER ||
+	       source->info.type == OBS_SOURCE_TYPE_TRANSITION ||
+	       (source->info.output_flags &
+		(OBS_SOURCE_ASYNC | OBS_SOURCE_CONTROLLABLE_MEDIA)) != 0;
+}
+
+bool obs_source_video_static(const obs_source_t *source)
+{
+	/* idle transitions only render their current source */
+	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
+		return !source->transitioning_video;
+
+	return (source->info.output_flags & OBS_SOURCE_STATIC_VIDEO) != 0;
+}
+
+static inline void mark_video_rendered(const obs_source_t *source)
+{
+	if (!obs_source_video_static(source))
+		obs->video.rendered_dynamic = true;
+}
+
+bool obs_source_needs_tick(const obs_source_t *source)
+{
+	return always_ticks(source) || source->showing || source->active ||
+	       os_atomic_load_long(&source->show_refs) > 0 ||
+	       os_atomic_load_long(&source->activate_refs) > 0 ||
+	       os_atomic_load_long(&source->defer_update_count) > 0;
+}
+
+void obs_source_request_tick(obs_source_t *source)
+{
+	struct obs_core_data *data = &obs->data;
+
+	pthread_mutex_lock(&data->tick_sources_mutex);
+	if (!source->tick_listed) {
+		da_push_back(data->tick_sources, &source);
+		source->tick_listed = true;
+	}
+	pthread_mutex_unlock(&data->tick_sources_mutex);
+}
+
+/* called from the video thread after a tick, rechecked under the lock in
+ * case the source was requested again in the meantime */
+void obs_source_drop_tick(obs_source_t *source)
+{
+	struct obs_core_data *data = &obs->data;
+
+	pthread_mutex_lock(&data->tick_sources_mutex);
+	if (source->tick_listed && !obs_source_needs_tick(source)) {
+		da_erase_item(data->tick_sources, &source);
+		source->tick_listed = false;
+	}
+	pthread_mutex_unlock(&data->tick_sources_mutex);
+}
+
 static void obs_source_init_finalize(struct obs_source *source)
 {
 	if (is_audio_source(source)) {
@@ -254,6 +314,9 @@ static void obs_source_init_finalize(struct obs_source *source)
 	}
 	obs_context_data_insert_uuid(&source->context, &obs->data.sources_mutex,
 				     &obs->data.sources);
+
+	if (always_ticks(source))
+		obs_source_request_tick(source);
 }
 
 static bool obs_source_hotkey_mute(void *data, obs_hotkey_pair_id id,
@@ -627,6 +690,8 @@ static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 static bool obs_source_filter_remove_refless(obs_source_t *source,
 					     obs_source_t *filter);
 static void obs_source_destroy_defer(struct obs_source *source);
+static void free_async_cache(struct obs_source *source);
+static void release_unused_frames(struct obs_source *source);
 
 void obs_source_destroy(struct obs_source *source)
 {
@@ -674,6 +739,13 @@ void obs_source_destroy(struct obs_source *source)
 		obs_context_data_remove_name(&source->context,
 					     &obs->data.public_sources);
 
+	pthread_mutex_lock(&obs->data.tick_sources_mutex);
+	if (source->tick_listed) {
+		da_erase_item(obs->data.tick_sources, &source);
+		source->tick_listed = false;
+	}
+	pthread_mutex_unlock(&obs->data.tick_sources_mutex);
+
 	/* defer source destroy */
 	os_task_queue_queue_task(obs->destruction_task_thread,
 				 (os_task_t)obs_source_destroy_defer, source);
@@ -689,6 +761,11 @@ static void obs_source_destroy_defer(struct obs_source *source)
 
 	obs_source_dosignal(source, "source_destroy", "destroy");
 
+	/* sources may need their frames back before they can be destroyed */
+	pthread_mutex_lock(&source->async_mutex);
+	free_async_cache(source);
+	pthread_mutex_unlock(&source->async_mutex);
+
 	if (source->context.data) {
 		source->info.destroy(source->context.data);
 		source->context.data = NULL;
@@ -703,9 +780,6 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	obs_hotkey_unregister(source->push_to_mute_key);
 	obs_hotkey_pair_unregister(source->mute_unmute_key);
 
-	for (i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
-
 	gs_enter_context(obs->video.graphics);
 	if (source->async_texrender)
 		gs_texrender_destroy(source->async_texrender);
@@ -854,6 +928,9 @@ void obs_source_remove(obs_source_t *source)
 			s->removed = true;
 			obs_source_dosignal(s, "source_remove", "remove");
 			obs_source_release(s);
+
+			/* scenes stop drawing it on the next render */
+			obs_video_damage();
 		}
 	}
 }
@@ -982,6 +1059,7 @@ static void obs_source_deferred_update(obs_source_t *source)
 				    source->context.settings);
 		os_atomic_compare_swap_long(&source->defer_update_count, count,
 					    0);
+		obs_video_damage();
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -997,6 +1075,7 @@ void obs_source_update(obs_source_t *source, obs_data_t *settings)
 
 	if (source->info.output_flags & OBS_SOURCE_VIDEO) {
 		os_atomic_inc_long(&source->defer_update_count);
+		obs_source_request_tick(source);
 	} else if (source->context.data && source->info.update) {
 		source->info.update(source->context.data,
 				    source->context.settings);
@@ -1013,6 +1092,14 @@ void obs_source_reset_settings(obs_source_t *source, obs_data_t *settings)
 	obs_source_update(source, settings);
 }
 
+void obs_source_content_changed(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_content_changed"))
+		return;
+
+	obs_video_damage();
+}
+
 void obs_source_update_properties(obs_source_t *source)
 {
 	if (!obs_source_valid(source, "obs_source_update_properties"))
@@ -1135,6 +1222,7 @@ static void activate_tree(obs_source_t *parent, obs_source_t *child,
 			  void *param)
 {
 	os_atomic_inc_long(&child->activate_refs);
+	obs_source_request_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1152,6 +1240,7 @@ static void deactivate_tree(obs_source_t *parent, obs_source_t *child,
 static void show_tree(obs_source_t *parent, obs_source_t *child, void *param)
 {
 	os_atomic_inc_long(&child->show_refs);
+	obs_source_request_tick(child);
 
 	UNUSED_PARAMETER(parent);
 	UNUSED_PARAMETER(param);
@@ -1171,6 +1260,7 @@ void obs_source_activate(obs_source_t *source, enum view_type type)
 		return;
 
 	os_atomic_inc_long(&source->show_refs);
+	obs_source_request_tick(source);
 	obs_source_enum_active_tree(source, show_tree, NULL);
 
 	if (type == MAIN_VIEW) {
@@ -1295,6 +1385,8 @@ static void async_tick(obs_source_t *source)
 		source->async_update_texture =
 			set_async_texture_size(source, source->cur_async_frame);
 
+	release_unused_frames(source);
+
 	pthread_mutex_unlock(&source->async_mutex);
 }
 
@@ -2929,6 +3021,8 @@ static void source_render(obs_source_t *source, gs_effect_t *effect)
 void obs_source_default_render(obs_source_t *source)
 {
 	if (source->context.data) {
+		mark_video_rendered(source);
+
 		gs_effect_t *effect = obs->video.default_effect;
 		gs_technique_t *tech = gs_effect_get_technique(effect, "Draw");
 		size_t passes, i;
@@ -3014,6 +3108,8 @@ static inline void render_video(obs_source_t *source)
 				     get_type_format(source->info.type),
 				     obs_source_get_name(source));
 
+	mark_video_rendered(source);
+
 	if (source->filters.num && !source->rendering_filter)
 		obs_source_render_filters(source);
 
@@ -3214,6 +3310,8 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_video_damage();
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -3252,6 +3350,8 @@ static bool obs_source_filter_remove_refless(obs_source_t *source,
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
+	obs_video_damage();
+
 	calldata_init_fixed(&cd, stack, sizeof(stack));
 	calldata_set_ptr(&cd, "source", source);
 	calldata_set_ptr(&cd, "filter", filter);
@@ -3384,8 +3484,10 @@ void obs_source_filter_set_order(obs_source_t *source, obs_source_t *filter,
 	success = move_filter_dir(source, filter, movement);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		obs_video_damage();
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 int obs_source_filter_get_index(obs_source_t *source, obs_source_t *filter)
@@ -3431,8 +3533,10 @@ void obs_source_filter_set_index(obs_source_t *source, obs_source_t *filter,
 	success = set_filter_index(source, filter, index);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		obs_video_damage();
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 
 obs_data_t *obs_source_get_settings(const obs_source_t *source)
@@ -3601,86 +3705,245 @@ static inline bool async_texture_changed(struct obs_source *source,
 	       source->async_cache_height != frame->height || prev != cur;
 }
 
-static inline void free_async_cache(struct obs_source *source)
+static void free_async_cache(struct obs_source *source)
 {
-	for (size_t i = 0; i < source->async_cache.num; i++)
-		obs_source_frame_decref(source->async_cache.array[i].frame);
+	for (size_t i = source->async_cache.num; i > 0; i--) {
+		struct async_frame *af = &source->async_cache.array[i - 1];
+		struct obs_source_frame *frame = af->frame;
+
+		if (af->release) {
+			af->used = false;
+		} else {
+			da_erase(source->async_cache, i - 1);
+			obs_source_frame_decref(frame);
+		}
+	}
 
-	da_resize(source->async_cache, 0);
 	da_resize(source->async_frames, 0);
 	source->cur_async_frame = NULL;
 	source->prev_async_frame = NULL;
+	source->async_pool_size = 0;
+
+	release_unused_frames(source);
+}
+
+/* hands frames passed with obs_source_output_video_nocopy back to their owner
+ * once nothing but the cache references them anymore.  this is deferred
+ * rather than done in remove_async_frame, as frames are still accessed for a
+ * short while after being removed. */
+static void release_unused_frames(struct obs_source *source)
+{
+	for (size_t i = source->async_cache.num; i > 0; i--) {
+		struct async_frame *af = &source->async_cache.array[i - 1];
+		struct obs_source_frame *frame = af->frame;
+		obs_source_frame_release_t release = af->release;
+		void *param = af->release_param;
+
+		if (!release || af->used ||
+		    os_atomic_load_long(&frame->refs) > 1)
+			continue;
+
+		da_erase(source->async_cache, i - 1);
+		bfree(frame);
+		release(param);
+	}
+}
+
+/* returns queued frames to the pool without freeing their allocations */
+static void drop_async_frames(struct obs_source *source)
+{
+	for (size_t i = 0; i < source->async_frames.num; i++)
+		remove_async_frame(source, source->async_frames.array[i]);
+
+	source->async_frames_dropped += source->async_frames.num;
+	da_resize(source->async_frames, 0);
 }
 
 #define MAX_UNUSED_FRAME_DURATION 5
+#define MAX_STALE_FRAME_DURATION 60
+
+#define MIN_ASYNC_POOL_FRAMES 2
+#define MAX_ASYNC_POOL_FRAMES 8
+#define MAX_ASYNC_POOL_SIZE (128 * 1024 * 1024)
+
+static inline bool async_frame_compatible(const struct obs_source_frame *a,
+					  const struct obs_source_frame *b)
+{
+	return a->format == b->format && a->width == b->width &&
+	       a->height == b->height && a->full_range == b->full_range;
+}
+
+static struct obs_source_frame *
+add_async_cache_frame(obs_source_t *source,
+		      const struct obs_source_frame *frame, bool used)
+{
+	struct async_frame new_af;
+
+	new_af.frame = obs_source_frame_create(frame->format, frame->width,
+					       frame->height);
+	new_af.frame->full_range = frame->full_range;
+	new_af.frame->refs = 1;
+	new_af.used = used;
+	new_af.unused_count = 0;
+	new_af.release = NULL;
+	new_af.release_param = NULL;
+
+	da_push_back(source->async_cache, &new_af);
+	return new_af.frame;
+}
+
+static size_t count_compatible_frames(obs_source_t *source,
+				      const struct obs_source_frame *frame)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *af = &source->async_cache.array[i];
+		if (!af->release && async_frame_compatible(af->frame, frame))
+			count++;
+	}
+
+	return count;
+}
+
+/* sizes the frame pool for a newly negotiated format and allocates it up
+ * front, so that frames don't have to be allocated while capturing */
+static void reset_async_pool(obs_source_t *source,
+			     const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *pool_frame = NULL;
+	size_t frame_size = 0;
+	size_t pool_size;
+
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		struct async_frame *af = &source->async_cache.array[i];
+		if (!af->release && async_frame_compatible(af->frame, frame)) {
+			pool_frame = af->frame;
+			break;
+		}
+	}
+
+	if (!pool_frame)
+		pool_frame = add_async_cache_frame(source, frame, false);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++)
+		frame_size += (size_t)pool_frame->linesize[i] * frame->height;
+
+	pool_size = frame_size ? MAX_ASYNC_POOL_SIZE / frame_size : 0;
+	if (pool_size < MIN_ASYNC_POOL_FRAMES)
+		pool_size = MIN_ASYNC_POOL_FRAMES;
+	else if (pool_size > MAX_ASYNC_POOL_FRAMES)
+		pool_size = MAX_ASYNC_POOL_FRAMES;
+
+	source->async_pool_size = pool_size;
+
+	for (size_t i = count_compatible_frames(source, frame); i < pool_size;
+	     i++)
+		add_async_cache_frame(source, frame, false);
+}
 
 /* frees frame allocations if they haven't been used for a specific period
- * of time */
-static void clean_cache(obs_source_t *source)
+ * of time.  frames of the current format are kept up to the pool size, the
+ * ones allocated on demand beyond it are freed once idle.  frames of a
+ * previous format are kept a little longer in case the format flips back. */
+static void clean_cache(obs_source_t *source,
+			const struct obs_source_frame *frame)
 {
+	size_t compatible = count_compatible_frames(source, frame);
+
 	for (size_t i = source->async_cache.num; i > 0; i--) {
 		struct async_frame *af = &source->async_cache.array[i - 1];
-		if (!af->used) {
-			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
-				da_erase(source->async_cache, i - 1);
-			}
+		bool current = async_frame_compatible(af->frame, frame);
+		long max_unused = current ? MAX_UNUSED_FRAME_DURATION
+					  : MAX_STALE_FRAME_DURATION;
+
+		if (af->used || af->release)
+			continue;
+		if (current && compatible <= source->async_pool_size)
+			continue;
+
+		if (++af->unused_count >= max_unused) {
+			obs_source_frame_destroy(af->frame);
+			da_erase(source->async_cache, i - 1);
+			if (current)
+				compatible--;
 		}
 	}
+
+	release_unused_frames(source);
 }
 
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *
-cache_video(struct obs_source *source, const struct obs_source_frame *frame)
-{
-	struct obs_source_frame *new_frame = NULL;
-
-	pthread_mutex_lock(&source->async_mutex);
 
+static void update_async_cache_format(struct obs_source *source,
+				      const struct obs_source_frame *frame,
+				      bool pooled)
+{
+	/* the renderer isn't keeping up; rather than letting latency grow or
+	 * freeing the pool, return the backlog to the pool and resync on the
+	 * newest frame */
 	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
-		free_async_cache(source);
+		drop_async_frames(source);
+		source->async_cache_overflows++;
 		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
 	}
 
-	if (async_texture_changed(source, frame)) {
-		free_async_cache(source);
+	bool changed = async_texture_changed(source, frame);
+	bool pool_changed = changed ||
+			    source->async_cache_format != frame->format ||
+			    source->async_cache_full_range != frame->full_range;
+
+	if (changed) {
+		/* deinterlacing needs consecutive frames of the same size */
+		if (deinterlacing_enabled(source)) {
+			drop_async_frames(source);
+			if (source->prev_async_frame) {
+				remove_async_frame(source,
+						   source->prev_async_frame);
+				source->prev_async_frame = NULL;
+			}
+		}
+
 		source->async_cache_width = frame->width;
 		source->async_cache_height = frame->height;
 	}
 
-	const enum video_format format = frame->format;
-	source->async_cache_format = format;
+	if (pooled && (pool_changed || !source->async_pool_size))
+		reset_async_pool(source, frame);
+	else if (pool_changed)
+		source->async_pool_size = 0;
+
+	source->async_cache_format = frame->format;
 	source->async_cache_full_range = frame->full_range;
 	source->async_cache_trc = frame->trc;
+}
+
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
+static inline struct obs_source_frame *
+cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	update_async_cache_format(source, frame, true);
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
+		if (!af->used && !af->release &&
+		    async_frame_compatible(af->frame, frame)) {
 			new_frame = af->frame;
-			new_frame->format = format;
 			af->used = true;
 			af->unused_count = 0;
+			source->async_frames_reused++;
 			break;
 		}
 	}
 
-	clean_cache(source);
-
-	if (!new_frame) {
-		struct async_frame new_af;
-
-		new_frame = obs_source_frame_create(format, frame->width,
-						    frame->height);
-		new_af.frame = new_frame;
-		new_af.used = true;
-		new_af.unused_count = 0;
-		new_frame->refs = 1;
+	if (!new_frame)
+		new_frame = add_async_cache_frame(source, frame, true);
 
-		da_push_back(source->async_cache, &new_af);
-	}
+	clean_cache(source, frame);
 
 	os_atomic_inc_long(&new_frame->refs);
 
@@ -3740,6 +4003,49 @@ void obs_source_output_video(obs_source_t *source,
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+void obs_source_output_video_nocopy(obs_source_t *source,
+				    const struct obs_source_frame *frame,
+				    obs_source_frame_release_t release,
+				    void *param)
+{
+	struct obs_source_frame *new_frame;
+	struct async_frame af;
+
+	if (!release) {
+		obs_source_output_video(source, frame);
+		return;
+	}
+	if (destroying(source) ||
+	    !obs_source_valid(source, "obs_source_output_video_nocopy") ||
+	    !obs_ptr_valid(frame, "obs_source_output_video_nocopy")) {
+		release(param);
+		return;
+	}
+
+	new_frame = bmemdup(frame, sizeof(*frame));
+	new_frame->full_range =
+		format_is_yuv(frame->format) ? frame->full_range : true;
+	new_frame->refs = 1;
+	new_frame->prev_frame = false;
+
+	af.frame = new_frame;
+	af.unused_count = 0;
+	af.used = true;
+	af.release = release;
+	af.release_param = param;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	update_async_cache_format(source, new_frame, false);
+	da_push_back(source->async_cache, &af);
+	clean_cache(source, new_frame);
+
+	da_push_back(source->async_frames, &new_frame);
+	source->async_active = true;
+
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
 void obs_source_output_video2(obs_source_t *source,
 			      const struct obs_source_frame2 *frame)
 {
@@ -4280,6 +4586,7 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		while (source->async_frames.num > 1) {
 			da_erase(source->async_frames, 0);
 			remove_async_frame(source, next_frame);
+			source->async_frames_dropped++;
 			next_frame = source->async_frames.array[0];
 		}
 
@@ -4319,8 +4626,10 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		    (source->last_frame_ts - next_frame->timestamp) < 2000000)
 			break;
 
-		if (frame)
+		if (frame) {
 			da_erase(source->async_frames, 0);
+			source->async_frames_dropped++;
+		}
 
 #if DEBUG_ASYNC_FRAMES
 		blog(LOG_DEBUG,
@@ -4416,10 +4725,12 @@ void obs_source_release_frame(obs_source_t *source,
 	} else {
 		pthread_mutex_lock(&source->async_mutex);
 
-		if (os_atomic_dec_long(&frame->refs) == 0)
+		if (os_atomic_dec_long(&frame->refs) == 0) {
 			obs_source_frame_destroy(frame);
-		else
+		} else {
 			remove_async_frame(source, frame);
+			release_unused_frames(source);
+		}
 
 		pthread_mutex_unlock(&source->async_mutex);
 	}
@@ -5289,6 +5600,7 @@ void obs_source_set_enabled(obs_source_t *source, bool enabled)
 		return;
 
 	source->enabled = enabled;
+	obs_video_damage();
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
@@ -5506,24 +5818,18 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 static inline void multiply_output_audio(obs_source_t *source, size_t mix,
 					 size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
-
-	while (out < end)
-		*(out++) *= vol;
+	obs->audio.kernels->scale(source->audio_output_buf[mix][0], vol,
+				  AUDIO_OUTPUT_FRAMES * channels);
 }
 
 static inline void multiply_vol_data(obs_source_t *source, size_t mix,
 				     size_t channels, float *vol_data)
 {
-	for (size_t ch = 0; ch < channels; ch++) {
-		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
-		register float *vol = vol_data;
+	const struct audio_kernels *kernels = obs->audio.kernels;
 
-		while (out < end)
-			*(out++) *= *(vol++);
-	}
+	for (size_t ch = 0; ch < channels; ch++)
+		kernels->scale_ramp(source->audio_output_buf[mix][ch], vol_data,
+				    AUDIO_OUTPUT_FRAMES);
 }
 
 static inline void apply_audio_action(obs_source_t *source,
@@ -5635,6 +5941,66 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 	}
 }
 
+static inline bool audio_buf_silent(const float *buf, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (buf[i] != 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+static void update_silent_mixes(obs_source_t *source, uint32_t mixers,
+				size_t channels)
+{
+	uint32_t silent_mixes = 0;
+
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		uint32_t mix_bit = 1 << mix;
+
+		if ((mixers & mix_bit) == 0)
+			continue;
+
+		if (audio_buf_silent(source->audio_output_buf[mix][0],
+				     AUDIO_OUTPUT_FRAMES * channels))
+			silent_mixes |= mix_bit;
+	}
+
+	source->audio_silent_mixes = silent_mixes;
+}
+
+/* returns true if the source is muted or at zero volume for the whole tick,
+ * in which case its output does not need to be rendered at all */
+static bool audio_source_silent(obs_source_t *source)
+{
+	bool actions_pending;
+
+	pthread_mutex_lock(&source->audio_actions_mutex);
+	actions_pending = source->audio_actions.num > 0;
+	pthread_mutex_unlock(&source->audio_actions_mutex);
+
+	return !actions_pending &&
+	       get_source_volume(source, source->audio_ts) == 0.0f;
+}
+
+static void clear_silent_mixes(obs_source_t *source, uint32_t mixers,
+			       size_t channels)
+{
+	/* only clear what isn't already known to be silent */
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		uint32_t mix_bit = 1 << mix;
+
+		if ((mixers & mix_bit) == 0 ||
+		    (source->audio_silent_mixes & mix_bit) != 0)
+			continue;
+
+		memset(source->audio_output_buf[mix][0], 0,
+		       sizeof(float) * AUDIO_OUTPUT_FRAMES * channels);
+		source->audio_silent_mixes |= mix_bit;
+	}
+}
+
 static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 				size_t channels, size_t sample_rate)
 {
@@ -5676,6 +6042,7 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 	}
 
 	apply_audio_volume(source, mixers, channels, sample_rate);
+	update_silent_mixes(source, mixers, channels);
 }
 
 static void audio_submix(obs_source_t *source, size_t channels,
@@ -5725,6 +6092,14 @@ static inline void process_audio_source_tick(obs_source_t *source,
 		return;
 	}
 
+	if (!audio_submix && audio_source_silent(source)) {
+		pthread_mutex_unlock(&source->audio_buf_mutex);
+
+		clear_silent_mixes(source, mixers, channels);
+		source->audio_pending = false;
+		return;
+	}
+
 	for (size_t ch = 0; ch < channels; ch++)
 		deque_peek_front(&source->audio_input_buf[ch],
 				 source->audio_output_buf[0][ch], size);
@@ -5763,6 +6138,7 @@ static inline void process_audio_source_tick(obs_source_t *source,
 		memset(source->audio_output_buf[0][0], 0, size * channels);
 
 	apply_audio_volume(source, mixers, channels, sample_rate);
+	update_silent_mixes(source, mixers, channels);
 	source->audio_pending = false;
 }
 
@@ -5940,6 +6316,41 @@ bool obs_source_async_unbuffered(const obs_source_t *source)
 		       : false;
 }
 
+static inline uint64_t get_async_counter(obs_source_t *source,
+					 const uint64_t *counter)
+{
+	uint64_t val;
+
+	pthread_mutex_lock(&source->async_mutex);
+	val = *counter;
+	pthread_mutex_unlock(&source->async_mutex);
+	return val;
+}
+
+uint64_t obs_source_get_async_frames_reused(obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_frames_reused")
+		       ? get_async_counter(source,
+					   &source->async_frames_reused)
+		       : 0;
+}
+
+uint64_t obs_source_get_async_frames_dropped(obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_frames_dropped")
+		       ? get_async_counter(source,
+					   &source->async_frames_dropped)
+		       : 0;
+}
+
+uint64_t obs_source_get_async_cache_overflows(obs_source_t *source)
+{
+	return obs_source_valid(source, "obs_source_get_async_cache_overflows")
+		       ? get_async_counter(source,
+					   &source->async_cache_overflows)
+		       : 0;
+}
+
 obs_data_t *obs_source_get_private_settings(obs_source_t *source)
 {
 	if (!obs_ptr_valid(source, "obs_source_get_private_settings"))
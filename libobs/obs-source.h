@@ -203,6 +203,13 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CAP_DONT_SHOW_PROPERTIES (1 << 16)
 
+/**
+ * Source's video only changes when it is updated, or when it calls
+ * obs_source_content_changed.  Frames made up only of such sources are not
+ * rendered again if nothing changed since the previous frame.
+ */
+#define OBS_SOURCE_STATIC_VIDEO (1 << 17)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
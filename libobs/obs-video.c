@@ -29,10 +29,13 @@
 #include <windows.h>
 #endif
 
+#define NBSP "\xC2\xA0"
+
+static const char *sources_ticked_name = "sources_ticked";
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
-	struct obs_source *source;
 	uint64_t delta_time;
 	float seconds;
 
@@ -60,24 +63,44 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 
 	da_clear(data->sources_to_tick);
 
-	pthread_mutex_lock(&data->sources_mutex);
+	pthread_mutex_lock(&data->tick_sources_mutex);
 
-	source = data->sources;
-	while (source) {
+	for (size_t i = 0; i < data->tick_sources.num; i++) {
+		obs_source_t *source = data->tick_sources.array[i];
 		obs_source_t *s = obs_source_get_ref(source);
 		if (s)
 			da_push_back(data->sources_to_tick, &s);
-		source = (struct obs_source *)source->context.hh_uuid.next;
 	}
 
-	pthread_mutex_unlock(&data->sources_mutex);
+	pthread_mutex_unlock(&data->tick_sources_mutex);
+
+	profile_counter(sources_ticked_name,
+			(int64_t)data->sources_to_tick.num);
 
 	/* ------------------------------------- */
 	/* call the tick function of each source */
 
+	struct obs_frame_timing *timing = &obs->video.frame_timing;
+
 	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
 		obs_source_t *s = data->sources_to_tick.array[i];
+		uint64_t tick_start = os_gettime_ns();
+
 		obs_source_video_tick(s, seconds);
+
+		uint64_t tick_ns = os_gettime_ns() - tick_start;
+		if (tick_ns > timing->slowest_tick_ns) {
+			timing->slowest_tick_ns = tick_ns;
+			snprintf(timing->slowest_tick_source,
+				 sizeof(timing->slowest_tick_source), "%s",
+				 s->context.uuid);
+		}
+
+		/* hidden sources without anything to do leave the tick set
+		 * until they are shown or updated again */
+		if (!obs_source_needs_tick(s))
+			obs_source_drop_tick(s);
+
 		obs_source_release(s);
 	}
 
@@ -167,15 +190,19 @@ static inline void draw_mix_texture(const size_t mix_idx)
 	gs_enable_framebuffer_srgb(false);
 }
 
-static const char *render_main_texture_name = "render_main_texture";
-static inline void render_main_texture(struct obs_core_video_mix *video)
+static inline bool can_reuse_last_texture(const struct obs_core_video_mix *mix,
+					  long damage)
+{
+	return mix->texture_rendered && mix->texture_static &&
+	       mix->texture_damage == damage;
+}
+
+static inline void draw_main_texture(struct obs_core_video_mix *video,
+				     long damage)
 {
 	uint32_t base_width = video->ovi.base_width;
 	uint32_t base_height = video->ovi.base_height;
-
-	profile_start(render_main_texture_name);
-	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_MAIN_TEXTURE,
-			      render_main_texture_name);
+	bool draw_callbacks;
 
 	struct vec4 clear_color;
 	vec4_set(&clear_color, 0.0f, 0.0f, 0.0f, 0.0f);
@@ -188,6 +215,7 @@ static inline void render_main_texture(struct obs_core_video_mix *video)
 
 	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
 
+	draw_callbacks = obs->data.draw_callbacks.num > 0;
 	for (size_t i = obs->data.draw_callbacks.num; i > 0; i--) {
 		struct draw_callback *const callback =
 			obs->data.draw_callbacks.array + (i - 1);
@@ -198,12 +226,50 @@ static inline void render_main_texture(struct obs_core_video_mix *video)
 
 	/* In some cases we can reuse a previous mix's texture and save re-rendering everything */
 	size_t reuse_idx;
-	if (can_reuse_mix_texture(video, &reuse_idx))
+	if (can_reuse_mix_texture(video, &reuse_idx)) {
+		const struct obs_core_video_mix *other =
+			obs->video.mixes.array[reuse_idx];
+
 		draw_mix_texture(reuse_idx);
-	else
+		video->texture_static = other->texture_static;
+		damage = other->texture_damage;
+	} else {
+		obs->video.rendered_dynamic = false;
 		obs_view_render(video->view);
+		video->texture_static = !obs->video.rendered_dynamic;
+	}
+
+	/* draw callbacks can draw anything, never skip them */
+	if (draw_callbacks)
+		video->texture_static = false;
 
+	video->texture_damage = damage;
 	video->texture_rendered = true;
+}
+
+static const char *render_main_texture_name = "render_main_texture";
+static const char *reused_frames_name = "reused_frames";
+static inline void render_main_texture(struct obs_core_video_mix *video)
+{
+	long damage = os_atomic_load_long(&obs->video.damage);
+	uint64_t start_time = os_gettime_ns();
+
+	profile_start(render_main_texture_name);
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_MAIN_TEXTURE,
+			      render_main_texture_name);
+
+	/* nothing changed since the last frame, its texture is still valid */
+	if (can_reuse_last_texture(video, damage)) {
+		gs_set_render_target_with_color_space(
+			video->render_texture, NULL, video->render_space);
+		set_render_size(video->ovi.base_width, video->ovi.base_height);
+
+		obs->video.reused_frames++;
+		profile_counter(reused_frames_name,
+				(int64_t)obs->video.reused_frames);
+	} else {
+		draw_main_texture(video, damage);
+	}
 
 	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
 
@@ -217,6 +283,9 @@ static inline void render_main_texture(struct obs_core_video_mix *video)
 
 	GS_DEBUG_MARKER_END();
 	profile_end(render_main_texture_name);
+
+	obs->video.frame_timing.render_main_texture_ns +=
+		os_gettime_ns() - start_time;
 }
 
 static inline gs_effect_t *
@@ -446,9 +515,11 @@ stage_output_texture(struct obs_core_video_mix *video, int cur_texture,
 		     gs_stagesurf_t *const *const copy_surfaces,
 		     size_t channel_count)
 {
-	profile_start(stage_output_texture_name);
+	/* the readback thread has not finished with this surface yet */
+	if (os_atomic_load_bool(&video->readback_busy[cur_texture]))
+		return;
 
-	unmap_last_surface(video);
+	profile_start(stage_output_texture_name);
 
 	if (!video->gpu_conversion) {
 		gs_stagesurf_t *copy = copy_surfaces[0];
@@ -459,7 +530,7 @@ stage_output_texture(struct obs_core_video_mix *video, int cur_texture,
 		for (size_t i = 1; i < NUM_CHANNELS; ++i)
 			video->active_copy_surfaces[cur_texture][i] = NULL;
 
-		video->textures_copied[cur_texture] = true;
+		video->texture_staged = true;
 	} else if (video->texture_converted) {
 		for (size_t i = 0; i < channel_count; i++) {
 			gs_stagesurf_t *copy = copy_surfaces[i];
@@ -471,7 +542,7 @@ stage_output_texture(struct obs_core_video_mix *video, int cur_texture,
 		for (size_t i = channel_count; i < NUM_CHANNELS; ++i)
 			video->active_copy_surfaces[cur_texture][i] = NULL;
 
-		video->textures_copied[cur_texture] = true;
+		video->texture_staged = true;
 	}
 
 	profile_end(stage_output_texture_name);
@@ -602,7 +673,8 @@ static inline void render_video(struct obs_core_video_mix *video,
 		if (gpu_active) {
 			convert_textures = video->convert_textures_encode;
 #ifdef _WIN32
-			copy_surfaces = video->copy_surfaces_encode;
+			copy_surfaces =
+				&video->copy_surfaces_encode[cur_texture];
 			channel_count = 1;
 #endif
 			gs_flush();
@@ -632,14 +704,11 @@ static inline void render_video(struct obs_core_video_mix *video,
 }
 
 static inline bool download_frame(struct obs_core_video_mix *video,
-				  int prev_texture, struct video_data *frame)
+				  int texture, struct video_data *frame)
 {
-	if (!video->textures_copied[prev_texture])
-		return false;
-
 	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
 		gs_stagesurf_t *surface =
-			video->active_copy_surfaces[prev_texture][channel];
+			video->active_copy_surfaces[texture][channel];
 		if (surface) {
 			if (!gs_stagesurface_map(surface, &frame->data[channel],
 						 &frame->linesize[channel]))
@@ -887,6 +956,168 @@ static inline void output_video_data(struct obs_core_video_mix *video,
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+/* raw frame readback                                                        */
+
+static const char *readback_map_name = "readback_map";
+static const char *readback_unmap_name = "readback_unmap";
+static const char *output_frame_output_video_data_name = "output_video_data";
+
+/* maps are done with the graphics context entered, but the copy into the
+ * video output happens outside of it so the render loop is never blocked
+ * by it */
+static void readback_frame(struct obs_core_video_mix *video,
+			   const struct obs_readback *rb)
+{
+	struct video_data frame;
+	bool mapped;
+
+	memset(&frame, 0, sizeof(struct video_data));
+
+	profile_start(readback_map_name);
+	gs_enter_context(obs->video.graphics);
+	mapped = download_frame(video, rb->texture, &frame);
+	gs_leave_context();
+	profile_end(readback_map_name);
+
+	if (mapped) {
+		frame.timestamp = rb->info.timestamp;
+		profile_start(output_frame_output_video_data_name);
+		output_video_data(video, &frame, rb->info.count);
+		profile_end(output_frame_output_video_data_name);
+	}
+
+	profile_start(readback_unmap_name);
+	gs_enter_context(obs->video.graphics);
+	unmap_last_surface(video);
+	gs_leave_context();
+	profile_end(readback_unmap_name);
+
+	os_atomic_set_bool(&video->readback_busy[rb->texture], false);
+}
+
+static void *readback_thread(void *data)
+{
+	struct obs_core_video_mix *video = data;
+	uint64_t interval = video_output_get_frame_time(video->video);
+
+	os_set_thread_name("obs readback thread");
+	const char *readback_thread_name = profile_store_name(
+		obs_get_profiler_name_store(),
+		"obs_readback_thread(%g" NBSP "ms)", interval / 1000000.);
+	profile_register_root(readback_thread_name, interval);
+
+	while (os_sem_wait(video->readback_semaphore) == 0) {
+		struct obs_readback rb;
+
+		if (os_atomic_load_bool(&video->readback_stop))
+			break;
+
+		pthread_mutex_lock(&video->readback_mutex);
+		deque_pop_front(&video->readback_queue, &rb, sizeof(rb));
+		pthread_mutex_unlock(&video->readback_mutex);
+
+		profile_start(readback_thread_name);
+		readback_frame(video, &rb);
+		profile_end(readback_thread_name);
+
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+bool init_readback_thread(struct obs_core_video_mix *video)
+{
+	if (video->readback_thread_initialized)
+		return true;
+
+	os_atomic_set_bool(&video->readback_stop, false);
+
+	if (!video->readback_semaphore &&
+	    os_sem_init(&video->readback_semaphore, 0) != 0)
+		return false;
+	if (pthread_create(&video->readback_thread, NULL, readback_thread,
+			   video) != 0)
+		return false;
+
+	video->readback_thread_initialized = true;
+	return true;
+}
+
+void stop_readback_thread(struct obs_core_video_mix *video)
+{
+	if (video->readback_thread_initialized) {
+		os_atomic_set_bool(&video->readback_stop, true);
+		os_sem_post(video->readback_semaphore);
+		pthread_join(video->readback_thread, NULL);
+		video->readback_thread_initialized = false;
+	}
+
+	/* anything still queued is dropped */
+	pthread_mutex_lock(&video->readback_mutex);
+	deque_free(&video->readback_queue);
+	pthread_mutex_unlock(&video->readback_mutex);
+	deque_free(&video->readback_staged);
+
+	for (size_t i = 0; i < MAX_TEXTURES; i++)
+		os_atomic_set_bool(&video->readback_busy[i], false);
+}
+
+static void release_readback(struct obs_core_video_mix *video)
+{
+	struct obs_readback rb;
+
+	deque_pop_front(&video->readback_staged, &rb, sizeof(rb));
+
+	if (!video->readback_thread_initialized) {
+		readback_frame(video, &rb);
+		return;
+	}
+
+	pthread_mutex_lock(&video->readback_mutex);
+	deque_push_back(&video->readback_queue, &rb, sizeof(rb));
+	pthread_mutex_unlock(&video->readback_mutex);
+
+	os_sem_post(video->readback_semaphore);
+}
+
+static void queue_readback(struct obs_core_video_mix *video, int texture)
+{
+	struct obs_readback rb = {.texture = texture};
+	size_t max_staged = (size_t)video->num_textures - 1;
+
+	if (!video->vframe_info_buffer.size)
+		return;
+
+	deque_pop_front(&video->vframe_info_buffer, &rb.info, sizeof(rb.info));
+
+	if (!video->texture_staged) {
+		video_output_inc_texture_skipped_frames(video->video);
+		return;
+	}
+
+	os_atomic_set_bool(&video->readback_busy[texture], true);
+	deque_push_back(&video->readback_staged, &rb, sizeof(rb));
+
+	/* give the GPU num_textures - 1 frames to finish the copy before the
+	 * surface is mapped */
+	while (video->readback_staged.size / sizeof(rb) > max_staged)
+		release_readback(video);
+}
+
+static void discard_staged_readbacks(struct obs_core_video_mix *video)
+{
+	struct obs_readback rb;
+
+	while (video->readback_staged.size) {
+		deque_pop_front(&video->readback_staged, &rb, sizeof(rb));
+		os_atomic_set_bool(&video->readback_busy[rb.texture], false);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
 void add_ready_encoder_group(obs_encoder_t *encoder)
 {
 	obs_weak_encoder_t *weak = obs_encoder_get_weak_encoder(encoder);
@@ -895,6 +1126,64 @@ void add_ready_encoder_group(obs_encoder_t *encoder)
 	pthread_mutex_unlock(&obs->video.encoder_group_mutex);
 }
 
+static void save_lag_trace(void *param)
+{
+	struct obs_core_video *video = param;
+	uint64_t duration_ns;
+	struct dstr path = {0};
+	char timestamp[64];
+	time_t now = time(NULL);
+
+	pthread_mutex_lock(&video->lag_trace_mutex);
+	dstr_copy(&path, video->lag_trace_dir);
+	duration_ns = video->lag_trace_duration_ns;
+	pthread_mutex_unlock(&video->lag_trace_mutex);
+
+	if (!dstr_is_empty(&path)) {
+		profiler_trace_t *trace = profiler_trace_capture(duration_ns);
+
+		strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H-%M-%S",
+			 localtime(&now));
+		os_mkdirs(path.array);
+		dstr_catf(&path, "/lag-trace %s.json", timestamp);
+
+		if (profiler_trace_dump_json(trace, path.array))
+			blog(LOG_INFO, "Missed frame, saved trace to '%s'",
+			     path.array);
+		else
+			blog(LOG_WARNING, "Failed to save lag trace to '%s'",
+			     path.array);
+
+		profiler_trace_free(trace);
+	}
+
+	dstr_free(&path);
+	os_atomic_set_bool(&video->lag_trace_pending, false);
+}
+
+/* at most one trace per capture window, written out on the thread pool */
+static void capture_lag_trace(struct obs_core_video *video, uint64_t time)
+{
+	os_thread_pool_t *pool = obs_get_thread_pool();
+	uint64_t duration_ns;
+
+	if (!pool || !os_atomic_load_bool(&video->lag_trace_enabled))
+		return;
+
+	pthread_mutex_lock(&video->lag_trace_mutex);
+	duration_ns = video->lag_trace_duration_ns;
+	pthread_mutex_unlock(&video->lag_trace_mutex);
+
+	if (time - video->last_lag_trace_time < duration_ns)
+		return;
+	if (os_atomic_exchange_bool(&video->lag_trace_pending, true))
+		return;
+
+	video->last_lag_trace_time = time;
+	os_thread_pool_submit(pool, save_lag_trace, video,
+			      OS_TASK_PRIORITY_LOW, NULL);
+}
+
 static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 			       uint64_t interval_ns)
 {
@@ -906,6 +1195,9 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 	if (os_sleepto_ns(t)) {
 		*p_time = t;
 		count = 1;
+
+		uint64_t now = os_gettime_ns();
+		video->frame_timing.sleep_overshoot_ns = now > t ? now - t : 0;
 	} else {
 		const uint64_t udiff = os_gettime_ns() - cur_time;
 		int64_t diff;
@@ -915,11 +1207,19 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 						      : interval_ns;
 		count = (int)(clamped_diff / interval_ns);
 		*p_time = cur_time + interval_ns * count;
+
+		video->frame_timing.sleep_overshoot_ns =
+			clamped_diff - interval_ns;
 	}
 
+	video->frame_timing.lagged_frames = (uint32_t)(count - 1);
+
 	video->total_frames += count;
 	video->lagged_frames += count - 1;
 
+	if (count > 1)
+		capture_lag_trace(video, cur_time);
+
 	vframe_info.timestamp = cur_time;
 	vframe_info.count = count;
 
@@ -963,21 +1263,15 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 
 static const char *output_frame_gs_context_name = "gs_context(video->graphics)";
 static const char *output_frame_render_video_name = "render_video";
-static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
-static const char *output_frame_output_video_data_name = "output_video_data";
 static inline void output_frame(struct obs_core_video_mix *video)
 {
 	const bool raw_active = video->raw_was_active;
 	const bool gpu_active = video->gpu_was_active;
 
 	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1
-					    : cur_texture - 1;
-	struct video_data frame;
-	bool frame_ready = 0;
 
-	memset(&frame, 0, sizeof(struct video_data));
+	video->texture_staged = false;
 
 	profile_start(output_frame_gs_context_name);
 	gs_enter_context(obs->video.graphics);
@@ -989,31 +1283,19 @@ static inline void output_frame(struct obs_core_video_mix *video)
 	GS_DEBUG_MARKER_END();
 	profile_end(output_frame_render_video_name);
 
-	if (raw_active) {
-		profile_start(output_frame_download_frame_name);
-		frame_ready = download_frame(video, prev_texture, &frame);
-		profile_end(output_frame_download_frame_name);
-	}
-
+	uint64_t flush_start = os_gettime_ns();
 	profile_start(output_frame_gs_flush_name);
 	gs_flush();
 	profile_end(output_frame_gs_flush_name);
+	obs->video.frame_timing.gs_flush_ns += os_gettime_ns() - flush_start;
 
 	gs_leave_context();
 	profile_end(output_frame_gs_context_name);
 
-	if (raw_active && frame_ready) {
-		struct obs_vframe_info vframe_info;
-		deque_pop_front(&video->vframe_info_buffer, &vframe_info,
-				sizeof(vframe_info));
-
-		frame.timestamp = vframe_info.timestamp;
-		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
-		profile_end(output_frame_output_video_data_name);
-	}
+	if (raw_active)
+		queue_readback(video, cur_texture);
 
-	if (++video->cur_texture == NUM_TEXTURES)
+	if (++video->cur_texture == video->num_textures)
 		video->cur_texture = 0;
 }
 
@@ -1035,8 +1317,6 @@ static inline void output_frames(void)
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
-#define NBSP "\xC2\xA0"
-
 static void clear_base_frame_data(struct obs_core_video_mix *video)
 {
 	video->texture_rendered = false;
@@ -1047,7 +1327,7 @@ static void clear_base_frame_data(struct obs_core_video_mix *video)
 
 static void clear_raw_frame_data(struct obs_core_video_mix *video)
 {
-	memset(video->textures_copied, 0, sizeof(video->textures_copied));
+	discard_staged_readbacks(video);
 	deque_free(&video->vframe_info_buffer);
 }
 
@@ -1172,8 +1452,16 @@ static inline void update_active_state(struct obs_core_video_mix *video)
 
 	if (!was_active && active)
 		clear_base_frame_data(video);
-	if (!raw_was_active && raw_active)
+	if (!raw_was_active && raw_active) {
 		clear_raw_frame_data(video);
+
+		if (!init_readback_thread(video))
+			blog(LOG_WARNING, "Failed to create readback thread, "
+					  "reading back raw frames on the "
+					  "graphics thread");
+	}
+	if (raw_was_active && !raw_active)
+		discard_staged_readbacks(video);
 	if (!gpu_was_active && gpu_active)
 		clear_gpu_frame_data(video);
 
@@ -1203,11 +1491,48 @@ static inline bool stop_requested(void)
 	return success;
 }
 
+static void record_frame_timing(struct obs_core_video *video)
+{
+	struct obs_frame_timing *timing = &video->frame_timing;
+
+	pthread_mutex_lock(&video->frame_timings_mutex);
+	video->frame_timings[video->frame_timings_pos] = *timing;
+	if (++video->frame_timings_pos == NUM_FRAME_TIMINGS)
+		video->frame_timings_pos = 0;
+	if (video->num_frame_timings < NUM_FRAME_TIMINGS)
+		video->num_frame_timings++;
+	pthread_mutex_unlock(&video->frame_timings_mutex);
+
+	if (timing->lagged_frames) {
+		struct calldata data;
+		uint8_t stack[128];
+
+		calldata_init_fixed(&data, stack, sizeof(stack));
+		calldata_set_int(&data, "lagged_frames",
+				 (long long)timing->lagged_frames);
+		calldata_set_ptr(&data, "timing", timing);
+		signal_handler_signal(obs->signals, "frame_missed", &data);
+	}
+}
+
+static inline uint64_t elapsed_since(uint64_t *time)
+{
+	uint64_t now = os_gettime_ns();
+	uint64_t elapsed = now - *time;
+	*time = now;
+	return elapsed;
+}
+
 bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 {
+	struct obs_frame_timing *timing = &obs->video.frame_timing;
 	uint64_t frame_start = os_gettime_ns();
+	uint64_t phase_start = frame_start;
 	uint64_t frame_time_ns;
 
+	memset(timing, 0, sizeof(*timing));
+	timing->timestamp = obs->video.video_time;
+
 	update_active_states();
 
 	profile_start(context->video_thread_name);
@@ -1216,10 +1541,12 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	gs_begin_frame();
 	gs_leave_context();
 
+	phase_start = os_gettime_ns();
 	profile_start(tick_sources_name);
 	context->last_time =
 		tick_sources(obs->video.video_time, context->last_time);
 	profile_end(tick_sources_name);
+	timing->tick_ns = elapsed_since(&phase_start);
 
 #ifdef _WIN32
 	MSG msg;
@@ -1229,23 +1556,28 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 	}
 #endif
 
+	phase_start = os_gettime_ns();
 	profile_start(output_frame_name);
 	output_frames();
 	profile_end(output_frame_name);
+	timing->output_frames_ns = elapsed_since(&phase_start);
 
 	profile_start(render_displays_name);
 	render_displays();
 	profile_end(render_displays_name);
+	timing->render_displays_ns = elapsed_since(&phase_start);
 
 	execute_graphics_tasks();
 
 	frame_time_ns = os_gettime_ns() - frame_start;
+	timing->frame_ns = frame_time_ns;
 
 	profile_end(context->video_thread_name);
 
 	profile_reenable_thread();
 
 	video_sleep(&obs->video, &obs->video.video_time, context->interval);
+	record_frame_timing(&obs->video);
 
 	context->frame_time_total_ns += frame_time_ns;
 	context->fps_total_ns += (obs->video.video_time - context->last_time);
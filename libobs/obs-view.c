@@ -106,6 +106,8 @@ void obs_view_set_source(obs_view_t *view, uint32_t channel,
 
 	pthread_mutex_unlock(&view->channels_mutex);
 
+	obs_video_damage();
+
 	if (source)
 		obs_source_activate(source, AUX_VIEW);
 
@@ -423,7 +423,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 		break;
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (size_t i = 0; i < (size_t)video->num_textures; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces_encode[i] =
@@ -494,7 +494,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 	if (success) {
 		video->render_space = space;
 	} else {
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (size_t i = 0; i < MAX_TEXTURES; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(
@@ -616,6 +616,32 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 		gs_effect_create_from_file(filename, NULL);
 	bfree(filename);
 
+	/* link the programs of the core effects now, rather than on the
+	 * first frames that use them.  Without a shader cache to load them
+	 * from, this would link every pass, including the many that are never
+	 * used, so only do it with one */
+	struct gs_shader_cache_stats cache_stats;
+	bool prewarm = gs_get_shader_cache_stats(&cache_stats);
+
+	gs_effect_t *core_effects[] = {
+		video->default_effect,
+		video->default_rect_effect,
+		video->opaque_effect,
+		video->solid_effect,
+		video->repeat_effect,
+		video->conversion_effect,
+		video->bicubic_effect,
+		video->lanczos_effect,
+		video->area_effect,
+		video->bilinear_lowres_effect,
+		video->premultiplied_alpha_effect,
+	};
+
+	for (size_t i = 0; prewarm && i < OBS_COUNTOF(core_effects); i++) {
+		if (core_effects[i])
+			gs_effect_prewarm(core_effects[i]);
+	}
+
 	point_sampler.max_anisotropy = 1;
 	video->point_sampler = gs_samplerstate_create(&point_sampler);
 
@@ -677,10 +703,16 @@ static int obs_init_video_mix(struct obs_video_info *ovi,
 	struct video_output_info vi;
 
 	pthread_mutex_init_value(&video->gpu_encoder_mutex);
+	pthread_mutex_init_value(&video->readback_mutex);
 
 	make_video_info(&vi, ovi);
 	video->ovi = *ovi;
 
+	video->num_textures =
+		(int)os_atomic_load_long(&obs->video.readback_depth);
+	if (!video->num_textures)
+		video->num_textures = NUM_TEXTURES;
+
 	/* main view graphics thread drives all frame output,
 	 * so share FPS settings for aux views */
 	pthread_mutex_lock(&obs->video.mixes_mutex);
@@ -712,6 +744,8 @@ static int obs_init_video_mix(struct obs_video_info *ovi,
 
 	if (pthread_mutex_init(&video->gpu_encoder_mutex, NULL) < 0)
 		return OBS_VIDEO_FAIL;
+	if (pthread_mutex_init(&video->readback_mutex, NULL) < 0)
+		return OBS_VIDEO_FAIL;
 
 	gs_enter_context(obs->video.graphics);
 
@@ -803,7 +837,7 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 		}
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (size_t i = 0; i < MAX_TEXTURES; i++) {
 		for (size_t c = 0; c < NUM_CHANNELS; c++) {
 			if (video->copy_surfaces[i][c]) {
 				gs_stagesurface_destroy(
@@ -844,6 +878,13 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 void obs_free_video_mix(struct obs_core_video_mix *video)
 {
 	if (video->video) {
+		/* the readback thread outputs to the video output */
+		stop_readback_thread(video);
+		if (video->readback_semaphore) {
+			os_sem_destroy(video->readback_semaphore);
+			video->readback_semaphore = NULL;
+		}
+
 		video_output_close(video->video);
 		video->video = NULL;
 
@@ -853,10 +894,12 @@ void obs_free_video_mix(struct obs_core_video_mix *video)
 		deque_free(&video->vframe_info_buffer_gpu);
 
 		video->texture_rendered = false;
-		memset(video->textures_copied, 0,
-		       sizeof(video->textures_copied));
+		video->texture_staged = false;
 		video->texture_converted = false;
 
+		pthread_mutex_destroy(&video->readback_mutex);
+		pthread_mutex_init_value(&video->readback_mutex);
+
 		pthread_mutex_destroy(&video->gpu_encoder_mutex);
 		pthread_mutex_init_value(&video->gpu_encoder_mutex);
 		da_free(video->gpu_encoders);
@@ -950,6 +993,11 @@ static bool obs_init_audio(struct audio_output_info *ai)
 	audio->monitoring_device_name = bstrdup("Default");
 	audio->monitoring_device_id = bstrdup("default");
 
+	audio->kernels = audio_kernels_get_best();
+	blog(LOG_INFO, "Audio mixing kernels: %s", audio->kernels->name);
+
+	audio_render_pool_init(audio, obs->audio_render_threads);
+
 	errorcode = audio_output_open(&audio->audio, ai);
 	if (errorcode == AUDIO_OUTPUT_SUCCESS)
 		return true;
@@ -977,6 +1025,8 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	audio_render_pool_free(audio);
+
 	deque_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
@@ -999,6 +1049,7 @@ static bool obs_init_data(void)
 
 	pthread_mutex_init_value(&obs->data.displays_mutex);
 	pthread_mutex_init_value(&obs->data.draw_callbacks_mutex);
+	pthread_mutex_init_value(&obs->data.tick_sources_mutex);
 
 	if (pthread_mutex_init_recursive(&data->sources_mutex) != 0)
 		goto fail;
@@ -1014,6 +1065,8 @@ static bool obs_init_data(void)
 		goto fail;
 	if (pthread_mutex_init_recursive(&obs->data.draw_callbacks_mutex) != 0)
 		goto fail;
+	if (pthread_mutex_init(&data->tick_sources_mutex, NULL) != 0)
+		goto fail;
 
 	if (!obs_view_init(&data->main_view))
 		goto fail;
@@ -1093,6 +1146,7 @@ static void obs_free_data(void)
 	pthread_mutex_destroy(&data->encoders_mutex);
 	pthread_mutex_destroy(&data->services_mutex);
 	pthread_mutex_destroy(&data->draw_callbacks_mutex);
+	pthread_mutex_destroy(&data->tick_sources_mutex);
 	da_free(data->draw_callbacks);
 	da_free(data->rendered_callbacks);
 	da_free(data->tick_callbacks);
@@ -1102,6 +1156,7 @@ static void obs_free_data(void)
 		bfree(data->protocols.array[i]);
 	da_free(data->protocols);
 	da_free(data->sources_to_tick);
+	da_free(data->tick_sources);
 }
 
 static const char *obs_signals[] = {
@@ -1127,6 +1182,8 @@ static const char *obs_signals[] = {
 
 	"void channel_change(int channel, in out ptr source, ptr prev_source)",
 
+	"void frame_missed(int lagged_frames, ptr timing)",
+
 	"void hotkey_layout_change()",
 	"void hotkey_register(ptr hotkey)",
 	"void hotkey_unregister(ptr hotkey)",
@@ -1250,6 +1307,11 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	pthread_mutex_init_value(&obs->video.encoder_group_mutex);
 	pthread_mutex_init_value(&obs->video.mixes_mutex);
 
+	if (pthread_mutex_init(&obs->video.lag_trace_mutex, NULL) != 0)
+		return false;
+	if (pthread_mutex_init(&obs->video.frame_timings_mutex, NULL) != 0)
+		return false;
+
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
 	if (!obs->name_store) {
@@ -1270,6 +1332,10 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	if (!obs->destruction_task_thread)
 		return false;
 
+	obs->thread_pool = os_thread_pool_create("libobs: thread pool", 0);
+	if (!obs->thread_pool)
+		return false;
+
 	if (module_config_path)
 		obs->module_config_path = bstrdup(module_config_path);
 	obs->locale = bstrdup(locale);
@@ -1432,6 +1498,14 @@ void obs_shutdown(void)
 	stop_audio();
 	stop_hotkeys();
 
+	/* module code may still be queued, so finish it before unloading */
+	os_thread_pool_destroy(obs->thread_pool);
+	obs->thread_pool = NULL;
+
+	pthread_mutex_destroy(&obs->video.lag_trace_mutex);
+	pthread_mutex_destroy(&obs->video.frame_timings_mutex);
+	bfree(obs->video.lag_trace_dir);
+
 	module = obs->first_module;
 	while (module) {
 		struct obs_module *next = module->next;
@@ -1446,6 +1520,7 @@ void obs_shutdown(void)
 	os_task_queue_destroy(obs->destruction_task_thread);
 	obs_free_hotkeys();
 	obs_free_graphics();
+	obs_free_encoder_packet_pool();
 	proc_handler_destroy(obs->procs);
 	signal_handler_destroy(obs->signals);
 	obs->procs = NULL;
@@ -1635,13 +1710,23 @@ bool obs_reset_audio2(const struct obs_audio_info2 *oai)
 	     "\tsamples per sec: %d\n"
 	     "\tspeakers:        %d\n"
 	     "\tmax buffering:   %d milliseconds\n"
-	     "\tbuffering type:  %s",
+	     "\tbuffering type:  %s\n"
+	     "\trender threads:  %d",
 	     (int)ai.samples_per_sec, (int)ai.speakers, max_buffering_ms,
-	     oai->fixed_buffering ? "fixed" : "dynamically increasing");
+	     oai->fixed_buffering ? "fixed" : "dynamically increasing",
+	     (int)obs->audio_render_threads);
 
 	return obs_init_audio(&ai);
 }
 
+void obs_set_audio_render_threads(uint32_t threads)
+{
+	if (!obs)
+		return;
+
+	obs->audio_render_threads = threads;
+}
+
 bool obs_reset_audio(const struct obs_audio_info *oai)
 {
 	struct obs_audio_info2 oai2 = {
@@ -1680,6 +1765,7 @@ void obs_set_video_levels(float sdr_white_level, float hdr_nominal_peak_level)
 
 	video->sdr_white_level = sdr_white_level;
 	video->hdr_nominal_peak_level = hdr_nominal_peak_level;
+	obs_video_damage();
 }
 
 bool obs_get_audio_info(struct obs_audio_info *oai)
@@ -3054,6 +3140,8 @@ void obs_add_main_render_callback(void (*draw)(void *param, uint32_t cx,
 	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
 	da_insert(obs->data.draw_callbacks, 0, &data);
 	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
+
+	obs_video_damage();
 }
 
 void obs_remove_main_render_callback(void (*draw)(void *param, uint32_t cx,
@@ -3065,6 +3153,8 @@ void obs_remove_main_render_callback(void (*draw)(void *param, uint32_t cx,
 	pthread_mutex_lock(&obs->data.draw_callbacks_mutex);
 	da_erase_item(obs->data.draw_callbacks, &data);
 	pthread_mutex_unlock(&obs->data.draw_callbacks_mutex);
+
+	obs_video_damage();
 }
 
 void obs_add_main_rendered_callback(void (*rendered)(void *param), void *param)
@@ -3096,6 +3186,33 @@ uint32_t obs_get_lagged_frames(void)
 	return obs->video.lagged_frames;
 }
 
+uint32_t obs_get_reused_frames(void)
+{
+	return obs->video.reused_frames;
+}
+
+size_t obs_get_frame_timings(struct obs_frame_timing *timings, size_t max)
+{
+	struct obs_core_video *video = &obs->video;
+	size_t num, start;
+
+	if (!timings || !max)
+		return 0;
+
+	pthread_mutex_lock(&video->frame_timings_mutex);
+
+	num = video->num_frame_timings < max ? video->num_frame_timings : max;
+	start = video->frame_timings_pos + NUM_FRAME_TIMINGS - num;
+
+	for (size_t i = 0; i < num; i++)
+		timings[i] =
+			video->frame_timings[(start + i) % NUM_FRAME_TIMINGS];
+
+	pthread_mutex_unlock(&video->frame_timings_mutex);
+
+	return num;
+}
+
 struct obs_core_video_mix *get_mix_for_video(video_t *v)
 {
 	struct obs_core_video_mix *result = NULL;
@@ -3397,6 +3514,56 @@ bool obs_wait_for_destroy_queue(void)
 	return os_task_queue_wait(obs->destruction_task_thread);
 }
 
+os_thread_pool_t *obs_get_thread_pool(void)
+{
+	return obs ? obs->thread_pool : NULL;
+}
+
+void obs_set_lag_trace_capture(const char *directory, uint32_t seconds)
+{
+	struct obs_core_video *video;
+	bool enable = directory && *directory && seconds;
+
+	if (!obs)
+		return;
+
+	video = &obs->video;
+
+	pthread_mutex_lock(&video->lag_trace_mutex);
+	bfree(video->lag_trace_dir);
+	video->lag_trace_dir = enable ? bstrdup(directory) : NULL;
+	video->lag_trace_duration_ns = (uint64_t)seconds * 1000000000ULL;
+	pthread_mutex_unlock(&video->lag_trace_mutex);
+
+	if (enable)
+		profiler_trace_start();
+	os_atomic_set_bool(&video->lag_trace_enabled, enable);
+}
+
+void obs_set_video_readback_depth(uint32_t depth)
+{
+	if (!obs)
+		return;
+
+	if (depth && depth < 2)
+		depth = 2;
+	if (depth > MAX_TEXTURES)
+		depth = MAX_TEXTURES;
+
+	os_atomic_set_long(&obs->video.readback_depth, (long)depth);
+}
+
+uint32_t obs_get_video_readback_depth(void)
+{
+	long depth;
+
+	if (!obs)
+		return NUM_TEXTURES;
+
+	depth = os_atomic_load_long(&obs->video.readback_depth);
+	return depth ? (uint32_t)depth : NUM_TEXTURES;
+}
+
 static void set_ui_thread(void *unused)
 {
 	is_ui_thread = true;
@@ -21,6 +21,7 @@
 #include "util/bmem.h"
 #include "util/profiler.h"
 #include "util/text-lookup.h"
+#include "util/thread-pool.h"
 #include "graphics/graphics.h"
 #include "graphics/vec2.h"
 #include "graphics/vec3.h"
@@ -424,6 +425,14 @@ EXPORT int obs_reset_video(struct obs_video_info *ovi);
 EXPORT bool obs_reset_audio(const struct obs_audio_info *oai);
 EXPORT bool obs_reset_audio2(const struct obs_audio_info2 *oai);
 
+/**
+ * Sets the number of worker threads used to render independent audio sources
+ * in parallel, 0 renders everything on the audio thread.
+ *
+ * @note Takes effect on the next reset of the base audio.
+ */
+EXPORT void obs_set_audio_render_threads(uint32_t threads);
+
 /** Gets the current video settings, returns false if no video */
 EXPORT bool obs_get_video_info(struct obs_video_info *ovi);
 
@@ -882,6 +891,33 @@ EXPORT uint64_t obs_get_frame_interval_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/** Number of frames whose main texture was reused because nothing changed */
+EXPORT uint32_t obs_get_reused_frames(void);
+
+/** Time spent in each phase of one graphics thread frame, in nanoseconds */
+struct obs_frame_timing {
+	uint64_t timestamp;
+	uint64_t tick_ns;
+	uint64_t output_frames_ns;
+	uint64_t render_main_texture_ns; /* part of output_frames_ns */
+	uint64_t gs_flush_ns;            /* part of output_frames_ns */
+	uint64_t render_displays_ns;
+	uint64_t frame_ns;
+	uint64_t sleep_overshoot_ns;
+	uint32_t lagged_frames;
+
+	/* the source that took the longest to tick, by UUID */
+	uint64_t slowest_tick_ns;
+	char slowest_tick_source[37];
+};
+
+/**
+ * Copies the timings of up to max of the most recent frames, oldest first.
+ * Returns the number of frames copied.
+ */
+EXPORT size_t obs_get_frame_timings(struct obs_frame_timing *timings,
+				    size_t max);
+
 EXPORT bool obs_nv12_tex_active(void);
 EXPORT bool obs_p010_tex_active(void);
 
@@ -904,6 +940,29 @@ EXPORT bool obs_in_task_thread(enum obs_task_type type);
 
 EXPORT bool obs_wait_for_destroy_queue(void);
 
+/**
+ * Returns the shared libobs worker thread pool, for short CPU-bound jobs that
+ * can be split up.  Valid between obs_startup and obs_shutdown.
+ */
+EXPORT os_thread_pool_t *obs_get_thread_pool(void);
+
+/**
+ * Saves a profiler trace of the last few seconds to the given directory
+ * whenever the graphics thread misses a frame (at most once per capture
+ * window).  Starts trace recording if necessary.  Pass NULL or 0 seconds to
+ * disable.
+ */
+EXPORT void obs_set_lag_trace_capture(const char *directory, uint32_t seconds);
+
+/**
+ * Sets the number of staging surfaces used to read back raw frames (2 to 4,
+ * 0 for the default of 2).  More surfaces give the GPU more time before a
+ * frame is mapped, at the cost of a frame of latency for raw outputs each.
+ * Takes effect the next time video is reset.
+ */
+EXPORT void obs_set_video_readback_depth(uint32_t depth);
+EXPORT uint32_t obs_get_video_readback_depth(void);
+
 typedef void (*obs_task_handler_t)(obs_task_t task, void *param, bool wait);
 EXPORT void obs_set_ui_task_handler(obs_task_handler_t handler);
 
@@ -1441,6 +1500,21 @@ EXPORT void obs_source_output_video(obs_source_t *source,
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
+typedef void (*obs_source_frame_release_t)(void *param);
+
+/**
+ * Outputs asynchronous video data without copying it.  The frame's planes
+ * must stay valid until libobs calls release, which happens exactly once,
+ * after the frame has been uploaded or discarded.  release may be called from
+ * any thread (including from within this call) and must not call back into
+ * the source.  All frames are released before the source's destroy callback
+ * is called.
+ */
+EXPORT void obs_source_output_video_nocopy(obs_source_t *source,
+					   const struct obs_source_frame *frame,
+					   obs_source_frame_release_t release,
+					   void *param);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 EXPORT void obs_source_output_cea708(obs_source_t *source,
@@ -1477,6 +1551,12 @@ EXPORT void obs_source_set_video_frame2(obs_source_t *source,
 EXPORT void obs_source_output_audio(obs_source_t *source,
 				    const struct obs_source_audio *audio);
 
+/**
+ * Signals that the video of a source with OBS_SOURCE_STATIC_VIDEO has changed
+ * outside of its update callback, so the next frame has to be rendered again
+ */
+EXPORT void obs_source_content_changed(obs_source_t *source);
+
 /** Signal an update to any currently used properties via 'update_properties' */
 EXPORT void obs_source_update_properties(obs_source_t *source);
 
@@ -1599,6 +1679,15 @@ EXPORT bool obs_source_async_unbuffered(const obs_source_t *source);
 EXPORT void obs_source_set_async_decoupled(obs_source_t *source, bool decouple);
 EXPORT bool obs_source_async_decoupled(const obs_source_t *source);
 
+/** Number of async frames that were served from the source's frame pool */
+EXPORT uint64_t obs_source_get_async_frames_reused(obs_source_t *source);
+
+/** Number of async frames that were skipped or discarded before rendering */
+EXPORT uint64_t obs_source_get_async_frames_dropped(obs_source_t *source);
+
+/** Number of times the async frame queue overflowed */
+EXPORT uint64_t obs_source_get_async_cache_overflows(obs_source_t *source);
+
 EXPORT void obs_source_set_audio_active(obs_source_t *source, bool show);
 EXPORT bool obs_source_audio_active(const obs_source_t *source);
 
@@ -2595,6 +2684,12 @@ EXPORT void obs_encoder_packet_ref(struct encoder_packet *dst,
 				   struct encoder_packet *src);
 EXPORT void obs_encoder_packet_release(struct encoder_packet *packet);
 
+/**
+ * Allocates reference counted packet data, with a reference count of one.
+ * The data is released along with the packet by obs_encoder_packet_release.
+ */
+EXPORT uint8_t *obs_encoder_packet_alloc(size_t size);
+
 EXPORT void *obs_encoder_create_rerouted(obs_encoder_t *encoder,
 					 const char *reroute_id);
 
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "c99defs.h"
+#include "deque.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Merge Queue
+ *
+ *   Ordered queue made of several FIFO lanes.  Each lane is kept sorted on
+ * its own; as long as items arrive in order per lane (the common case),
+ * pushing is a plain append.  A binary heap over the lane fronts yields the
+ * smallest item of all lanes, so peeking is O(1) and popping is
+ * O(log lanes).
+ *
+ *   Items can be accessed and modified in place by lane.  If a modification
+ * changes the order between lanes, call merge_queue_rebuild afterwards.
+ */
+
+typedef int (*merge_queue_compare_t)(const void *a, const void *b);
+
+struct merge_queue {
+	size_t element_size;
+	size_t num_lanes;
+	merge_queue_compare_t compare;
+
+	struct deque *lanes;
+	size_t *heap;
+	size_t heap_size;
+	size_t num;
+};
+
+static inline void merge_queue_init(struct merge_queue *mq,
+				    size_t element_size, size_t num_lanes,
+				    merge_queue_compare_t compare)
+{
+	memset(mq, 0, sizeof(struct merge_queue));
+	mq->element_size = element_size;
+	mq->num_lanes = num_lanes;
+	mq->compare = compare;
+	mq->lanes = bzalloc(sizeof(struct deque) * num_lanes);
+	mq->heap = bzalloc(sizeof(size_t) * num_lanes);
+}
+
+static inline void merge_queue_free(struct merge_queue *mq)
+{
+	for (size_t i = 0; i < mq->num_lanes; i++)
+		deque_free(&mq->lanes[i]);
+
+	bfree(mq->lanes);
+	bfree(mq->heap);
+	memset(mq, 0, sizeof(struct merge_queue));
+}
+
+static inline size_t merge_queue_size(const struct merge_queue *mq)
+{
+	return mq->num;
+}
+
+static inline size_t merge_queue_lane_size(const struct merge_queue *mq,
+					   size_t lane)
+{
+	return mq->lanes[lane].size / mq->element_size;
+}
+
+static inline void *merge_queue_lane_item(struct merge_queue *mq, size_t lane,
+					  size_t idx)
+{
+	return deque_data(&mq->lanes[lane], idx * mq->element_size);
+}
+
+static inline void *merge_queue_lane_front(struct merge_queue *mq,
+					   size_t lane)
+{
+	return merge_queue_lane_item(mq, lane, 0);
+}
+
+static inline void *merge_queue_lane_back(struct merge_queue *mq, size_t lane)
+{
+	size_t size = merge_queue_lane_size(mq, lane);
+	return size ? merge_queue_lane_item(mq, lane, size - 1) : NULL;
+}
+
+static inline bool merge_queue_heap_less(struct merge_queue *mq, size_t a,
+					 size_t b)
+{
+	int cmp = mq->compare(merge_queue_lane_front(mq, mq->heap[a]),
+			      merge_queue_lane_front(mq, mq->heap[b]));
+	return cmp < 0 || (cmp == 0 && mq->heap[a] < mq->heap[b]);
+}
+
+static inline void merge_queue_heap_swap(struct merge_queue *mq, size_t a,
+					 size_t b)
+{
+	size_t tmp = mq->heap[a];
+	mq->heap[a] = mq->heap[b];
+	mq->heap[b] = tmp;
+}
+
+static inline void merge_queue_sift_up(struct merge_queue *mq, size_t idx)
+{
+	while (idx) {
+		size_t parent = (idx - 1) / 2;
+		if (!merge_queue_heap_less(mq, idx, parent))
+			break;
+
+		merge_queue_heap_swap(mq, idx, parent);
+		idx = parent;
+	}
+}
+
+static inline void merge_queue_sift_down(struct merge_queue *mq, size_t idx)
+{
+	for (;;) {
+		size_t left = idx * 2 + 1;
+		size_t right = left + 1;
+		size_t smallest = idx;
+
+		if (left < mq->heap_size &&
+		    merge_queue_heap_less(mq, left, smallest))
+			smallest = left;
+		if (right < mq->heap_size &&
+		    merge_queue_heap_less(mq, right, smallest))
+			smallest = right;
+		if (smallest == idx)
+			break;
+
+		merge_queue_heap_swap(mq, idx, smallest);
+		idx = smallest;
+	}
+}
+
+/** Restores the order between lanes after items were modified in place */
+static inline void merge_queue_rebuild(struct merge_queue *mq)
+{
+	mq->heap_size = 0;
+	for (size_t i = 0; i < mq->num_lanes; i++) {
+		if (mq->lanes[i].size)
+			mq->heap[mq->heap_size++] = i;
+	}
+
+	for (size_t i = mq->heap_size / 2; i > 0; i--)
+		merge_queue_sift_down(mq, i - 1);
+}
+
+static inline void merge_queue_clear(struct merge_queue *mq)
+{
+	for (size_t i = 0; i < mq->num_lanes; i++) {
+		struct deque *lane = &mq->lanes[i];
+		lane->size = 0;
+		lane->start_pos = lane->end_pos = 0;
+	}
+
+	mq->heap_size = 0;
+	mq->num = 0;
+}
+
+static inline void merge_queue_push(struct merge_queue *mq, size_t lane,
+				    const void *item)
+{
+	struct deque *dq = &mq->lanes[lane];
+	size_t size = mq->element_size;
+	size_t idx = dq->size / size;
+	bool was_empty = !idx;
+
+	deque_push_back(dq, item, size);
+	mq->num++;
+
+	if (was_empty) {
+		mq->heap[mq->heap_size] = lane;
+		merge_queue_sift_up(mq, mq->heap_size++);
+		return;
+	}
+
+	/* out of order within the lane, move it back to where it belongs */
+	while (idx > 0) {
+		uint8_t *prev = deque_data(dq, (idx - 1) * size);
+		uint8_t *cur = deque_data(dq, idx * size);
+
+		if (mq->compare(prev, cur) <= 0)
+			break;
+
+		for (size_t i = 0; i < size; i++) {
+			uint8_t tmp = prev[i];
+			prev[i] = cur[i];
+			cur[i] = tmp;
+		}
+
+		if (--idx == 0)
+			merge_queue_rebuild(mq);
+	}
+}
+
+/** Returns the smallest item of all lanes, or NULL if empty */
+static inline void *merge_queue_peek(struct merge_queue *mq)
+{
+	return mq->heap_size ? merge_queue_lane_front(mq, mq->heap[0]) : NULL;
+}
+
+static inline void merge_queue_pop(struct merge_queue *mq, void *item)
+{
+	struct deque *dq;
+
+	if (!mq->heap_size)
+		return;
+
+	dq = &mq->lanes[mq->heap[0]];
+	deque_pop_front(dq, item, mq->element_size);
+	mq->num--;
+
+	if (!dq->size)
+		mq->heap[0] = mq->heap[--mq->heap_size];
+	merge_queue_sift_down(mq, 0);
+}
+
+/** Pops the first item of a specific lane */
+static inline void merge_queue_pop_lane(struct merge_queue *mq, size_t lane,
+					void *item)
+{
+	struct deque *dq = &mq->lanes[lane];
+
+	if (!dq->size)
+		return;
+
+	deque_pop_front(dq, item, mq->element_size);
+	mq->num--;
+	merge_queue_rebuild(mq);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -263,6 +263,17 @@ static DARRAY(profile_root_entry) root_entries;
 static THREAD_LOCAL profile_call *thread_context = NULL;
 static THREAD_LOCAL bool thread_enabled = true;
 
+static volatile bool trace_active = false;
+enum trace_event_type {
+	TRACE_EVENT_BEGIN,
+	TRACE_EVENT_END,
+	TRACE_EVENT_COUNTER,
+};
+
+static void trace_record(const char *name, uint64_t time,
+			 enum trace_event_type type, int64_t value);
+static void free_trace_buffers(void);
+
 void profiler_start(void)
 {
 	pthread_mutex_lock(&root_mutex);
@@ -367,6 +378,9 @@ static void merge_context(profile_call *context)
 
 void profile_start(const char *name)
 {
+	if (os_atomic_load_bool(&trace_active))
+		trace_record(name, os_gettime_ns(), TRACE_EVENT_BEGIN, 0);
+
 	if (!thread_enabled)
 		return;
 
@@ -395,6 +409,9 @@ void profile_start(const char *name)
 void profile_end(const char *name)
 {
 	uint64_t end = os_gettime_ns();
+	if (os_atomic_load_bool(&trace_active))
+		trace_record(name, end, TRACE_EVENT_END, 0);
+
 	if (!thread_enabled)
 		return;
 
@@ -827,6 +844,8 @@ void profiler_free(void)
 	da_free(old_root_entries);
 
 	pthread_mutex_destroy(&root_mutex);
+
+	free_trace_buffers();
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1180,3 +1199,357 @@ uint64_t profiler_snapshot_entry_overall_between_calls_count(
 {
 	return entry ? entry->overall_between_calls_count : 0;
 }
+
+/* ------------------------------------------------------------------------- */
+/* Trace recording */
+
+/* Every thread that records events gets its own ring of raw begin/end and
+ * counter events.  Only the owning thread ever writes to a ring, so recording
+ * needs no locks; readers copy the ring and then discard anything the writer
+ * may have overwritten in the meantime.  Rings of exited threads are reused.
+ * Threads count themselves while recording, so that the rings are only freed
+ * once nobody is writing to them anymore. */
+
+#define TRACE_RING_SIZE 16384
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+
+struct trace_event {
+	const char *name;
+	uint64_t time;
+	enum trace_event_type type;
+	int64_t value;
+};
+
+struct trace_buffer {
+	struct trace_buffer *next;
+	long thread_id;
+	const char *thread_name;
+	bool in_use;
+
+	volatile long pos;
+	struct trace_event events[TRACE_RING_SIZE];
+};
+
+struct trace_thread {
+	long thread_id;
+	const char *thread_name;
+	DARRAY(struct trace_event) events;
+};
+
+struct profiler_trace {
+	uint64_t start_time;
+	uint64_t end_time;
+	DARRAY(struct trace_thread) threads;
+};
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_buffer *trace_buffers = NULL;
+static long trace_thread_counter = 0;
+static volatile long trace_generation = 0;
+static volatile long trace_recorders = 0;
+static pthread_key_t trace_key;
+static bool trace_key_initialized = false;
+
+static THREAD_LOCAL struct trace_buffer *thread_trace = NULL;
+static THREAD_LOCAL long thread_trace_generation = 0;
+
+static void trace_thread_exit(void *param)
+{
+	struct trace_buffer *buf = param;
+
+	pthread_mutex_lock(&trace_mutex);
+	if (thread_trace_generation == trace_generation)
+		buf->in_use = false;
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+static struct trace_buffer *trace_acquire_buffer(void)
+{
+	struct trace_buffer *buf;
+
+	pthread_mutex_lock(&trace_mutex);
+
+	buf = trace_buffers;
+	while (buf && buf->in_use)
+		buf = buf->next;
+
+	if (!buf) {
+		buf = bzalloc(sizeof(*buf));
+		buf->next = trace_buffers;
+		trace_buffers = buf;
+	}
+
+	buf->in_use = true;
+	buf->thread_id = ++trace_thread_counter;
+	buf->thread_name = NULL;
+	os_atomic_set_long(&buf->pos, 0);
+
+	if (trace_key_initialized)
+		pthread_setspecific(trace_key, buf);
+
+	thread_trace_generation = trace_generation;
+	pthread_mutex_unlock(&trace_mutex);
+
+	return buf;
+}
+
+static void trace_record(const char *name, uint64_t time,
+			 enum trace_event_type type, int64_t value)
+{
+	struct trace_buffer *buf = thread_trace;
+
+	/* counted so that the buffers aren't freed while being written to */
+	os_atomic_inc_long(&trace_recorders);
+	if (!os_atomic_load_bool(&trace_active))
+		goto done;
+
+	if (!buf || thread_trace_generation != trace_generation)
+		buf = thread_trace = trace_acquire_buffer();
+
+	/* name threads after the first thing they profile */
+	if (!buf->thread_name && type == TRACE_EVENT_BEGIN)
+		buf->thread_name = name;
+
+	long pos = buf->pos;
+	struct trace_event *event = &buf->events[pos & TRACE_RING_MASK];
+	event->name = name;
+	event->time = time;
+	event->type = type;
+	event->value = value;
+	os_atomic_set_long(&buf->pos, pos + 1);
+
+done:
+	os_atomic_dec_long(&trace_recorders);
+}
+
+void profiler_trace_start(void)
+{
+	pthread_mutex_lock(&trace_mutex);
+	if (!trace_key_initialized)
+		trace_key_initialized =
+			pthread_key_create(&trace_key, trace_thread_exit) == 0;
+	pthread_mutex_unlock(&trace_mutex);
+
+	os_atomic_set_bool(&trace_active, true);
+}
+
+void profiler_trace_stop(void)
+{
+	os_atomic_set_bool(&trace_active, false);
+}
+
+bool profiler_trace_active(void)
+{
+	return os_atomic_load_bool(&trace_active);
+}
+
+void profile_counter(const char *name, int64_t value)
+{
+	if (os_atomic_load_bool(&trace_active))
+		trace_record(name, os_gettime_ns(), TRACE_EVENT_COUNTER, value);
+}
+
+static void copy_trace_buffer(struct trace_buffer *buf,
+			      struct trace_thread *thread, uint64_t start_time)
+{
+	long end = os_atomic_load_long(&buf->pos);
+	long start = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+	struct trace_event *events;
+	size_t depth = 0;
+
+	da_resize(thread->events, (size_t)(end - start));
+	events = thread->events.array;
+	for (long i = start; i < end; i++)
+		events[i - start] = buf->events[i & TRACE_RING_MASK];
+
+	/* anything the writer has lapped while copying may be torn */
+	long pos = os_atomic_load_long(&buf->pos);
+	long first_valid = pos - TRACE_RING_SIZE + 1;
+	size_t skip = first_valid > start ? (size_t)(first_valid - start) : 0;
+
+	/* drop events that are too old, and ends whose begin is gone */
+	size_t out = 0;
+	for (size_t i = skip; i < thread->events.num; i++) {
+		struct trace_event *event = &events[i];
+
+		if (event->time < start_time)
+			continue;
+		if (event->type == TRACE_EVENT_BEGIN) {
+			depth++;
+		} else if (event->type == TRACE_EVENT_END) {
+			if (!depth)
+				continue;
+			depth--;
+		}
+
+		events[out++] = *event;
+	}
+	thread->events.num = out;
+}
+
+profiler_trace_t *profiler_trace_capture(uint64_t duration_ns)
+{
+	profiler_trace_t *trace = bzalloc(sizeof(*trace));
+	struct trace_buffer *buf;
+
+	trace->end_time = os_gettime_ns();
+	trace->start_time = duration_ns < trace->end_time
+				    ? trace->end_time - duration_ns
+				    : 0;
+
+	pthread_mutex_lock(&trace_mutex);
+	for (buf = trace_buffers; buf; buf = buf->next) {
+		struct trace_thread *thread = da_push_back_new(trace->threads);
+		thread->thread_id = buf->thread_id;
+		thread->thread_name = buf->thread_name;
+
+		copy_trace_buffer(buf, thread, trace->start_time);
+
+		if (!thread->events.num) {
+			da_free(thread->events);
+			da_pop_back(trace->threads);
+		}
+	}
+	pthread_mutex_unlock(&trace_mutex);
+
+	return trace;
+}
+
+void profiler_trace_free(profiler_trace_t *trace)
+{
+	if (!trace)
+		return;
+
+	for (size_t i = 0; i < trace->threads.num; i++)
+		da_free(trace->threads.array[i].events);
+	da_free(trace->threads);
+	bfree(trace);
+}
+
+size_t profiler_trace_num_events(const profiler_trace_t *trace)
+{
+	size_t num = 0;
+
+	if (!trace)
+		return 0;
+
+	for (size_t i = 0; i < trace->threads.num; i++)
+		num += trace->threads.array[i].events.num;
+	return num;
+}
+
+static void json_cat_escaped(struct dstr *buffer, const char *str)
+{
+	dstr_cat_ch(buffer, '"');
+	for (; str && *str; str++) {
+		unsigned char ch = (unsigned char)*str;
+
+		if (ch == '"' || ch == '\\') {
+			dstr_cat_ch(buffer, '\\');
+			dstr_cat_ch(buffer, (char)ch);
+		} else if (ch < 0x20) {
+			dstr_catf(buffer, "\\u%04x", ch);
+		} else {
+			dstr_cat_ch(buffer, (char)ch);
+		}
+	}
+	dstr_cat_ch(buffer, '"');
+}
+
+static char trace_event_phase(enum trace_event_type type)
+{
+	switch (type) {
+	case TRACE_EVENT_BEGIN:
+		return 'B';
+	case TRACE_EVENT_END:
+		return 'E';
+	case TRACE_EVENT_COUNTER:
+		return 'C';
+	}
+
+	return 'i';
+}
+
+static void trace_dump_thread(const profiler_trace_t *trace,
+			      const struct trace_thread *thread,
+			      struct dstr *buffer, FILE *f)
+{
+	dstr_printf(buffer,
+		    ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+		    "\"tid\":%ld,\"args\":{\"name\":",
+		    thread->thread_id);
+	json_cat_escaped(buffer, thread->thread_name ? thread->thread_name
+						     : "thread");
+	dstr_cat(buffer, "}}");
+	fwrite(buffer->array, 1, buffer->len, f);
+
+	for (size_t i = 0; i < thread->events.num; i++) {
+		const struct trace_event *event = &thread->events.array[i];
+		uint64_t ns = event->time - trace->start_time;
+
+		dstr_copy(buffer, ",\n{\"name\":");
+		json_cat_escaped(buffer, event->name);
+		dstr_catf(buffer,
+			  ",\"ph\":\"%c\",\"pid\":1,\"tid\":%ld,"
+			  "\"ts\":%" PRIu64 ".%03" PRIu64,
+			  trace_event_phase(event->type), thread->thread_id,
+			  ns / 1000, ns % 1000);
+		if (event->type == TRACE_EVENT_COUNTER)
+			dstr_catf(buffer, ",\"args\":{\"value\":%" PRId64 "}",
+				  event->value);
+		dstr_cat_ch(buffer, '}');
+		fwrite(buffer->array, 1, buffer->len, f);
+	}
+}
+
+bool profiler_trace_dump_json(const profiler_trace_t *trace,
+			      const char *filename)
+{
+	struct dstr buffer = {0};
+	FILE *f;
+
+	if (!trace)
+		return false;
+
+	f = os_fopen(filename, "wb");
+	if (!f)
+		return false;
+
+	/* the process metadata entry keeps the separators simple */
+	dstr_copy(&buffer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+			   "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+			   "\"args\":{\"name\":\"libobs\"}}");
+	fwrite(buffer.array, 1, buffer.len, f);
+
+	for (size_t i = 0; i < trace->threads.num; i++)
+		trace_dump_thread(trace, &trace->threads.array[i], &buffer, f);
+
+	fwrite("\n]}\n", 1, 4, f);
+
+	dstr_free(&buffer);
+	fclose(f);
+	return true;
+}
+
+static void free_trace_buffers(void)
+{
+	struct trace_buffer *buf;
+
+	os_atomic_set_bool(&trace_active, false);
+
+	/* threads that saw tracing as active may still be recording */
+	while (os_atomic_load_long(&trace_recorders))
+		os_sleep_ms(1);
+
+	pthread_mutex_lock(&trace_mutex);
+	buf = trace_buffers;
+	trace_buffers = NULL;
+	os_atomic_inc_long(&trace_generation);
+	pthread_mutex_unlock(&trace_mutex);
+
+	while (buf) {
+		struct trace_buffer *next = buf->next;
+		bfree(buf);
+		buf = next;
+	}
+}
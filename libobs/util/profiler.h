@@ -10,6 +10,7 @@ extern "C" {
 typedef struct profiler_snapshot profiler_snapshot_t;
 typedef struct profiler_snapshot_entry profiler_snapshot_entry_t;
 typedef struct profiler_time_entry profiler_time_entry_t;
+typedef struct profiler_trace profiler_trace_t;
 
 /* ------------------------------------------------------------------------- */
 /* Profiling */
@@ -33,6 +34,33 @@ EXPORT void profiler_print_time_between_calls(profiler_snapshot_t *snap);
 
 EXPORT void profiler_free(void);
 
+/* ------------------------------------------------------------------------- */
+/* Trace recording
+ *
+ *   While active, every profile_start/profile_end is additionally recorded
+ * with its raw timestamp into a fixed-size ring per thread, independent of
+ * whether the profiler itself is running.  The most recent events can be
+ * captured at any time and exported as Chrome trace-event JSON, which can be
+ * loaded in Perfetto or chrome://tracing.
+ *
+ *   profile_counter records a named value (shown as a counter track), it is
+ * only recorded while tracing is active.
+ *
+ *   Captured traces reference the profiler names, so they must be dumped
+ * before the name stores are freed. */
+
+EXPORT void profiler_trace_start(void);
+EXPORT void profiler_trace_stop(void);
+EXPORT bool profiler_trace_active(void);
+
+EXPORT void profile_counter(const char *name, int64_t value);
+
+EXPORT profiler_trace_t *profiler_trace_capture(uint64_t duration_ns);
+EXPORT void profiler_trace_free(profiler_trace_t *trace);
+EXPORT size_t profiler_trace_num_events(const profiler_trace_t *trace);
+EXPORT bool profiler_trace_dump_json(const profiler_trace_t *trace,
+				     const char *filename);
+
 /* ------------------------------------------------------------------------- */
 /* Profiler name storage */
 
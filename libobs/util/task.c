@@ -3,22 +3,40 @@
 #include "threading.h"
 #include "deque.h"
 
+/* Tasks are pushed into a bounded multi-producer single-consumer ring
+ * without taking any locks.  Only when the ring is full do producers fall
+ * back to a mutex-protected overflow deque, which keeps queueing from ever
+ * failing while preserving per-producer ordering. */
+
+#define TASK_RING_SIZE 4096
+#define TASK_RING_MASK (TASK_RING_SIZE - 1)
+#define TASK_DRAIN_BATCH 64
+
+struct task_cell {
+	volatile long sequence;
+	struct os_task_info ti;
+};
+
 struct os_task_queue {
 	pthread_t thread;
 	os_sem_t *sem;
 	long id;
 
-	bool waiting;
-	bool tasks_processed;
+	volatile bool waiting;
+	volatile bool tasks_processed;
 	os_event_t *wait_event;
 
-	pthread_mutex_t mutex;
-	struct deque tasks;
-};
+	struct task_cell ring[TASK_RING_SIZE];
+	volatile long enqueue_pos;
+	long dequeue_pos;
 
-struct os_task_info {
-	os_task_t task;
-	void *param;
+	/* number of tasks queued but not yet popped by the consumer */
+	volatile long num_tasks;
+	volatile bool sleeping;
+
+	pthread_mutex_t overflow_mutex;
+	volatile long overflow_count;
+	struct deque overflow;
 };
 
 static THREAD_LOCAL bool exit_thread = false;
@@ -32,7 +50,10 @@ os_task_queue_t *os_task_queue_create(void)
 	struct os_task_queue *tq = bzalloc(sizeof(*tq));
 	tq->id = os_atomic_inc_long(&thread_id_counter);
 
-	if (pthread_mutex_init(&tq->mutex, NULL) != 0)
+	for (long i = 0; i < TASK_RING_SIZE; i++)
+		tq->ring[i].sequence = i;
+
+	if (pthread_mutex_init(&tq->overflow_mutex, NULL) != 0)
 		goto fail1;
 	if (os_sem_init(&tq->sem, 0) != 0)
 		goto fail2;
@@ -49,12 +70,142 @@ fail4:
 fail3:
 	os_sem_destroy(tq->sem);
 fail2:
-	pthread_mutex_destroy(&tq->mutex);
+	pthread_mutex_destroy(&tq->overflow_mutex);
 fail1:
 	bfree(tq);
 	return NULL;
 }
 
+static inline long seq_diff(long a, long b)
+{
+	return (long)((unsigned long)a - (unsigned long)b);
+}
+
+/* reserves and fills up to count consecutive cells, returns the number of
+ * tasks that were pushed, or 0 if the ring is full */
+static size_t ring_push(struct os_task_queue *tq,
+			const struct os_task_info *tasks, size_t count)
+{
+	long pos = os_atomic_load_long(&tq->enqueue_pos);
+	long num;
+
+	if (count > TASK_RING_SIZE)
+		count = TASK_RING_SIZE;
+
+	for (;;) {
+		struct task_cell *cell = &tq->ring[pos & TASK_RING_MASK];
+		long diff = seq_diff(os_atomic_load_long(&cell->sequence), pos);
+
+		if (diff < 0)
+			return 0;
+		if (diff > 0) {
+			pos = os_atomic_load_long(&tq->enqueue_pos);
+			continue;
+		}
+
+		/* cells are freed in order, so if the last cell of the range
+		 * is free, the whole range is */
+		num = (long)count;
+		while (num > 1) {
+			cell = &tq->ring[(pos + num - 1) & TASK_RING_MASK];
+			diff = seq_diff(os_atomic_load_long(&cell->sequence),
+					pos + num - 1);
+			if (diff == 0)
+				break;
+			num--;
+		}
+
+		if (os_atomic_compare_exchange_long(&tq->enqueue_pos, &pos,
+						    pos + num))
+			break;
+	}
+
+	for (long i = 0; i < num; i++) {
+		struct task_cell *cell = &tq->ring[(pos + i) & TASK_RING_MASK];
+		cell->ti = tasks[i];
+		os_atomic_store_long(&cell->sequence, pos + i + 1);
+	}
+
+	return (size_t)num;
+}
+
+static bool ring_pop(struct os_task_queue *tq, struct os_task_info *ti)
+{
+	long pos = tq->dequeue_pos;
+	struct task_cell *cell = &tq->ring[pos & TASK_RING_MASK];
+	long seq = os_atomic_load_long(&cell->sequence);
+
+	if (seq_diff(seq, pos + 1) < 0)
+		return false;
+
+	*ti = cell->ti;
+	os_atomic_store_long(&cell->sequence, pos + TASK_RING_SIZE);
+	tq->dequeue_pos = pos + 1;
+	return true;
+}
+
+static inline void add_num_tasks(struct os_task_queue *tq, long val)
+{
+	long num = os_atomic_load_long(&tq->num_tasks);
+	while (!os_atomic_compare_exchange_long(&tq->num_tasks, &num,
+						num + val))
+		;
+}
+
+static void push_tasks(struct os_task_queue *tq,
+		       const struct os_task_info *tasks, size_t count)
+{
+	add_num_tasks(tq, (long)count);
+
+	/* once anything is in the overflow deque, everything goes there
+	 * until the consumer has caught up, so ordering is kept */
+	while (count && !os_atomic_load_long(&tq->overflow_count)) {
+		size_t pushed = ring_push(tq, tasks, count);
+		if (!pushed)
+			break;
+
+		tasks += pushed;
+		count -= pushed;
+	}
+
+	if (count) {
+		pthread_mutex_lock(&tq->overflow_mutex);
+		deque_push_back(&tq->overflow, tasks, sizeof(*tasks) * count);
+		os_atomic_set_long(&tq->overflow_count,
+				   (long)(tq->overflow.size / sizeof(*tasks)));
+		pthread_mutex_unlock(&tq->overflow_mutex);
+	}
+
+	if (os_atomic_exchange_bool(&tq->sleeping, false))
+		os_sem_post(tq->sem);
+}
+
+/* consumer side: drains up to max tasks, ring first */
+static size_t pop_tasks(struct os_task_queue *tq, struct os_task_info *tasks,
+			size_t max)
+{
+	size_t count = 0;
+
+	while (count < max && ring_pop(tq, &tasks[count]))
+		count++;
+
+	if (!count && os_atomic_load_long(&tq->overflow_count)) {
+		pthread_mutex_lock(&tq->overflow_mutex);
+		size_t avail = tq->overflow.size / sizeof(*tasks);
+		if (avail > max)
+			avail = max;
+		deque_pop_front(&tq->overflow, tasks, sizeof(*tasks) * avail);
+		os_atomic_set_long(&tq->overflow_count,
+				   (long)(tq->overflow.size / sizeof(*tasks)));
+		pthread_mutex_unlock(&tq->overflow_mutex);
+		count = avail;
+	}
+
+	if (count)
+		add_num_tasks(tq, -(long)count);
+	return count;
+}
+
 bool os_task_queue_queue_task(os_task_queue_t *tq, os_task_t task, void *param)
 {
 	struct os_task_info ti = {
@@ -65,10 +216,18 @@ bool os_task_queue_queue_task(os_task_queue_t *tq, os_task_t task, void *param)
 	if (!tq)
 		return false;
 
-	pthread_mutex_lock(&tq->mutex);
-	deque_push_back(&tq->tasks, &ti, sizeof(ti));
-	pthread_mutex_unlock(&tq->mutex);
-	os_sem_post(tq->sem);
+	push_tasks(tq, &ti, 1);
+	return true;
+}
+
+bool os_task_queue_queue_tasks(os_task_queue_t *tq,
+			       const struct os_task_info *tasks, size_t count)
+{
+	if (!tq || !tasks)
+		return false;
+
+	if (count)
+		push_tasks(tq, tasks, count);
 	return true;
 }
 
@@ -93,8 +252,8 @@ void os_task_queue_destroy(os_task_queue_t *tq)
 	pthread_join(tq->thread, NULL);
 	os_event_destroy(tq->wait_event);
 	os_sem_destroy(tq->sem);
-	pthread_mutex_destroy(&tq->mutex);
-	deque_free(&tq->tasks);
+	pthread_mutex_destroy(&tq->overflow_mutex);
+	deque_free(&tq->overflow);
 	bfree(tq);
 }
 
@@ -103,25 +262,13 @@ bool os_task_queue_wait(os_task_queue_t *tq)
 	if (!tq)
 		return false;
 
-	struct os_task_info ti = {
-		wait_for_thread,
-		tq,
-	};
-
-	pthread_mutex_lock(&tq->mutex);
-	tq->waiting = true;
-	tq->tasks_processed = false;
-	deque_push_back(&tq->tasks, &ti, sizeof(ti));
-	pthread_mutex_unlock(&tq->mutex);
+	os_atomic_set_bool(&tq->tasks_processed, false);
+	os_atomic_set_bool(&tq->waiting, true);
+	os_task_queue_queue_task(tq, wait_for_thread, tq);
 
-	os_sem_post(tq->sem);
 	os_event_wait(tq->wait_event);
 
-	pthread_mutex_lock(&tq->mutex);
-	bool tasks_processed = tq->tasks_processed;
-	pthread_mutex_unlock(&tq->mutex);
-
-	return tasks_processed;
+	return os_atomic_load_bool(&tq->tasks_processed);
 }
 
 bool os_task_queue_inside(os_task_queue_t *tq)
@@ -129,36 +276,57 @@ bool os_task_queue_inside(os_task_queue_t *tq)
 	return tq->id == thread_id;
 }
 
+static void wait_for_tasks(struct os_task_queue *tq)
+{
+	os_atomic_set_bool(&tq->sleeping, true);
+
+	/* re-check after announcing that we're going to sleep, producers
+	 * only post the semaphore if they see the flag set */
+	if (!os_atomic_load_long(&tq->num_tasks))
+		os_sem_wait(tq->sem);
+
+	os_atomic_set_bool(&tq->sleeping, false);
+}
+
 static void *tiny_tubular_task_thread(void *param)
 {
 	struct os_task_queue *tq = param;
+	struct os_task_info tasks[TASK_DRAIN_BATCH];
 	thread_id = tq->id;
 
 	os_set_thread_name(__FUNCTION__);
 
-	while (!exit_thread && os_sem_wait(tq->sem) == 0) {
-		struct os_task_info ti;
+	while (!exit_thread) {
+		size_t count = pop_tasks(tq, tasks, TASK_DRAIN_BATCH);
 
-		pthread_mutex_lock(&tq->mutex);
-		deque_pop_front(&tq->tasks, &ti, sizeof(ti));
-		if (tq->tasks.size && ti.task == wait_for_thread) {
-			deque_push_back(&tq->tasks, &ti, sizeof(ti));
-			deque_pop_front(&tq->tasks, &ti, sizeof(ti));
-		}
-		if (tq->tasks.size && ti.task == stop_thread) {
-			deque_push_back(&tq->tasks, &ti, sizeof(ti));
-			deque_pop_front(&tq->tasks, &ti, sizeof(ti));
+		if (!count) {
+			wait_for_tasks(tq);
+			continue;
 		}
-		if (tq->waiting) {
-			if (ti.task == wait_for_thread) {
-				tq->waiting = false;
-			} else {
-				tq->tasks_processed = true;
+
+		for (size_t i = 0; i < count && !exit_thread; i++) {
+			struct os_task_info ti = tasks[i];
+			bool remaining = i + 1 < count ||
+					 os_atomic_load_long(&tq->num_tasks);
+
+			/* waits and stops always go to the back of the line */
+			if (remaining && (ti.task == wait_for_thread ||
+					  ti.task == stop_thread)) {
+				push_tasks(tq, &ti, 1);
+				continue;
+			}
+
+			if (os_atomic_load_bool(&tq->waiting)) {
+				if (ti.task == wait_for_thread) {
+					os_atomic_set_bool(&tq->waiting, false);
+				} else {
+					os_atomic_set_bool(&tq->tasks_processed,
+							   true);
+				}
 			}
-		}
-		pthread_mutex_unlock(&tq->mutex);
 
-		ti.task(ti.param);
+			ti.task(ti.param);
+		}
 	}
 
 	return NULL;
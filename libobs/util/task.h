@@ -11,9 +11,20 @@ typedef struct os_task_queue os_task_queue_t;
 
 typedef void (*os_task_t)(void *param);
 
+struct os_task_info {
+	os_task_t task;
+	void *param;
+};
+
 EXPORT os_task_queue_t *os_task_queue_create(void);
 EXPORT bool os_task_queue_queue_task(os_task_queue_t *tt, os_task_t task,
 				     void *param);
+/* queues several tasks at once with a single wakeup of the task thread.  they
+ * run in order, but the task thread may start on the first tasks before the
+ * rest have been queued */
+EXPORT bool os_task_queue_queue_tasks(os_task_queue_t *tt,
+				      const struct os_task_info *tasks,
+				      size_t count);
 EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
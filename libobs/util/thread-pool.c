@@ -0,0 +1,325 @@
+#include "thread-pool.h"
+#include "platform.h"
+#include "threading.h"
+#include "deque.h"
+#include "bmem.h"
+#include "dstr.h"
+
+struct pool_task {
+	os_task_t task;
+	void *param;
+	os_task_group_t *group;
+};
+
+struct pool_worker {
+	os_thread_pool_t *pool;
+	size_t index;
+	pthread_t thread;
+	bool initialized;
+
+	/* owner pushes and pops at the back, thieves take from the front */
+	pthread_mutex_t mutex;
+	struct deque tasks[OS_TASK_PRIORITY_COUNT];
+	volatile long num_tasks;
+};
+
+struct os_thread_pool {
+	char *name;
+	struct pool_worker *workers;
+	size_t num_workers;
+
+	os_sem_t *sem;
+	volatile bool stop;
+	volatile long next_worker;
+};
+
+struct os_task_group {
+	/* the signal happens under the mutex, so that the group can't be
+	 * destroyed by a waiter while the last task is still signalling */
+	pthread_mutex_t mutex;
+	volatile long pending;
+	os_event_t *done_event;
+};
+
+static THREAD_LOCAL struct pool_worker *current_worker = NULL;
+
+/* ------------------------------------------------------------------------- */
+
+static void push_task(struct pool_worker *worker, const struct pool_task *pt,
+		      enum os_task_priority priority)
+{
+	pthread_mutex_lock(&worker->mutex);
+	deque_push_back(&worker->tasks[priority], pt, sizeof(*pt));
+	os_atomic_inc_long(&worker->num_tasks);
+	pthread_mutex_unlock(&worker->mutex);
+}
+
+static bool take_task(struct pool_worker *worker, struct pool_task *pt,
+		      enum os_task_priority priority, bool steal)
+{
+	bool found = false;
+
+	if (!os_atomic_load_long(&worker->num_tasks))
+		return false;
+
+	pthread_mutex_lock(&worker->mutex);
+	struct deque *tasks = &worker->tasks[priority];
+	if (tasks->size) {
+		if (steal)
+			deque_pop_front(tasks, pt, sizeof(*pt));
+		else
+			deque_pop_back(tasks, pt, sizeof(*pt));
+		os_atomic_dec_long(&worker->num_tasks);
+		found = true;
+	}
+	pthread_mutex_unlock(&worker->mutex);
+
+	return found;
+}
+
+static bool find_task(os_thread_pool_t *pool, struct pool_worker *self,
+		      struct pool_task *pt)
+{
+	size_t start = self ? self->index + 1 : 0;
+
+	for (int prio = OS_TASK_PRIORITY_COUNT - 1; prio >= 0; prio--) {
+		if (self && take_task(self, pt, prio, false))
+			return true;
+
+		for (size_t i = 0; i < pool->num_workers; i++) {
+			struct pool_worker *victim =
+				&pool->workers[(start + i) % pool->num_workers];
+			if (victim != self && take_task(victim, pt, prio, true))
+				return true;
+		}
+	}
+
+	return false;
+}
+
+static void run_task(struct pool_task *pt)
+{
+	os_task_group_t *group = pt->group;
+
+	pt->task(pt->param);
+
+	if (group) {
+		pthread_mutex_lock(&group->mutex);
+		if (os_atomic_dec_long(&group->pending) == 0)
+			os_event_signal(group->done_event);
+		pthread_mutex_unlock(&group->mutex);
+	}
+}
+
+static void *pool_worker_thread(void *param)
+{
+	struct pool_worker *worker = param;
+	os_thread_pool_t *pool = worker->pool;
+	struct pool_task pt;
+	struct dstr name = {0};
+
+	dstr_printf(&name, "%s: worker %d", pool->name, (int)worker->index);
+	os_set_thread_name(name.array);
+	dstr_free(&name);
+
+	current_worker = worker;
+
+	for (;;) {
+		if (find_task(pool, worker, &pt)) {
+			run_task(&pt);
+			continue;
+		}
+
+		if (os_atomic_load_bool(&pool->stop))
+			break;
+
+		os_sem_wait(pool->sem);
+	}
+
+	current_worker = NULL;
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+os_thread_pool_t *os_thread_pool_create(const char *name, size_t num_threads)
+{
+	os_thread_pool_t *pool = bzalloc(sizeof(*pool));
+
+	if (!num_threads) {
+		int cores = os_get_logical_cores();
+		num_threads = cores > 2 ? (size_t)(cores - 1) : 1;
+	}
+
+	pool->name = bstrdup(name ? name : "thread pool");
+	pool->workers = bzalloc(sizeof(struct pool_worker) * num_threads);
+	pool->num_workers = num_threads;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		struct pool_worker *worker = &pool->workers[i];
+		worker->pool = pool;
+		worker->index = i;
+		pthread_mutex_init_value(&worker->mutex);
+	}
+
+	if (os_sem_init(&pool->sem, 0) != 0)
+		goto fail;
+
+	for (size_t i = 0; i < num_threads; i++) {
+		if (pthread_mutex_init(&pool->workers[i].mutex, NULL) != 0)
+			goto fail;
+	}
+
+	for (size_t i = 0; i < num_threads; i++) {
+		struct pool_worker *worker = &pool->workers[i];
+
+		if (pthread_create(&worker->thread, NULL, pool_worker_thread,
+				   worker) != 0)
+			goto fail;
+
+		worker->initialized = true;
+	}
+
+	return pool;
+
+fail:
+	os_thread_pool_destroy(pool);
+	return NULL;
+}
+
+void os_thread_pool_destroy(os_thread_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	os_atomic_set_bool(&pool->stop, true);
+
+	for (size_t i = 0; i < pool->num_workers; i++)
+		os_sem_post(pool->sem);
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct pool_worker *worker = &pool->workers[i];
+		if (worker->initialized)
+			pthread_join(worker->thread, NULL);
+	}
+
+	for (size_t i = 0; i < pool->num_workers; i++) {
+		struct pool_worker *worker = &pool->workers[i];
+
+		pthread_mutex_destroy(&worker->mutex);
+		for (size_t prio = 0; prio < OS_TASK_PRIORITY_COUNT; prio++)
+			deque_free(&worker->tasks[prio]);
+	}
+
+	os_sem_destroy(pool->sem);
+	bfree(pool->workers);
+	bfree(pool->name);
+	bfree(pool);
+}
+
+size_t os_thread_pool_num_threads(const os_thread_pool_t *pool)
+{
+	return pool ? pool->num_workers : 0;
+}
+
+bool os_thread_pool_inside(const os_thread_pool_t *pool)
+{
+	return pool && current_worker && current_worker->pool == pool;
+}
+
+bool os_thread_pool_submit(os_thread_pool_t *pool, os_task_t task,
+			   void *param, enum os_task_priority priority,
+			   os_task_group_t *group)
+{
+	struct pool_task pt = {task, param, group};
+	struct pool_worker *worker;
+
+	if (!pool || !task)
+		return false;
+	if ((int)priority < 0 || priority >= OS_TASK_PRIORITY_COUNT)
+		priority = OS_TASK_PRIORITY_NORMAL;
+
+	if (group) {
+		pthread_mutex_lock(&group->mutex);
+		if (os_atomic_inc_long(&group->pending) == 1)
+			os_event_reset(group->done_event);
+		pthread_mutex_unlock(&group->mutex);
+	}
+
+	if (os_thread_pool_inside(pool)) {
+		worker = current_worker;
+	} else {
+		long idx = os_atomic_inc_long(&pool->next_worker);
+		worker = &pool->workers[(unsigned long)idx % pool->num_workers];
+	}
+
+	push_task(worker, &pt, priority);
+	os_sem_post(pool->sem);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+os_task_group_t *os_task_group_create(void)
+{
+	os_task_group_t *group = bzalloc(sizeof(*group));
+
+	if (pthread_mutex_init(&group->mutex, NULL) != 0) {
+		bfree(group);
+		return NULL;
+	}
+	if (os_event_init(&group->done_event, OS_EVENT_TYPE_MANUAL) != 0) {
+		pthread_mutex_destroy(&group->mutex);
+		bfree(group);
+		return NULL;
+	}
+
+	os_event_signal(group->done_event);
+	return group;
+}
+
+void os_task_group_destroy(os_task_group_t *group)
+{
+	if (!group)
+		return;
+
+	os_event_destroy(group->done_event);
+	pthread_mutex_destroy(&group->mutex);
+	bfree(group);
+}
+
+long os_task_group_pending(const os_task_group_t *group)
+{
+	return group ? os_atomic_load_long(&group->pending) : 0;
+}
+
+static bool group_finished(os_task_group_t *group)
+{
+	pthread_mutex_lock(&group->mutex);
+	bool finished = !group->pending;
+	pthread_mutex_unlock(&group->mutex);
+	return finished;
+}
+
+void os_thread_pool_wait_for_group(os_thread_pool_t *pool,
+				   os_task_group_t *group)
+{
+	struct pool_task pt;
+
+	if (!pool || !group)
+		return;
+
+	if (!os_thread_pool_inside(pool)) {
+		while (!group_finished(group))
+			os_event_timedwait(group->done_event, 10);
+		return;
+	}
+
+	/* never block a worker, help out with other tasks instead */
+	while (!group_finished(group)) {
+		if (find_task(pool, current_worker, &pt))
+			run_task(&pt);
+		else
+			os_event_timedwait(group->done_event, 1);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "c99defs.h"
+#include "task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Work-stealing thread pool
+ *
+ *   Every worker thread owns one deque per priority.  Tasks submitted from a
+ * worker go to that worker's deques and are run newest first, tasks submitted
+ * from any other thread are distributed over the workers.  Idle workers steal
+ * the oldest tasks from other workers, always preferring higher priorities.
+ *
+ *   Tasks can optionally be tracked in a group, which can be waited on.
+ * Waiting on a group from inside a worker thread runs other queued tasks in
+ * the meantime instead of blocking the worker.
+ */
+
+struct os_thread_pool;
+struct os_task_group;
+typedef struct os_thread_pool os_thread_pool_t;
+typedef struct os_task_group os_task_group_t;
+
+enum os_task_priority {
+	OS_TASK_PRIORITY_LOW,
+	OS_TASK_PRIORITY_NORMAL,
+	OS_TASK_PRIORITY_HIGH,
+};
+
+#define OS_TASK_PRIORITY_COUNT 3
+
+/**
+ * Creates a thread pool.  If num_threads is 0, one thread less than the
+ * number of logical cores is used (but at least one).
+ */
+EXPORT os_thread_pool_t *os_thread_pool_create(const char *name,
+					       size_t num_threads);
+
+/** Runs all remaining tasks, then stops and frees the pool */
+EXPORT void os_thread_pool_destroy(os_thread_pool_t *pool);
+
+EXPORT size_t os_thread_pool_num_threads(const os_thread_pool_t *pool);
+
+/** Returns true if called from one of the pool's worker threads */
+EXPORT bool os_thread_pool_inside(const os_thread_pool_t *pool);
+
+/**
+ * Queues a task.  group is optional; if set, the group must stay alive until
+ * os_thread_pool_wait_for_group has returned.
+ */
+EXPORT bool os_thread_pool_submit(os_thread_pool_t *pool, os_task_t task,
+				  void *param, enum os_task_priority priority,
+				  os_task_group_t *group);
+
+EXPORT os_task_group_t *os_task_group_create(void);
+EXPORT void os_task_group_destroy(os_task_group_t *group);
+
+/** Returns the number of tasks of the group that have not finished yet */
+EXPORT long os_task_group_pending(const os_task_group_t *group);
+
+/** Waits until every task submitted with the group has finished */
+EXPORT void os_thread_pool_wait_for_group(os_thread_pool_t *pool,
+					  os_task_group_t *group);
+
+#ifdef __cplusplus
+}
+#endif
@@ -75,6 +75,7 @@ static void image_source_load_texture(void *data)
 		warn("failed to load texture '%s'", context->file);
 	context->update_time_elapsed = 0;
 	os_atomic_set_bool(&context->texture_loaded, true);
+	obs_source_content_changed(context->source);
 }
 
 static void image_source_unload(void *data)
@@ -158,6 +159,8 @@ static void restart_gif(void *data)
 		gs_image_file4_update_texture(&context->if4);
 		obs_leave_graphics();
 
+		obs_source_content_changed(context->source);
+
 		context->restart_gif = false;
 	}
 }
@@ -280,6 +283,8 @@ static void image_source_tick(void *data, float seconds)
 			obs_enter_graphics();
 			gs_image_file4_update_texture(&context->if4);
 			obs_leave_graphics();
+
+			obs_source_content_changed(context->source);
 		}
 	}
 
@@ -372,7 +377,8 @@ image_source_get_color_space(void *data, size_t count,
 static struct obs_source_info image_source_info = {
 	.id = "image_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_STATIC_VIDEO,
 	.get_name = image_source_get_name,
 	.create = image_source_create,
 	.destroy = image_source_destroy,
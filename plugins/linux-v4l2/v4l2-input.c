@@ -65,6 +65,38 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define blog(level, msg, ...) blog(level, "v4l2-input: " msg, ##__VA_ARGS__)
 
+/* number of buffers that always stay queued in the driver, so that capture
+ * can continue while libobs holds on to frames */
+#define V4L2_RESERVED_BUFFERS 2
+
+struct v4l2_shared_buffers;
+
+/**
+ * Release parameter for a buffer passed to libobs without copying
+ */
+struct v4l2_buffer_ref {
+	struct v4l2_shared_buffers *shared;
+	uint32_t index;
+};
+
+/**
+ * Mapped buffers shared with libobs.  Owned by the source and by every
+ * buffer held by libobs, so that the mapping outlives the capture until the
+ * last buffer is returned.
+ */
+struct v4l2_shared_buffers {
+	pthread_mutex_t mutex;
+	volatile long refs;
+	volatile long in_use;
+
+	/** device to requeue returned buffers on, -1 once capture stopped */
+	int_fast32_t dev;
+	/** only set once the source gave up ownership */
+	struct v4l2_buffer_data buffers;
+	struct v4l2_buffer_ref *buffer_refs;
+	uint_fast32_t count;
+};
+
 /**
  * Data structure for the v4l2 source
  */
@@ -92,6 +124,7 @@ struct v4l2_data {
 	int height;
 	int linesize;
 	struct v4l2_buffer_data buffers;
+	struct v4l2_shared_buffers *shared;
 
 	bool auto_reset;
 	int timeout_frames;
@@ -161,6 +194,109 @@ static void v4l2_prep_obs_frame(struct v4l2_data *data,
 	}
 }
 
+static struct v4l2_shared_buffers *
+v4l2_shared_buffers_create(int_fast32_t dev, uint_fast32_t count)
+{
+	struct v4l2_shared_buffers *shared = bzalloc(sizeof(*shared));
+
+	if (pthread_mutex_init(&shared->mutex, NULL) != 0) {
+		bfree(shared);
+		return NULL;
+	}
+
+	shared->refs = 1;
+	shared->dev = dev;
+	shared->count = count;
+	shared->buffer_refs = bzalloc(sizeof(struct v4l2_buffer_ref) * count);
+
+	for (uint_fast32_t i = 0; i < count; i++) {
+		shared->buffer_refs[i].shared = shared;
+		shared->buffer_refs[i].index = (uint32_t)i;
+	}
+
+	return shared;
+}
+
+static void v4l2_shared_buffers_release(struct v4l2_shared_buffers *shared)
+{
+	if (os_atomic_dec_long(&shared->refs) != 0)
+		return;
+
+	v4l2_destroy_mmap(&shared->buffers);
+	pthread_mutex_destroy(&shared->mutex);
+	bfree(shared->buffer_refs);
+	bfree(shared);
+}
+
+/**
+ * Stops requeuing returned buffers and hands the buffer mapping over to the
+ * shared buffers, which unmap it once libobs has returned every buffer.
+ */
+static void v4l2_shared_buffers_detach(struct v4l2_shared_buffers *shared,
+				       struct v4l2_buffer_data *buffers)
+{
+	pthread_mutex_lock(&shared->mutex);
+	shared->dev = -1;
+	shared->buffers = *buffers;
+	pthread_mutex_unlock(&shared->mutex);
+
+	memset(buffers, 0, sizeof(*buffers));
+
+	if (os_atomic_load_long(&shared->in_use))
+		blog(LOG_DEBUG, "%ld buffers still in use, deferring unmap",
+		     os_atomic_load_long(&shared->in_use));
+
+	v4l2_shared_buffers_release(shared);
+}
+
+/** Called by libobs once a buffer passed without copying is not needed */
+static void v4l2_release_buffer(void *param)
+{
+	struct v4l2_buffer_ref *ref = param;
+	struct v4l2_shared_buffers *shared = ref->shared;
+	struct v4l2_buffer buf;
+
+	pthread_mutex_lock(&shared->mutex);
+	if (shared->dev != -1) {
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = ref->index;
+
+		if (v4l2_ioctl(shared->dev, VIDIOC_QBUF, &buf) < 0)
+			blog(LOG_DEBUG, "failed to requeue buffer #%u",
+			     ref->index);
+	}
+	os_atomic_dec_long(&shared->in_use);
+	pthread_mutex_unlock(&shared->mutex);
+
+	v4l2_shared_buffers_release(shared);
+}
+
+/**
+ * Passes a raw buffer to libobs without copying if enough buffers are left
+ * for the driver, returns false if the buffer still has to be requeued.
+ */
+static bool v4l2_output_buffer(struct v4l2_data *data,
+			       struct obs_source_frame *frame,
+			       struct v4l2_buffer *buf)
+{
+	struct v4l2_shared_buffers *shared = data->shared;
+
+	if (!shared || buf->index >= shared->count ||
+	    os_atomic_load_long(&shared->in_use) + V4L2_RESERVED_BUFFERS >=
+		    (long)shared->count) {
+		obs_source_output_video(data->source, frame);
+		return false;
+	}
+
+	os_atomic_inc_long(&shared->refs);
+	os_atomic_inc_long(&shared->in_use);
+	obs_source_output_video_nocopy(data->source, frame, v4l2_release_buffer,
+				       &shared->buffer_refs[buf->index]);
+	return true;
+}
+
 /*
  * Worker thread to get video data
  */
@@ -279,11 +415,17 @@ static void *v4l2_thread(void *vptr)
 				     "failed to unpack jpeg or h264");
 				break;
 			}
+			obs_source_output_video(data->source, &out);
 		} else {
 			for (uint_fast32_t i = 0; i < MAX_AV_PLANES; ++i)
 				out.data[i] = start + plane_offsets[i];
+
+			/* requeued by libobs once uploaded */
+			if (v4l2_output_buffer(data, &out, &buf)) {
+				frames++;
+				continue;
+			}
 		}
-		obs_source_output_video(data->source, &out);
 
 		if (v4l2_ioctl(data->dev, VIDIOC_QBUF, &buf) < 0) {
 			blog(LOG_ERROR, "%s: failed to enqueue buffer",
@@ -928,7 +1070,13 @@ static void v4l2_terminate(struct v4l2_data *data)
 	    data->pixfmt == V4L2_PIX_FMT_H264) {
 		v4l2_destroy_decoder(&data->decoder);
 	}
-	v4l2_destroy_mmap(&data->buffers);
+
+	if (data->shared) {
+		v4l2_shared_buffers_detach(data->shared, &data->buffers);
+		data->shared = NULL;
+	} else {
+		v4l2_destroy_mmap(&data->buffers);
+	}
 
 	if (data->dev != -1) {
 		v4l2_close(data->dev);
@@ -1048,6 +1196,9 @@ static void v4l2_init(struct v4l2_data *data)
 		goto fail;
 	}
 
+	data->shared =
+		v4l2_shared_buffers_create(data->dev, data->buffers.count);
+
 	if (data->pixfmt == V4L2_PIX_FMT_MJPEG ||
 	    data->pixfmt == V4L2_PIX_FMT_H264) {
 		if (v4l2_init_decoder(&data->decoder, data->pixfmt) < 0) {
@@ -46,6 +46,11 @@ target_sources(
           obs-ffmpeg-output.h
           obs-ffmpeg-mux.c
           obs-ffmpeg-mux.h
+          obs-ffmpeg-mux-engine.c
+          obs-ffmpeg-replay-ring.c
+          obs-ffmpeg-replay-ring.h
+          ffmpeg-mux/ffmpeg-mux.c
+          ffmpeg-mux/ffmpeg-mux.h
           obs-ffmpeg-hls-mux.c
           obs-ffmpeg-source.c
           obs-ffmpeg-compat.h
@@ -54,6 +59,8 @@ target_sources(
 
 target_include_directories(obs-ffmpeg PRIVATE ${CMAKE_BINARY_DIR}/config)
 
+target_compile_definitions(obs-ffmpeg PRIVATE FFMPEG_MUX_EMBEDDED)
+
 target_link_libraries(
   obs-ffmpeg
   PRIVATE OBS::libobs
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Compares the sustained throughput of muxing through the obs-ffmpeg-mux
+ * helper process with running the muxer in-process.  Synthetic video packets
+ * are written to a matroska file as fast as possible.
+ *
+ * usage: obs-ffmpeg-mux-benchmark <output dir> [frames] [frame size in KiB]
+ *                                  [write mode]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ffmpeg-mux.h"
+
+#include <util/platform.h>
+#include <util/pipe.h>
+#include <util/dstr.h>
+#include <util/bmem.h>
+
+#ifdef _WIN32
+#define FFMPEG_MUX "obs-ffmpeg-mux.exe"
+#else
+#define FFMPEG_MUX "obs-ffmpeg-mux"
+#endif
+
+struct bench_input {
+	int frames;
+	int cur;
+	uint8_t *frame;
+	uint32_t frame_size;
+	uint8_t header[16];
+	const char *write_mode;
+};
+
+static os_process_args_t *build_args(struct bench_input *in, const char *exe,
+				      const char *path)
+{
+	os_process_args_t *args = os_process_args_create(exe);
+
+	os_process_args_add_arg(args, path);
+	os_process_args_add_arg(args, "1"); /* video tracks */
+	os_process_args_add_arg(args, "0"); /* audio tracks */
+	os_process_args_add_arg(args, "mpeg4");
+	os_process_args_add_arg(args, "100000"); /* bitrate */
+	os_process_args_add_arg(args, "1920");
+	os_process_args_add_arg(args, "1080");
+	os_process_args_add_arg(args, "1"); /* primaries, BT.709 */
+	os_process_args_add_arg(args, "1"); /* trc, BT.709 */
+	os_process_args_add_arg(args, "1"); /* colorspace, BT.709 */
+	os_process_args_add_arg(args, "1"); /* range, limited */
+	os_process_args_add_arg(args, "1"); /* chroma location, left */
+	os_process_args_add_arg(args, "0"); /* max luminance */
+	os_process_args_add_arg(args, "60");
+	os_process_args_add_arg(args, "1");
+	os_process_args_add_arg(args, "0"); /* codec tag */
+	os_process_args_add_arg(args, ""); /* stream key */
+	os_process_args_add_arg(args, ""); /* muxer settings */
+	os_process_args_add_arg(args, in->write_mode);
+	return args;
+}
+
+static bool next_packet(struct bench_input *in, struct ffm_packet_info *info,
+			uint8_t **data)
+{
+	memset(info, 0, sizeof(*info));
+	info->type = FFM_PACKET_VIDEO;
+
+	/* the first packet is the codec header */
+	if (in->cur == 0) {
+		info->size = sizeof(in->header);
+		*data = in->header;
+		in->cur++;
+		return true;
+	}
+
+	if (in->cur > in->frames)
+		return false;
+
+	info->pts = info->dts = in->cur - 1;
+	info->size = in->frame_size;
+	info->keyframe = (in->cur - 1) % 120 == 0;
+	*data = in->frame;
+
+	/* keep the payload from being trivially identical */
+	in->frame[0] = (uint8_t)in->cur;
+	in->cur++;
+	return true;
+}
+
+static bool run_pipe(struct bench_input *in, const char *path)
+{
+	struct ffm_packet_info info;
+	os_process_pipe_t *pipe;
+	uint8_t *data;
+	bool success = true;
+
+	char *exe = os_get_executable_path_ptr(FFMPEG_MUX);
+	os_process_args_t *args = build_args(in, exe, path);
+	pipe = os_process_pipe_create2(args, "w");
+	os_process_args_destroy(args);
+	bfree(exe);
+
+	if (!pipe) {
+		fprintf(stderr, "Failed to start " FFMPEG_MUX "\n");
+		return false;
+	}
+
+	while (success && next_packet(in, &info, &data)) {
+		success = os_process_pipe_write(pipe, (const uint8_t *)&info,
+						sizeof(info)) == sizeof(info) &&
+			  os_process_pipe_write(pipe, data, info.size) ==
+				  info.size;
+	}
+
+	return os_process_pipe_destroy(pipe) == 0 && success;
+}
+
+static bool read_input(void *param, struct ffm_packet_info *info,
+		       uint8_t **data)
+{
+	return next_packet(param, info, data);
+}
+
+static bool run_in_process(struct bench_input *in, const char *path)
+{
+	os_process_args_t *args = build_args(in, FFMPEG_MUX, path);
+	struct dstr error = {0};
+	int ret;
+
+	ret = ffmpeg_mux_run((int)os_process_args_get_argc(args),
+			     os_process_args_get_argv(args), read_input, in,
+			     &error);
+	if (ret != FFM_SUCCESS)
+		fprintf(stderr, "Muxer failed: %s\n", error.array);
+
+	dstr_free(&error);
+	os_process_args_destroy(args);
+	return ret == FFM_SUCCESS;
+}
+
+static void bench(const char *name, const char *dir, struct bench_input *in,
+		  bool (*run)(struct bench_input *, const char *))
+{
+	struct dstr path = {0};
+	uint64_t start;
+	double sec;
+	double mb;
+
+	dstr_printf(&path, "%s/ffmpeg-mux-benchmark-%s.mkv", dir, name);
+	in->cur = 0;
+
+	start = os_gettime_ns();
+	if (!run(in, path.array)) {
+		printf("%-12s failed\n", name);
+		goto finish;
+	}
+	sec = (double)(os_gettime_ns() - start) / 1000000000.0;
+	mb = (double)in->frames * (double)in->frame_size / (1024.0 * 1024.0);
+
+	printf("%-12s %8.1f MiB in %6.2f s: %8.1f MiB/s\n", name, mb, sec,
+	       mb / sec);
+
+finish:
+	os_unlink(path.array);
+	dstr_free(&path);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_input in = {0};
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <output dir> [frames] "
+				"[frame size in KiB] [write mode]\n",
+			argv[0]);
+		return 1;
+	}
+
+	in.frames = argc > 2 ? atoi(argv[2]) : 600;
+	in.frame_size = (uint32_t)(argc > 3 ? atoi(argv[3]) : 512) * 1024;
+	in.write_mode = argc > 4 ? argv[4] : "";
+	if (in.frames <= 0 || !in.frame_size) {
+		fprintf(stderr, "Invalid frame count or size\n");
+		return 1;
+	}
+
+	in.frame = bmalloc(in.frame_size);
+	for (uint32_t i = 0; i < in.frame_size; i++)
+		in.frame[i] = (uint8_t)(i * 2654435761u >> 24);
+	for (size_t i = 0; i < sizeof(in.header); i++)
+		in.header[i] = (uint8_t)i;
+
+	printf("%d frames of %u KiB\n", in.frames, in.frame_size / 1024);
+	bench("pipe", argv[1], &in, run_pipe);
+	bench("in-process", argv[1], &in, run_in_process);
+
+	bfree(in.frame);
+	return 0;
+}
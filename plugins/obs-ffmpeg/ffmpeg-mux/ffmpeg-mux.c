@@ -14,22 +14,33 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#ifdef __linux__
+/* fallocate, sync_file_range and O_DIRECT */
+#define _GNU_SOURCE
+#endif
+
 #ifdef _WIN32
 #include <io.h>
 #include <fcntl.h>
 #include <windows.h>
 #define inline __inline
 
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 #endif
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include "ffmpeg-mux.h"
 
 #include <util/threading.h>
 #include <util/platform.h>
 #include <util/deque.h>
 #include <util/dstr.h>
+#include <util/base.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/channel_layout.h>
@@ -43,7 +54,61 @@
 
 /* ------------------------------------------------------------------------- */
 
+#ifdef FFMPEG_MUX_EMBEDDED
+/* errors of the muxer running on the current thread are collected here */
+static THREAD_LOCAL struct dstr *thread_last_error = NULL;
+#else
 static char *global_stream_key = "";
+#endif
+
+static void ffm_error(const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+#ifdef FFMPEG_MUX_EMBEDDED
+	struct dstr msg = {0};
+
+	/* messages are written for stderr, drop the line breaks */
+	dstr_vprintf(&msg, format, args);
+	while (msg.len && dstr_end(&msg) == '\n')
+		dstr_resize(&msg, msg.len - 1);
+
+	blog(LOG_WARNING, "[ffmpeg-mux] %s", msg.array ? msg.array : "");
+
+	if (thread_last_error) {
+		if (!dstr_is_empty(thread_last_error))
+			dstr_cat_ch(thread_last_error, '\n');
+		dstr_cat_dstr(thread_last_error, &msg);
+	}
+
+	dstr_free(&msg);
+#else
+	vfprintf(stderr, format, args);
+#endif
+	va_end(args);
+}
+
+static void ffm_info(const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+#ifdef FFMPEG_MUX_EMBEDDED
+	struct dstr msg = {0};
+
+	dstr_vprintf(&msg, format, args);
+	while (msg.len && dstr_end(&msg) == '\n')
+		dstr_resize(&msg, msg.len - 1);
+
+	blog(LOG_INFO, "[ffmpeg-mux] %s", msg.array ? msg.array : "");
+	dstr_free(&msg);
+#else
+	printf("info: ");
+	vprintf(format, args);
+#endif
+	va_end(args);
+}
 
 struct resize_buf {
 	uint8_t *buf;
@@ -97,6 +162,8 @@ struct main_params {
 	int max_luminance;
 	char *acodec;
 	char *muxer_settings;
+	char *stream_key;
+	char *write_mode;
 	int codec_tag;
 };
 
@@ -123,6 +190,28 @@ struct io_header {
 	size_t data_length;
 };
 
+enum io_write_mode {
+	/* regular buffered file I/O */
+	IO_WRITE_BUFFERED,
+	/* writes back and drops written data from the page cache as it goes */
+	IO_WRITE_WRITEBACK,
+	/* bypasses the page cache, partial blocks are written back */
+	IO_WRITE_DIRECT,
+};
+
+struct io_stats {
+	/* updated by the I/O thread */
+	uint64_t bytes;
+	uint64_t writes;
+	uint64_t write_ns;
+	uint64_t max_write_ns;
+	uint64_t slow_writes;
+
+	/* updated by the muxer, waiting for the I/O thread to make space */
+	uint64_t stalls;
+	uint64_t stall_ns;
+};
+
 struct io_buffer {
 	bool active;
 	bool shutdown_requested;
@@ -134,6 +223,28 @@ struct io_buffer {
 	FILE *output_file;
 	struct deque data;
 	uint64_t next_pos;
+
+	/* fragmented outputs are synced to disk as fragments complete */
+	bool flush_requested;
+	uint64_t pushed_writes;
+	uint64_t flushed_writes;
+
+	enum io_write_mode mode;
+	struct io_stats stats;
+
+	/* only accessed by the I/O thread */
+	uint64_t file_pos;
+	uint64_t end_pos;
+#ifdef __linux__
+	int direct_fd;
+	bool preallocate;
+	uint64_t prealloc_end;
+	uint64_t dropped_pos;
+#endif
+#ifdef FFMPEG_MUX_EMBEDDED
+	/* errors of the I/O thread, only read once it has been joined */
+	struct dstr last_error;
+#endif
 };
 
 struct ffmpeg_mux {
@@ -148,6 +259,7 @@ struct ffmpeg_mux {
 	struct header *audio_header;
 	int num_audio_streams;
 	bool initialized;
+	bool fragmented;
 	struct io_buffer io;
 };
 
@@ -201,6 +313,53 @@ static void free_avformat(struct ffmpeg_mux *ffm)
 	ffm->num_audio_streams = 0;
 }
 
+static const char *write_mode_name(enum io_write_mode mode)
+{
+	switch (mode) {
+	case IO_WRITE_BUFFERED:
+		return "buffered";
+	case IO_WRITE_WRITEBACK:
+		return "writeback";
+	case IO_WRITE_DIRECT:
+		return "direct";
+	}
+
+	return "unknown";
+}
+
+static void log_io_stats(struct ffmpeg_mux *ffm)
+{
+	struct io_stats *stats = &ffm->io.stats;
+	double mb = (double)stats->bytes / 1048576.0;
+	double sec = (double)stats->write_ns / 1000000000.0;
+
+	ffm_info("Wrote %.1f MiB to '%s' (%s): %" PRIu64
+		 " writes, %.1f MiB/s while writing, longest write %.1f ms, "
+		 "%" PRIu64 " slow writes, stalled %" PRIu64
+		 " times for %.1f ms\n",
+		 mb, ffm->params.printable_file.array,
+		 write_mode_name(ffm->io.mode), stats->writes,
+		 sec > 0.0 ? mb / sec : 0.0,
+		 (double)stats->max_write_ns / 1000000.0, stats->slow_writes,
+		 stats->stalls, (double)stats->stall_ns / 1000000.0);
+}
+
+/* errors are collected per thread, so the errors of the I/O thread are handed
+ * to the muxer thread after joining it */
+static void take_io_errors(struct io_buffer *io)
+{
+#ifdef FFMPEG_MUX_EMBEDDED
+	if (thread_last_error && !dstr_is_empty(&io->last_error)) {
+		if (!dstr_is_empty(thread_last_error))
+			dstr_cat_ch(thread_last_error, '\n');
+		dstr_cat_dstr(thread_last_error, &io->last_error);
+	}
+	dstr_free(&io->last_error);
+#else
+	UNUSED_PARAMETER(io);
+#endif
+}
+
 static void ffmpeg_mux_free(struct ffmpeg_mux *ffm)
 {
 	if (ffm->initialized) {
@@ -218,6 +377,9 @@ static void ffmpeg_mux_free(struct ffmpeg_mux *ffm)
 		pthread_mutex_unlock(&ffm->io.data_mutex);
 		pthread_join(ffm->io.io_thread, NULL);
 
+		take_io_errors(&ffm->io);
+		log_io_stats(ffm);
+
 		// Cleanup everything else
 		os_event_destroy(ffm->io.new_data_available_event);
 		os_event_destroy(ffm->io.buffer_space_available_event);
@@ -257,7 +419,7 @@ static bool get_opt_str(int *p_argc, char ***p_argv, char **str,
 	char **argv = *p_argv;
 
 	if (!argc) {
-		printf("Missing expected option: '%s'\n", opt);
+		ffm_error("Missing expected option: '%s'\n", opt);
 		return false;
 	}
 
@@ -295,6 +457,7 @@ static bool get_audio_params(struct audio_params *audio, int *argc,
 	return true;
 }
 
+#ifndef FFMPEG_MUX_EMBEDDED
 static void ffmpeg_log_callback(void *param, int level, const char *format,
 				va_list args)
 {
@@ -334,6 +497,7 @@ static void ffmpeg_log_callback(void *param, int level, const char *format,
 #endif
 	UNUSED_PARAMETER(param);
 }
+#endif
 
 static bool init_params(int *argc, char ***argv, struct main_params *params,
 			struct audio_params **p_audio)
@@ -348,15 +512,15 @@ static bool init_params(int *argc, char ***argv, struct main_params *params,
 		return false;
 
 	if (params->has_video > 1 || params->has_video < 0) {
-		puts("Invalid number of video tracks\n");
+		ffm_error("Invalid number of video tracks\n");
 		return false;
 	}
 	if (params->tracks < 0) {
-		puts("Invalid number of audio tracks\n");
+		ffm_error("Invalid number of audio tracks\n");
 		return false;
 	}
 	if (params->has_video == 0 && params->tracks == 0) {
-		puts("Must have at least 1 audio track or 1 video track\n");
+		ffm_error("Must have at least 1 audio track or 1 video track\n");
 		return false;
 	}
 
@@ -415,16 +579,26 @@ static bool init_params(int *argc, char ***argv, struct main_params *params,
 
 	dstr_copy(&params->printable_file, params->file);
 
-	get_opt_str(argc, argv, &global_stream_key, "stream key");
-	if (strcmp(global_stream_key, "") != 0) {
-		dstr_replace(&params->printable_file, global_stream_key,
+	params->stream_key = "";
+	get_opt_str(argc, argv, &params->stream_key, "stream key");
+	if (strcmp(params->stream_key, "") != 0) {
+		dstr_replace(&params->printable_file, params->stream_key,
 			     "{stream_key}");
 	}
 
+#ifndef FFMPEG_MUX_EMBEDDED
+	/* an embedded muxer must not replace the host's log callback */
+	global_stream_key = params->stream_key;
 	av_log_set_callback(ffmpeg_log_callback);
+#endif
 
 	get_opt_str(argc, argv, &params->muxer_settings, "muxer settings");
 
+	/* optional, older callers do not pass it */
+	params->write_mode = "";
+	if (*argc)
+		get_opt_str(argc, argv, &params->write_mode, "write mode");
+
 	return true;
 }
 
@@ -433,8 +607,7 @@ static bool new_stream(struct ffmpeg_mux *ffm, AVStream **stream,
 {
 	*stream = avformat_new_stream(ffm->output, NULL);
 	if (!*stream) {
-		fprintf(stderr, "Couldn't create stream for encoder '%s'\n",
-			name);
+		ffm_error("Couldn't create stream for encoder '%s'\n", name);
 		return false;
 	}
 
@@ -450,7 +623,7 @@ static void create_video_stream(struct ffmpeg_mux *ffm)
 
 	const AVCodecDescriptor *codec = avcodec_descriptor_get_by_name(name);
 	if (!codec) {
-		fprintf(stderr, "Couldn't find codec '%s'\n", name);
+		ffm_error("Couldn't find codec '%s'\n", name);
 		return;
 	}
 
@@ -557,13 +730,13 @@ static void create_audio_stream(struct ffmpeg_mux *ffm, int idx)
 	const AVCodecDescriptor *codec_desc =
 		avcodec_descriptor_get_by_name(name);
 	if (!codec_desc) {
-		fprintf(stderr, "Couldn't find codec descriptor '%s'\n", name);
+		ffm_error("Couldn't find codec descriptor '%s'\n", name);
 		return;
 	}
 
 	const AVCodec *codec = avcodec_find_encoder(codec_desc->id);
 	if (!codec) {
-		fprintf(stderr, "Couldn't find codec '%s'\n", name);
+		ffm_error("Couldn't find codec '%s'\n", name);
 		return;
 	}
 
@@ -654,82 +827,357 @@ static void ffmpeg_mux_header(struct ffmpeg_mux *ffm, uint8_t *data,
 	}
 }
 
-static size_t safe_read(void *vdata, size_t size)
+static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm, ffm_read_t read,
+				  void *param)
 {
-	uint8_t *data = vdata;
-	size_t total = size;
+	struct ffm_packet_info info = {0};
+	uint8_t *data;
 
-	while (size > 0) {
-		size_t in_size = fread(data, 1, size, stdin);
-		if (in_size == 0)
-			return 0;
+	if (!read(param, &info, &data))
+		return false;
 
-		size -= in_size;
-		data += in_size;
+	ffmpeg_mux_header(ffm, data, &info);
+	return true;
+}
+
+static inline bool ffmpeg_mux_get_extra_data(struct ffmpeg_mux *ffm,
+					     ffm_read_t read, void *param)
+{
+	if (ffm->params.has_video) {
+		if (!ffmpeg_mux_get_header(ffm, read, param)) {
+			return false;
+		}
 	}
 
-	return total;
+	for (int i = 0; i < ffm->params.tracks; i++) {
+		if (!ffmpeg_mux_get_header(ffm, read, param)) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
-static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+#define CHUNK_SIZE 1048576
+
+/* block size that direct I/O offsets, lengths and buffers are aligned to */
+#define IO_ALIGNMENT 4096
+
+/* the output file is grown in steps of this size ahead of the writes */
+#define PREALLOC_SIZE (128 * 1048576)
+
+/* write-behind keeps this much recently written data in the page cache */
+#define WRITEBACK_WINDOW (8 * 1048576)
+
+/* writes taking longer than this are counted as slow */
+#define SLOW_WRITE_NS 50000000ULL
+
+static enum io_write_mode get_write_mode(const char *name)
 {
-	struct ffm_packet_info info = {0};
+	if (strcmp(name, "writeback") == 0)
+		return IO_WRITE_WRITEBACK;
+	if (strcmp(name, "direct") == 0)
+		return IO_WRITE_DIRECT;
+	if (*name && strcmp(name, "buffered") != 0)
+		ffm_error("Unknown write mode '%s', using buffered I/O\n",
+			  name);
+
+	return IO_WRITE_BUFFERED;
+}
 
-	bool success = safe_read(&info, sizeof(info)) == sizeof(info);
-	if (success) {
-		uint8_t *data = malloc(info.size);
+static unsigned char *alloc_chunk(void)
+{
+#ifdef _WIN32
+	return malloc(CHUNK_SIZE);
+#else
+	void *chunk;
+	if (posix_memalign(&chunk, IO_ALIGNMENT, CHUNK_SIZE) != 0)
+		return NULL;
+	return chunk;
+#endif
+}
 
-		if (safe_read(data, info.size) == info.size) {
-			ffmpeg_mux_header(ffm, data, &info);
-		} else {
-			success = false;
+#ifdef __linux__
+static void setup_write_mode(struct ffmpeg_mux *ffm)
+{
+	struct io_buffer *io = &ffm->io;
+
+	io->direct_fd = -1;
+	io->preallocate = io->mode != IO_WRITE_BUFFERED;
+
+	if (io->mode != IO_WRITE_DIRECT)
+		return;
+
+	io->direct_fd = open(ffm->params.file, O_WRONLY | O_DIRECT | O_CLOEXEC);
+	if (io->direct_fd == -1) {
+		ffm_error("Couldn't open '%s' for direct I/O, %s, "
+			  "using writeback instead\n",
+			  ffm->params.printable_file.array, strerror(errno));
+		io->mode = IO_WRITE_WRITEBACK;
+	}
+}
+
+static bool pwrite_all(int fd, const unsigned char *data, size_t size,
+		       uint64_t pos)
+{
+	while (size) {
+		ssize_t ret = pwrite(fd, data, size, (off_t)pos);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
 		}
 
-		free(data);
+		data += ret;
+		size -= (size_t)ret;
+		pos += (uint64_t)ret;
 	}
 
-	return success;
+	return true;
 }
 
-static inline bool ffmpeg_mux_get_extra_data(struct ffmpeg_mux *ffm)
+static void preallocate(struct io_buffer *io, uint64_t end)
 {
-	if (ffm->params.has_video) {
-		if (!ffmpeg_mux_get_header(ffm)) {
-			return false;
+	int fd = fileno(io->output_file);
+
+	while (io->preallocate && end > io->prealloc_end) {
+		/* keep the size, so the file stays valid if we crash */
+		if (fallocate(fd, FALLOC_FL_KEEP_SIZE, (off_t)io->prealloc_end,
+			      PREALLOC_SIZE) != 0) {
+			io->preallocate = false;
+			break;
 		}
+
+		io->prealloc_end += PREALLOC_SIZE;
 	}
+}
 
-	for (int i = 0; i < ffm->params.tracks; i++) {
-		if (!ffmpeg_mux_get_header(ffm)) {
+/* Starts writing back the new data right away, and waits for the data that
+ * has left the window to reach the disk so it can be dropped from the page
+ * cache.  Also keeps the I/O thread at the speed of the disk instead of
+ * piling up dirty pages. */
+static void write_behind(struct io_buffer *io, uint64_t pos, size_t size)
+{
+	int fd = fileno(io->output_file);
+	uint64_t end = pos + size;
+
+	sync_file_range(fd, (off_t)pos, (off_t)size, SYNC_FILE_RANGE_WRITE);
+
+	if (end < io->dropped_pos + 2 * WRITEBACK_WINDOW)
+		return;
+
+	uint64_t drop_end = end - WRITEBACK_WINDOW;
+	off_t drop_size = (off_t)(drop_end - io->dropped_pos);
+
+	sync_file_range(fd, (off_t)io->dropped_pos, drop_size,
+			SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+				SYNC_FILE_RANGE_WAIT_AFTER);
+	posix_fadvise(fd, (off_t)io->dropped_pos, drop_size,
+		      POSIX_FADV_DONTNEED);
+	io->dropped_pos = drop_end;
+}
+
+/* Returns how much of the data can be written directly.  The rest is held
+ * back until more data follows, unless this is the end of a contiguous
+ * range. */
+static size_t get_direct_size(uint64_t pos, size_t size, bool final)
+{
+	size_t misalign = (size_t)(pos % IO_ALIGNMENT);
+
+	/* write up to the next block boundary with buffered I/O first */
+	if (misalign)
+		return 0;
+
+	if (final)
+		return size;
+
+	return size & ~(size_t)(IO_ALIGNMENT - 1);
+}
+
+static bool write_data(struct io_buffer *io, const unsigned char *data,
+		       size_t size, uint64_t pos, bool final, size_t *written)
+{
+	int fd = fileno(io->output_file);
+
+	if (io->mode == IO_WRITE_BUFFERED) {
+		if (pos != io->file_pos)
+			os_fseeki64(io->output_file, (int64_t)pos, SEEK_SET);
+		if (fwrite(data, size, 1, io->output_file) != 1)
 			return false;
+
+		io->file_pos = pos + size;
+		*written = size;
+		return true;
+	}
+
+	preallocate(io, pos + size);
+
+	if (io->mode == IO_WRITE_DIRECT) {
+		size_t direct_size = get_direct_size(pos, size, final);
+		size_t aligned_size = direct_size & ~(size_t)(IO_ALIGNMENT - 1);
+
+		if (!direct_size) {
+			size_t misalign = (size_t)(pos % IO_ALIGNMENT);
+
+			if (misalign) {
+				size_t head = IO_ALIGNMENT - misalign;
+				*written = head < size ? head : size;
+			} else {
+				*written = 0;
+			}
+
+			return pwrite_all(fd, data, *written, pos);
 		}
+
+		if (!pwrite_all(io->direct_fd, data, aligned_size, pos))
+			return false;
+
+		/* the partial block at the end of a range */
+		if (!pwrite_all(fd, data + aligned_size,
+				direct_size - aligned_size, pos + aligned_size))
+			return false;
+
+		*written = direct_size;
+		return true;
+	}
+
+	if (!pwrite_all(fd, data, size, pos))
+		return false;
+
+	write_behind(io, pos, size);
+	*written = size;
+	return true;
+}
+
+static void sync_output_file(struct io_buffer *io)
+{
+	if (io->mode == IO_WRITE_BUFFERED)
+		fflush(io->output_file);
+
+	fdatasync(fileno(io->output_file));
+}
+
+static void close_output_file(struct io_buffer *io)
+{
+	int fd = fileno(io->output_file);
+
+	if (io->mode != IO_WRITE_BUFFERED) {
+		/* releases the preallocated space past the end of the file,
+		 * and drops whatever is left in the page cache */
+		if (io->prealloc_end > io->end_pos &&
+		    ftruncate(fd, (off_t)io->end_pos) != 0)
+			ffm_error("Couldn't truncate output file, %s\n",
+				  strerror(errno));
+
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
 	}
 
+	if (io->direct_fd != -1)
+		close(io->direct_fd);
+
+	fclose(io->output_file);
+}
+#else
+static void setup_write_mode(struct ffmpeg_mux *ffm)
+{
+#ifdef __APPLE__
+	/* the closest there is to direct I/O, only skips the cache */
+	if (ffm->io.mode == IO_WRITE_DIRECT &&
+	    fcntl(fileno(ffm->io.output_file), F_NOCACHE, 1) == 0)
+		return;
+#endif
+
+	if (ffm->io.mode != IO_WRITE_BUFFERED) {
+		ffm_error("Write mode '%s' is not supported on this platform, "
+			  "using buffered I/O\n",
+			  write_mode_name(ffm->io.mode));
+		ffm->io.mode = IO_WRITE_BUFFERED;
+	}
+}
+
+static bool write_data(struct io_buffer *io, const unsigned char *data,
+		       size_t size, uint64_t pos, bool final, size_t *written)
+{
+	UNUSED_PARAMETER(final);
+
+	if (pos != io->file_pos)
+		os_fseeki64(io->output_file, (int64_t)pos, SEEK_SET);
+	if (fwrite(data, size, 1, io->output_file) != 1)
+		return false;
+
+	io->file_pos = pos + size;
+	*written = size;
 	return true;
 }
 
-#ifdef _MSC_VER
-#pragma warning(disable : 4996)
+static void sync_output_file(struct io_buffer *io)
+{
+	fflush(io->output_file);
+#ifdef _WIN32
+	_commit(_fileno(io->output_file));
+#else
+	fsync(fileno(io->output_file));
 #endif
+}
 
-#define CHUNK_SIZE 1048576
+static void close_output_file(struct io_buffer *io)
+{
+	fclose(io->output_file);
+}
+#endif
+
+static bool io_write(struct io_buffer *io, const unsigned char *data,
+		     size_t size, uint64_t pos, bool final, size_t *written)
+{
+	uint64_t start = os_gettime_ns();
+
+	if (!write_data(io, data, size, pos, final, written))
+		return false;
+
+	if (*written) {
+		uint64_t elapsed = os_gettime_ns() - start;
+
+		io->stats.bytes += *written;
+		io->stats.writes++;
+		io->stats.write_ns += elapsed;
+		if (elapsed > io->stats.max_write_ns)
+			io->stats.max_write_ns = elapsed;
+		if (elapsed > SLOW_WRITE_NS)
+			io->stats.slow_writes++;
+	}
+
+	if (pos + *written > io->end_pos)
+		io->end_pos = pos + *written;
+	return true;
+}
 
 static void *ffmpeg_mux_io_thread(void *data)
 {
 	struct ffmpeg_mux *ffm = data;
 
+#ifdef FFMPEG_MUX_EMBEDDED
+	thread_last_error = &ffm->io.last_error;
+#endif
+
 	// Chunk collects the writes into a larger batch
 	size_t chunk_used = 0;
 
-	unsigned char *chunk = malloc(CHUNK_SIZE);
+	unsigned char *chunk = alloc_chunk();
 	if (!chunk) {
 		os_atomic_set_bool(&ffm->io.output_error, true);
-		fprintf(stderr, "Error allocating memory for output\n");
+		ffm_error("Error allocating memory for output\n");
 		goto error;
 	}
 
 	bool shutting_down;
+	bool flushing = false;
 	bool want_seek = false;
+	bool seek_pending = false;
 	bool force_flush_chunk = false;
 
 	// current_seek_position is a virtual position updated as we read from
@@ -738,6 +1186,7 @@ static void *ffmpeg_mux_io_thread(void *data)
 	// offset we should seek to when we write the chunk.
 	uint64_t current_seek_position = 0;
 	uint64_t next_seek_position;
+	uint64_t write_position = 0;
 
 	for (;;) {
 		// Wait for ffmpeg to write data to the buffer
@@ -747,6 +1196,9 @@ static void *ffmpeg_mux_io_thread(void *data)
 		for (;;) {
 			shutting_down = os_atomic_load_bool(
 				&ffm->io.shutdown_requested);
+			if (os_atomic_exchange_bool(&ffm->io.flush_requested,
+						    false))
+				flushing = true;
 
 			pthread_mutex_lock(&ffm->io.data_mutex);
 
@@ -775,6 +1227,7 @@ static void *ffmpeg_mux_io_thread(void *data)
 					// if we already plan to seek, then seek.
 					if (chunk_used || want_seek) {
 						force_flush_chunk = true;
+						seek_pending = true;
 						break;
 					}
 
@@ -817,7 +1270,8 @@ static void *ffmpeg_mux_io_thread(void *data)
 			// if we were woken up to exit.
 			if (!force_flush_chunk &&
 			    (!chunk_used ||
-			     (chunk_used < 65536 && !shutting_down))) {
+			     (chunk_used < 65536 && !shutting_down &&
+			      !flushing))) {
 				os_event_reset(
 					ffm->io.new_data_available_event);
 				pthread_mutex_unlock(&ffm->io.data_mutex);
@@ -828,8 +1282,7 @@ static void *ffmpeg_mux_io_thread(void *data)
 
 			// Seek if we need to
 			if (want_seek) {
-				os_fseeki64(ffm->io.output_file,
-					    next_seek_position, SEEK_SET);
+				write_position = next_seek_position;
 
 				// Update the next virtual position, making sure to take
 				// into account the size of the chunk we're about to write.
@@ -839,18 +1292,35 @@ static void *ffmpeg_mux_io_thread(void *data)
 				want_seek = false;
 			}
 
-			// Write the current chunk to the output file
-			if (fwrite(chunk, chunk_used, 1, ffm->io.output_file) !=
-			    1) {
+			// Write the current chunk to the output file. Direct
+			// I/O may hold back a partial block until more data
+			// follows, it stays at the start of the chunk.
+			size_t written;
+			if (!io_write(&ffm->io, chunk, chunk_used,
+				      write_position,
+				      seek_pending || shutting_down || flushing,
+				      &written)) {
 				os_atomic_set_bool(&ffm->io.output_error, true);
-				fprintf(stderr, "Error writing to '%s', %s\n",
-					ffm->params.printable_file.array,
-					strerror(errno));
+				ffm_error("Error writing to '%s', %s\n",
+					  ffm->params.printable_file.array,
+					  strerror(errno));
 				goto error;
 			}
 
-			chunk_used = 0;
+			write_position += written;
+			chunk_used -= written;
+			if (chunk_used)
+				memmove(chunk, chunk + written, chunk_used);
+
 			force_flush_chunk = false;
+			seek_pending = false;
+		}
+
+		// Everything up to the end of the last fragment is written,
+		// make sure it survives a crash
+		if (flushing) {
+			sync_output_file(&ffm->io);
+			flushing = false;
 		}
 
 		// If this was the last chunk, time to exit
@@ -862,7 +1332,11 @@ error:
 	if (chunk)
 		free(chunk);
 
-	fclose(ffm->io.output_file);
+	close_output_file(&ffm->io);
+
+#ifdef FFMPEG_MUX_EMBEDDED
+	thread_last_error = NULL;
+#endif
 	return NULL;
 }
 
@@ -899,6 +1373,8 @@ static int ffmpeg_mux_write_av_buffer(void *opaque, uint8_t *buf, int buf_size)
 	if (os_atomic_load_bool(&ffm->io.output_error))
 		return -1;
 
+	uint64_t stall_start = 0;
+
 	for (;;) {
 		pthread_mutex_lock(&ffm->io.data_mutex);
 
@@ -909,12 +1385,21 @@ static int ffmpeg_mux_write_av_buffer(void *opaque, uint8_t *buf, int buf_size)
 			// No space, wait for the I/O thread to make space
 			os_event_reset(ffm->io.buffer_space_available_event);
 			pthread_mutex_unlock(&ffm->io.data_mutex);
+
+			if (!stall_start) {
+				stall_start = os_gettime_ns();
+				ffm->io.stats.stalls++;
+			}
+
 			os_event_wait(ffm->io.buffer_space_available_event);
 		} else {
 			break;
 		}
 	}
 
+	if (stall_start)
+		ffm->io.stats.stall_ns += os_gettime_ns() - stall_start;
+
 	struct io_header header;
 
 	header.data_length = buf_size;
@@ -926,6 +1411,7 @@ static int ffmpeg_mux_write_av_buffer(void *opaque, uint8_t *buf, int buf_size)
 
 	// Advance the next write position
 	ffm->io.next_pos += buf_size;
+	ffm->io.pushed_writes++;
 
 	// Tell the I/O thread that there's new data to be written
 	os_event_signal(ffm->io.new_data_available_event);
@@ -954,12 +1440,15 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 			// We're in charge of managing the actual file now
 			ffm->io.output_file = os_fopen(ffm->params.file, "wb");
 			if (!ffm->io.output_file) {
-				fprintf(stderr, "Couldn't open '%s', %s\n",
-					ffm->params.printable_file.array,
-					strerror(errno));
+				ffm_error("Couldn't open '%s', %s\n",
+					  ffm->params.printable_file.array,
+					  strerror(errno));
 				return FFM_ERROR;
 			}
 
+			ffm->io.mode = get_write_mode(ffm->params.write_mode);
+			setup_write_mode(ffm);
+
 			// Start at 1MB, this can grow up to 256 MB depending
 			// how fast data is going in and out (limited in
 			// ffmpeg_mux_write_av_buffer)
@@ -988,9 +1477,9 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 			ret = avio_open(&ffm->output->pb, ffm->params.file,
 					AVIO_FLAG_WRITE);
 			if (ret < 0) {
-				fprintf(stderr, "Couldn't open '%s', %s\n",
-					ffm->params.printable_file.array,
-					av_err2str(ret));
+				ffm_error("Couldn't open '%s', %s\n",
+					  ffm->params.printable_file.array,
+					  av_err2str(ret));
 				return FFM_ERROR;
 			}
 		}
@@ -999,12 +1488,13 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 	AVDictionary *dict = NULL;
 	if ((ret = av_dict_parse_string(&dict, ffm->params.muxer_settings, "=",
 					" ", 0))) {
-		fprintf(stderr, "Failed to parse muxer settings: %s\n%s\n",
-			av_err2str(ret), ffm->params.muxer_settings);
+		ffm_error("Failed to parse muxer settings: %s\n%s\n",
+			  av_err2str(ret), ffm->params.muxer_settings);
 
 		av_dict_free(&dict);
 	}
 
+#ifndef FFMPEG_MUX_EMBEDDED
 	if (av_dict_count(dict) > 0) {
 		printf("Using muxer settings:");
 
@@ -1015,11 +1505,16 @@ static inline int open_output_file(struct ffmpeg_mux *ffm)
 
 		printf("\n");
 	}
+#endif
+
+	AVDictionaryEntry *movflags = av_dict_get(dict, "movflags", NULL, 0);
+	ffm->fragmented = (movflags && strstr(movflags->value, "frag_")) ||
+			  av_dict_get(dict, "frag_duration", NULL, 0);
 
 	ret = avformat_write_header(ffm->output, &dict);
 	if (ret < 0) {
-		fprintf(stderr, "Error opening '%s': %s",
-			ffm->params.printable_file.array, av_err2str(ret));
+		ffm_error("Error opening '%s': %s",
+			  ffm->params.printable_file.array, av_err2str(ret));
 
 		av_dict_free(&dict);
 
@@ -1055,8 +1550,8 @@ static int ffmpeg_mux_init_context(struct ffmpeg_mux *ffm)
 		output_format = av_guess_format(NULL, ffm->params.file, NULL);
 
 	if (output_format == NULL) {
-		fprintf(stderr, "Couldn't find an appropriate muxer for '%s'\n",
-			ffm->params.printable_file.array);
+		ffm_error("Couldn't find an appropriate muxer for '%s'\n",
+			  ffm->params.printable_file.array);
 		return FFM_ERROR;
 	}
 
@@ -1069,8 +1564,8 @@ static int ffmpeg_mux_init_context(struct ffmpeg_mux *ffm)
 	ret = avformat_alloc_output_context2(&ffm->output, output_format, NULL,
 					     ffm->params.file);
 	if (ret < 0) {
-		fprintf(stderr, "Couldn't initialize output context: %s\n",
-			av_err2str(ret));
+		ffm_error("Couldn't initialize output context: %s\n",
+			  av_err2str(ret));
 		return FFM_ERROR;
 	}
 
@@ -1099,7 +1594,7 @@ static int ffmpeg_mux_init_context(struct ffmpeg_mux *ffm)
 }
 
 static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
-				    char *argv[])
+				    char *argv[], ffm_read_t read, void *param)
 {
 	argc--;
 	argv++;
@@ -1111,7 +1606,7 @@ static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
 			calloc(ffm->params.tracks, sizeof(*ffm->audio_header));
 	}
 
-	if (!ffmpeg_mux_get_extra_data(ffm))
+	if (!ffmpeg_mux_get_extra_data(ffm, read, param))
 		return FFM_ERROR;
 
 	ffm->packet = av_packet_alloc();
@@ -1121,9 +1616,10 @@ static int ffmpeg_mux_init_internal(struct ffmpeg_mux *ffm, int argc,
 	return ffmpeg_mux_init_context(ffm);
 }
 
-static int ffmpeg_mux_init(struct ffmpeg_mux *ffm, int argc, char *argv[])
+static int ffmpeg_mux_init(struct ffmpeg_mux *ffm, int argc, char *argv[],
+			   ffm_read_t read, void *param)
 {
-	int ret = ffmpeg_mux_init_internal(ffm, argc, argv);
+	int ret = ffmpeg_mux_init_internal(ffm, argc, argv, read, param);
 	if (ret != FFM_SUCCESS) {
 		ffmpeg_mux_free(ffm);
 		return ret;
@@ -1181,6 +1677,21 @@ static inline int64_t rescale_ts(struct ffmpeg_mux *ffm,
 				AV_ROUND_NEAR_INF | AV_ROUND_PASS_MINMAX);
 }
 
+/* Fragmented muxers keep the samples of the current fragment in memory, so
+ * anything written out means a fragment has just been completed. */
+static void ffmpeg_mux_flush_fragment(struct ffmpeg_mux *ffm)
+{
+	if (!ffm->io.active || ffm->io.pushed_writes == ffm->io.flushed_writes)
+		return;
+
+	ffm->io.flushed_writes = ffm->io.pushed_writes;
+	os_atomic_set_bool(&ffm->io.flush_requested, true);
+
+	pthread_mutex_lock(&ffm->io.data_mutex);
+	os_event_signal(ffm->io.new_data_available_event);
+	pthread_mutex_unlock(&ffm->io.data_mutex);
+}
+
 static inline bool ffmpeg_mux_packet(struct ffmpeg_mux *ffm, uint8_t *buf,
 				     struct ffm_packet_info *info)
 {
@@ -1205,27 +1716,29 @@ static inline bool ffmpeg_mux_packet(struct ffmpeg_mux *ffm, uint8_t *buf,
 
 	int ret = av_interleaved_write_frame(ffm->output, ffm->packet);
 
+	if (ffm->fragmented)
+		ffmpeg_mux_flush_fragment(ffm);
+
 	/* Treat "Invalid data found when processing input" and "Invalid argument" as non-fatal */
 	if (ret == AVERROR_INVALIDDATA || ret == -EINVAL) {
 		return true;
 	}
 
 	if (ret < 0) {
-		fprintf(stderr, "av_interleaved_write_frame failed: %d: %s\n",
-			ret, av_err2str(ret));
+		ffm_error("av_interleaved_write_frame failed: %d: %s\n", ret,
+			  av_err2str(ret));
 	}
 
 	return ret >= 0;
 }
 
-static inline bool read_change_file(struct ffmpeg_mux *ffm, uint32_t size,
-				    struct resize_buf *filename, int argc,
-				    char **argv)
+static inline bool change_file(struct ffmpeg_mux *ffm, const uint8_t *data,
+			       uint32_t size, struct resize_buf *filename,
+			       int argc, char **argv, ffm_read_t read,
+			       void *param)
 {
 	resize_buf_resize(filename, size + 1);
-	if (safe_read(filename->buf, size) != size) {
-		return false;
-	}
+	memcpy(filename->buf, data, size);
 	filename->buf[size] = 0;
 
 #ifdef ENABLE_FFMPEG_MUX_DEBUG
@@ -1238,9 +1751,9 @@ static inline bool read_change_file(struct ffmpeg_mux *ffm, uint32_t size,
 
 	ffmpeg_mux_free(ffm);
 
-	ret = ffmpeg_mux_init(ffm, argc, argv);
+	ret = ffmpeg_mux_init(ffm, argc, argv, read, param);
 	if (ret != FFM_SUCCESS) {
-		fprintf(stderr, "Couldn't initialize muxer\n");
+		ffm_error("Couldn't initialize muxer\n");
 		return false;
 	}
 
@@ -1249,19 +1762,94 @@ static inline bool read_change_file(struct ffmpeg_mux *ffm, uint32_t size,
 	return true;
 }
 
+int ffmpeg_mux_run(int argc, char *argv[], ffm_read_t read, void *param,
+		   struct dstr *last_error)
+{
+	struct ffm_packet_info info = {0};
+	struct ffmpeg_mux ffm = {0};
+	struct resize_buf rb_filename = {0};
+	uint8_t *data;
+	bool fail = false;
+	int ret;
+
+#ifdef FFMPEG_MUX_EMBEDDED
+	thread_last_error = last_error;
+#else
+	UNUSED_PARAMETER(last_error);
+#endif
+
+	ret = ffmpeg_mux_init(&ffm, argc, argv, read, param);
+	if (ret != FFM_SUCCESS) {
+		ffm_error("Couldn't initialize muxer\n");
+		goto finish;
+	}
+
+	while (!fail && read(param, &info, &data)) {
+		if (info.type == FFM_PACKET_CHANGE_FILE) {
+			fail = !change_file(&ffm, data, info.size, &rb_filename,
+					    argc, argv, read, param);
+			continue;
+		}
+
+		fail = !ffmpeg_mux_packet(&ffm, data, &info);
+	}
+
+	if (fail)
+		ret = FFM_ERROR;
+
+	ffmpeg_mux_free(&ffm);
+	resize_buf_free(&rb_filename);
+
+finish:
+#ifdef FFMPEG_MUX_EMBEDDED
+	thread_last_error = NULL;
+#endif
+	return ret;
+}
+
 /* ------------------------------------------------------------------------- */
 
+#ifndef FFMPEG_MUX_EMBEDDED
+static size_t safe_read(void *vdata, size_t size)
+{
+	uint8_t *data = vdata;
+	size_t total = size;
+
+	while (size > 0) {
+		size_t in_size = fread(data, 1, size, stdin);
+		if (in_size == 0)
+			return 0;
+
+		size -= in_size;
+		data += in_size;
+	}
+
+	return total;
+}
+
+static bool read_stdin(void *param, struct ffm_packet_info *info,
+		       uint8_t **data)
+{
+	struct resize_buf *rb = param;
+
+	if (safe_read(info, sizeof(*info)) != sizeof(*info))
+		return false;
+
+	resize_buf_resize(rb, info->size);
+	if (safe_read(rb->buf, info->size) != info->size)
+		return false;
+
+	*data = rb->buf;
+	return true;
+}
+
 #ifdef _WIN32
 int wmain(int argc, wchar_t *argv_w[])
 #else
 int main(int argc, char *argv[])
 #endif
 {
-	struct ffm_packet_info info = {0};
-	struct ffmpeg_mux ffm = {0};
 	struct resize_buf rb = {0};
-	struct resize_buf rb_filename = {0};
-	bool fail = false;
 	int ret;
 
 #ifdef _WIN32
@@ -1286,36 +1874,15 @@ int main(int argc, char *argv[])
 #endif
 	setvbuf(stderr, NULL, _IONBF, 0);
 
-	ret = ffmpeg_mux_init(&ffm, argc, argv);
-	if (ret != FFM_SUCCESS) {
-		fprintf(stderr, "Couldn't initialize muxer\n");
-		return ret;
-	}
-
-	while (!fail && safe_read(&info, sizeof(info)) == sizeof(info)) {
-		if (info.type == FFM_PACKET_CHANGE_FILE) {
-			fail = !read_change_file(&ffm, info.size, &rb_filename,
-						 argc, argv);
-			continue;
-		}
-
-		resize_buf_resize(&rb, info.size);
+	ret = ffmpeg_mux_run(argc, argv, read_stdin, &rb, NULL);
 
-		if (safe_read(rb.buf, info.size) == info.size) {
-			fail = !ffmpeg_mux_packet(&ffm, rb.buf, &info);
-		} else {
-			fail = true;
-		}
-	}
-
-	ffmpeg_mux_free(&ffm);
 	resize_buf_free(&rb);
-	resize_buf_free(&rb_filename);
 
 #ifdef _WIN32
 	for (int i = 0; i < argc; i++)
 		free(argv[i]);
 	free(argv);
 #endif
-	return 0;
+	return ret;
 }
+#endif
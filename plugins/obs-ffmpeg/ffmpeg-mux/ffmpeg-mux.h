@@ -37,3 +37,20 @@ struct ffm_packet_info {
 	enum ffm_packet_type type;
 	bool keyframe;
 };
+
+struct dstr;
+
+/*
+ * Returns the next packet.  The data must stay valid until the next call.
+ * Returns false once the input has ended.
+ */
+typedef bool (*ffm_read_t)(void *param, struct ffm_packet_info *info,
+			   uint8_t **data);
+
+/*
+ * Runs the muxer on the calling thread until the input has ended.  Error
+ * messages are appended to last_error if the muxer is built with
+ * FFMPEG_MUX_EMBEDDED, otherwise they are written to stderr.
+ */
+int ffmpeg_mux_run(int argc, char *argv[], ffm_read_t read, void *param,
+		   struct dstr *last_error);
@@ -37,7 +37,7 @@ void ffmpeg_hls_mux_destroy(void *data)
 		da_free(stream->mux_packets);
 		deque_free(&stream->packets);
 
-		os_process_pipe_destroy(stream->pipe);
+		stop_pipe(stream);
 		dstr_free(&stream->path);
 		dstr_free(&stream->printable_path);
 		dstr_free(&stream->stream_key);
@@ -151,7 +151,7 @@ bool ffmpeg_hls_mux_start(void *data)
 	start_pipe(stream, path.array);
 	dstr_free(&path);
 
-	if (!stream->pipe) {
+	if (!pipe_started(stream)) {
 		obs_output_set_last_error(
 			stream->output, obs_module_text("HelperProcessFailed"));
 		warn("Failed to create process pipe");
@@ -0,0 +1,242 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#include "ffmpeg-mux/ffmpeg-mux.h"
+#include "obs-ffmpeg-mux.h"
+
+/* Runs ffmpeg-mux on its own thread inside of the process instead of
+ * spawning obs-ffmpeg-mux and writing every packet through a pipe.  Encoded
+ * packets are only referenced, never copied. */
+
+/* the writer blocks once this much data is waiting to be muxed, which is
+ * about what the pipe buffers of the helper process would hold as well */
+#define MAX_QUEUED_BYTES (64 * 1024 * 1024)
+
+struct mux_item {
+	struct ffm_packet_info info;
+	struct encoder_packet packet;
+	uint8_t *data;
+};
+
+struct ffmpeg_mux_engine {
+	os_process_args_t *args;
+	char **argv;
+	int argc;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	os_sem_t *items_sem;
+	os_event_t *space_event;
+
+	struct deque items;
+	size_t queued_bytes;
+	bool stop;
+	bool finished;
+	int result;
+
+	/* only accessed by the engine thread */
+	struct mux_item cur;
+
+	/* written by the engine thread until it has finished */
+	struct dstr last_error;
+};
+
+static inline void mux_item_free(struct mux_item *item)
+{
+	if (item->packet.data)
+		obs_encoder_packet_release(&item->packet);
+	bfree(item->data);
+	memset(item, 0, sizeof(*item));
+}
+
+static bool engine_read(void *param, struct ffm_packet_info *info,
+			uint8_t **data)
+{
+	struct ffmpeg_mux_engine *engine = param;
+	bool found = false;
+
+	mux_item_free(&engine->cur);
+
+	for (;;) {
+		pthread_mutex_lock(&engine->mutex);
+		if (engine->items.size) {
+			deque_pop_front(&engine->items, &engine->cur,
+					sizeof(engine->cur));
+			engine->queued_bytes -= engine->cur.info.size;
+			os_event_signal(engine->space_event);
+			found = true;
+		}
+		bool stop = engine->stop;
+		pthread_mutex_unlock(&engine->mutex);
+
+		if (found || stop)
+			break;
+
+		os_sem_wait(engine->items_sem);
+	}
+
+	if (!found)
+		return false;
+
+	*info = engine->cur.info;
+	*data = engine->cur.data ? engine->cur.data : engine->cur.packet.data;
+	return true;
+}
+
+static void *engine_thread(void *param)
+{
+	struct ffmpeg_mux_engine *engine = param;
+	int ret;
+
+	os_set_thread_name("ffmpeg-mux: engine");
+
+	ret = ffmpeg_mux_run(engine->argc, engine->argv, engine_read, engine,
+			     &engine->last_error);
+	mux_item_free(&engine->cur);
+
+	/* wake up a writer that might be waiting for space */
+	pthread_mutex_lock(&engine->mutex);
+	engine->result = ret;
+	engine->finished = true;
+	os_event_signal(engine->space_event);
+	pthread_mutex_unlock(&engine->mutex);
+
+	return NULL;
+}
+
+struct ffmpeg_mux_engine *ffmpeg_mux_engine_create(os_process_args_t *args)
+{
+	struct ffmpeg_mux_engine *engine = bzalloc(sizeof(*engine));
+	size_t argc = os_process_args_get_argc(args);
+
+	/* the muxer temporarily replaces arguments when changing files, so
+	 * it gets its own copy of the argument pointers */
+	engine->args = args;
+	engine->argc = (int)argc;
+	engine->argv = bmemdup(os_process_args_get_argv(args),
+			       (argc + 1) * sizeof(char *));
+
+	pthread_mutex_init_value(&engine->mutex);
+	if (pthread_mutex_init(&engine->mutex, NULL) != 0)
+		goto fail;
+	if (os_sem_init(&engine->items_sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&engine->space_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+	if (pthread_create(&engine->thread, NULL, engine_thread, engine) != 0)
+		goto fail;
+
+	return engine;
+
+fail:
+	os_event_destroy(engine->space_event);
+	os_sem_destroy(engine->items_sem);
+	pthread_mutex_destroy(&engine->mutex);
+	os_process_args_destroy(engine->args);
+	bfree(engine->argv);
+	bfree(engine);
+	return NULL;
+}
+
+int ffmpeg_mux_engine_destroy(struct ffmpeg_mux_engine *engine)
+{
+	struct mux_item item;
+	int ret;
+
+	if (!engine)
+		return 0;
+
+	pthread_mutex_lock(&engine->mutex);
+	engine->stop = true;
+	pthread_mutex_unlock(&engine->mutex);
+
+	os_sem_post(engine->items_sem);
+	pthread_join(engine->thread, NULL);
+
+	/* only left over if the muxer failed */
+	while (engine->items.size) {
+		deque_pop_front(&engine->items, &item, sizeof(item));
+		mux_item_free(&item);
+	}
+
+	ret = engine->result;
+
+	deque_free(&engine->items);
+	dstr_free(&engine->last_error);
+	os_event_destroy(engine->space_event);
+	os_sem_destroy(engine->items_sem);
+	pthread_mutex_destroy(&engine->mutex);
+	os_process_args_destroy(engine->args);
+	bfree(engine->argv);
+	bfree(engine);
+	return ret;
+}
+
+bool ffmpeg_mux_engine_write(struct ffmpeg_mux_engine *engine,
+			     const struct ffm_packet_info *info,
+			     const uint8_t *data,
+			     struct encoder_packet *packet)
+{
+	struct mux_item item = {.info = *info};
+
+	if (packet)
+		obs_encoder_packet_ref(&item.packet, packet);
+	else if (info->size)
+		item.data = bmemdup(data, info->size);
+
+	pthread_mutex_lock(&engine->mutex);
+	while (!engine->finished && engine->queued_bytes &&
+	       engine->queued_bytes + info->size > MAX_QUEUED_BYTES) {
+		os_event_reset(engine->space_event);
+		pthread_mutex_unlock(&engine->mutex);
+		os_event_wait(engine->space_event);
+		pthread_mutex_lock(&engine->mutex);
+	}
+
+	if (engine->finished) {
+		pthread_mutex_unlock(&engine->mutex);
+		mux_item_free(&item);
+		return false;
+	}
+
+	deque_push_back(&engine->items, &item, sizeof(item));
+	engine->queued_bytes += info->size;
+	pthread_mutex_unlock(&engine->mutex);
+
+	os_sem_post(engine->items_sem);
+	return true;
+}
+
+size_t ffmpeg_mux_engine_read_err(struct ffmpeg_mux_engine *engine, char *buf,
+				  size_t size)
+{
+	size_t len = 0;
+
+	if (!size)
+		return 0;
+
+	pthread_mutex_lock(&engine->mutex);
+	if (engine->finished && engine->last_error.len) {
+		len = engine->last_error.len;
+		if (len > size - 1)
+			len = size - 1;
+		memcpy(buf, engine->last_error.array, len);
+	}
+	pthread_mutex_unlock(&engine->mutex);
+
+	buf[len] = 0;
+	return len;
+}
@@ -22,6 +22,8 @@
 #include "util/windows/win-version.h"
 #endif
 
+#include <util/util_uint64.h>
+#include <inttypes.h>
 #include <libavformat/avformat.h>
 
 #define do_log(level, format, ...)                  \
@@ -47,6 +49,17 @@ static const char *ffmpeg_mpegts_mux_getname(void *type)
 
 static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 {
+	if (stream->ring) {
+		/* a save in progress still reads from the ring */
+		if (stream->mux_thread_joinable) {
+			pthread_join(stream->mux_thread, NULL);
+			stream->mux_thread_joinable = false;
+		}
+
+		replay_ring_destroy(stream->ring);
+		stream->ring = NULL;
+	}
+
 	while (stream->packets.size > 0) {
 		struct encoder_packet pkt;
 		deque_pop_front(&stream->packets, &pkt, sizeof(pkt));
@@ -74,7 +87,7 @@ static void ffmpeg_mux_destroy(void *data)
 	da_free(stream->mux_packets);
 	deque_free(&stream->packets);
 
-	os_process_pipe_destroy(stream->pipe);
+	stop_pipe(stream);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
 	dstr_free(&stream->stream_key);
@@ -268,23 +281,42 @@ static void add_stream_key(os_process_args_t *args, struct ffmpeg_muxer *stream)
 static void add_muxer_params(os_process_args_t *args,
 			     struct ffmpeg_muxer *stream)
 {
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	int64_t frag_duration = obs_data_get_int(settings, "fragment_duration");
 	struct dstr mux = {0};
 
 	if (dstr_is_empty(&stream->muxer_settings)) {
-		obs_data_t *settings = obs_output_get_settings(stream->output);
 		dstr_copy(&mux,
 			  obs_data_get_string(settings, "muxer_settings"));
-		obs_data_release(settings);
 	} else {
 		dstr_copy(&mux, stream->muxer_settings.array);
 	}
 
+	obs_data_release(settings);
+
+	/* fragments still start at keyframes, but span at least this many
+	 * milliseconds */
+	if (frag_duration > 0 && mux.array &&
+	    strstr(mux.array, "frag_keyframe") &&
+	    !strstr(mux.array, "min_frag_duration"))
+		dstr_catf(&mux, " min_frag_duration=%" PRId64,
+			  frag_duration * 1000);
+
 	log_muxer_params(stream, mux.array);
 	os_process_args_add_arg(args, mux.array ? mux.array : "");
 
 	dstr_free(&mux);
 }
 
+static void add_write_mode(os_process_args_t *args,
+			   struct ffmpeg_muxer *stream)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	os_process_args_add_arg(args,
+				obs_data_get_string(settings, "write_mode"));
+	obs_data_release(settings);
+}
+
 static void build_command_line(struct ffmpeg_muxer *stream,
 			       os_process_args_t **args, const char *path)
 {
@@ -325,16 +357,74 @@ static void build_command_line(struct ffmpeg_muxer *stream,
 
 	add_stream_key(*args, stream);
 	add_muxer_params(*args, stream);
+	add_write_mode(*args, stream);
 }
 
 void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	os_process_args_t *args = NULL;
 	build_command_line(stream, &args, path);
+
+	if (stream->in_process) {
+		/* the engine takes ownership of the arguments */
+		stream->engine = ffmpeg_mux_engine_create(args);
+		return;
+	}
+
 	stream->pipe = os_process_pipe_create2(args, "w");
 	os_process_args_destroy(args);
 }
 
+bool pipe_started(struct ffmpeg_muxer *stream)
+{
+	return stream->pipe || stream->engine;
+}
+
+int stop_pipe(struct ffmpeg_muxer *stream)
+{
+	int ret = 0;
+
+	if (stream->engine)
+		ret = ffmpeg_mux_engine_destroy(stream->engine);
+	else if (stream->pipe)
+		ret = os_process_pipe_destroy(stream->pipe);
+
+	stream->engine = NULL;
+	stream->pipe = NULL;
+	return ret;
+}
+
+static bool pipe_write(struct ffmpeg_muxer *stream,
+		       const struct ffm_packet_info *info, const uint8_t *data,
+		       struct encoder_packet *packet)
+{
+	size_t ret;
+
+	if (stream->engine) {
+		if (!ffmpeg_mux_engine_write(stream->engine, info, data,
+					     packet)) {
+			warn("ffmpeg-mux engine is no longer running");
+			return false;
+		}
+		return true;
+	}
+
+	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)info,
+				    sizeof(*info));
+	if (ret != sizeof(*info)) {
+		warn("os_process_pipe_write for info structure failed");
+		return false;
+	}
+
+	ret = os_process_pipe_write(stream->pipe, data, info->size);
+	if (ret != info->size) {
+		warn("os_process_pipe_write for packet data failed");
+		return false;
+	}
+
+	return true;
+}
+
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream,
 					obs_data_t *settings, const char *path)
 {
@@ -410,6 +500,7 @@ static inline bool ffmpeg_mux_start_internal(struct ffmpeg_muxer *stream,
 {
 	const char *path = obs_data_get_string(settings, "path");
 
+	stream->in_process = obs_data_get_bool(settings, "in_process");
 	update_encoder_settings(stream, path);
 
 	if (!obs_output_can_begin_data_capture(stream->output, 0))
@@ -458,7 +549,7 @@ static inline bool ffmpeg_mux_start_internal(struct ffmpeg_muxer *stream,
 
 	start_pipe(stream, path);
 
-	if (!stream->pipe) {
+	if (!pipe_started(stream)) {
 		obs_output_set_last_error(
 			stream->output, obs_module_text("HelperProcessFailed"));
 		warn("Failed to create process pipe");
@@ -501,8 +592,7 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -555,8 +645,12 @@ static void signal_failure(struct ffmpeg_muxer *stream)
 
 	size_t len;
 
-	len = os_process_pipe_read_err(stream->pipe, (uint8_t *)error,
-				       sizeof(error) - 1);
+	if (stream->engine)
+		len = ffmpeg_mux_engine_read_err(stream->engine, error,
+						 sizeof(error));
+	else
+		len = os_process_pipe_read_err(stream->pipe, (uint8_t *)error,
+					       sizeof(error) - 1);
 
 	if (len > 0) {
 		error[len] = 0;
@@ -640,10 +734,11 @@ static void generate_filename(struct ffmpeg_muxer *stream, struct dstr *dst,
 	obs_data_release(settings);
 }
 
-bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
+static bool write_packet_internal(struct ffmpeg_muxer *stream,
+				  struct encoder_packet *packet,
+				  bool refcounted)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
-	size_t ret;
 
 	struct ffm_packet_info info = {.pts = packet->pts,
 				       .dts = packet->dts,
@@ -663,17 +758,8 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		}
 	}
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info,
-				    sizeof(info));
-	if (ret != sizeof(info)) {
-		warn("os_process_pipe_write for info structure failed");
-		signal_failure(stream);
-		return false;
-	}
-
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
-	if (ret != packet->size) {
-		warn("os_process_pipe_write for packet data failed");
+	if (!pipe_write(stream, &info, packet->data,
+			refcounted ? packet : NULL)) {
 		signal_failure(stream);
 		return false;
 	}
@@ -686,6 +772,11 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 	return true;
 }
 
+bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
+{
+	return write_packet_internal(stream, packet, true);
+}
+
 static bool send_audio_headers(struct ffmpeg_muxer *stream,
 			       obs_encoder_t *aencoder, size_t idx)
 {
@@ -695,7 +786,7 @@ static bool send_audio_headers(struct ffmpeg_muxer *stream,
 
 	if (!obs_encoder_get_extra_data(aencoder, &packet.data, &packet.size))
 		return false;
-	return write_packet(stream, &packet);
+	return write_packet_internal(stream, &packet, false);
 }
 
 static bool send_video_headers(struct ffmpeg_muxer *stream)
@@ -707,7 +798,7 @@ static bool send_video_headers(struct ffmpeg_muxer *stream)
 
 	if (!obs_encoder_get_extra_data(vencoder, &packet.data, &packet.size))
 		return false;
-	return write_packet(stream, &packet);
+	return write_packet_internal(stream, &packet, false);
 }
 
 bool send_headers(struct ffmpeg_muxer *stream)
@@ -760,23 +851,11 @@ static inline bool should_split(struct ffmpeg_muxer *stream,
 
 static bool send_new_filename(struct ffmpeg_muxer *stream, const char *filename)
 {
-	size_t ret;
 	uint32_t size = (uint32_t)strlen(filename);
 	struct ffm_packet_info info = {.type = FFM_PACKET_CHANGE_FILE,
 				       .size = size};
 
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info,
-				    sizeof(info));
-	if (ret != sizeof(info)) {
-		warn("os_process_pipe_write for info structure failed");
-		signal_failure(stream);
-		return false;
-	}
-
-	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)filename,
-				    size);
-	if (ret != size) {
-		warn("os_process_pipe_write for packet data failed");
+	if (!pipe_write(stream, &info, (const uint8_t *)filename, NULL)) {
 		signal_failure(stream);
 		return false;
 	}
@@ -1003,8 +1082,11 @@ static void save_replay_proc(void *data, calldata_t *cd)
 static void get_last_replay(void *data, calldata_t *cd)
 {
 	struct ffmpeg_muxer *stream = data;
-	if (!os_atomic_load_bool(&stream->muxing))
-		calldata_set_string(cd, "path", stream->path.array);
+
+	pthread_mutex_lock(&stream->save_mutex);
+	if (!dstr_is_empty(&stream->last_replay))
+		calldata_set_string(cd, "path", stream->last_replay.array);
+	pthread_mutex_unlock(&stream->save_mutex);
 }
 
 static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
@@ -1013,6 +1095,11 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 	struct ffmpeg_muxer *stream = bzalloc(sizeof(*stream));
 	stream->output = output;
 
+	if (pthread_mutex_init(&stream->save_mutex, NULL) != 0) {
+		bfree(stream);
+		return NULL;
+	}
+
 	stream->hotkey =
 		obs_hotkey_register_output(output, "ReplayBuffer.Save",
 					   obs_module_text("ReplayBuffer.Save"),
@@ -1025,6 +1112,7 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 
 	signal_handler_t *sh = obs_output_get_signal_handler(output);
 	signal_handler_add(sh, "void saved()");
+	signal_handler_add(sh, "void save_progress(string path, int progress)");
 
 	return stream;
 }
@@ -1034,9 +1122,38 @@ static void replay_buffer_destroy(void *data)
 	struct ffmpeg_muxer *stream = data;
 	if (stream->hotkey)
 		obs_hotkey_unregister(stream->hotkey);
+
+	/* finishes all queued saves */
+	if (stream->mux_thread_joinable) {
+		pthread_join(stream->mux_thread, NULL);
+		stream->mux_thread_joinable = false;
+	}
+
+	deque_free(&stream->saves);
+	dstr_free(&stream->last_replay);
+	pthread_mutex_destroy(&stream->save_mutex);
 	ffmpeg_mux_destroy(data);
 }
 
+static void replay_buffer_create_ring(struct ffmpeg_muxer *stream,
+				      obs_data_t *settings)
+{
+	const char *dir = obs_data_get_string(settings, "disk_buffer_dir");
+	char *default_dir = NULL;
+
+	if (!dir || !*dir) {
+		default_dir = obs_module_config_path("replay-buffer");
+		dir = default_dir;
+	}
+
+	stream->ring = replay_ring_create(dir, (size_t)stream->max_size);
+	if (!stream->ring)
+		warn("Failed to create disk buffer, keeping the replay "
+		     "buffer in memory instead");
+
+	bfree(default_dir);
+}
+
 static bool replay_buffer_start(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
@@ -1047,8 +1164,16 @@ static bool replay_buffer_start(void *data)
 		return false;
 
 	obs_data_t *s = obs_output_get_settings(stream->output);
+	stream->in_process = obs_data_get_bool(s, "in_process");
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+	stream->max_save_rate =
+		(uint64_t)obs_data_get_int(s, "max_save_rate_mb") *
+		(1024 * 1024);
+
+	if (obs_data_get_bool(s, "disk_buffer") && stream->max_size > 0)
+		replay_buffer_create_ring(stream, s);
+
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -1124,6 +1249,43 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream,
 		purge(stream);
 }
 
+static inline void offset_packet(struct encoder_packet *pkt,
+				 int64_t video_offset, int64_t *audio_offsets,
+				 int64_t video_pts_offset,
+				 int64_t *audio_dts_offsets)
+{
+	if (pkt->type == OBS_ENCODER_VIDEO) {
+		pkt->dts_usec -= video_offset;
+		pkt->dts -= video_pts_offset;
+		pkt->pts -= video_pts_offset;
+	} else {
+		pkt->dts_usec -= audio_offsets[pkt->track_idx];
+		pkt->dts -= audio_dts_offsets[pkt->track_idx];
+		pkt->pts -= audio_dts_offsets[pkt->track_idx];
+	}
+}
+
+static void insert_ring_packet(replay_ring_packets_t *packets,
+			       struct replay_ring_packet *packet,
+			       int64_t video_offset, int64_t *audio_offsets,
+			       int64_t video_pts_offset,
+			       int64_t *audio_dts_offsets)
+{
+	struct replay_ring_packet pkt = *packet;
+	size_t idx;
+
+	offset_packet(&pkt.packet, video_offset, audio_offsets,
+		      video_pts_offset, audio_dts_offsets);
+
+	for (idx = packets->num; idx > 0; idx--) {
+		struct replay_ring_packet *p = packets->array + (idx - 1);
+		if (p->packet.dts_usec < pkt.packet.dts_usec)
+			break;
+	}
+
+	da_insert(*packets, idx, &pkt);
+}
+
 static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet,
 			  int64_t video_offset, int64_t *audio_offsets,
 			  int64_t video_pts_offset, int64_t *audio_dts_offsets)
@@ -1132,16 +1294,8 @@ static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet,
 	size_t idx;
 
 	obs_encoder_packet_ref(&pkt, packet);
-
-	if (pkt.type == OBS_ENCODER_VIDEO) {
-		pkt.dts_usec -= video_offset;
-		pkt.dts -= video_pts_offset;
-		pkt.pts -= video_pts_offset;
-	} else {
-		pkt.dts_usec -= audio_offsets[pkt.track_idx];
-		pkt.dts -= audio_dts_offsets[pkt.track_idx];
-		pkt.pts -= audio_dts_offsets[pkt.track_idx];
-	}
+	offset_packet(&pkt, video_offset, audio_offsets, video_pts_offset,
+		      audio_dts_offsets);
 
 	for (idx = packets->num; idx > 0; idx--) {
 		struct encoder_packet *p = packets->array + (idx - 1);
@@ -1152,66 +1306,195 @@ static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet,
 	da_insert(*packets, idx, &pkt);
 }
 
-static void *replay_buffer_mux_thread(void *data)
+struct replay_save {
+	struct dstr path;
+	mux_packets_t packets;
+	replay_ring_packets_t ring_packets;
+
+	uint64_t total_bytes;
+	uint64_t written_bytes;
+	uint64_t start_ns;
+	int progress;
+};
+
+static void replay_save_free(struct replay_save *save)
 {
-	struct ffmpeg_muxer *stream = data;
-	bool error = false;
+	for (size_t i = 0; i < save->packets.num; i++)
+		obs_encoder_packet_release(&save->packets.array[i]);
+	da_free(save->packets);
+	da_free(save->ring_packets);
+	dstr_free(&save->path);
+}
+
+static void replay_save_written(struct ffmpeg_muxer *stream,
+				struct replay_save *save, size_t size)
+{
+	int progress;
+
+	save->written_bytes += size;
+	progress = save->total_bytes ? (int)util_mul_div64(save->written_bytes,
+							    100,
+							    save->total_bytes)
+				     : 100;
+
+	if (progress != save->progress) {
+		signal_handler_t *sh =
+			obs_output_get_signal_handler(stream->output);
+		calldata_t cd = {0};
+
+		save->progress = progress;
+		calldata_set_string(&cd, "path", save->path.array);
+		calldata_set_int(&cd, "progress", progress);
+		signal_handler_signal(sh, "save_progress", &cd);
+		calldata_free(&cd);
+	}
+
+	/* keep saves from starving other disk I/O, such as recordings */
+	if (stream->max_save_rate)
+		os_sleepto_ns(save->start_ns +
+			      util_mul_div64(save->written_bytes, 1000000000ULL,
+					     stream->max_save_rate));
+}
+
+static bool write_ring_packets(struct ffmpeg_muxer *stream,
+			       struct replay_save *save)
+{
+	uint8_t *buf = NULL;
+	size_t capacity = 0;
+	bool success = true;
+
+	for (size_t i = 0; i < save->ring_packets.num; i++) {
+		struct replay_ring_packet *rp = &save->ring_packets.array[i];
+		struct encoder_packet pkt = rp->packet;
+
+		if (pkt.size > capacity) {
+			capacity = pkt.size;
+			buf = brealloc(buf, capacity);
+		}
+
+		if (!replay_ring_read(stream->ring, rp->seq, buf, pkt.size)) {
+			warn("Replay buffer data was overwritten while saving, "
+			     "the disk buffer is too small");
+			success = false;
+			break;
+		}
+
+		pkt.data = buf;
+		if (!write_packet_internal(stream, &pkt, false)) {
+			success = false;
+			break;
+		}
+
+		replay_save_written(stream, save, pkt.size);
+	}
+
+	bfree(buf);
+	return success;
+}
+
+static bool write_packets(struct ffmpeg_muxer *stream, struct replay_save *save)
+{
+	for (size_t i = 0; i < save->packets.num; i++) {
+		struct encoder_packet *pkt = &save->packets.array[i];
+		size_t size = pkt->size;
+
+		if (!write_packet(stream, pkt))
+			return false;
+
+		obs_encoder_packet_release(pkt);
+		replay_save_written(stream, save, size);
+	}
+
+	return true;
+}
+
+static bool write_replay(struct ffmpeg_muxer *stream, struct replay_save *save)
+{
+	bool success = false;
 
-	start_pipe(stream, stream->path.array);
+	save->start_ns = os_gettime_ns();
+	start_pipe(stream, save->path.array);
 
-	if (!stream->pipe) {
+	if (!pipe_started(stream)) {
 		warn("Failed to create process pipe");
-		error = true;
-		goto error;
+		return false;
 	}
 
 	if (!send_headers(stream)) {
 		warn("Could not write headers for file '%s'",
-		     stream->path.array);
-		error = true;
-		goto error;
+		     save->path.array);
+		goto finish;
 	}
 
-	for (size_t i = 0; i < stream->mux_packets.num; i++) {
-		struct encoder_packet *pkt = &stream->mux_packets.array[i];
-		if (!write_packet(stream, pkt)) {
-			warn("Could not write packet for file '%s'",
-			     stream->path.array);
-			error = true;
-			goto error;
-		}
-		obs_encoder_packet_release(pkt);
+	if (!(stream->ring ? write_ring_packets(stream, save)
+			   : write_packets(stream, save))) {
+		warn("Could not write packet for file '%s'", save->path.array);
+		goto finish;
 	}
 
-	info("Wrote replay buffer to '%s'", stream->path.array);
+	info("Wrote replay buffer to '%s'", save->path.array);
+	success = true;
 
-error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
-	if (error) {
-		for (size_t i = 0; i < stream->mux_packets.num; i++)
-			obs_encoder_packet_release(
-				&stream->mux_packets.array[i]);
-	}
-	da_free(stream->mux_packets);
-	os_atomic_set_bool(&stream->muxing, false);
+finish:
+	stop_pipe(stream);
+	return success;
+}
 
-	if (!error) {
-		calldata_t cd = {0};
-		signal_handler_t *sh =
-			obs_output_get_signal_handler(stream->output);
-		signal_handler_signal(sh, "saved", &cd);
+static void *replay_buffer_mux_thread(void *data)
+{
+	struct ffmpeg_muxer *stream = data;
+	struct replay_save save;
+
+	os_set_thread_name("replay buffer save");
+
+	for (;;) {
+		pthread_mutex_lock(&stream->save_mutex);
+		if (!stream->saves.size) {
+			os_atomic_set_bool(&stream->muxing, false);
+			pthread_mutex_unlock(&stream->save_mutex);
+			break;
+		}
+		deque_pop_front(&stream->saves, &save, sizeof(save));
+		pthread_mutex_unlock(&stream->save_mutex);
+
+		bool success = write_replay(stream, &save);
+
+		if (success) {
+			pthread_mutex_lock(&stream->save_mutex);
+			dstr_copy_dstr(&stream->last_replay, &save.path);
+			pthread_mutex_unlock(&stream->save_mutex);
+		}
+
+		replay_save_free(&save);
+
+		if (success) {
+			calldata_t cd = {0};
+			signal_handler_t *sh =
+				obs_output_get_signal_handler(stream->output);
+			signal_handler_signal(sh, "saved", &cd);
+		}
 	}
 
 	return NULL;
 }
 
+/* takes a snapshot of the buffer by reference and queues it for the save
+ * thread, saves requested while another one is written are queued too */
 static void replay_buffer_save(struct ffmpeg_muxer *stream)
 {
 	const size_t size = sizeof(struct encoder_packet);
-	size_t num_packets = stream->packets.size / size;
-
-	da_reserve(stream->mux_packets, num_packets);
+	replay_ring_packets_t ring_packets = {0};
+	struct replay_save save = {0};
+	size_t num_packets;
+
+	if (stream->ring) {
+		replay_ring_get_packets(stream->ring, &ring_packets);
+		num_packets = ring_packets.num;
+		da_reserve(save.ring_packets, num_packets);
+	} else {
+		num_packets = stream->packets.size / size;
+		da_reserve(save.packets, num_packets);
+	}
 
 	/* ---------------------------- */
 	/* reorder packets */
@@ -1225,7 +1508,10 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 
 	for (size_t i = 0; i < num_packets; i++) {
 		struct encoder_packet *pkt;
-		pkt = deque_data(&stream->packets, i * size);
+		if (stream->ring)
+			pkt = &ring_packets.array[i].packet;
+		else
+			pkt = deque_data(&stream->packets, i * size);
 
 		if (pkt->type == OBS_ENCODER_VIDEO) {
 			if (!found_video) {
@@ -1242,21 +1528,45 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 			}
 		}
 
-		insert_packet(&stream->mux_packets, pkt, video_offset,
-			      audio_offsets, video_pts_offset,
-			      audio_dts_offsets);
+		save.total_bytes += pkt->size;
+
+		if (stream->ring)
+			insert_ring_packet(&save.ring_packets,
+					   &ring_packets.array[i], video_offset,
+					   audio_offsets, video_pts_offset,
+					   audio_dts_offsets);
+		else
+			insert_packet(&save.packets, pkt, video_offset,
+				      audio_offsets, video_pts_offset,
+				      audio_dts_offsets);
 	}
 
-	generate_filename(stream, &stream->path, true);
+	da_free(ring_packets);
+
+	generate_filename(stream, &save.path, true);
+	save.progress = -1;
+
+	pthread_mutex_lock(&stream->save_mutex);
+	deque_push_back(&stream->saves, &save, sizeof(save));
 
-	os_atomic_set_bool(&stream->muxing, true);
-	stream->mux_thread_joinable = pthread_create(&stream->mux_thread, NULL,
-						     replay_buffer_mux_thread,
-						     stream) == 0;
-	if (!stream->mux_thread_joinable) {
-		warn("Failed to create muxer thread");
-		os_atomic_set_bool(&stream->muxing, false);
+	if (!os_atomic_load_bool(&stream->muxing)) {
+		/* the previous save thread has run out of saves */
+		if (stream->mux_thread_joinable)
+			pthread_join(stream->mux_thread, NULL);
+
+		os_atomic_set_bool(&stream->muxing, true);
+		stream->mux_thread_joinable =
+			pthread_create(&stream->mux_thread, NULL,
+				       replay_buffer_mux_thread, stream) == 0;
+		if (!stream->mux_thread_joinable) {
+			warn("Failed to create muxer thread");
+			os_atomic_set_bool(&stream->muxing, false);
+			deque_pop_back(&stream->saves, &save, sizeof(save));
+			replay_save_free(&save);
+		}
 	}
+
+	pthread_mutex_unlock(&stream->save_mutex);
 }
 
 static void deactivate_replay_buffer(struct ffmpeg_muxer *stream, int code)
@@ -1294,27 +1604,24 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	obs_encoder_packet_ref(&pkt, packet);
-	replay_buffer_purge(stream, &pkt);
+	if (stream->ring) {
+		replay_ring_push(stream->ring, packet);
+		replay_ring_purge(stream->ring, stream->max_time);
+	} else {
+		obs_encoder_packet_ref(&pkt, packet);
+		replay_buffer_purge(stream, &pkt);
 
-	if (!stream->packets.size)
-		stream->cur_time = pkt.dts_usec;
-	stream->cur_size += pkt.size;
+		if (!stream->packets.size)
+			stream->cur_time = pkt.dts_usec;
+		stream->cur_size += pkt.size;
 
-	deque_push_back(&stream->packets, packet, sizeof(*packet));
+		deque_push_back(&stream->packets, packet, sizeof(*packet));
 
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
-		stream->keyframes++;
+		if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
+			stream->keyframes++;
+	}
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
-		if (os_atomic_load_bool(&stream->muxing))
-			return;
-
-		if (stream->mux_thread_joinable) {
-			pthread_join(stream->mux_thread, NULL);
-			stream->mux_thread_joinable = false;
-		}
-
 		stream->save_ts = 0;
 		replay_buffer_save(stream);
 	}
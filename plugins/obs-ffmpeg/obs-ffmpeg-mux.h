@@ -9,11 +9,18 @@
 #include <util/platform.h>
 #include <util/threading.h>
 
+#include "obs-ffmpeg-replay-ring.h"
+
 typedef DARRAY(struct encoder_packet) mux_packets_t;
 
+struct ffm_packet_info;
+struct ffmpeg_mux_engine;
+
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
+	struct ffmpeg_mux_engine *engine;
+	bool in_process;
 	int64_t stop_ts;
 	uint64_t total_bytes;
 	bool sent_headers;
@@ -38,6 +45,15 @@ struct ffmpeg_muxer {
 	volatile bool muxing;
 	mux_packets_t mux_packets;
 
+	/* replay buffer kept in a memory-mapped file */
+	struct replay_ring *ring;
+
+	/* replay buffer saves, written one after another */
+	pthread_mutex_t save_mutex;
+	struct deque saves;
+	struct dstr last_replay;
+	uint64_t max_save_rate;
+
 	/* split file */
 	bool found_video;
 	bool found_audio[MAX_AUDIO_MIXES];
@@ -69,8 +85,20 @@ struct ffmpeg_muxer {
 bool stopping(struct ffmpeg_muxer *stream);
 bool active(struct ffmpeg_muxer *stream);
 void start_pipe(struct ffmpeg_muxer *stream, const char *path);
+bool pipe_started(struct ffmpeg_muxer *stream);
+int stop_pipe(struct ffmpeg_muxer *stream);
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
 bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
 void ffmpeg_mux_stop(void *data, uint64_t ts);
 uint64_t ffmpeg_mux_total_bytes(void *data);
+
+/* in-process muxing, see obs-ffmpeg-mux-engine.c */
+struct ffmpeg_mux_engine *ffmpeg_mux_engine_create(os_process_args_t *args);
+int ffmpeg_mux_engine_destroy(struct ffmpeg_mux_engine *engine);
+bool ffmpeg_mux_engine_write(struct ffmpeg_mux_engine *engine,
+			     const struct ffm_packet_info *info,
+			     const uint8_t *data,
+			     struct encoder_packet *packet);
+size_t ffmpeg_mux_engine_read_err(struct ffmpeg_mux_engine *engine, char *buf,
+				  size_t size);
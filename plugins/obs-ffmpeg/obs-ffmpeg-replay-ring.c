@@ -0,0 +1,381 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+#include "obs-ffmpeg-replay-ring.h"
+
+#include <util/deque.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include <inttypes.h>
+
+#define do_log(level, format, ...) \
+	blog(level, "[replay buffer ring] " format, ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+struct ring_entry {
+	struct encoder_packet packet;
+	size_t offset;
+};
+
+struct replay_ring {
+	uint8_t *data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+
+	/* the saving thread reads while the output thread writes */
+	pthread_mutex_t mutex;
+
+	struct deque entries;
+	struct deque keyframes;
+	uint64_t first_seq;
+
+	/* write position, and offset of the oldest packet's data */
+	size_t head;
+	size_t tail;
+};
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef _WIN32
+static bool map_ring(struct replay_ring *ring, const char *path)
+{
+	wchar_t *wpath = NULL;
+	uint64_t size = ring->size;
+
+	os_utf8_to_wcs_ptr(path, 0, &wpath);
+
+	/* the file only exists for as long as the ring does */
+	ring->file = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+				 CREATE_ALWAYS,
+				 FILE_ATTRIBUTE_TEMPORARY |
+					 FILE_FLAG_DELETE_ON_CLOSE,
+				 NULL);
+	bfree(wpath);
+
+	if (ring->file == INVALID_HANDLE_VALUE) {
+		ring->file = NULL;
+		return false;
+	}
+
+	ring->mapping = CreateFileMappingW(ring->file, NULL, PAGE_READWRITE,
+					   (DWORD)(size >> 32), (DWORD)size,
+					   NULL);
+	if (!ring->mapping)
+		return false;
+
+	ring->data = MapViewOfFile(ring->mapping, FILE_MAP_ALL_ACCESS, 0, 0,
+				   ring->size);
+	return !!ring->data;
+}
+
+static void unmap_ring(struct replay_ring *ring)
+{
+	if (ring->data)
+		UnmapViewOfFile(ring->data);
+	if (ring->mapping)
+		CloseHandle(ring->mapping);
+	if (ring->file)
+		CloseHandle(ring->file);
+}
+#else
+static bool map_ring(struct replay_ring *ring, const char *path)
+{
+	void *data;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd == -1)
+		return false;
+
+	/* the mapping keeps the data alive, the file itself is not needed */
+	unlink(path);
+
+#ifdef __linux__
+	/* reserve the disk space now instead of failing on a page fault */
+	if (posix_fallocate(fd, 0, (off_t)ring->size) != 0) {
+		close(fd);
+		return false;
+	}
+#else
+	if (ftruncate(fd, (off_t)ring->size) != 0) {
+		close(fd);
+		return false;
+	}
+#endif
+
+	data = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+		    0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	ring->data = data;
+	return true;
+}
+
+static void unmap_ring(struct replay_ring *ring)
+{
+	if (ring->data)
+		munmap(ring->data, ring->size);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+struct replay_ring *replay_ring_create(const char *dir, size_t size)
+{
+	struct replay_ring *ring = bzalloc(sizeof(*ring));
+	struct dstr path = {0};
+
+	ring->size = size;
+	pthread_mutex_init_value(&ring->mutex);
+	if (pthread_mutex_init(&ring->mutex, NULL) != 0)
+		goto fail;
+
+	os_mkdirs(dir);
+	dstr_printf(&path, "%s/replay-%" PRIu64 ".buf", dir, os_gettime_ns());
+
+	if (!map_ring(ring, path.array)) {
+		warn("Failed to map %zu bytes at '%s'", size, path.array);
+		goto fail;
+	}
+
+	info("Mapped %zu MiB at '%s'", size / (1024 * 1024), path.array);
+	dstr_free(&path);
+	return ring;
+
+fail:
+	dstr_free(&path);
+	replay_ring_destroy(ring);
+	return NULL;
+}
+
+void replay_ring_destroy(struct replay_ring *ring)
+{
+	if (!ring)
+		return;
+
+	unmap_ring(ring);
+	deque_free(&ring->entries);
+	deque_free(&ring->keyframes);
+	pthread_mutex_destroy(&ring->mutex);
+	bfree(ring);
+}
+
+static inline size_t num_entries(struct replay_ring *ring)
+{
+	return ring->entries.size / sizeof(struct ring_entry);
+}
+
+static inline struct ring_entry *get_entry(struct replay_ring *ring,
+					   size_t idx)
+{
+	return deque_data(&ring->entries, idx * sizeof(struct ring_entry));
+}
+
+static inline size_t num_keyframes(struct replay_ring *ring)
+{
+	return ring->keyframes.size / sizeof(uint64_t);
+}
+
+static inline uint64_t get_keyframe(struct replay_ring *ring, size_t idx)
+{
+	return *(uint64_t *)deque_data(&ring->keyframes,
+				       idx * sizeof(uint64_t));
+}
+
+static void clear_internal(struct replay_ring *ring)
+{
+	ring->first_seq += num_entries(ring);
+	deque_free(&ring->entries);
+	deque_free(&ring->keyframes);
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+/* drops the oldest packet, and if it was a keyframe, the rest of its group
+ * of pictures as well */
+static void drop_front(struct replay_ring *ring)
+{
+	size_t count = num_entries(ring);
+	size_t drop = 1;
+
+	if (num_keyframes(ring) && get_keyframe(ring, 0) == ring->first_seq) {
+		deque_pop_front(&ring->keyframes, NULL, sizeof(uint64_t));
+		drop = num_keyframes(ring)
+			       ? (size_t)(get_keyframe(ring, 0) -
+					  ring->first_seq)
+			       : count;
+	}
+
+	if (drop >= count) {
+		clear_internal(ring);
+		return;
+	}
+
+	deque_pop_front(&ring->entries, NULL, drop * sizeof(struct ring_entry));
+	ring->first_seq += drop;
+	ring->tail = get_entry(ring, 0)->offset;
+}
+
+static bool fits(struct replay_ring *ring, size_t pos, size_t size)
+{
+	if (!ring->entries.size)
+		return true;
+
+	/* not wrapped around, free space is behind head and before tail */
+	if (ring->tail < ring->head)
+		return pos == ring->head || pos + size <= ring->tail;
+
+	/* wrapped around, free space is between head and tail */
+	return pos == ring->head && pos + size <= ring->tail;
+}
+
+bool replay_ring_push(struct replay_ring *ring,
+		      const struct encoder_packet *packet)
+{
+	struct ring_entry entry = {.packet = *packet};
+	size_t pos;
+
+	if (packet->size > ring->size) {
+		warn("Packet of %zu bytes is larger than the ring",
+		     packet->size);
+		return false;
+	}
+
+	pthread_mutex_lock(&ring->mutex);
+
+	for (;;) {
+		if (!ring->entries.size)
+			ring->head = ring->tail = 0;
+
+		pos = ring->head + packet->size <= ring->size ? ring->head : 0;
+		if (fits(ring, pos, packet->size))
+			break;
+
+		drop_front(ring);
+	}
+
+	memcpy(ring->data + pos, packet->data, packet->size);
+
+	entry.packet.data = NULL;
+	entry.offset = pos;
+	if (!ring->entries.size)
+		ring->tail = pos;
+	ring->head = pos + packet->size;
+
+	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe) {
+		uint64_t seq = ring->first_seq + num_entries(ring);
+		deque_push_back(&ring->keyframes, &seq, sizeof(seq));
+	}
+
+	deque_push_back(&ring->entries, &entry, sizeof(entry));
+
+	pthread_mutex_unlock(&ring->mutex);
+	return true;
+}
+
+void replay_ring_purge(struct replay_ring *ring, int64_t max_time_usec)
+{
+	pthread_mutex_lock(&ring->mutex);
+
+	while (num_keyframes(ring) > 2) {
+		struct ring_entry *first = get_entry(ring, 0);
+		struct ring_entry *last =
+			get_entry(ring, num_entries(ring) - 1);
+
+		if (last->packet.dts_usec - first->packet.dts_usec <=
+		    max_time_usec)
+			break;
+
+		drop_front(ring);
+	}
+
+	pthread_mutex_unlock(&ring->mutex);
+}
+
+void replay_ring_clear(struct replay_ring *ring)
+{
+	pthread_mutex_lock(&ring->mutex);
+	clear_internal(ring);
+	pthread_mutex_unlock(&ring->mutex);
+}
+
+size_t replay_ring_num_packets(struct replay_ring *ring)
+{
+	pthread_mutex_lock(&ring->mutex);
+	size_t num = num_entries(ring);
+	pthread_mutex_unlock(&ring->mutex);
+	return num;
+}
+
+void replay_ring_get_packets(struct replay_ring *ring,
+			     replay_ring_packets_t *packets)
+{
+	pthread_mutex_lock(&ring->mutex);
+
+	size_t num = num_entries(ring);
+	da_reserve(*packets, packets->num + num);
+
+	for (size_t i = 0; i < num; i++) {
+		struct replay_ring_packet *pkt = da_push_back_new(*packets);
+		pkt->packet = get_entry(ring, i)->packet;
+		pkt->seq = ring->first_seq + i;
+	}
+
+	pthread_mutex_unlock(&ring->mutex);
+}
+
+bool replay_ring_read(struct replay_ring *ring, uint64_t seq, uint8_t *dst,
+		      size_t size)
+{
+	bool success = false;
+
+	pthread_mutex_lock(&ring->mutex);
+
+	if (seq >= ring->first_seq &&
+	    seq - ring->first_seq < (uint64_t)num_entries(ring)) {
+		struct ring_entry *entry =
+			get_entry(ring, (size_t)(seq - ring->first_seq));
+
+		if (entry->packet.size == size) {
+			memcpy(dst, ring->data + entry->offset, size);
+			success = true;
+		}
+	}
+
+	pthread_mutex_unlock(&ring->mutex);
+	return success;
+}
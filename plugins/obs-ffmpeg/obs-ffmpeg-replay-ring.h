@@ -0,0 +1,55 @@
+#pragma once
+
+#include <obs-module.h>
+#include <util/darray.h>
+
+/*
+ * Replay buffer ring backed by a pre-allocated memory-mapped file.
+ *
+ *   Packet data is copied into the ring, only the packet descriptions stay
+ * in RAM.  When the ring is full, the oldest group of pictures is dropped.
+ * Video keyframes are indexed, so whole groups of pictures can be dropped
+ * without scanning the packets.
+ *
+ *   Packets are addressed by a sequence number.  Data of a packet can be read
+ * from another thread as long as it has not been overwritten yet.
+ */
+
+struct replay_ring;
+
+struct replay_ring_packet {
+	/* data is not set, use replay_ring_read */
+	struct encoder_packet packet;
+	uint64_t seq;
+};
+
+typedef DARRAY(struct replay_ring_packet) replay_ring_packets_t;
+
+struct replay_ring *replay_ring_create(const char *dir, size_t size);
+void replay_ring_destroy(struct replay_ring *ring);
+
+/** Drops all packets */
+void replay_ring_clear(struct replay_ring *ring);
+
+/** Copies a packet into the ring, dropping old packets if needed */
+bool replay_ring_push(struct replay_ring *ring,
+		      const struct encoder_packet *packet);
+
+/**
+ * Drops the oldest groups of pictures until the buffered duration is within
+ * max_time_usec.  At least two keyframes are always kept.
+ */
+void replay_ring_purge(struct replay_ring *ring, int64_t max_time_usec);
+
+size_t replay_ring_num_packets(struct replay_ring *ring);
+
+/** Appends the descriptions of all buffered packets, oldest first */
+void replay_ring_get_packets(struct replay_ring *ring,
+			     replay_ring_packets_t *packets);
+
+/**
+ * Copies the data of a packet.  Returns false if the packet has been
+ * overwritten in the meantime.
+ */
+bool replay_ring_read(struct replay_ring *ring, uint64_t seq, uint8_t *dst,
+		      size_t size);
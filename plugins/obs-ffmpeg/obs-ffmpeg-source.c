@@ -279,6 +279,13 @@ static void get_frame(void *opaque, struct obs_source_frame *f)
 	obs_source_output_video(s->source, f);
 }
 
+static void get_frame_nocopy(void *opaque, struct obs_source_frame *f,
+			     obs_source_frame_release_t release, void *param)
+{
+	struct ffmpeg_source *s = opaque;
+	obs_source_output_video_nocopy(s->source, f, release, param);
+}
+
 static void preload_frame(void *opaque, struct obs_source_frame *f)
 {
 	struct ffmpeg_source *s = opaque;
@@ -329,6 +336,7 @@ static void ffmpeg_source_open(struct ffmpeg_source *s)
 		struct mp_media_info info = {
 			.opaque = s,
 			.v_cb = get_frame,
+			.v_nocopy_cb = get_frame_nocopy,
 			.v_preload_cb = preload_frame,
 			.v_seek_cb = seek_frame,
 			.a_cb = get_audio,
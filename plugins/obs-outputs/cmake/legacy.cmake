@@ -24,9 +24,13 @@ target_sources(
           net-if.h
           null-output.c
           rtmp-helpers.h
+          rtmp-abr.c
+          rtmp-abr.h
           rtmp-stream.c
           rtmp-stream.h
           rtmp-windows.c
+          rtmp-linux.c
+          rtmp-multi.c
           rtmp-av1.c
           rtmp-av1.h
           utils.h
@@ -293,15 +293,13 @@ void flv_meta_data(obs_output_t *context, uint8_t **output, size_t *size,
 static int32_t last_time = 0;
 #endif
 
-static void flv_video(struct serializer *s, int32_t dts_offset,
-		      struct encoder_packet *packet, bool is_header)
+/* writes the tag header and the video packet header, up to the payload */
+static void flv_video_header(struct serializer *s, int32_t dts_offset,
+			     struct encoder_packet *packet, bool is_header)
 {
 	int64_t offset = packet->pts - packet->dts;
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
 
-	if (!packet->data || !packet->size)
-		return;
-
 	s_w8(s, RTMP_PACKET_TYPE_VIDEO);
 
 #ifdef DEBUG_TIMESTAMPS
@@ -322,19 +320,26 @@ static void flv_video(struct serializer *s, int32_t dts_offset,
 	s_w8(s, packet->keyframe ? 0x17 : 0x27);
 	s_w8(s, is_header ? 0 : 1);
 	s_wb24(s, get_ms_time(packet, offset));
+}
+
+static void flv_video(struct serializer *s, int32_t dts_offset,
+		      struct encoder_packet *packet, bool is_header)
+{
+	if (!packet->data || !packet->size)
+		return;
+
+	flv_video_header(s, dts_offset, packet, is_header);
 	s_write(s, packet->data, packet->size);
 
 	write_previous_tag_size(s);
 }
 
-static void flv_audio(struct serializer *s, int32_t dts_offset,
-		      struct encoder_packet *packet, bool is_header)
+/* writes the tag header and the audio packet header, up to the payload */
+static void flv_audio_header(struct serializer *s, int32_t dts_offset,
+			     struct encoder_packet *packet, bool is_header)
 {
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
 
-	if (!packet->data || !packet->size)
-		return;
-
 	s_w8(s, RTMP_PACKET_TYPE_AUDIO);
 
 #ifdef DEBUG_TIMESTAMPS
@@ -354,6 +359,15 @@ static void flv_audio(struct serializer *s, int32_t dts_offset,
 	/* these are the two extra bytes mentioned above */
 	s_w8(s, 0xaf);
 	s_w8(s, is_header ? 0 : 1);
+}
+
+static void flv_audio(struct serializer *s, int32_t dts_offset,
+		      struct encoder_packet *packet, bool is_header)
+{
+	if (!packet->data || !packet->size)
+		return;
+
+	flv_audio_header(s, dts_offset, packet, is_header);
 	s_write(s, packet->data, packet->size);
 
 	write_previous_tag_size(s);
@@ -376,15 +390,54 @@ void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 	*size = data.bytes.num;
 }
 
-// Y2023 spec
-void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id,
-		   int32_t dts_offset, uint8_t **output, size_t *size, int type,
-		   size_t idx)
+static size_t tag_header_write(void *param, const void *data, size_t size)
+{
+	struct flv_tag *tag = param;
+
+	if (tag->header_size + size > sizeof(tag->header)) {
+		assert(0 && "FLV tag header too large");
+		return 0;
+	}
+
+	memcpy(tag->header + tag->header_size, data, size);
+	tag->header_size += size;
+	return size;
+}
+
+static void tag_serializer_init(struct serializer *s, struct flv_tag *tag,
+				struct encoder_packet *packet)
+{
+	memset(s, 0, sizeof(*s));
+	s->data = tag;
+	s->write = tag_header_write;
+
+	tag->header_size = 0;
+	tag->data = packet->data;
+	tag->size = packet->size;
+}
+
+void flv_packet_mux_tag(struct encoder_packet *packet, int32_t dts_offset,
+			struct flv_tag *tag, bool is_header)
 {
-	struct array_output_data data;
 	struct serializer s;
-	array_output_serializer_init(&s, &data);
 
+	tag_serializer_init(&s, tag, packet);
+
+	if (!packet->data || !packet->size)
+		return;
+
+	if (packet->type == OBS_ENCODER_VIDEO)
+		flv_video_header(&s, dts_offset, packet, is_header);
+	else
+		flv_audio_header(&s, dts_offset, packet, is_header);
+}
+
+// Y2023 spec
+static void flv_packet_ex_header(struct serializer *s,
+				 struct encoder_packet *packet,
+				 enum video_id_t codec_id, int32_t dts_offset,
+				 int type, size_t idx)
+{
 	assert(packet->type == OBS_ENCODER_VIDEO);
 
 	int32_t time_ms = get_ms_time(packet, packet->dts) - dts_offset;
@@ -401,10 +454,10 @@ void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id,
 	if (is_multitrack)
 		header_metadata_size += 2; // w8+w8
 
-	s_w8(&s, RTMP_PACKET_TYPE_VIDEO);
-	s_wb24(&s, (uint32_t)packet->size + header_metadata_size);
-	s_wtimestamp(&s, time_ms);
-	s_wb24(&s, 0); // always 0
+	s_w8(s, RTMP_PACKET_TYPE_VIDEO);
+	s_wb24(s, (uint32_t)packet->size + header_metadata_size);
+	s_wtimestamp(s, time_ms);
+	s_wb24(s, 0); // always 0
 
 	uint8_t frame_type = packet->keyframe ? FT_KEY : FT_INTER;
 
@@ -413,22 +466,34 @@ void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id,
 	 * The default trackId is 0.
 	 */
 	if (is_multitrack) {
-		s_w8(&s, FRAME_HEADER_EX | PACKETTYPE_MULTITRACK | frame_type);
-		s_w8(&s, MULTITRACKTYPE_ONE_TRACK | type);
-		s_w4cc(&s, codec_id);
+		s_w8(s, FRAME_HEADER_EX | PACKETTYPE_MULTITRACK | frame_type);
+		s_w8(s, MULTITRACKTYPE_ONE_TRACK | type);
+		s_w4cc(s, codec_id);
 		// trackId
-		s_w8(&s, (uint8_t)idx);
+		s_w8(s, (uint8_t)idx);
 	} else {
-		s_w8(&s, FRAME_HEADER_EX | type | frame_type);
-		s_w4cc(&s, codec_id);
+		s_w8(s, FRAME_HEADER_EX | type | frame_type);
+		s_w4cc(s, codec_id);
 	}
 
 	// H.264/HEVC composition time offset
 	if ((codec_id == CODEC_H264 || codec_id == CODEC_HEVC) &&
 	    type == PACKETTYPE_FRAMES) {
-		s_wb24(&s, get_ms_time(packet, packet->pts - packet->dts));
+		s_wb24(s, get_ms_time(packet, packet->pts - packet->dts));
 	}
 
+}
+
+void flv_packet_ex(struct encoder_packet *packet, enum video_id_t codec_id,
+		   int32_t dts_offset, uint8_t **output, size_t *size, int type,
+		   size_t idx)
+{
+	struct array_output_data data;
+	struct serializer s;
+	array_output_serializer_init(&s, &data);
+
+	flv_packet_ex_header(&s, packet, codec_id, dts_offset, type, idx);
+
 	// packet data
 	s_write(&s, packet->data, packet->size);
 
@@ -446,18 +511,34 @@ void flv_packet_start(struct encoder_packet *packet, enum video_id_t codec,
 		      idx);
 }
 
-void flv_packet_frames(struct encoder_packet *packet, enum video_id_t codec,
-		       int32_t dts_offset, uint8_t **output, size_t *size,
-		       size_t idx)
+static int frames_packet_type(struct encoder_packet *packet,
+			      enum video_id_t codec)
 {
-	int packet_type = PACKETTYPE_FRAMES;
 	// PACKETTYPE_FRAMESX is an optimization to avoid sending composition
 	// time offsets of 0. See Enhanced RTMP spec.
 	if ((codec == CODEC_H264 || codec == CODEC_HEVC) &&
 	    packet->dts == packet->pts)
-		packet_type = PACKETTYPE_FRAMESX;
-	flv_packet_ex(packet, codec, dts_offset, output, size, packet_type,
-		      idx);
+		return PACKETTYPE_FRAMESX;
+	return PACKETTYPE_FRAMES;
+}
+
+void flv_packet_frames(struct encoder_packet *packet, enum video_id_t codec,
+		       int32_t dts_offset, uint8_t **output, size_t *size,
+		       size_t idx)
+{
+	flv_packet_ex(packet, codec, dts_offset, output, size,
+		      frames_packet_type(packet, codec), idx);
+}
+
+void flv_packet_frames_tag(struct encoder_packet *packet,
+			   enum video_id_t codec, int32_t dts_offset,
+			   struct flv_tag *tag, size_t idx)
+{
+	struct serializer s;
+
+	tag_serializer_init(&s, tag, packet);
+	flv_packet_ex_header(&s, packet, codec, dts_offset,
+			     frames_packet_type(packet, codec), idx);
 }
 
 void flv_packet_end(struct encoder_packet *packet, enum video_id_t codec,
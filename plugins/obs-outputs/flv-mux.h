@@ -28,6 +28,21 @@ enum video_id_t {
 	CODEC_HEVC,
 };
 
+/* room for the tag header and the largest video packet header */
+#define FLV_TAG_HEADER_MAX_SIZE 32
+
+/*
+ * An FLV tag split into its headers and the packet data, which stays in the
+ * encoder packet, so it can be sent without being copied.  The trailing
+ * previous tag size is not included.
+ */
+struct flv_tag {
+	uint8_t header[FLV_TAG_HEADER_MAX_SIZE];
+	size_t header_size;
+	const uint8_t *data;
+	size_t size;
+};
+
 static enum video_id_t to_video_type(const char *codec)
 {
 	if (strcmp(codec, "h264") == 0)
@@ -54,6 +69,10 @@ extern void flv_additional_meta_data(obs_output_t *context, uint8_t **output,
 				     size_t *size);
 extern void flv_packet_mux(struct encoder_packet *packet, int32_t dts_offset,
 			   uint8_t **output, size_t *size, bool is_header);
+/* same as flv_packet_mux, header_size is 0 if there is nothing to send */
+extern void flv_packet_mux_tag(struct encoder_packet *packet,
+			       int32_t dts_offset, struct flv_tag *tag,
+			       bool is_header);
 extern void flv_additional_packet_mux(struct encoder_packet *packet,
 				      int32_t dts_offset, uint8_t **output,
 				      size_t *size, bool is_header,
@@ -65,6 +84,9 @@ extern void flv_packet_start(struct encoder_packet *packet,
 extern void flv_packet_frames(struct encoder_packet *packet,
 			      enum video_id_t codec, int32_t dts_offset,
 			      uint8_t **output, size_t *size, size_t idx);
+extern void flv_packet_frames_tag(struct encoder_packet *packet,
+				  enum video_id_t codec, int32_t dts_offset,
+				  struct flv_tag *tag, size_t idx);
 extern void flv_packet_end(struct encoder_packet *packet, enum video_id_t codec,
 			   uint8_t **output, size_t *size, size_t idx);
 extern void flv_packet_metadata(enum video_id_t codec, uint8_t **output,
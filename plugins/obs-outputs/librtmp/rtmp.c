@@ -1576,11 +1576,29 @@ ReadN(RTMP *r, char *buffer, int n)
     return nOriginalSize - n;
 }
 
+static void
+SendFailed(RTMP *r, int sockerr)
+{
+    struct linger l;
+
+    r->last_error_code = sockerr;
+
+    // Force-close the socket. Sometimes a send() error isn't fatal, so
+    // we could end up writing an unpublish message which some services
+    // treat as a clean shutdown. We need to disable lingering too so
+    // the remote side sees an abortive shutdown (RST).
+    l.l_onoff = 1;
+    l.l_linger = 0;
+    setsockopt(r->m_sb.sb_socket, SOL_SOCKET, SO_LINGER, (char *)&l, sizeof(l));
+    RTMPSockBuf_Close(&r->m_sb);
+
+    RTMP_Close(r);
+}
+
 static int
 WriteN(RTMP *r, const char *buffer, int n)
 {
     const char *ptr = buffer;
-    struct linger l;
 
     while (n > 0)
     {
@@ -1603,18 +1621,7 @@ WriteN(RTMP *r, const char *buffer, int n)
             if (sockerr == EINTR && !RTMP_ctrlC)
                 continue;
 
-            r->last_error_code = sockerr;
-
-            // Force-close the socket. Sometimes a send() error isn't fatal, so
-            // we could end up writing an unpublish message which some services
-            // treat as a clean shutdown. We need to disable lingering too so
-            // the remote side sees an abortive shutdown (RST).
-            l.l_onoff = 1;
-            l.l_linger = 0;
-            setsockopt(r->m_sb.sb_socket, SOL_SOCKET, SO_LINGER, (char *)&l, sizeof(l));
-            RTMPSockBuf_Close(&r->m_sb);
-
-            RTMP_Close(r);
+            SendFailed(r, sockerr);
             n = 1;
             break;
         }
@@ -1629,6 +1636,57 @@ WriteN(RTMP *r, const char *buffer, int n)
     return n == 0;
 }
 
+/* Like WriteN, for up to RTMP_IOVEC_BATCH buffers.  Modifies iov. */
+static int
+WriteV(RTMP *r, RTMPIOVec *iov, int n)
+{
+    if (r->m_bCustomSend && r->m_customSendFunc)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            if (!WriteN(r, iov[i].iv_base, iov[i].iv_len))
+                return FALSE;
+        }
+        return TRUE;
+    }
+
+    while (n > 0)
+    {
+        int nBytes = RTMPSockBuf_SendV(&r->m_sb, iov, n);
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d (%d buffers)", __FUNCTION__,
+                     sockerr, n);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            SendFailed(r, sockerr);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        /* skip what was sent, the last buffer may be sent partially */
+        while (n > 0 && nBytes >= iov->iv_len)
+        {
+            nBytes -= iov->iv_len;
+            iov++;
+            n--;
+        }
+        if (n > 0)
+        {
+            iov->iv_base += nBytes;
+            iov->iv_len -= nBytes;
+        }
+    }
+
+    return TRUE;
+}
+
 #define SAVC(x)	static const AVal av_##x = AVC(#x)
 
 SAVC(app);
@@ -4085,18 +4143,19 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+/* Picks the header type of a packet and encodes the header of its first
+ * chunk, ending right before hend.  Returns the header size, 0 on failure.
+ */
+static int
+EncodeChunkHeader(RTMP *r, RTMPPacket *packet, char *hend, char **pheader,
+                  int *pcSize, uint32_t *pt)
 {
     const RTMPPacket *prevPacket;
     uint32_t last = 0;
     int nSize;
     int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *header, *hptr, c;
     uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -4107,7 +4166,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
             free(r->m_vecChannelsOut);
             r->m_vecChannelsOut = NULL;
             r->m_channelsAllocatedOut = 0;
-            return FALSE;
+            return 0;
         }
         r->m_vecChannelsOut = packets;
         memset(r->m_vecChannelsOut + r->m_channelsAllocatedOut, 0, sizeof(RTMPPacket*) * (n - r->m_channelsAllocatedOut));
@@ -4133,7 +4192,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     {
         RTMP_Log(RTMP_LOGERROR, "sanity failed!! trying to send header of type: 0x%02x.",
                  (unsigned char)packet->m_headerType);
-        return FALSE;
+        return 0;
     }
 
     nSize = packetSize[packet->m_headerType];
@@ -4141,16 +4200,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     cSize = 0;
     t = packet->m_nTimeStamp - last;
 
-    if (packet->m_body)
-    {
-        header = packet->m_body - nSize;
-        hend = packet->m_body;
-    }
-    else
-    {
-        header = hbuf + 6;
-        hend = hbuf + sizeof(hbuf);
-    }
+    header = hend - nSize;
 
     if (packet->m_nChannel > 319)
         cSize = 2;
@@ -4207,6 +4257,58 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     if (nSize > 1 && t >= 0xffffff)
         hptr = AMF_EncodeInt32(hptr, hend, t);
 
+    *pheader = header;
+    *pcSize = cSize;
+    *pt = t;
+    return hSize;
+}
+
+/* Encodes the header of the chunks following the first one of a packet,
+ * returns the header size
+ */
+static int
+EncodeContinuationHeader(const RTMPPacket *packet, char c, int cSize,
+                         uint32_t t, char *header)
+{
+    int hSize = 1 + cSize;
+
+    *header = (0xc0 | c);
+    if (cSize)
+    {
+        int tmp = packet->m_nChannel - 64;
+        header[1] = tmp & 0xff;
+        if (cSize == 2)
+            header[2] = tmp >> 8;
+    }
+    if (t >= 0xffffff)
+    {
+        AMF_EncodeInt32(header + hSize, header + hSize + 4, t);
+        hSize += 4;
+    }
+    return hSize;
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    int nSize;
+    int hSize, cSize;
+    char *header, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    uint32_t t;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    if (packet->m_body)
+        hend = packet->m_body;
+    else
+        hend = hbuf + sizeof(hbuf);
+
+    hSize = EncodeChunkHeader(r, packet, hend, &header, &cSize, &t);
+    if (!hSize)
+        return FALSE;
+    c = *header;
+
     nSize = packet->m_nBodySize;
     buffer = packet->m_body;
     nChunkSize = r->m_outChunkSize;
@@ -4253,28 +4355,9 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         // prepare to send off remaining data in Type 3 chunks
         if (nSize > 0)
         {
-            header = buffer - 1;
-            hSize = 1;
-            if (cSize)
-            {
-                header -= cSize;
-                hSize += cSize;
-            }
-            if (t >= 0xffffff)
-            {
-                hSize += 4;
-                header -= 4;
-            }
-            *header = (0xc0 | c);
-            if (cSize)
-            {
-                int tmp = packet->m_nChannel - 64;
-                header[1] = tmp & 0xff;
-                if (cSize == 2)
-                    header[2] = tmp >> 8;
-            }
-            if (t >= 0xffffff)
-                AMF_EncodeInt32(header+hSize-4, header+hSize, t);
+            hSize = 1 + cSize + (t >= 0xffffff ? 4 : 0);
+            header = buffer - hSize;
+            EncodeContinuationHeader(packet, c, cSize, t, header);
         }
     }
     if (tbuf)
@@ -4523,6 +4606,64 @@ RTMPSockBuf_Send(RTMPSockBuf *sb, const char *buf, int len)
     return rc;
 }
 
+int
+RTMPSockBuf_SendV(RTMPSockBuf *sb, const RTMPIOVec *iov, int count)
+{
+    int rc;
+
+    if (count > RTMP_IOVEC_BATCH)
+        count = RTMP_IOVEC_BATCH;
+
+#if defined(RTMP_NETSTACK_DUMP)
+    for (int i = 0; i < count; i++)
+        fwrite(iov[i].iv_base, 1, iov[i].iv_len, netstackdump);
+#endif
+
+#if defined(CRYPTO) && !defined(NO_SSL)
+    if (sb->sb_ssl)
+    {
+        /* TLS records cannot be gathered, send the first buffer only */
+        return RTMPSockBuf_Send(sb, iov[0].iv_base, iov[0].iv_len);
+    }
+#endif
+
+#ifdef _WIN32
+    {
+        WSABUF bufs[RTMP_IOVEC_BATCH];
+        DWORD sent = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            bufs[i].buf = (char *)iov[i].iv_base;
+            bufs[i].len = (ULONG)iov[i].iv_len;
+        }
+
+        if (WSASend(sb->sb_socket, bufs, (DWORD)count, &sent, 0, NULL,
+                    NULL) == SOCKET_ERROR)
+            rc = -1;
+        else
+            rc = (int)sent;
+    }
+#else
+    {
+        struct iovec vec[RTMP_IOVEC_BATCH];
+        struct msghdr msg;
+
+        for (int i = 0; i < count; i++)
+        {
+            vec[i].iov_base = (void *)iov[i].iv_base;
+            vec[i].iov_len = (size_t)iov[i].iv_len;
+        }
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = vec;
+        msg.msg_iovlen = count;
+        rc = (int)sendmsg(sb->sb_socket, &msg, MSG_NOSIGNAL);
+    }
+#endif
+    return rc;
+}
+
 int
 RTMPSockBuf_Close(RTMPSockBuf *sb)
 {
@@ -5383,3 +5524,162 @@ RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
     }
     return size+s2;
 }
+
+/* Sends a packet whose body is split across several buffers.  The chunk
+ * headers are sent from a separate buffer, so the body is never copied.
+ */
+static int
+SendPacketV(RTMP *r, RTMPPacket *packet, const RTMPIOVec *body, int count)
+{
+    RTMPIOVec vec[RTMP_IOVEC_BATCH];
+    char hbuf[RTMP_MAX_HEADER_SIZE], cbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *header;
+    int hSize, cSize, contSize;
+    int nChunkSize = r->m_outChunkSize;
+    int chunkLeft = nChunkSize;
+    int n = 0, offset = 0;
+    uint32_t t;
+
+    hSize = EncodeChunkHeader(r, packet, hbuf + sizeof(hbuf), &header,
+                              &cSize, &t);
+    if (!hSize)
+        return FALSE;
+    c = *header;
+
+    contSize = EncodeContinuationHeader(packet, c, cSize, t, cbuf);
+
+    RTMP_Log(RTMP_LOGDEBUG2, "%s: fd=%d, size=%d", __FUNCTION__, (int)r->m_sb.sb_socket,
+             packet->m_nBodySize);
+
+    vec[n].iv_base = header;
+    vec[n++].iv_len = hSize;
+
+    while (count > 0)
+    {
+        int len = body->iv_len - offset;
+
+        if (!len)
+        {
+            body++;
+            count--;
+            offset = 0;
+            continue;
+        }
+
+        /* leave room for a chunk header and a piece of the body */
+        if (n + 2 > RTMP_IOVEC_BATCH)
+        {
+            if (!WriteV(r, vec, n))
+                return FALSE;
+            n = 0;
+        }
+
+        if (!chunkLeft)
+        {
+            vec[n].iv_base = cbuf;
+            vec[n++].iv_len = contSize;
+            chunkLeft = nChunkSize;
+        }
+
+        if (len > chunkLeft)
+            len = chunkLeft;
+
+        vec[n].iv_base = body->iv_base + offset;
+        vec[n++].iv_len = len;
+        chunkLeft -= len;
+        offset += len;
+    }
+
+    if (n && !WriteV(r, vec, n))
+        return FALSE;
+
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    return TRUE;
+}
+
+int
+RTMP_WriteV(RTMP *r, const RTMPIOVec *iov, int count, int streamIdx)
+{
+    RTMPPacket packet;
+    RTMPIOVec body[RTMP_IOVEC_BATCH];
+    const char *buf;
+    int size = 0, ret;
+
+    if (count < 1 || count > RTMP_IOVEC_BATCH || iov[0].iv_len < 11)
+        return FALSE;
+
+    /* a tag given to RTMP_Write is still incomplete */
+    if (r->m_write.m_nBytesRead)
+        return FALSE;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.m_nChannel = 0x04;	/* source channel */
+    packet.m_nInfoField2 = r->Link.streams[streamIdx].id;
+
+    buf = iov[0].iv_base;
+    packet.m_packetType = *buf++;
+    packet.m_nBodySize = AMF_DecodeInt24(buf);
+    buf += 3;
+    packet.m_nTimeStamp = AMF_DecodeInt24(buf);
+    buf += 3;
+    packet.m_nTimeStamp |= *buf++ << 24;
+    buf += 3;
+
+    if (((packet.m_packetType == RTMP_PACKET_TYPE_AUDIO
+            || packet.m_packetType == RTMP_PACKET_TYPE_VIDEO) &&
+            !packet.m_nTimeStamp) || packet.m_packetType == RTMP_PACKET_TYPE_INFO)
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    }
+    else
+    {
+        packet.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+    }
+
+    body[0].iv_base = buf;
+    body[0].iv_len = iov[0].iv_len - 11;
+    for (int i = 1; i < count; i++)
+        body[i] = iov[i];
+    for (int i = 0; i < count; i++)
+        size += body[i].iv_len;
+
+    if ((uint32_t)size != packet.m_nBodySize)
+    {
+        RTMP_Log(RTMP_LOGERROR, "%s, tag body is %d bytes, expected %u", __FUNCTION__,
+                 size, packet.m_nBodySize);
+        return FALSE;
+    }
+
+    /* HTTP and TLS need the packet in one piece to avoid tiny requests
+     * and records, so fall back to copying the body */
+    if ((r->Link.protocol & RTMP_FEATURE_HTTP) || r->m_sb.sb_ssl)
+    {
+        char *enc;
+
+        if (!RTMPPacket_Alloc(&packet, packet.m_nBodySize))
+        {
+            RTMP_Log(RTMP_LOGDEBUG, "%s, failed to allocate packet", __FUNCTION__);
+            return FALSE;
+        }
+
+        enc = packet.m_body;
+        for (int i = 0; i < count; i++)
+        {
+            memcpy(enc, body[i].iv_base, body[i].iv_len);
+            enc += body[i].iv_len;
+        }
+
+        ret = RTMP_SendPacket(r, &packet, FALSE);
+        RTMPPacket_Free(&packet);
+    }
+    else
+    {
+        ret = SendPacketV(r, &packet, body, count);
+    }
+
+    if (!ret)
+        return -1;
+    return size + 11;
+}
@@ -274,6 +274,16 @@ extern "C"
         void *sb_ssl;
     } RTMPSockBuf;
 
+    /* one part of the data given to RTMP_WriteV */
+    typedef struct RTMPIOVec
+    {
+        const char *iv_base;
+        int iv_len;
+    } RTMPIOVec;
+
+/* number of parts sent with a single gathering write */
+#define RTMP_IOVEC_BATCH 64
+
     void RTMPPacket_Reset(RTMPPacket *p);
     void RTMPPacket_Dump(RTMPPacket *p);
     int RTMPPacket_Alloc(RTMPPacket *p, uint32_t nSize);
@@ -533,6 +543,7 @@ extern "C"
 
     int RTMPSockBuf_Fill(RTMPSockBuf *sb);
     int RTMPSockBuf_Send(RTMPSockBuf *sb, const char *buf, int len);
+    int RTMPSockBuf_SendV(RTMPSockBuf *sb, const RTMPIOVec *iov, int count);
     int RTMPSockBuf_Close(RTMPSockBuf *sb);
 
     int RTMP_SendCreateStream(RTMP *r);
@@ -543,6 +554,13 @@ extern "C"
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
 
+    /* Sends a single FLV tag split across several buffers, without its
+     * trailing previous tag size.  The first buffer must hold the whole
+     * 11 byte tag header.  Unlike RTMP_Write, the tag body is not copied,
+     * the chunk headers are sent along with it in gathering writes.
+     */
+    int RTMP_WriteV(RTMP *r, const RTMPIOVec *iov, int count, int streamIdx);
+
 #ifdef USE_HASHSWF
     /* hashswf.c */
     int RTMP_HashSWF(const char *url, unsigned int *size, unsigned char *hash,
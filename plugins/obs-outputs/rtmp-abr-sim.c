@@ -0,0 +1,377 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Runs the adaptive bitrate controller against a local TCP sink that only
+ * reads at a limited rate, which drops and recovers over time.  Frames are
+ * produced at the controller's bitrate, queued like the RTMP output queues
+ * its packets, and sent by a separate thread, which samples the socket after
+ * each frame.  The controller state is printed every second.
+ *
+ *   Loopback has next to no round trip time, so BASE_RTT_MS is added to the
+ * measured one to stand in for the distance to a real server.
+ *
+ * usage: obs-rtmp-abr-sim [bitrate in kbps] [link rates in kbps...]
+ *
+ * Each link rate lasts for 20 seconds, the default is a link that can carry
+ * the full bitrate, then drops to a third of it and recovers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/deque.h>
+#include <util/bmem.h>
+#include "librtmp/rtmp_sys.h"
+#include "rtmp-abr.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#ifdef _WIN32
+#define SHUT_RDWR SD_BOTH
+#endif
+
+#define FPS 30
+#define AUDIO_BITRATE 160
+#define PHASE_SEC 20
+#define MAX_PHASES 16
+#define SOCKET_BUF_SIZE (64 * 1024)
+#define SINK_TICK_NS 10000000ULL
+#define BASE_RTT_MS 40
+
+struct link {
+	long rates[MAX_PHASES];
+	int phases;
+	uint64_t start_ts;
+};
+
+struct sink {
+	SOCKET fd;
+	struct link *link;
+	pthread_t thread;
+};
+
+struct frame {
+	uint64_t ts;
+	size_t size;
+};
+
+struct sender {
+	SOCKET fd;
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	struct deque frames;
+	uint64_t bytes_sent;
+	struct abr_sample socket_sample;
+	volatile bool stop;
+	pthread_t thread;
+};
+
+static inline int link_phase(struct link *link, uint64_t ts)
+{
+	return (int)((ts - link->start_ts) / (PHASE_SEC * 1000000000ULL));
+}
+
+static long link_rate(struct link *link, uint64_t ts)
+{
+	int phase = link_phase(link, ts);
+	return phase < link->phases ? link->rates[phase] : 0;
+}
+
+/* reads no faster than the current link rate allows */
+static void *sink_thread(void *data)
+{
+	struct sink *sink = data;
+	char *buf = bmalloc(SOCKET_BUF_SIZE);
+	uint64_t last_ts = os_gettime_ns();
+	uint64_t ts = last_ts;
+	double budget = 0.0;
+
+	while (link_phase(sink->link, ts) < sink->link->phases) {
+		double bytes_per_sec =
+			(double)link_rate(sink->link, ts) * 1000.0 / 8.0;
+		int ret;
+
+		budget += bytes_per_sec * (double)(ts - last_ts) / 1000000000.0;
+
+		/* an idle link doesn't save up bandwidth */
+		if (budget > bytes_per_sec * 0.05)
+			budget = bytes_per_sec * 0.05;
+
+		while (budget >= 1.0) {
+			int size = budget < SOCKET_BUF_SIZE ? (int)budget
+							    : SOCKET_BUF_SIZE;
+
+			ret = recv(sink->fd, buf, size, 0);
+			if (ret <= 0)
+				goto finish;
+			budget -= ret;
+		}
+
+		os_sleepto_ns(ts + SINK_TICK_NS);
+		last_ts = ts;
+		ts = os_gettime_ns();
+	}
+
+finish:
+	bfree(buf);
+	return NULL;
+}
+
+static void *send_thread(void *data)
+{
+	struct sender *sender = data;
+	char *buf = bzalloc(SOCKET_BUF_SIZE);
+	RTMPSockBuf sb = {.sb_socket = sender->fd};
+
+	while (os_sem_wait(sender->sem) == 0 && !sender->stop) {
+		struct frame frame;
+
+		pthread_mutex_lock(&sender->mutex);
+		deque_peek_front(&sender->frames, &frame, sizeof(frame));
+		pthread_mutex_unlock(&sender->mutex);
+
+		while (frame.size) {
+			size_t size = frame.size < SOCKET_BUF_SIZE
+					      ? frame.size
+					      : SOCKET_BUF_SIZE;
+			int ret = send(sender->fd, buf, (int)size,
+				       MSG_NOSIGNAL);
+			if (ret <= 0)
+				goto finish;
+
+			frame.size -= (size_t)ret;
+			sender->bytes_sent += (uint64_t)ret;
+		}
+
+		/* like the output, the socket is sampled by its sender */
+		struct abr_sample sample = {0};
+		abr_sample_socket(&sample, &sb);
+		if (sample.has_socket_info)
+			sample.rtt_usec += BASE_RTT_MS * 1000;
+
+		/* the frame stays queued until it is completely sent */
+		pthread_mutex_lock(&sender->mutex);
+		deque_pop_front(&sender->frames, NULL, sizeof(frame));
+		sender->socket_sample = sample;
+		pthread_mutex_unlock(&sender->mutex);
+	}
+
+finish:
+	bfree(buf);
+	return NULL;
+}
+
+static SOCKET connect_sink(struct sink *sink)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t addr_len = sizeof(addr);
+	int buf_size = SOCKET_BUF_SIZE;
+	SOCKET listener, fd = INVALID_SOCKET;
+
+	sink->fd = INVALID_SOCKET;
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (listener == INVALID_SOCKET)
+		return INVALID_SOCKET;
+
+	/* small buffers, so that a slow reader pushes back quickly */
+	setsockopt(listener, SOL_SOCKET, SO_RCVBUF, (const char *)&buf_size,
+		   sizeof(buf_size));
+
+	if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    listen(listener, 1) != 0 ||
+	    getsockname(listener, (struct sockaddr *)&addr, &addr_len) != 0)
+		goto fail;
+
+	fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd == INVALID_SOCKET)
+		goto fail;
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (const char *)&buf_size,
+		   sizeof(buf_size));
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+		goto fail;
+
+	sink->fd = accept(listener, NULL, NULL);
+	if (sink->fd == INVALID_SOCKET)
+		goto fail;
+	if (pthread_create(&sink->thread, NULL, sink_thread, sink) != 0)
+		goto fail;
+
+	closesocket(listener);
+	return fd;
+
+fail:
+	if (sink->fd != INVALID_SOCKET)
+		closesocket(sink->fd);
+	if (fd != INVALID_SOCKET)
+		closesocket(fd);
+	closesocket(listener);
+	return INVALID_SOCKET;
+}
+
+static int64_t queue_usec(struct sender *sender, uint64_t ts)
+{
+	struct frame frame;
+	int64_t usec = 0;
+
+	pthread_mutex_lock(&sender->mutex);
+	if (sender->frames.size) {
+		deque_peek_front(&sender->frames, &frame, sizeof(frame));
+		usec = (int64_t)(ts - frame.ts) / 1000;
+	}
+	pthread_mutex_unlock(&sender->mutex);
+	return usec;
+}
+
+static void simulate(struct link *link, long bitrate)
+{
+	struct abr_controller abr;
+	struct sender sender = {0};
+	struct sink sink = {.link = link};
+	uint64_t frame_ts, end_ts, next_print;
+	long bitrate_sum = 0, sent_sum = 0;
+	int frames = 0;
+
+	abr_init(&abr, bitrate, AUDIO_BITRATE);
+
+	pthread_mutex_init(&sender.mutex, NULL);
+	os_sem_init(&sender.sem, 0);
+
+	link->start_ts = os_gettime_ns();
+	sender.fd = connect_sink(&sink);
+	if (sender.fd == INVALID_SOCKET) {
+		printf("failed to connect to the sink\n");
+		goto finish;
+	}
+
+	pthread_create(&sender.thread, NULL, send_thread, &sender);
+
+	printf("time  link  bitrate  throughput   rtt  queue  gradient  "
+	       "loss  state\n");
+
+	frame_ts = link->start_ts;
+	end_ts = link->start_ts + PHASE_SEC * 1000000000ULL * link->phases;
+	next_print = link->start_ts + 1000000000ULL;
+
+	while (frame_ts < end_ts) {
+		struct abr_sample sample;
+		struct frame frame;
+
+		frame.ts = frame_ts;
+		frame.size = (size_t)(abr.bitrate + AUDIO_BITRATE) * 1000 / 8 /
+			     FPS;
+
+		pthread_mutex_lock(&sender.mutex);
+		deque_push_back(&sender.frames, &frame, sizeof(frame));
+		pthread_mutex_unlock(&sender.mutex);
+		os_sem_post(sender.sem);
+
+		pthread_mutex_lock(&sender.mutex);
+		sample = sender.socket_sample;
+		pthread_mutex_unlock(&sender.mutex);
+
+		sample.ts_ns = frame_ts;
+		sample.bytes_sent = sender.bytes_sent;
+		sample.queue_usec = queue_usec(&sender, frame_ts);
+		abr_update(&abr, &sample);
+
+		bitrate_sum += abr.bitrate;
+		frames++;
+
+		if (frame_ts >= next_print) {
+			printf("%4.0f  %4ld  %7ld  %10.0f  %4.0f  %5.0f  %8.1f"
+			       "  %4.1f  %s\n",
+			       (double)(frame_ts - link->start_ts) /
+				       1000000000.0,
+			       link_rate(link, frame_ts), abr.bitrate,
+			       abr.throughput, abr.rtt_ms, abr.queue_delay_ms,
+			       abr.gradient, abr.loss * 100.0,
+			       abr_state_name(abr.state));
+			next_print += 1000000000ULL;
+		}
+
+		frame_ts += 1000000000ULL / FPS;
+		os_sleepto_ns(frame_ts);
+	}
+
+	sent_sum = (long)(sender.bytes_sent * 8 / 1000 /
+			  (PHASE_SEC * (uint64_t)link->phases));
+	printf("average bitrate %ld kbps, sent %ld kbps\n",
+	       bitrate_sum / frames, sent_sum);
+
+	/* shutting the connection down wakes a sink waiting for data and
+	 * fails any send still blocked on a full socket */
+	sender.stop = true;
+	os_sem_post(sender.sem);
+	shutdown(sink.fd, SHUT_RDWR);
+	shutdown(sender.fd, SHUT_RDWR);
+	pthread_join(sink.thread, NULL);
+	pthread_join(sender.thread, NULL);
+	closesocket(sink.fd);
+	closesocket(sender.fd);
+
+finish:
+	deque_free(&sender.frames);
+	os_sem_destroy(sender.sem);
+	pthread_mutex_destroy(&sender.mutex);
+}
+
+int main(int argc, char *argv[])
+{
+	struct link link = {0};
+	long bitrate;
+
+#ifdef _WIN32
+	WSADATA wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+
+	bitrate = argc > 1 ? atol(argv[1]) : 6000;
+	for (int i = 2; i < argc && link.phases < MAX_PHASES; i++)
+		link.rates[link.phases++] = atol(argv[i]);
+
+	if (!link.phases) {
+		link.rates[0] = (bitrate + AUDIO_BITRATE) * 3 / 2;
+		link.rates[1] = bitrate / 3;
+		link.rates[2] = link.rates[0];
+		link.phases = 3;
+	}
+
+	if (bitrate <= 0) {
+		fprintf(stderr, "usage: %s [bitrate in kbps] [link rates]\n",
+			argv[0]);
+		return 1;
+	}
+
+	simulate(&link, bitrate);
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	return 0;
+}
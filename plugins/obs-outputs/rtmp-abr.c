@@ -0,0 +1,415 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "rtmp-abr.h"
+#include "librtmp/rtmp_sys.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#endif
+
+#define ABR_MIN_BITRATE 50
+
+/* samples closer together than this are ignored */
+#define ABR_INTERVAL_NS 100000000ULL
+
+/* the lowest round trip time is tracked over two windows of this length */
+#define ABR_MIN_RTT_WINDOW_NS 10000000000ULL
+
+/* smoothing of the measurements, per sample */
+#define ABR_LOSS_ALPHA 0.25
+#define ABR_DELAY_ALPHA 0.1
+
+/* congestion detection */
+#define ABR_GRADIENT_THRESHOLD 25.0  /* ms of queueing delay per second */
+#define ABR_MIN_QUEUE_DELAY_MS 25.0  /* ignore the gradient below this */
+#define ABR_MAX_QUEUE_DELAY_MS 200.0 /* congested no matter the gradient */
+#define ABR_LOSS_THRESHOLD 0.05
+
+/* rate control */
+#define ABR_BETA 0.85
+#define ABR_DECREASE_INTERVAL_NS 1000000000ULL
+#define ABR_HOLD_NS 1000000000ULL
+#define ABR_MULTIPLICATIVE_INCREASE 0.08 /* per second */
+#define ABR_ADDITIVE_INCREASE 0.02       /* of the bitrate, per second */
+#define ABR_MIN_ADDITIVE_INCREASE 10.0   /* kbps per second */
+#define ABR_NEAR_CONGESTION 0.9
+#define ABR_MAX_OVERSHOOT 1.5
+
+/* smallest increase that is worth reconfiguring the encoder for */
+#define ABR_MIN_INCREASE 0.05
+
+enum abr_signal {
+	ABR_SIGNAL_NORMAL,
+	ABR_SIGNAL_OVERUSE,
+	ABR_SIGNAL_UNDERUSE,
+};
+
+void abr_init(struct abr_controller *abr, long bitrate, long audio_bitrate)
+{
+	memset(abr, 0, sizeof(*abr));
+	abr->max_bitrate = bitrate;
+	abr->min_bitrate = bitrate < ABR_MIN_BITRATE ? bitrate
+						     : ABR_MIN_BITRATE;
+	abr->audio_bitrate = audio_bitrate;
+	abr->bitrate = bitrate;
+	abr->target = (double)bitrate;
+	abr->state = ABR_STATE_INCREASE;
+}
+
+const char *abr_state_name(enum abr_state state)
+{
+	switch (state) {
+	case ABR_STATE_INCREASE:
+		return "increase";
+	case ABR_STATE_HOLD:
+		return "hold";
+	case ABR_STATE_DECREASE:
+		return "decrease";
+	}
+
+	return "unknown";
+}
+
+static inline double ewma(double avg, double val, double alpha)
+{
+	return avg * (1.0 - alpha) + val * alpha;
+}
+
+static uint64_t delivered_bytes(const struct abr_sample *s)
+{
+	uint64_t in_flight = 0;
+
+	/* data still in the socket has not been delivered yet */
+	if (s->has_socket_info)
+		in_flight = (uint64_t)s->unacked_bytes + s->unsent_bytes;
+
+	return s->bytes_sent > in_flight ? s->bytes_sent - in_flight : 0;
+}
+
+/* delivery rate over the last ABR_RATE_WINDOW samples */
+static void update_throughput(struct abr_controller *abr,
+			      const struct abr_sample *s)
+{
+	uint64_t delivered = delivered_bytes(s);
+	size_t oldest;
+	uint64_t dt;
+
+	if (delivered > abr->delivered)
+		abr->delivered = delivered;
+
+	abr->rate_ts[abr->rate_pos] = s->ts_ns;
+	abr->rate_bytes[abr->rate_pos] = abr->delivered;
+	abr->rate_pos = (abr->rate_pos + 1) % ABR_RATE_WINDOW;
+
+	/* until the window is full, measure from the first sample */
+	oldest = abr->rate_ts[abr->rate_pos] ? abr->rate_pos : 0;
+
+	dt = s->ts_ns - abr->rate_ts[oldest];
+	if (!dt)
+		return;
+
+	abr->throughput = (double)(abr->delivered - abr->rate_bytes[oldest]) *
+			  8.0 * 1000000.0 / (double)dt;
+}
+
+static void update_min_rtt(struct abr_controller *abr, uint64_t ts,
+			   double rtt_ms)
+{
+	if (ts >= abr->min_rtt_reset) {
+		abr->prev_min_rtt_ms = abr->min_rtt_ms;
+		abr->min_rtt_ms = rtt_ms;
+		abr->min_rtt_reset = ts + ABR_MIN_RTT_WINDOW_NS;
+	} else if (rtt_ms < abr->min_rtt_ms) {
+		abr->min_rtt_ms = rtt_ms;
+	}
+}
+
+/* least squares slope of the smoothed queueing delay over time */
+static double trendline_slope(const struct abr_controller *abr)
+{
+	double t_avg = 0.0, d_avg = 0.0;
+	double num = 0.0, den = 0.0;
+	size_t n = abr->trend_count;
+
+	if (n < 2)
+		return 0.0;
+
+	for (size_t i = 0; i < n; i++) {
+		t_avg += abr->trend_t[i];
+		d_avg += abr->trend_d[i];
+	}
+	t_avg /= (double)n;
+	d_avg /= (double)n;
+
+	for (size_t i = 0; i < n; i++) {
+		double dt = abr->trend_t[i] - t_avg;
+		num += dt * (abr->trend_d[i] - d_avg);
+		den += dt * dt;
+	}
+
+	return den > 0.0 ? num / den : 0.0;
+}
+
+static void update_delay(struct abr_controller *abr,
+			 const struct abr_sample *s)
+{
+	double delay = (double)s->queue_usec / 1000.0;
+
+	if (s->has_socket_info) {
+		double min_rtt;
+
+		abr->rtt_ms = (double)s->rtt_usec / 1000.0;
+		update_min_rtt(abr, s->ts_ns, abr->rtt_ms);
+
+		min_rtt = abr->min_rtt_ms;
+		if (abr->prev_min_rtt_ms > 0.0 &&
+		    abr->prev_min_rtt_ms < min_rtt)
+			min_rtt = abr->prev_min_rtt_ms;
+
+		delay += abr->rtt_ms - min_rtt;
+
+		/* time to drain the unsent data at the current throughput */
+		if (abr->throughput > 0.0)
+			delay += (double)s->unsent_bytes * 8.0 /
+				 abr->throughput;
+	}
+
+	if (delay < 0.0)
+		delay = 0.0;
+
+	abr->queue_delay_ms = delay;
+	if (abr->trend_count)
+		abr->smoothed_delay_ms =
+			ewma(abr->smoothed_delay_ms, delay, ABR_DELAY_ALPHA);
+	else
+		abr->smoothed_delay_ms = delay;
+
+	abr->trend_t[abr->trend_pos] =
+		(double)(s->ts_ns - abr->start_ts) / 1000000000.0;
+	abr->trend_d[abr->trend_pos] = abr->smoothed_delay_ms;
+	abr->trend_pos = (abr->trend_pos + 1) % ABR_TRENDLINE_SIZE;
+	if (abr->trend_count < ABR_TRENDLINE_SIZE)
+		abr->trend_count++;
+
+	abr->gradient = trendline_slope(abr);
+}
+
+static void update_loss(struct abr_controller *abr,
+			const struct abr_sample *s)
+{
+	uint64_t sent = s->bytes_sent - abr->last.bytes_sent;
+	double loss = 0.0;
+
+	if (!s->has_socket_info || !abr->last.has_socket_info)
+		return;
+
+	if (sent && s->retransmitted_bytes > abr->last.retransmitted_bytes) {
+		loss = (double)(s->retransmitted_bytes -
+				abr->last.retransmitted_bytes) /
+		       (double)sent;
+		if (loss > 1.0)
+			loss = 1.0;
+	}
+
+	abr->loss = ewma(abr->loss, loss, ABR_LOSS_ALPHA);
+}
+
+static enum abr_signal detect(const struct abr_controller *abr)
+{
+	if (abr->loss > ABR_LOSS_THRESHOLD)
+		return ABR_SIGNAL_OVERUSE;
+	if (abr->queue_delay_ms > ABR_MAX_QUEUE_DELAY_MS)
+		return ABR_SIGNAL_OVERUSE;
+	if (abr->gradient > ABR_GRADIENT_THRESHOLD &&
+	    abr->queue_delay_ms > ABR_MIN_QUEUE_DELAY_MS)
+		return ABR_SIGNAL_OVERUSE;
+	if (abr->gradient < -ABR_GRADIENT_THRESHOLD)
+		return ABR_SIGNAL_UNDERUSE;
+	return ABR_SIGNAL_NORMAL;
+}
+
+static void decrease(struct abr_controller *abr, uint64_t ts)
+{
+	double available = abr->throughput - (double)abr->audio_bitrate;
+
+	if (ts < abr->last_decrease + ABR_DECREASE_INTERVAL_NS)
+		return;
+
+	/* after a decrease, wait for the queues to drain unless they keep
+	 * growing */
+	if (abr->state != ABR_STATE_INCREASE &&
+	    abr->queue_delay_ms <= abr->last_decrease_delay_ms)
+		return;
+
+	/* without a usable measurement, back off from the current target */
+	if (available <= 0.0 || available > abr->target)
+		available = abr->target;
+
+	abr->congested_bitrate = available;
+	abr->target = available * ABR_BETA;
+	abr->state = ABR_STATE_DECREASE;
+	abr->last_decrease = ts;
+	abr->last_decrease_delay_ms = abr->queue_delay_ms;
+	abr->hold_until = ts + ABR_HOLD_NS;
+}
+
+static void increase(struct abr_controller *abr, double dt)
+{
+	double target = abr->target;
+	double limit;
+
+	if (abr->congested_bitrate > 0.0 &&
+	    target > abr->congested_bitrate * ABR_NEAR_CONGESTION) {
+		double step = target * ABR_ADDITIVE_INCREASE;
+		if (step < ABR_MIN_ADDITIVE_INCREASE)
+			step = ABR_MIN_ADDITIVE_INCREASE;
+		target += step * dt;
+	} else {
+		target *= 1.0 + ABR_MULTIPLICATIVE_INCREASE * dt;
+	}
+
+	/* well past the last congestion point, the link must have changed */
+	if (abr->congested_bitrate > 0.0 &&
+	    target > abr->congested_bitrate * (2.0 - ABR_NEAR_CONGESTION))
+		abr->congested_bitrate = 0.0;
+
+	/* don't get too far ahead of what the connection has carried */
+	limit = (abr->throughput - (double)abr->audio_bitrate) *
+		ABR_MAX_OVERSHOOT;
+	if (abr->throughput > 0.0 && target > limit)
+		target = limit > abr->target ? limit : abr->target;
+
+	abr->target = target;
+}
+
+static bool apply(struct abr_controller *abr)
+{
+	long bitrate;
+	double change;
+
+	if (abr->target > (double)abr->max_bitrate)
+		abr->target = (double)abr->max_bitrate;
+	if (abr->target < (double)abr->min_bitrate)
+		abr->target = (double)abr->min_bitrate;
+
+	bitrate = (long)abr->target;
+	if (bitrate == abr->bitrate)
+		return false;
+
+	/* apply every decrease, but only increase in worthwhile steps */
+	change = (double)(bitrate - abr->bitrate) / (double)abr->bitrate;
+	if (change > 0.0 && change < ABR_MIN_INCREASE &&
+	    bitrate != abr->max_bitrate)
+		return false;
+
+	abr->bitrate = bitrate;
+	return true;
+}
+
+bool abr_update(struct abr_controller *abr, const struct abr_sample *sample)
+{
+	uint64_t ts = sample->ts_ns;
+	double dt;
+
+	if (!abr->last_ts) {
+		abr->last = *sample;
+		abr->start_ts = ts;
+		abr->last_ts = ts;
+		abr->delivered = delivered_bytes(sample);
+		abr->rate_ts[0] = ts;
+		abr->rate_bytes[0] = abr->delivered;
+		abr->rate_pos = 1;
+
+		/* the round trip time is unknown until the socket is sampled */
+		if (sample->has_socket_info)
+			update_min_rtt(abr, ts,
+				       (double)sample->rtt_usec / 1000.0);
+		return false;
+	}
+
+	if (ts < abr->last_ts + ABR_INTERVAL_NS)
+		return false;
+
+	dt = (double)(ts - abr->last_ts) / 1000000000.0;
+
+	update_throughput(abr, sample);
+	update_delay(abr, sample);
+	update_loss(abr, sample);
+
+	abr->last = *sample;
+	abr->last_ts = ts;
+
+	switch (detect(abr)) {
+	case ABR_SIGNAL_OVERUSE:
+		decrease(abr, ts);
+		break;
+
+	case ABR_SIGNAL_UNDERUSE:
+		/* the queues are draining, let them */
+		abr->state = ABR_STATE_HOLD;
+		break;
+
+	case ABR_SIGNAL_NORMAL:
+		if (abr->state == ABR_STATE_DECREASE)
+			abr->state = ABR_STATE_HOLD;
+
+		if (abr->state == ABR_STATE_HOLD && ts >= abr->hold_until &&
+		    abr->queue_delay_ms < ABR_MIN_QUEUE_DELAY_MS)
+			abr->state = ABR_STATE_INCREASE;
+
+		if (abr->state == ABR_STATE_INCREASE)
+			increase(abr, dt);
+		break;
+	}
+
+	return apply(abr);
+}
+
+void abr_sample_socket(struct abr_sample *sample, struct RTMPSockBuf *sb)
+{
+#ifdef __linux__
+	struct tcp_info info;
+	socklen_t size = sizeof(info);
+	uint32_t unacked;
+	int queued = 0;
+
+	if (sb->sb_socket == INVALID_SOCKET)
+		return;
+	if (getsockopt(sb->sb_socket, IPPROTO_TCP, TCP_INFO, &info, &size) !=
+	    0)
+		return;
+
+	/* SIOCOUTQ counts both unsent and unacknowledged bytes */
+	if (ioctl(sb->sb_socket, SIOCOUTQ, &queued) != 0)
+		queued = 0;
+
+	unacked = info.tcpi_unacked * info.tcpi_snd_mss;
+
+	sample->has_socket_info = true;
+	sample->rtt_usec = info.tcpi_rtt;
+	sample->unacked_bytes = unacked;
+	sample->unsent_bytes =
+		(uint32_t)queued > unacked ? (uint32_t)queued - unacked : 0;
+	sample->retransmitted_bytes =
+		info.tcpi_total_retrans * info.tcpi_snd_mss;
+#else
+	UNUSED_PARAMETER(sample);
+	UNUSED_PARAMETER(sb);
+#endif
+}
@@ -0,0 +1,128 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+#include <util/c99defs.h>
+
+/*
+ * Adaptive bitrate controller for network outputs.
+ *
+ *   The controller is fed periodic samples of the connection state and
+ * estimates the available bandwidth from three signals:
+ *
+ * - delay: the queueing delay, made of the round trip time above the lowest
+ *   one seen recently, the data waiting in the socket send buffer, and the
+ *   media waiting in the output's own packet queue.  A trend line fitted to
+ *   the recent queueing delay gives its gradient, which detects congestion
+ *   before the queues are actually full.
+ * - loss: the share of sent data that had to be retransmitted.
+ * - throughput: the rate at which sent data is acknowledged.
+ *
+ *   On congestion the bitrate drops to a fraction of the measured
+ * throughput, then holds until the queues have drained.  Otherwise it grows
+ * multiplicatively, and only additively when getting close to the bitrate
+ * at which congestion last happened.
+ *
+ *   The controller itself does no I/O, abr_sample_socket fills in the socket
+ * state where the platform provides it.  Elsewhere only the output's own
+ * queue and the send rate are used.
+ */
+
+#define ABR_TRENDLINE_SIZE 20
+#define ABR_RATE_WINDOW 10
+
+enum abr_state {
+	ABR_STATE_INCREASE,
+	ABR_STATE_HOLD,
+	ABR_STATE_DECREASE,
+};
+
+struct abr_sample {
+	uint64_t ts_ns;
+
+	/* total bytes handed to the socket */
+	uint64_t bytes_sent;
+
+	/* duration of the media waiting in the output's packet queue */
+	int64_t queue_usec;
+
+	/* socket state, only valid if has_socket_info is set */
+	bool has_socket_info;
+	uint32_t rtt_usec;
+	uint32_t unacked_bytes;
+	uint32_t unsent_bytes;
+	uint32_t retransmitted_bytes;
+};
+
+struct abr_controller {
+	/* video bitrates in kbps */
+	long max_bitrate;
+	long min_bitrate;
+	long audio_bitrate;
+	long bitrate;
+	double target;
+
+	enum abr_state state;
+	uint64_t start_ts;
+	uint64_t last_ts;
+	uint64_t hold_until;
+	uint64_t last_decrease;
+	double last_decrease_delay_ms;
+
+	/* bitrate at which congestion last happened, 0 if unknown */
+	double congested_bitrate;
+
+	/* measurements */
+	struct abr_sample last;
+	uint64_t delivered;
+	uint64_t rate_ts[ABR_RATE_WINDOW];
+	uint64_t rate_bytes[ABR_RATE_WINDOW];
+	size_t rate_pos;
+	double throughput;
+	double rtt_ms;
+	double min_rtt_ms;
+	double prev_min_rtt_ms;
+	uint64_t min_rtt_reset;
+	double queue_delay_ms;
+	double smoothed_delay_ms;
+	double gradient;
+	double loss;
+
+	double trend_t[ABR_TRENDLINE_SIZE];
+	double trend_d[ABR_TRENDLINE_SIZE];
+	size_t trend_count;
+	size_t trend_pos;
+};
+
+void abr_init(struct abr_controller *abr, long bitrate, long audio_bitrate);
+
+/**
+ * Feeds a sample to the controller.  Returns true if the video bitrate
+ * changed enough to be worth reconfiguring the encoder for.
+ */
+bool abr_update(struct abr_controller *abr, const struct abr_sample *sample);
+
+const char *abr_state_name(enum abr_state state);
+
+struct RTMPSockBuf;
+
+/**
+ * Fills in the socket state of a sample, currently only on Linux.  Must be
+ * called on the thread that owns the socket.
+ */
+void abr_sample_socket(struct abr_sample *sample, struct RTMPSockBuf *sb);
@@ -0,0 +1,371 @@
+#ifdef __linux__
+#include "rtmp-stream.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/sockios.h>
+
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT 25
+#endif
+
+/* keep no more than this share of the write buffer unsent in the kernel */
+#define NOTSENT_LOWAT_DIVISOR 16
+#define MIN_NOTSENT_LOWAT 16384
+
+static void fatal_sock_shutdown(struct rtmp_stream *stream)
+{
+	close(stream->rtmp.m_sb.sb_socket);
+	stream->rtmp.m_sb.sb_socket = -1;
+	stream->write_buf_len = 0;
+	os_event_signal(stream->buffer_space_available_event);
+}
+
+void socket_thread_linux_signal(struct rtmp_stream *stream)
+{
+	uint64_t val = 1;
+
+	if (write(stream->socket_wake_fd, &val, sizeof(val)) < 0 &&
+	    errno != EAGAIN)
+		blog(LOG_WARNING,
+		     "socket_thread_linux: Failed to signal "
+		     "socket thread, errno %d",
+		     errno);
+}
+
+static void set_notsent_lowat(struct rtmp_stream *stream)
+{
+	int lowat = (int)(stream->write_buf_size / NOTSENT_LOWAT_DIVISOR);
+
+	if (lowat < MIN_NOTSENT_LOWAT)
+		lowat = MIN_NOTSENT_LOWAT;
+
+	/* with the kernel only accepting data once its unsent queue is
+	 * nearly empty, the backlog stays in the write buffer where
+	 * congestion detection can see it */
+	if (setsockopt(stream->rtmp.m_sb.sb_socket, IPPROTO_TCP,
+		       TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) != 0) {
+		blog(LOG_WARNING,
+		     "socket_thread_linux: Failed to set "
+		     "TCP_NOTSENT_LOWAT, errno %d",
+		     errno);
+		return;
+	}
+
+	blog(LOG_INFO, "socket_thread_linux: Unsent data limited to %d bytes",
+	     lowat);
+}
+
+static void update_kernel_queue(struct rtmp_stream *stream, long *peak)
+{
+	int unsent = 0;
+
+	if (ioctl(stream->rtmp.m_sb.sb_socket, SIOCOUTQNSD, &unsent) != 0)
+		return;
+
+	os_atomic_set_long(&stream->socket_unsent_bytes, unsent);
+	if (unsent > *peak)
+		*peak = unsent;
+}
+
+static bool socket_event(struct rtmp_stream *stream, uint32_t events,
+			 bool *can_write, uint64_t last_send_time)
+{
+	if (events & EPOLLOUT)
+		*can_write = true;
+
+	if (events & EPOLLIN) {
+		char discard[16384];
+
+		for (;;) {
+			ssize_t ret = recv(stream->rtmp.m_sb.sb_socket,
+					   discard, sizeof(discard), 0);
+			if (ret > 0)
+				continue;
+			if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+				break;
+
+			blog(LOG_ERROR,
+			     "socket_thread_linux: "
+			     "Socket error, recv() returned "
+			     "%zd, errno %d",
+			     ret, ret < 0 ? errno : 0);
+			stream->rtmp.last_error_code = ret < 0 ? errno : 0;
+			fatal_sock_shutdown(stream);
+			return false;
+		}
+	}
+
+	if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+		int err_code = 0;
+		socklen_t size = sizeof(err_code);
+
+		getsockopt(stream->rtmp.m_sb.sb_socket, SOL_SOCKET, SO_ERROR,
+			   &err_code, &size);
+
+		if (last_send_time) {
+			uint32_t diff =
+				(os_gettime_ns() / 1000000) - last_send_time;
+
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Connection "
+			     "closed, %u ms since last send "
+			     "(buffer: %zu / %zu)",
+			     diff, stream->write_buf_len,
+			     stream->write_buf_size);
+		}
+
+		if (os_event_try(stream->stop_event) != EAGAIN)
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Aborting due "
+			     "to connection close during shutdown, "
+			     "%zu bytes lost, error %d",
+			     stream->write_buf_len, err_code);
+		else
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Aborting due "
+			     "to connection close, error %d",
+			     err_code);
+
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return false;
+	}
+
+	return true;
+}
+
+enum data_ret { RET_BREAK, RET_FATAL, RET_CONTINUE };
+
+static enum data_ret write_data(struct rtmp_stream *stream, bool *can_write,
+				uint64_t *last_send_time,
+				size_t latency_packet_size, int delay_time)
+{
+	size_t sent = 0;
+	int err_code = 0;
+	bool fatal_err = false;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	/* send as much as the socket takes, then move the remaining data
+	 * to the front of the buffer once */
+	while (sent < stream->write_buf_len) {
+		size_t send_len = stream->write_buf_len - sent;
+		int ret;
+
+		if (stream->low_latency_mode && send_len > latency_packet_size)
+			send_len = latency_packet_size;
+
+		ret = RTMPSockBuf_Send(&stream->rtmp.m_sb,
+				       (const char *)stream->write_buf + sent,
+				       (int)send_len);
+
+		if (ret > 0) {
+			sent += (size_t)ret;
+
+			if (stream->low_latency_mode)
+				break;
+			continue;
+		}
+
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0 && errno == EAGAIN) {
+			*can_write = false;
+			break;
+		}
+
+		/* connection closed, or connection was aborted / socket
+		 * closed / etc, that's a fatal error. */
+		err_code = ret < 0 ? errno : 0;
+		fatal_err = true;
+		break;
+	}
+
+	if (fatal_err) {
+		blog(LOG_ERROR,
+		     "socket_thread_linux: "
+		     "Socket error, send() failed, errno %d",
+		     err_code);
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return RET_FATAL;
+	}
+
+	if (sent) {
+		if (stream->write_buf_len - sent)
+			memmove(stream->write_buf, stream->write_buf + sent,
+				stream->write_buf_len - sent);
+		stream->write_buf_len -= sent;
+
+		*last_send_time = os_gettime_ns() / 1000000;
+
+		os_event_signal(stream->buffer_space_available_event);
+	}
+
+	bool done = !*can_write || !stream->write_buf_len;
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+
+	if (done)
+		return RET_BREAK;
+
+	if (delay_time)
+		os_sleep_ms(delay_time);
+
+	return RET_CONTINUE;
+}
+
+#define LATENCY_FACTOR 20
+#define MAX_EVENTS 2
+
+static inline void socket_thread_linux_internal(struct rtmp_stream *stream)
+{
+	bool can_write = false;
+
+	int delay_time;
+	size_t latency_packet_size;
+	uint64_t last_send_time = 0;
+	long peak_unsent = 0;
+
+	struct epoll_event ev = {0};
+	struct epoll_event events[MAX_EVENTS];
+	int epoll_fd;
+
+	os_set_thread_name("rtmp-stream: socket_thread");
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Aborting due to "
+		     "epoll_create1 failure, errno %d",
+		     errno);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	/* edge triggered, so that EPOLLOUT only reports the socket becoming
+	 * writable again after a send would have blocked */
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.fd = stream->rtmp.m_sb.sb_socket;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev) != 0)
+		goto epoll_fail;
+
+	ev.events = EPOLLIN;
+	ev.data.fd = stream->socket_wake_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev) != 0)
+		goto epoll_fail;
+
+	if (stream->low_latency_mode) {
+		delay_time = 1000 / LATENCY_FACTOR;
+		latency_packet_size =
+			stream->write_buf_size / (LATENCY_FACTOR - 2);
+	} else {
+		latency_packet_size = stream->write_buf_size;
+		delay_time = 0;
+	}
+
+	if (!stream->disable_send_window_optimization) {
+		set_notsent_lowat(stream);
+	} else {
+		blog(LOG_INFO, "socket_thread_linux: Send window "
+			       "optimization disabled by user.");
+	}
+
+	for (;;) {
+		if (os_event_try(stream->send_thread_signaled_exit) != EAGAIN) {
+			pthread_mutex_lock(&stream->write_buf_mutex);
+			if (stream->write_buf_len == 0) {
+				pthread_mutex_unlock(&stream->write_buf_mutex);
+				os_event_reset(
+					stream->send_thread_signaled_exit);
+				break;
+			}
+
+			pthread_mutex_unlock(&stream->write_buf_mutex);
+		}
+
+		int count = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+
+			blog(LOG_ERROR,
+			     "socket_thread_linux: Aborting due "
+			     "to epoll_wait failure, errno %d",
+			     errno);
+			fatal_sock_shutdown(stream);
+			goto exit;
+		}
+
+		for (int i = 0; i < count; i++) {
+			if (events[i].data.fd == stream->socket_wake_fd) {
+				uint64_t val;
+				if (read(stream->socket_wake_fd, &val,
+					 sizeof(val)) < 0 &&
+				    errno != EAGAIN)
+					blog(LOG_WARNING,
+					     "socket_thread_linux: Failed "
+					     "to read wake event, errno %d",
+					     errno);
+				continue;
+			}
+
+			if (!socket_event(stream, events[i].events,
+					  &can_write, last_send_time))
+				goto exit;
+		}
+
+		if (can_write) {
+			for (;;) {
+				enum data_ret ret = write_data(
+					stream, &can_write, &last_send_time,
+					latency_packet_size, delay_time);
+
+				switch (ret) {
+				case RET_BREAK:
+					goto exit_write_loop;
+				case RET_FATAL:
+					goto exit;
+				case RET_CONTINUE:;
+				}
+			}
+		}
+	exit_write_loop:
+		update_kernel_queue(stream, &peak_unsent);
+
+		if (stream->dbr_enabled)
+			dbr_sample_socket(stream);
+	}
+
+	blog(LOG_INFO,
+	     "socket_thread_linux: Normal exit, "
+	     "peak unsent kernel queue %ld bytes",
+	     peak_unsent);
+
+exit:
+	os_atomic_set_long(&stream->socket_unsent_bytes, 0);
+	close(epoll_fd);
+	return;
+
+epoll_fail:
+	blog(LOG_ERROR,
+	     "socket_thread_linux: Aborting due to "
+	     "epoll_ctl failure, errno %d",
+	     errno);
+	fatal_sock_shutdown(stream);
+	close(epoll_fd);
+}
+
+void *socket_thread_linux(void *data)
+{
+	struct rtmp_stream *stream = data;
+	socket_thread_linux_internal(stream);
+	return NULL;
+}
+#endif
@@ -0,0 +1,984 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Streams the same encoders to several RTMP servers.
+ *
+ *   Each packet is parsed and muxed into an FLV tag header once, and the
+ * resulting tag is shared by reference between the destinations.  Every
+ * destination has its own queue of tags and its own thread, which sends the
+ * tag header and the packet data straight from the shared tag.  Frame
+ * dropping and reconnecting happen per destination, so a slow or failing
+ * server doesn't affect the others.
+ *
+ *   The destinations are set with the "destinations" array setting, each
+ * item holding "server", "key" and optionally "username" and "password".
+ */
+
+#include <obs-module.h>
+#include <obs-avc.h>
+#ifdef ENABLE_HEVC
+#include <obs-hevc.h>
+#include "rtmp-hevc.h"
+#endif
+#include <util/platform.h>
+#include <util/darray.h>
+#include <util/deque.h>
+#include <util/dstr.h>
+#include <util/threading.h>
+#include "librtmp/rtmp.h"
+#include "rtmp-av1.h"
+#include "flv-mux.h"
+
+#define do_log(level, format, ...)                      \
+	blog(level, "[rtmp multi stream: '%s'] " format, \
+	     obs_output_get_name(multi->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+#define OPT_DESTINATIONS "destinations"
+#define OPT_DROP_THRESHOLD "drop_threshold_ms"
+#define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
+#define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
+
+#define RETRY_MIN_MSEC 2000
+#define RETRY_MAX_MSEC 30000
+
+/* an FLV tag shared between all destinations */
+struct multi_tag {
+	volatile long refs;
+	struct encoder_packet packet;
+	struct flv_tag flv;
+};
+
+struct multi_dest {
+	struct rtmp_multi *multi;
+	size_t idx;
+
+	struct dstr path;
+	struct dstr key;
+	struct dstr username;
+	struct dstr password;
+
+	RTMP rtmp;
+	pthread_t thread;
+	bool thread_active;
+
+	/* protects everything below, shared with the data thread */
+	pthread_mutex_t mutex;
+	os_sem_t *send_sem;
+	struct deque tags;
+	bool connected;
+	bool wait_keyframe;
+	int min_priority;
+	float congestion;
+
+	bool sent_headers;
+	uint64_t total_bytes_sent;
+	int dropped_frames;
+	int reconnects;
+};
+
+struct multi_headers {
+	uint8_t *meta;
+	size_t meta_size;
+	uint8_t *audio;
+	size_t audio_size;
+	uint8_t *video;
+	size_t video_size;
+	uint8_t *video_end;
+	size_t video_end_size;
+};
+
+struct rtmp_multi {
+	obs_output_t *output;
+
+	DARRAY(struct multi_dest *) dests;
+	volatile long running_dests;
+
+	volatile bool active;
+	volatile bool closing;
+	volatile bool encode_error;
+	os_event_t *stop_event;
+	uint64_t stop_ts;
+	uint64_t shutdown_timeout_ts;
+	int max_shutdown_time_sec;
+
+	enum video_id_t video_codec;
+	bool got_first_video;
+	int32_t start_dts_offset;
+	struct multi_headers headers;
+
+	int64_t drop_threshold_usec;
+	int64_t pframe_drop_threshold_usec;
+	char *dest_url;
+};
+
+static const char *rtmp_multi_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("RTMPMultiStream");
+}
+
+static inline bool active(struct rtmp_multi *multi)
+{
+	return os_atomic_load_bool(&multi->active);
+}
+
+static inline bool stop_requested(struct rtmp_multi *multi)
+{
+	return os_event_try(multi->stop_event) != EAGAIN;
+}
+
+static inline void tag_release(struct multi_tag *tag)
+{
+	if (os_atomic_dec_long(&tag->refs) == 0) {
+		obs_encoder_packet_release(&tag->packet);
+		bfree(tag);
+	}
+}
+
+static void free_tags(struct multi_dest *dest)
+{
+	while (dest->tags.size) {
+		struct multi_tag *tag;
+		deque_pop_front(&dest->tags, &tag, sizeof(tag));
+		tag_release(tag);
+	}
+}
+
+static void free_headers(struct multi_headers *headers)
+{
+	bfree(headers->meta);
+	bfree(headers->audio);
+	bfree(headers->video);
+	bfree(headers->video_end);
+	memset(headers, 0, sizeof(*headers));
+}
+
+static void free_dests(struct rtmp_multi *multi)
+{
+	for (size_t i = 0; i < multi->dests.num; i++) {
+		struct multi_dest *dest = multi->dests.array[i];
+
+		if (dest->thread_active)
+			pthread_join(dest->thread, NULL);
+
+		free_tags(dest);
+		deque_free(&dest->tags);
+		os_sem_destroy(dest->send_sem);
+		pthread_mutex_destroy(&dest->mutex);
+		RTMP_TLS_Free(&dest->rtmp);
+		dstr_free(&dest->path);
+		dstr_free(&dest->key);
+		dstr_free(&dest->username);
+		dstr_free(&dest->password);
+		bfree(dest);
+	}
+
+	da_free(multi->dests);
+}
+
+static void rtmp_multi_destroy(void *data)
+{
+	struct rtmp_multi *multi = data;
+
+	free_dests(multi);
+	free_headers(&multi->headers);
+	os_event_destroy(multi->stop_event);
+	bfree(multi->dest_url);
+	bfree(multi);
+}
+
+static void get_destination_count_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_multi *multi = data;
+	calldata_set_int(cd, "count", (long long)multi->dests.num);
+}
+
+static void get_destination_stats_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_multi *multi = data;
+	long long idx = calldata_int(cd, "index");
+	struct multi_dest *dest;
+
+	if (idx < 0 || (size_t)idx >= multi->dests.num)
+		return;
+
+	dest = multi->dests.array[idx];
+
+	pthread_mutex_lock(&dest->mutex);
+	calldata_set_string(cd, "url", dest->path.array);
+	calldata_set_bool(cd, "connected", dest->connected);
+	calldata_set_int(cd, "total_bytes", (long long)dest->total_bytes_sent);
+	calldata_set_int(cd, "dropped_frames", dest->dropped_frames);
+	calldata_set_int(cd, "reconnects", dest->reconnects);
+	calldata_set_float(cd, "congestion", dest->congestion);
+	pthread_mutex_unlock(&dest->mutex);
+}
+
+static void *rtmp_multi_create(obs_data_t *settings, obs_output_t *output)
+{
+	struct rtmp_multi *multi = bzalloc(sizeof(struct rtmp_multi));
+	multi->output = output;
+
+	if (os_event_init(&multi->stop_event, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail;
+
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph, "void get_destination_count(out int count)",
+			 get_destination_count_proc, multi);
+	proc_handler_add(ph,
+			 "void get_destination_stats(in int index, "
+			 "out string url, out bool connected, "
+			 "out int total_bytes, out int dropped_frames, "
+			 "out int reconnects, out float congestion)",
+			 get_destination_stats_proc, multi);
+
+	UNUSED_PARAMETER(settings);
+	return multi;
+
+fail:
+	rtmp_multi_destroy(multi);
+	return NULL;
+}
+
+static inline void set_rtmp_dstr(AVal *val, struct dstr *str)
+{
+	bool valid = !dstr_is_empty(str);
+	val->av_val = valid ? str->array : NULL;
+	val->av_len = valid ? (int)str->len : 0;
+}
+
+static bool send_buffer(struct multi_dest *dest, const uint8_t *data,
+			size_t size)
+{
+	if (!data)
+		return true;
+	if (RTMP_Write(&dest->rtmp, (const char *)data, (int)size, 0) < 0)
+		return false;
+
+	dest->total_bytes_sent += size;
+	return true;
+}
+
+static bool send_tag(struct multi_dest *dest, struct multi_tag *tag)
+{
+	RTMPIOVec iov[2];
+
+	iov[0].iv_base = (const char *)tag->flv.header;
+	iov[0].iv_len = (int)tag->flv.header_size;
+	iov[1].iv_base = (const char *)tag->flv.data;
+	iov[1].iv_len = (int)tag->flv.size;
+
+	if (RTMP_WriteV(&dest->rtmp, iov, 2, 0) < 0)
+		return false;
+
+	/* counted like a full FLV tag, including the previous tag size */
+	dest->total_bytes_sent += tag->flv.header_size + tag->flv.size + 4;
+	return true;
+}
+
+static bool send_headers(struct multi_dest *dest)
+{
+	struct multi_headers *headers = &dest->multi->headers;
+
+	dest->sent_headers = true;
+	return send_buffer(dest, headers->meta, headers->meta_size) &&
+	       send_buffer(dest, headers->audio, headers->audio_size) &&
+	       send_buffer(dest, headers->video, headers->video_size);
+}
+
+static bool dest_connect(struct multi_dest *dest)
+{
+	struct rtmp_multi *multi = dest->multi;
+
+	info("Connecting destination %zu to %s...", dest->idx,
+	     dest->path.array);
+
+	RTMP_TLS_Free(&dest->rtmp);
+	RTMP_Init(&dest->rtmp);
+
+	if (!RTMP_SetupURL(&dest->rtmp, dest->path.array)) {
+		warn("Destination %zu has an invalid URL", dest->idx);
+		return false;
+	}
+
+	RTMP_EnableWrite(&dest->rtmp);
+
+	set_rtmp_dstr(&dest->rtmp.Link.pubUser, &dest->username);
+	set_rtmp_dstr(&dest->rtmp.Link.pubPasswd, &dest->password);
+	dest->rtmp.Link.flashVer.av_val = "FMLE/3.0 (compatible; FMSc/1.0)";
+	dest->rtmp.Link.flashVer.av_len =
+		(int)strlen(dest->rtmp.Link.flashVer.av_val);
+	dest->rtmp.Link.swfUrl = dest->rtmp.Link.tcUrl;
+
+	RTMP_AddStream(&dest->rtmp, dest->key.array);
+
+	dest->rtmp.m_outChunkSize = 4096;
+	dest->rtmp.m_bSendChunkSizeInfo = true;
+	dest->rtmp.m_bUseNagle = true;
+
+	if (!RTMP_Connect(&dest->rtmp, NULL)) {
+		warn("Destination %zu failed to connect, error %d", dest->idx,
+		     dest->rtmp.last_error_code);
+		return false;
+	}
+
+	if (!RTMP_ConnectStream(&dest->rtmp, 0)) {
+		warn("Destination %zu failed to publish", dest->idx);
+		RTMP_Close(&dest->rtmp);
+		return false;
+	}
+
+	info("Destination %zu connected", dest->idx);
+
+	/* start with a keyframe, the data that was queued for the previous
+	 * connection is discarded */
+	pthread_mutex_lock(&dest->mutex);
+	free_tags(dest);
+	dest->connected = true;
+	dest->wait_keyframe = true;
+	dest->min_priority = 0;
+	dest->congestion = 0.0f;
+	pthread_mutex_unlock(&dest->mutex);
+
+	dest->sent_headers = false;
+	return true;
+}
+
+static void dest_disconnect(struct multi_dest *dest)
+{
+	pthread_mutex_lock(&dest->mutex);
+	dest->connected = false;
+	free_tags(dest);
+	pthread_mutex_unlock(&dest->mutex);
+
+	RTMP_Close(&dest->rtmp);
+}
+
+static inline bool shutdown_timed_out(struct rtmp_multi *multi)
+{
+	return os_atomic_load_bool(&multi->closing) &&
+	       os_gettime_ns() >= multi->shutdown_timeout_ts;
+}
+
+/* returns false when the connection failed */
+static bool dest_send_loop(struct multi_dest *dest)
+{
+	struct rtmp_multi *multi = dest->multi;
+
+	while (os_sem_wait(dest->send_sem) == 0) {
+		struct multi_tag *tag = NULL;
+		bool success;
+
+		if (stop_requested(multi) || shutdown_timed_out(multi))
+			return true;
+
+		pthread_mutex_lock(&dest->mutex);
+		if (dest->tags.size)
+			deque_pop_front(&dest->tags, &tag, sizeof(tag));
+		pthread_mutex_unlock(&dest->mutex);
+
+		if (!tag) {
+			if (!os_atomic_load_bool(&multi->closing))
+				continue;
+
+			return send_buffer(dest, multi->headers.video_end,
+					   multi->headers.video_end_size);
+		}
+
+		success = (dest->sent_headers || send_headers(dest)) &&
+			  send_tag(dest, tag);
+		tag_release(tag);
+
+		if (!success) {
+			warn("Destination %zu disconnected", dest->idx);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void finish(struct rtmp_multi *multi)
+{
+	os_atomic_set_bool(&multi->active, false);
+
+	if (os_atomic_load_bool(&multi->encode_error))
+		obs_output_signal_stop(multi->output, OBS_OUTPUT_ENCODE_ERROR);
+	else
+		obs_output_end_data_capture(multi->output);
+}
+
+/* returns false if the output stopped while waiting */
+static bool wait_to_retry(struct rtmp_multi *multi, uint32_t msec)
+{
+	for (uint32_t waited = 0; waited < msec; waited += 100) {
+		if (os_event_timedwait(multi->stop_event, 100) == 0 ||
+		    os_atomic_load_bool(&multi->closing))
+			return false;
+	}
+
+	return true;
+}
+
+static void *dest_thread(void *data)
+{
+	struct multi_dest *dest = data;
+	struct rtmp_multi *multi = dest->multi;
+	uint32_t retry_msec = 0;
+
+	os_set_thread_name("rtmp-multi: dest_thread");
+
+	while (!stop_requested(multi) &&
+	       !os_atomic_load_bool(&multi->closing)) {
+		if (retry_msec) {
+			if (!wait_to_retry(multi, retry_msec))
+				break;
+
+			pthread_mutex_lock(&dest->mutex);
+			dest->reconnects++;
+			pthread_mutex_unlock(&dest->mutex);
+		}
+
+		if (!dest_connect(dest)) {
+			retry_msec = retry_msec ? retry_msec * 2
+						: RETRY_MIN_MSEC;
+			if (retry_msec > RETRY_MAX_MSEC)
+				retry_msec = RETRY_MAX_MSEC;
+			continue;
+		}
+
+		retry_msec = dest_send_loop(dest) ? 0 : RETRY_MIN_MSEC;
+		dest_disconnect(dest);
+	}
+
+	if (os_atomic_dec_long(&multi->running_dests) == 0)
+		finish(multi);
+	return NULL;
+}
+
+static bool add_dest(struct rtmp_multi *multi, obs_data_t *item)
+{
+	struct multi_dest *dest = bzalloc(sizeof(*dest));
+	dest->multi = multi;
+	dest->idx = multi->dests.num;
+	pthread_mutex_init_value(&dest->mutex);
+
+	dstr_copy(&dest->path, obs_data_get_string(item, "server"));
+	dstr_copy(&dest->key, obs_data_get_string(item, "key"));
+	dstr_copy(&dest->username, obs_data_get_string(item, "username"));
+	dstr_copy(&dest->password, obs_data_get_string(item, "password"));
+	dstr_depad(&dest->path);
+	dstr_depad(&dest->key);
+
+	da_push_back(multi->dests, &dest);
+
+	if (pthread_mutex_init(&dest->mutex, NULL) != 0)
+		return false;
+	if (os_sem_init(&dest->send_sem, 0) != 0)
+		return false;
+
+	if (dstr_is_empty(&dest->path)) {
+		warn("Destination %zu has no URL", dest->idx);
+		return false;
+	}
+
+	return true;
+}
+
+static bool init_dests(struct rtmp_multi *multi, obs_data_t *settings)
+{
+	obs_data_array_t *array =
+		obs_data_get_array(settings, OPT_DESTINATIONS);
+	size_t count = obs_data_array_count(array);
+	bool success = count > 0;
+
+	for (size_t i = 0; success && i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		success = add_dest(multi, item);
+		obs_data_release(item);
+	}
+
+	obs_data_array_release(array);
+
+	if (!count)
+		warn("No destinations");
+	return success;
+}
+
+static bool rtmp_multi_start(void *data)
+{
+	struct rtmp_multi *multi = data;
+	obs_data_t *settings;
+	obs_encoder_t *venc;
+	int64_t drop_b, drop_p;
+	bool success;
+
+	if (!obs_output_can_begin_data_capture(multi->output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(multi->output, 0))
+		return false;
+
+	free_dests(multi);
+	free_headers(&multi->headers);
+	os_event_reset(multi->stop_event);
+	os_atomic_set_bool(&multi->closing, false);
+	os_atomic_set_bool(&multi->encode_error, false);
+	multi->got_first_video = false;
+	multi->stop_ts = 0;
+
+	venc = obs_output_get_video_encoder(multi->output);
+	multi->video_codec = to_video_type(obs_encoder_get_codec(venc));
+
+	settings = obs_output_get_settings(multi->output);
+	drop_b = (int64_t)obs_data_get_int(settings, OPT_DROP_THRESHOLD);
+	drop_p = (int64_t)obs_data_get_int(settings, OPT_PFRAME_DROP_THRESHOLD);
+	multi->max_shutdown_time_sec =
+		(int)obs_data_get_int(settings, OPT_MAX_SHUTDOWN_TIME_SEC);
+	success = init_dests(multi, settings);
+	obs_data_release(settings);
+
+	if (!success) {
+		obs_output_set_last_error(multi->output,
+					  obs_module_text("InvalidParameter"));
+		free_dests(multi);
+		return false;
+	}
+
+	if (drop_p < (drop_b + 200))
+		drop_p = drop_b + 200;
+
+	multi->drop_threshold_usec = 1000 * drop_b;
+	multi->pframe_drop_threshold_usec = 1000 * drop_p;
+
+	os_atomic_set_long(&multi->running_dests, (long)multi->dests.num);
+	os_atomic_set_bool(&multi->active, true);
+
+	for (size_t i = 0; i < multi->dests.num; i++) {
+		struct multi_dest *dest = multi->dests.array[i];
+
+		if (pthread_create(&dest->thread, NULL, dest_thread, dest) !=
+		    0) {
+			warn("Failed to create thread for destination %zu", i);
+			os_atomic_dec_long(&multi->running_dests);
+			continue;
+		}
+
+		dest->thread_active = true;
+	}
+
+	if (!os_atomic_load_long(&multi->running_dests)) {
+		os_atomic_set_bool(&multi->active, false);
+		return false;
+	}
+
+	info("Streaming to %zu destinations", multi->dests.num);
+	obs_output_begin_data_capture(multi->output, 0);
+	return true;
+}
+
+static void post_all(struct rtmp_multi *multi)
+{
+	for (size_t i = 0; i < multi->dests.num; i++)
+		os_sem_post(multi->dests.array[i]->send_sem);
+}
+
+static void rtmp_multi_stop(void *data, uint64_t ts)
+{
+	struct rtmp_multi *multi = data;
+
+	if (!active(multi)) {
+		obs_output_signal_stop(multi->output, OBS_OUTPUT_SUCCESS);
+		return;
+	}
+
+	if (ts == 0) {
+		os_event_signal(multi->stop_event);
+		post_all(multi);
+		return;
+	}
+
+	/* the destinations are closed once the packets up to the stop
+	 * timestamp have been queued */
+	multi->stop_ts = ts / 1000ULL;
+	multi->shutdown_timeout_ts =
+		ts + (uint64_t)multi->max_shutdown_time_sec * 1000000000ULL;
+}
+
+static bool build_video_header(struct rtmp_multi *multi)
+{
+	obs_encoder_t *vencoder = obs_output_get_video_encoder(multi->output);
+	struct multi_headers *headers = &multi->headers;
+	struct encoder_packet packet = {.type = OBS_ENCODER_VIDEO,
+					.timebase_den = 1,
+					.keyframe = true};
+	uint8_t *header;
+	size_t size;
+
+	if (!obs_encoder_get_extra_data(vencoder, &header, &size))
+		return false;
+
+	switch (multi->video_codec) {
+	case CODEC_NONE:
+		return false;
+	case CODEC_H264:
+		packet.size = obs_parse_avc_header(&packet.data, header, size);
+		flv_packet_mux(&packet, 0, &headers->video,
+			       &headers->video_size, true);
+		bfree(packet.data);
+		return true;
+	case CODEC_HEVC:
+#ifdef ENABLE_HEVC
+		packet.size = obs_parse_hevc_header(&packet.data, header, size);
+		break;
+#else
+		return false;
+#endif
+	case CODEC_AV1:
+		packet.size = obs_parse_av1_header(&packet.data, header, size);
+		break;
+	}
+
+	flv_packet_start(&packet, multi->video_codec, &headers->video,
+			 &headers->video_size, 0);
+	bfree(packet.data);
+
+	packet.data = NULL;
+	packet.size = 0;
+	packet.keyframe = false;
+	flv_packet_end(&packet, multi->video_codec, &headers->video_end,
+		       &headers->video_end_size, 0);
+	return true;
+}
+
+/* the headers are muxed once and sent to each destination as it connects */
+static bool build_headers(struct rtmp_multi *multi)
+{
+	obs_encoder_t *aencoder =
+		obs_output_get_audio_encoder(multi->output, 0);
+	struct multi_headers *headers = &multi->headers;
+
+	flv_meta_data(multi->output, &headers->meta, &headers->meta_size,
+		      false);
+
+	if (aencoder) {
+		struct encoder_packet packet = {.type = OBS_ENCODER_AUDIO,
+						.timebase_den = 1};
+
+		if (!obs_encoder_get_extra_data(aencoder, &packet.data,
+						&packet.size))
+			return false;
+
+		flv_packet_mux(&packet, 0, &headers->audio,
+			       &headers->audio_size, true);
+	}
+
+	return build_video_header(multi);
+}
+
+static struct multi_tag *mux_tag(struct rtmp_multi *multi,
+				 struct encoder_packet *packet)
+{
+	struct multi_tag *tag = bzalloc(sizeof(*tag));
+	tag->refs = 1;
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		switch (multi->video_codec) {
+		case CODEC_NONE:
+			break;
+		case CODEC_H264:
+			obs_parse_avc_packet(&tag->packet, packet);
+			break;
+		case CODEC_HEVC:
+#ifdef ENABLE_HEVC
+			obs_parse_hevc_packet(&tag->packet, packet);
+#endif
+			break;
+		case CODEC_AV1:
+			obs_parse_av1_packet(&tag->packet, packet);
+			break;
+		}
+	} else {
+		obs_encoder_packet_ref(&tag->packet, packet);
+	}
+
+	if (packet->type == OBS_ENCODER_VIDEO &&
+	    multi->video_codec != CODEC_H264)
+		flv_packet_frames_tag(&tag->packet, multi->video_codec,
+				      multi->start_dts_offset, &tag->flv, 0);
+	else
+		flv_packet_mux_tag(&tag->packet, multi->start_dts_offset,
+				   &tag->flv, false);
+
+	if (!tag->flv.header_size) {
+		tag_release(tag);
+		return NULL;
+	}
+
+	return tag;
+}
+
+static void drop_frames(struct multi_dest *dest, int highest_priority)
+{
+	struct deque new_buf = {0};
+	int num_frames_dropped = 0;
+
+	while (dest->tags.size) {
+		struct multi_tag *tag;
+		deque_pop_front(&dest->tags, &tag, sizeof(tag));
+
+		/* do not drop audio data or video keyframes */
+		if (tag->packet.type == OBS_ENCODER_AUDIO ||
+		    tag->packet.drop_priority >= highest_priority) {
+			deque_push_back(&new_buf, &tag, sizeof(tag));
+		} else {
+			num_frames_dropped++;
+			tag_release(tag);
+		}
+	}
+
+	deque_free(&dest->tags);
+	dest->tags = new_buf;
+
+	if (dest->min_priority < highest_priority)
+		dest->min_priority = highest_priority;
+
+	dest->dropped_frames += num_frames_dropped;
+}
+
+static int64_t buffer_duration_usec(struct multi_dest *dest,
+				    struct multi_tag *last)
+{
+	size_t count = dest->tags.size / sizeof(last);
+
+	for (size_t i = 0; i < count; i++) {
+		struct multi_tag **cur =
+			deque_data(&dest->tags, i * sizeof(last));
+		struct encoder_packet *packet = &(*cur)->packet;
+
+		if (packet->type == OBS_ENCODER_VIDEO && !packet->keyframe)
+			return last->packet.dts_usec - packet->dts_usec;
+	}
+
+	return 0;
+}
+
+static void check_to_drop_frames(struct rtmp_multi *multi,
+				 struct multi_dest *dest,
+				 struct multi_tag *last)
+{
+	int64_t duration = buffer_duration_usec(dest, last);
+
+	dest->congestion =
+		(float)duration / (float)multi->drop_threshold_usec;
+
+	if (duration > multi->pframe_drop_threshold_usec)
+		drop_frames(dest, OBS_NAL_PRIORITY_HIGHEST);
+	else if (duration > multi->drop_threshold_usec)
+		drop_frames(dest, OBS_NAL_PRIORITY_HIGH);
+}
+
+/* returns true if the destination took a reference to the tag */
+static bool dest_add_tag(struct rtmp_multi *multi, struct multi_dest *dest,
+			 struct multi_tag *tag)
+{
+	struct encoder_packet *packet = &tag->packet;
+
+	if (!dest->connected)
+		return false;
+
+	if (packet->type == OBS_ENCODER_VIDEO) {
+		if (dest->wait_keyframe) {
+			if (!packet->keyframe)
+				return false;
+			dest->wait_keyframe = false;
+		}
+
+		check_to_drop_frames(multi, dest, tag);
+
+		/* if currently dropping frames, drop packets until it
+		 * reaches the desired priority */
+		if (packet->drop_priority < dest->min_priority) {
+			dest->dropped_frames++;
+			return false;
+		}
+
+		dest->min_priority = 0;
+
+	} else if (dest->wait_keyframe) {
+		return false;
+	}
+
+	os_atomic_inc_long(&tag->refs);
+	deque_push_back(&dest->tags, &tag, sizeof(tag));
+	return true;
+}
+
+static void begin_closing(struct rtmp_multi *multi)
+{
+	if (os_atomic_exchange_bool(&multi->closing, true))
+		return;
+
+	info("Stopping, sending the remaining data");
+	post_all(multi);
+}
+
+static void rtmp_multi_data(void *data, struct encoder_packet *packet)
+{
+	struct rtmp_multi *multi = data;
+	struct multi_tag *tag;
+
+	if (!active(multi) || os_atomic_load_bool(&multi->closing))
+		return;
+
+	/* encoder fail */
+	if (!packet) {
+		os_atomic_set_bool(&multi->encode_error, true);
+		os_event_signal(multi->stop_event);
+		post_all(multi);
+		return;
+	}
+
+	if (multi->stop_ts && packet->sys_dts_usec >= (int64_t)multi->stop_ts) {
+		begin_closing(multi);
+		return;
+	}
+
+	if (packet->type == OBS_ENCODER_VIDEO && !multi->got_first_video) {
+		if (!build_headers(multi)) {
+			warn("Failed to get the encoder headers");
+			os_atomic_set_bool(&multi->encode_error, true);
+			os_event_signal(multi->stop_event);
+			post_all(multi);
+			return;
+		}
+
+		multi->start_dts_offset = get_ms_time(packet, packet->dts);
+		multi->got_first_video = true;
+	}
+
+	/* nothing is sent before the first video packet */
+	if (!multi->got_first_video)
+		return;
+
+	tag = mux_tag(multi, packet);
+	if (!tag)
+		return;
+
+	for (size_t i = 0; i < multi->dests.num; i++) {
+		struct multi_dest *dest = multi->dests.array[i];
+		bool added;
+
+		pthread_mutex_lock(&dest->mutex);
+		added = dest_add_tag(multi, dest, tag);
+		pthread_mutex_unlock(&dest->mutex);
+
+		if (added)
+			os_sem_post(dest->send_sem);
+	}
+
+	tag_release(tag);
+}
+
+static void rtmp_multi_defaults(obs_data_t *defaults)
+{
+	obs_data_set_default_int(defaults, OPT_DROP_THRESHOLD, 700);
+	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
+	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
+}
+
+static obs_properties_t *rtmp_multi_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+	obs_property_t *p;
+
+	p = obs_properties_add_int(props, OPT_DROP_THRESHOLD,
+				   obs_module_text("RTMPStream.DropThreshold"),
+				   200, 10000, 100);
+	obs_property_int_set_suffix(p, " ms");
+
+	return props;
+}
+
+static uint64_t rtmp_multi_total_bytes_sent(void *data)
+{
+	struct rtmp_multi *multi = data;
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < multi->dests.num; i++)
+		total += multi->dests.array[i]->total_bytes_sent;
+	return total;
+}
+
+static int rtmp_multi_dropped_frames(void *data)
+{
+	struct rtmp_multi *multi = data;
+	int dropped = 0;
+
+	for (size_t i = 0; i < multi->dests.num; i++)
+		dropped += multi->dests.array[i]->dropped_frames;
+	return dropped;
+}
+
+/* the most congested destination */
+static float rtmp_multi_congestion(void *data)
+{
+	struct rtmp_multi *multi = data;
+	float congestion = 0.0f;
+
+	for (size_t i = 0; i < multi->dests.num; i++) {
+		struct multi_dest *dest = multi->dests.array[i];
+		float val = dest->min_priority > 0 ? 1.0f : dest->congestion;
+
+		if (val > congestion)
+			congestion = val;
+	}
+
+	return congestion;
+}
+
+struct obs_output_info rtmp_multi_output_info = {
+	.id = "rtmp_multi_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED,
+#ifdef NO_CRYPTO
+	.protocols = "RTMP",
+#else
+	.protocols = "RTMP;RTMPS",
+#endif
+#ifdef ENABLE_HEVC
+	.encoded_video_codecs = "h264;hevc;av1",
+#else
+	.encoded_video_codecs = "h264;av1",
+#endif
+	.encoded_audio_codecs = "aac",
+	.get_name = rtmp_multi_getname,
+	.create = rtmp_multi_create,
+	.destroy = rtmp_multi_destroy,
+	.start = rtmp_multi_start,
+	.stop = rtmp_multi_stop,
+	.encoded_packet = rtmp_multi_data,
+	.get_defaults = rtmp_multi_defaults,
+	.get_properties = rtmp_multi_properties,
+	.get_total_bytes = rtmp_multi_total_bytes_sent,
+	.get_congestion = rtmp_multi_congestion,
+	.get_dropped_frames = rtmp_multi_dropped_frames,
+};
@@ -0,0 +1,281 @@
+/******************************************************************************
+    Copyright (C) 2026 by agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ * Compares the CPU cost of the two RTMP send paths: muxing each packet into
+ * a full FLV tag for RTMP_Write, and sending the tag headers along with the
+ * encoder data through RTMP_WriteV.  Synthetic H.264/AAC packets are sent as
+ * fast as possible to a local TCP sink that discards them.
+ *
+ * usage: obs-rtmp-send-benchmark [frames] [bitrate in kbps]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/bmem.h>
+#include "librtmp/rtmp_sys.h"
+#include "flv-mux.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define FPS 60
+#define KEYINT (FPS * 2)
+#define AUDIO_PER_VIDEO 3
+#define AUDIO_SIZE 384
+#define SINK_BUF_SIZE (256 * 1024)
+
+struct sink {
+	SOCKET fd;
+	uint64_t bytes;
+	pthread_t thread;
+};
+
+struct bench_input {
+	int frames;
+	uint32_t frame_size;
+	uint32_t keyframe_size;
+	uint8_t *frame;
+	uint8_t audio[AUDIO_SIZE];
+};
+
+static uint64_t thread_cpu_ns(void)
+{
+#ifdef _WIN32
+	FILETIME create, exit, kernel, user;
+	ULARGE_INTEGER k, u;
+
+	GetThreadTimes(GetCurrentThread(), &create, &exit, &kernel, &user);
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return (k.QuadPart + u.QuadPart) * 100;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void *sink_thread(void *data)
+{
+	struct sink *sink = data;
+	char *buf = bmalloc(SINK_BUF_SIZE);
+	int ret;
+
+	while ((ret = recv(sink->fd, buf, SINK_BUF_SIZE, 0)) > 0)
+		sink->bytes += (uint64_t)ret;
+
+	bfree(buf);
+	return NULL;
+}
+
+/* connects a socket to a sink thread on the loopback interface */
+static SOCKET connect_sink(struct sink *sink)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t addr_len = sizeof(addr);
+	SOCKET listener, fd = INVALID_SOCKET;
+
+	sink->fd = INVALID_SOCKET;
+	sink->bytes = 0;
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (listener == INVALID_SOCKET)
+		return INVALID_SOCKET;
+
+	if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    listen(listener, 1) != 0 ||
+	    getsockname(listener, (struct sockaddr *)&addr, &addr_len) != 0)
+		goto fail;
+
+	fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (fd == INVALID_SOCKET)
+		goto fail;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+		goto fail;
+
+	sink->fd = accept(listener, NULL, NULL);
+	if (sink->fd == INVALID_SOCKET)
+		goto fail;
+	if (pthread_create(&sink->thread, NULL, sink_thread, sink) != 0)
+		goto fail;
+
+	closesocket(listener);
+	return fd;
+
+fail:
+	if (sink->fd != INVALID_SOCKET)
+		closesocket(sink->fd);
+	if (fd != INVALID_SOCKET)
+		closesocket(fd);
+	closesocket(listener);
+	return INVALID_SOCKET;
+}
+
+static void next_packet(struct bench_input *in, int i, int sub,
+			struct encoder_packet *packet)
+{
+	memset(packet, 0, sizeof(*packet));
+	packet->timebase_num = 1;
+	packet->timebase_den = FPS * AUDIO_PER_VIDEO;
+	packet->dts = packet->pts = (int64_t)i * AUDIO_PER_VIDEO + sub;
+
+	if (sub == 0) {
+		packet->type = OBS_ENCODER_VIDEO;
+		packet->keyframe = i % KEYINT == 0;
+		packet->size = packet->keyframe ? in->keyframe_size
+						: in->frame_size;
+		packet->data = in->frame;
+
+		/* keep the payload from being trivially identical */
+		in->frame[0] = (uint8_t)i;
+	} else {
+		packet->type = OBS_ENCODER_AUDIO;
+		packet->size = AUDIO_SIZE;
+		packet->data = in->audio;
+	}
+}
+
+static bool send_copy(RTMP *rtmp, struct encoder_packet *packet)
+{
+	uint8_t *data;
+	size_t size;
+	int ret;
+
+	flv_packet_mux(packet, 0, &data, &size, false);
+	ret = RTMP_Write(rtmp, (char *)data, (int)size, 0);
+	bfree(data);
+	return ret >= 0;
+}
+
+static bool send_gather(RTMP *rtmp, struct encoder_packet *packet)
+{
+	struct flv_tag tag;
+	RTMPIOVec iov[2];
+
+	flv_packet_mux_tag(packet, 0, &tag, false);
+
+	iov[0].iv_base = (const char *)tag.header;
+	iov[0].iv_len = (int)tag.header_size;
+	iov[1].iv_base = (const char *)tag.data;
+	iov[1].iv_len = (int)tag.size;
+	return RTMP_WriteV(rtmp, iov, 2, 0) >= 0;
+}
+
+static void bench(const char *name, struct bench_input *in,
+		  bool (*send)(RTMP *, struct encoder_packet *))
+{
+	struct sink sink;
+	RTMP rtmp;
+	uint64_t start, cpu_start, wall_ns, cpu_ns;
+	double mbit;
+	bool success = true;
+
+	RTMP_Init(&rtmp);
+	rtmp.m_outChunkSize = 4096;
+	rtmp.m_sb.sb_socket = connect_sink(&sink);
+	if (rtmp.m_sb.sb_socket == INVALID_SOCKET) {
+		printf("%-8s failed to connect to the sink\n", name);
+		RTMP_TLS_Free(&rtmp);
+		return;
+	}
+
+	start = os_gettime_ns();
+	cpu_start = thread_cpu_ns();
+
+	for (int i = 0; success && i < in->frames; i++) {
+		for (int sub = 0; success && sub < AUDIO_PER_VIDEO; sub++) {
+			struct encoder_packet packet;
+
+			next_packet(in, i, sub, &packet);
+			success = send(&rtmp, &packet);
+		}
+	}
+
+	cpu_ns = thread_cpu_ns() - cpu_start;
+
+	/* no stream was published, so closing sends nothing */
+	RTMP_Close(&rtmp);
+	RTMP_TLS_Free(&rtmp);
+	pthread_join(sink.thread, NULL);
+	closesocket(sink.fd);
+	wall_ns = os_gettime_ns() - start;
+
+	if (!success) {
+		printf("%-8s failed\n", name);
+		return;
+	}
+
+	mbit = (double)sink.bytes * 8.0 / 1000000.0;
+	printf("%-8s %9.1f Mbit in %7.1f ms, %7.1f ms CPU: "
+	       "%7.2f us CPU per Mbit\n",
+	       name, mbit, (double)wall_ns / 1000000.0,
+	       (double)cpu_ns / 1000000.0, (double)cpu_ns / 1000.0 / mbit);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_input in = {0};
+	int kbps;
+
+#ifdef _WIN32
+	WSADATA wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+
+	in.frames = argc > 1 ? atoi(argv[1]) : 36000;
+	kbps = argc > 2 ? atoi(argv[2]) : 6000;
+	if (in.frames <= 0 || kbps <= 0) {
+		fprintf(stderr, "usage: %s [frames] [bitrate in kbps]\n",
+			argv[0]);
+		return 1;
+	}
+
+	/* a keyframe is about ten times the size of the other frames */
+	in.frame_size = (uint32_t)((uint64_t)kbps * 1000 / 8 * KEYINT / FPS /
+				   (KEYINT + 9));
+	in.keyframe_size = in.frame_size * 10;
+
+	in.frame = bmalloc(in.keyframe_size);
+	for (uint32_t i = 0; i < in.keyframe_size; i++)
+		in.frame[i] = (uint8_t)(i * 2654435761u >> 24);
+	for (size_t i = 0; i < sizeof(in.audio); i++)
+		in.audio[i] = (uint8_t)i;
+
+	printf("%d frames at %d kbps, %u KiB keyframes\n", in.frames, kbps,
+	       in.keyframe_size / 1024);
+	bench("copy", &in, send_copy);
+	bench("gather", &in, send_gather);
+
+	bfree(in.frame);
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	return 0;
+}
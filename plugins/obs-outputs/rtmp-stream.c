@@ -24,6 +24,8 @@
 
 #ifdef _WIN32
 #include <util/windows/win-version.h>
+#elif defined(__linux__)
+#include <sys/eventfd.h>
 #endif
 
 #ifndef SEC_TO_NSEC
@@ -38,12 +40,6 @@
 #define MSEC_TO_NSEC 1000000ULL
 #endif
 
-/* dynamic bitrate coefficients */
-#define DBR_INC_TIMER (4ULL * SEC_TO_NSEC)
-#define DBR_TRIGGER_USEC (200ULL * MSEC_TO_USEC)
-#define MIN_ESTIMATE_DURATION_MS 1000
-#define MAX_ESTIMATE_DURATION_MS 2000
-
 static const char *rtmp_stream_getname(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -134,7 +130,6 @@ static void rtmp_stream_destroy(void *data)
 #ifdef TEST_FRAMEDROPS
 	deque_free(&stream->droptest_info);
 #endif
-	deque_free(&stream->dbr_frames);
 	pthread_mutex_destroy(&stream->dbr_mutex);
 
 	os_event_destroy(stream->buffer_space_available_event);
@@ -142,17 +137,42 @@ static void rtmp_stream_destroy(void *data)
 	os_event_destroy(stream->socket_available_event);
 	os_event_destroy(stream->send_thread_signaled_exit);
 	pthread_mutex_destroy(&stream->write_buf_mutex);
+#ifdef __linux__
+	if (stream->socket_wake_fd >= 0)
+		close(stream->socket_wake_fd);
+#endif
 
 	if (stream->write_buf)
 		bfree(stream->write_buf);
 	bfree(stream);
 }
 
+static void get_bitrate_stats_proc(void *data, calldata_t *cd)
+{
+	struct rtmp_stream *stream = data;
+	struct abr_controller *abr = &stream->abr;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	calldata_set_bool(cd, "enabled", stream->dbr_enabled);
+	calldata_set_int(cd, "bitrate", abr->bitrate);
+	calldata_set_int(cd, "throughput", (long long)abr->throughput);
+	calldata_set_float(cd, "rtt", abr->rtt_ms);
+	calldata_set_float(cd, "min_rtt", abr->min_rtt_ms);
+	calldata_set_float(cd, "queue_delay", abr->queue_delay_ms);
+	calldata_set_float(cd, "delay_gradient", abr->gradient);
+	calldata_set_float(cd, "loss", abr->loss);
+	calldata_set_string(cd, "state", abr_state_name(abr->state));
+	pthread_mutex_unlock(&stream->dbr_mutex);
+}
+
 static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+#ifdef __linux__
+	stream->socket_wake_fd = -1;
+#endif
 
 	RTMP_LogSetCallback(log_rtmp);
 	RTMP_LogSetLevel(RTMP_LOGWARNING);
@@ -192,6 +212,22 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		warn("Failed to initialize socket exit event");
 		goto fail;
 	}
+#ifdef __linux__
+	stream->socket_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (stream->socket_wake_fd < 0) {
+		warn("Failed to initialize socket wake event");
+		goto fail;
+	}
+#endif
+
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph,
+			 "void get_bitrate_stats(out bool enabled, "
+			 "out int bitrate, out int throughput, out float rtt, "
+			 "out float min_rtt, out float queue_delay, "
+			 "out float delay_gradient, out float loss, "
+			 "out string state)",
+			 get_bitrate_stats_proc, stream);
 
 	UNUSED_PARAMETER(settings);
 	return stream;
@@ -350,6 +386,14 @@ static void droptest_cap_data_rate(struct rtmp_stream *stream, size_t size)
 }
 #endif
 
+static inline void signal_socket_thread(struct rtmp_stream *stream)
+{
+	os_event_signal(stream->buffer_has_data_event);
+#ifdef __linux__
+	socket_thread_linux_signal(stream);
+#endif
+}
+
 static int socket_queue_data(RTMPSockBuf *sb, const char *data, int len,
 			     void *arg)
 {
@@ -380,7 +424,7 @@ retry_send:
 
 	pthread_mutex_unlock(&stream->write_buf_mutex);
 
-	os_event_signal(stream->buffer_has_data_event);
+	signal_socket_thread(stream);
 
 	return len;
 }
@@ -405,6 +449,32 @@ static int handle_socket_read(struct rtmp_stream *stream)
 	return 0;
 }
 
+/* sends the tag headers and the encoder packet data without copying them
+ * into a single buffer first */
+static int send_tag(struct rtmp_stream *stream, struct flv_tag *tag)
+{
+	RTMPIOVec iov[2];
+	int ret;
+
+	if (!tag->header_size)
+		return 0;
+
+	iov[0].iv_base = (const char *)tag->header;
+	iov[0].iv_len = (int)tag->header_size;
+	iov[1].iv_base = (const char *)tag->data;
+	iov[1].iv_len = (int)tag->size;
+
+#ifdef TEST_FRAMEDROPS
+	droptest_cap_data_rate(stream, tag->header_size + tag->size);
+#endif
+
+	ret = RTMP_WriteV(&stream->rtmp, iov, 2, 0);
+
+	/* counted like a full FLV tag, including the previous tag size */
+	stream->total_bytes_sent += tag->header_size + tag->size + 4;
+	return ret;
+}
+
 static int send_packet(struct rtmp_stream *stream,
 		       struct encoder_packet *packet, bool is_header,
 		       size_t idx)
@@ -417,6 +487,16 @@ static int send_packet(struct rtmp_stream *stream,
 	if (handle_socket_read(stream))
 		return -1;
 
+	if (idx == 0 && !is_header) {
+		struct flv_tag tag;
+
+		flv_packet_mux_tag(packet, stream->start_dts_offset, &tag,
+				   false);
+		ret = send_tag(stream, &tag);
+		obs_encoder_packet_release(packet);
+		return ret;
+	}
+
 	if (idx > 0) {
 		flv_additional_packet_mux(
 			packet, is_header ? 0 : stream->start_dts_offset, &data,
@@ -453,15 +533,22 @@ static int send_packet_ex(struct rtmp_stream *stream,
 	if (handle_socket_read(stream))
 		return -1;
 
+	if (!is_header && !is_footer) {
+		struct flv_tag tag;
+
+		flv_packet_frames_tag(packet, stream->video_codec[idx],
+				      stream->start_dts_offset, &tag, idx);
+		ret = send_tag(stream, &tag);
+		obs_encoder_packet_release(packet);
+		return ret;
+	}
+
 	if (is_header) {
 		flv_packet_start(packet, stream->video_codec[idx], &data, &size,
 				 idx);
-	} else if (is_footer) {
+	} else {
 		flv_packet_end(packet, stream->video_codec[idx], &data, &size,
 			       idx);
-	} else {
-		flv_packet_frames(packet, stream->video_codec[idx],
-				  stream->start_dts_offset, &data, &size, idx);
 	}
 
 #ifdef TEST_FRAMEDROPS
@@ -471,10 +558,8 @@ static int send_packet_ex(struct rtmp_stream *stream,
 	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
 	bfree(data);
 
-	if (is_header || is_footer) // manually created packets
-		bfree(packet->data);
-	else
-		obs_encoder_packet_release(packet);
+	// manually created packets
+	bfree(packet->data);
 
 	stream->total_bytes_sent += size;
 	return ret;
@@ -581,37 +666,6 @@ static void set_output_error(struct rtmp_stream *stream)
 		obs_output_set_last_error(stream->output, msg);
 }
 
-static void dbr_add_frame(struct rtmp_stream *stream, struct dbr_frame *back)
-{
-	struct dbr_frame front;
-	uint64_t dur;
-
-	deque_push_back(&stream->dbr_frames, back, sizeof(*back));
-	deque_peek_front(&stream->dbr_frames, &front, sizeof(front));
-
-	stream->dbr_data_size += back->size;
-
-	dur = (back->send_end - front.send_beg) / 1000000;
-
-	if (dur >= MAX_ESTIMATE_DURATION_MS) {
-		stream->dbr_data_size -= front.size;
-		deque_pop_front(&stream->dbr_frames, NULL, sizeof(front));
-	}
-
-	stream->dbr_est_bitrate =
-		(dur >= MIN_ESTIMATE_DURATION_MS)
-			? (long)(stream->dbr_data_size * 1000 / dur)
-			: 0;
-	stream->dbr_est_bitrate *= 8;
-	stream->dbr_est_bitrate /= 1000;
-
-	if (stream->dbr_est_bitrate) {
-		stream->dbr_est_bitrate -= stream->audio_bitrate;
-		if (stream->dbr_est_bitrate < 50)
-			stream->dbr_est_bitrate = 50;
-	}
-}
-
 static void dbr_set_bitrate(struct rtmp_stream *stream);
 
 #ifdef _WIN32
@@ -629,6 +683,27 @@ static void log_sndbuf_size(struct rtmp_stream *stream)
 	}
 }
 
+/* the socket is only sampled by the thread that sends on it and may close it,
+ * the send thread or the socket loop, and handed to the controller on its
+ * next update */
+void dbr_sample_socket(struct rtmp_stream *stream)
+{
+	struct abr_sample sample = {0};
+
+	abr_sample_socket(&sample, &stream->rtmp.m_sb);
+
+	/* data in the socket loop's buffer has not reached the socket yet */
+	if (stream->new_socket_loop && sample.has_socket_info) {
+		pthread_mutex_lock(&stream->write_buf_mutex);
+		sample.unsent_bytes += (uint32_t)stream->write_buf_len;
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+	}
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	stream->socket_sample = sample;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+}
+
 static void *send_thread(void *data)
 {
 	struct rtmp_stream *stream = data;
@@ -641,7 +716,6 @@ static void *send_thread(void *data)
 
 	while (os_sem_wait(stream->send_sem) == 0) {
 		struct encoder_packet packet;
-		struct dbr_frame dbr_frame;
 
 		if (stopping(stream) && stream->stop_ts == 0) {
 			break;
@@ -664,11 +738,6 @@ static void *send_thread(void *data)
 			}
 		}
 
-		if (stream->dbr_enabled) {
-			dbr_frame.send_beg = os_gettime_ns();
-			dbr_frame.size = packet.size;
-		}
-
 		int sent;
 		if (packet.type == OBS_ENCODER_VIDEO &&
 		    (stream->video_codec[packet.track_idx] != CODEC_H264 ||
@@ -686,13 +755,8 @@ static void *send_thread(void *data)
 			break;
 		}
 
-		if (stream->dbr_enabled) {
-			dbr_frame.send_end = os_gettime_ns();
-
-			pthread_mutex_lock(&stream->dbr_mutex);
-			dbr_add_frame(stream, &dbr_frame);
-			pthread_mutex_unlock(&stream->dbr_mutex);
-		}
+		if (stream->dbr_enabled && !stream->new_socket_loop)
+			dbr_sample_socket(stream);
 	}
 
 	bool encode_error = os_atomic_load_bool(&stream->encode_error);
@@ -713,7 +777,7 @@ static void *send_thread(void *data)
 
 	if (stream->new_socket_loop) {
 		os_event_signal(stream->send_thread_signaled_exit);
-		os_event_signal(stream->buffer_has_data_event);
+		signal_socket_thread(stream);
 		pthread_join(stream->socket_thread, NULL);
 		stream->socket_thread_active = false;
 		stream->rtmp.m_bCustomSend = false;
@@ -725,10 +789,15 @@ static void *send_thread(void *data)
 
 	/* reset bitrate on stop */
 	if (stream->dbr_enabled) {
-		if (stream->dbr_cur_bitrate != stream->dbr_orig_bitrate) {
-			stream->dbr_cur_bitrate = stream->dbr_orig_bitrate;
+		bool changed;
+
+		pthread_mutex_lock(&stream->dbr_mutex);
+		changed = stream->abr.bitrate != stream->abr.max_bitrate;
+		stream->abr.bitrate = stream->abr.max_bitrate;
+		pthread_mutex_unlock(&stream->dbr_mutex);
+
+		if (changed)
 			dbr_set_bitrate(stream);
-		}
 	}
 
 	if (!stopping(stream)) {
@@ -1089,12 +1158,16 @@ static int init_send(struct rtmp_stream *stream)
 		stream->write_buf_size = ideal_buffer_size;
 		stream->write_buf = bmalloc(ideal_buffer_size);
 
-#ifndef _WIN32
-		warn("New socket loop not supported on this platform");
-		return OBS_OUTPUT_ERROR;
-#else
+#ifdef _WIN32
 		ret = pthread_create(&stream->socket_thread, NULL,
 				     socket_thread_windows, stream);
+#elif defined(__linux__)
+		ret = pthread_create(&stream->socket_thread, NULL,
+				     socket_thread_linux, stream);
+#else
+		warn("New socket loop not supported on this platform");
+		return OBS_OUTPUT_ERROR;
+#endif
 
 		if (ret != 0) {
 			RTMP_Close(&stream->rtmp);
@@ -1106,7 +1179,6 @@ static int init_send(struct rtmp_stream *stream)
 		stream->rtmp.m_bCustomSend = true;
 		stream->rtmp.m_customSendFunc = socket_queue_data;
 		stream->rtmp.m_customSendParam = stream;
-#endif
 	}
 
 	os_atomic_set_bool(&stream->active, true);
@@ -1344,14 +1416,11 @@ static bool init_connect(struct rtmp_stream *stream)
 		}
 	}
 
-	deque_free(&stream->dbr_frames);
-	stream->audio_bitrate = (long)obs_data_get_int(asettings, "bitrate");
-	stream->dbr_data_size = 0;
-	stream->dbr_orig_bitrate = (long)obs_data_get_int(vsettings, "bitrate");
-	stream->dbr_cur_bitrate = stream->dbr_orig_bitrate;
-	stream->dbr_est_bitrate = 0;
-	stream->dbr_inc_bitrate = stream->dbr_orig_bitrate / 10;
-	stream->dbr_inc_timeout = 0;
+	pthread_mutex_lock(&stream->dbr_mutex);
+	abr_init(&stream->abr, (long)obs_data_get_int(vsettings, "bitrate"),
+		 (long)obs_data_get_int(asettings, "bitrate"));
+	memset(&stream->socket_sample, 0, sizeof(stream->socket_sample));
+	pthread_mutex_unlock(&stream->dbr_mutex);
 	stream->dbr_enabled = obs_data_get_bool(settings, OPT_DYN_BITRATE);
 
 	caps = obs_encoder_get_caps(venc);
@@ -1393,7 +1462,7 @@ static bool init_connect(struct rtmp_stream *stream)
 		stream->addrlen_hint = len;
 	}
 
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
 	stream->new_socket_loop =
 		obs_data_get_bool(settings, OPT_NEWSOCKETLOOP_ENABLED);
 	stream->low_latency_mode =
@@ -1548,93 +1617,40 @@ static bool find_first_video_packet(struct rtmp_stream *stream,
 	return false;
 }
 
-static bool dbr_bitrate_lowered(struct rtmp_stream *stream)
-{
-	long prev_bitrate = stream->dbr_prev_bitrate;
-	long est_bitrate = 0;
-	long new_bitrate;
-
-	if (stream->dbr_est_bitrate &&
-	    stream->dbr_est_bitrate < stream->dbr_cur_bitrate) {
-		stream->dbr_data_size = 0;
-		deque_pop_front(&stream->dbr_frames, NULL,
-				stream->dbr_frames.size);
-		est_bitrate = stream->dbr_est_bitrate / 100 * 100;
-		if (est_bitrate < 50) {
-			est_bitrate = 50;
-		}
-	}
-
-#if 0
-	if (prev_bitrate && est_bitrate) {
-		if (prev_bitrate < est_bitrate) {
-			blog(LOG_INFO, "going back to prev bitrate: "
-					"prev_bitrate (%d) < est_bitrate (%d)",
-					prev_bitrate,
-					est_bitrate);
-			new_bitrate = prev_bitrate;
-		} else {
-			new_bitrate = est_bitrate;
-		}
-		new_bitrate = est_bitrate;
-	} else if (prev_bitrate) {
-		new_bitrate = prev_bitrate;
-		info("going back to prev bitrate");
-
-	} else if (est_bitrate) {
-		new_bitrate = est_bitrate;
-
-	} else {
-		return false;
-	}
-#else
-	if (est_bitrate) {
-		new_bitrate = est_bitrate;
-
-	} else if (prev_bitrate) {
-		new_bitrate = prev_bitrate;
-		info("going back to prev bitrate");
-
-	} else {
-		return false;
-	}
-
-	if (new_bitrate == stream->dbr_cur_bitrate) {
-		return false;
-	}
-#endif
-
-	stream->dbr_prev_bitrate = 0;
-	stream->dbr_cur_bitrate = new_bitrate;
-	stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
-	info("bitrate decreased to: %ld", stream->dbr_cur_bitrate);
-	return true;
-}
-
 static void dbr_set_bitrate(struct rtmp_stream *stream)
 {
 	obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
 	obs_data_t *settings = obs_encoder_get_settings(vencoder);
 
-	obs_data_set_int(settings, "bitrate", stream->dbr_cur_bitrate);
+	obs_data_set_int(settings, "bitrate", stream->abr.bitrate);
 	obs_encoder_update(vencoder, settings);
 
 	obs_data_release(settings);
 }
 
-static void dbr_inc_bitrate(struct rtmp_stream *stream)
+static void dbr_update(struct rtmp_stream *stream, int64_t queue_usec)
 {
-	stream->dbr_prev_bitrate = stream->dbr_cur_bitrate;
-	stream->dbr_cur_bitrate += stream->dbr_inc_bitrate;
-
-	if (stream->dbr_cur_bitrate >= stream->dbr_orig_bitrate) {
-		stream->dbr_cur_bitrate = stream->dbr_orig_bitrate;
-		info("bitrate increased to: %ld, done",
-		     stream->dbr_cur_bitrate);
-	} else if (stream->dbr_cur_bitrate < stream->dbr_orig_bitrate) {
-		stream->dbr_inc_timeout = os_gettime_ns() + DBR_INC_TIMER;
-		info("bitrate increased to: %ld, waiting",
-		     stream->dbr_cur_bitrate);
+	struct abr_sample sample = {0};
+	long prev_bitrate;
+	bool changed;
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	sample = stream->socket_sample;
+	sample.ts_ns = os_gettime_ns();
+	sample.bytes_sent = stream->total_bytes_sent;
+	sample.queue_usec = queue_usec;
+	prev_bitrate = stream->abr.bitrate;
+	changed = abr_update(&stream->abr, &sample);
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	if (changed) {
+		info("bitrate %s to %ld (throughput: %.0f kbps, "
+		     "queue delay: %.0f ms, loss: %.1f%%)",
+		     stream->abr.bitrate < prev_bitrate ? "decreased"
+							: "increased",
+		     stream->abr.bitrate, stream->abr.throughput,
+		     stream->abr.queue_delay_ms, stream->abr.loss * 100.0);
+		dbr_set_bitrate(stream);
 	}
 }
 
@@ -1649,21 +1665,12 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	int64_t drop_threshold = pframes ? stream->pframe_drop_threshold_usec
 					 : stream->drop_threshold_usec;
 
-	if (!pframes && stream->dbr_enabled) {
-		if (stream->dbr_inc_timeout) {
-			uint64_t t = os_gettime_ns();
-
-			if (t >= stream->dbr_inc_timeout) {
-				stream->dbr_inc_timeout = 0;
-				dbr_inc_bitrate(stream);
-				dbr_set_bitrate(stream);
-			}
-		}
-	}
-
 	if (num_packets < 5) {
-		if (!pframes)
+		if (!pframes) {
 			stream->congestion = 0.0f;
+			if (stream->dbr_enabled)
+				dbr_update(stream, 0);
+		}
 		return;
 	}
 
@@ -1679,28 +1686,11 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 			(float)buffer_duration_usec / (float)drop_threshold;
 	}
 
-	/* alternatively, drop only pframes:
-	 * (!pframes && stream->dbr_enabled)
-	 * but let's test without dropping frames
-	 * at all first */
+	/* with dynamic bitrate, the encoder is slowed down instead of
+	 * dropping frames */
 	if (stream->dbr_enabled) {
-		bool bitrate_changed = false;
-
-		if (pframes) {
-			return;
-		}
-
-		if ((uint64_t)buffer_duration_usec >= DBR_TRIGGER_USEC) {
-			pthread_mutex_lock(&stream->dbr_mutex);
-			bitrate_changed = dbr_bitrate_lowered(stream);
-			pthread_mutex_unlock(&stream->dbr_mutex);
-		}
-
-		if (bitrate_changed) {
-			debug("buffer_duration_msec: %" PRId64,
-			      buffer_duration_usec / 1000);
-			dbr_set_bitrate(stream);
-		}
+		if (!pframes)
+			dbr_update(stream, buffer_duration_usec);
 		return;
 	}
 
@@ -1798,7 +1788,7 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
 #endif
@@ -1843,7 +1833,7 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 	}
 	netif_saddr_data_free(&addrs);
 
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
 	obs_properties_add_bool(props, OPT_NEWSOCKETLOOP_ENABLED,
 				obs_module_text("RTMPStream.NewSocketLoop"));
 	obs_properties_add_bool(props, OPT_LOWLATENCY_ENABLED,
@@ -1869,6 +1859,18 @@ static float rtmp_stream_congestion(void *data)
 {
 	struct rtmp_stream *stream = data;
 
+#ifdef __linux__
+	/* the socket thread keeps the kernel's unsent queue short, count it
+	 * along with the write buffer */
+	if (stream->new_socket_loop) {
+		size_t queued = stream->write_buf_len +
+				(size_t)os_atomic_load_long(
+					&stream->socket_unsent_bytes);
+		float congestion =
+			(float)queued / (float)stream->write_buf_size;
+		return congestion > 1.0f ? 1.0f : congestion;
+	}
+#endif
 	if (stream->new_socket_loop)
 		return (float)stream->write_buf_len /
 		       (float)stream->write_buf_size;
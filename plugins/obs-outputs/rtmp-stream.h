@@ -8,6 +8,7 @@
 #include "librtmp/log.h"
 #include "flv-mux.h"
 #include "net-if.h"
+#include "rtmp-abr.h"
 
 #ifdef _WIN32
 #include <Iphlpapi.h>
@@ -47,12 +48,6 @@ struct droptest_info {
 };
 #endif
 
-struct dbr_frame {
-	uint64_t send_beg;
-	uint64_t send_end;
-	size_t size;
-};
-
 struct rtmp_stream {
 	obs_output_t *output;
 
@@ -103,15 +98,8 @@ struct rtmp_stream {
 #endif
 
 	pthread_mutex_t dbr_mutex;
-	struct deque dbr_frames;
-	size_t dbr_data_size;
-	uint64_t dbr_inc_timeout;
-	long audio_bitrate;
-	long dbr_est_bitrate;
-	long dbr_orig_bitrate;
-	long dbr_prev_bitrate;
-	long dbr_cur_bitrate;
-	long dbr_inc_bitrate;
+	struct abr_controller abr;
+	struct abr_sample socket_sample;
 	bool dbr_enabled;
 
 	enum video_id_t video_codec[MAX_OUTPUT_VIDEO_ENCODERS];
@@ -131,12 +119,21 @@ struct rtmp_stream {
 	os_event_t *buffer_has_data_event;
 	os_event_t *socket_available_event;
 	os_event_t *send_thread_signaled_exit;
+#ifdef __linux__
+	int socket_wake_fd;
+	volatile long socket_unsent_bytes;
+#endif
 };
 
 #ifdef _WIN32
 void *socket_thread_windows(void *data);
+#elif defined(__linux__)
+void *socket_thread_linux(void *data);
+void socket_thread_linux_signal(struct rtmp_stream *stream);
 #endif
 
+void dbr_sample_socket(struct rtmp_stream *stream);
+
 /* Adapted from FFmpeg's libavutil/pixfmt.h
  *
  * Renamed to make it apparent that these are not imported as this module does
@@ -0,0 +1,170 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <cmocka.h>
+
+#include <util/platform.h>
+#include <media-io/audio-kernels.h>
+
+/* one 1024 frame tick, plus an odd tail to exercise the scalar remainder */
+#define NUM_SAMPLES (1024 + 7)
+#define BENCH_ITERATIONS 20000
+
+static float src[NUM_SAMPLES];
+static float vol[NUM_SAMPLES];
+static float expected[NUM_SAMPLES];
+static float actual[NUM_SAMPLES];
+
+static void fill_test_data(void)
+{
+	for (size_t i = 0; i < NUM_SAMPLES; i++) {
+		src[i] = sinf((float)i * 0.01f) * 1.5f;
+		vol[i] = (float)i / (float)NUM_SAMPLES;
+	}
+
+	src[3] = NAN;
+	src[NUM_SAMPLES - 1] = NAN;
+}
+
+static void reset(float *buf)
+{
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		buf[i] = cosf((float)i * 0.02f);
+}
+
+static void compare(size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (isnan(expected[i]))
+			assert_true(isnan(actual[i]));
+		else
+			assert_true(expected[i] == actual[i]);
+	}
+}
+
+static void check_kernels(const struct audio_kernels *ref,
+			  const struct audio_kernels *k)
+{
+	/* vary the length and offset to hit unaligned heads and tails */
+	for (size_t off = 0; off < 4; off++) {
+		size_t count = NUM_SAMPLES - off;
+
+		reset(expected);
+		reset(actual);
+		ref->accumulate(expected + off, src, count);
+		k->accumulate(actual + off, src, count);
+		compare(NUM_SAMPLES);
+
+		ref->scale(expected + off, 0.5f, count);
+		k->scale(actual + off, 0.5f, count);
+		compare(NUM_SAMPLES);
+
+		ref->scale_ramp(expected + off, vol, count);
+		k->scale_ramp(actual + off, vol, count);
+		compare(NUM_SAMPLES);
+
+		memcpy(expected, src, sizeof(src));
+		memcpy(actual, src, sizeof(src));
+		ref->clamp(expected + off, count);
+		k->clamp(actual + off, count);
+		compare(NUM_SAMPLES);
+	}
+}
+
+static void kernels_match_scalar_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const struct audio_kernels *ref =
+		audio_kernels_get(AUDIO_KERNEL_SCALAR);
+	assert_non_null(ref);
+	assert_non_null(audio_kernels_get_best());
+
+	fill_test_data();
+
+	for (int type = AUDIO_KERNEL_SSE2; type <= AUDIO_KERNEL_AVX; type++) {
+		const struct audio_kernels *k = audio_kernels_get(type);
+		if (k)
+			check_kernels(ref, k);
+	}
+}
+
+static void clamp_values_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const struct audio_kernels *k = audio_kernels_get_best();
+	float data[9] = {NAN, 2.0f, -2.0f, 0.5f, -0.5f, 1.0f, -1.0f,
+			 INFINITY, -INFINITY};
+	const float result[9] = {0.0f,  1.0f,  -1.0f, 0.5f, -0.5f,
+				 1.0f, -1.0f, 1.0f,  -1.0f};
+
+	k->clamp(data, 9);
+	assert_memory_equal(data, result, sizeof(result));
+}
+
+static void benchmark_kernels(const struct audio_kernels *k)
+{
+	uint64_t start, accumulate_ns, scale_ns, ramp_ns, clamp_ns;
+
+	reset(actual);
+
+	start = os_gettime_ns();
+	for (int i = 0; i < BENCH_ITERATIONS; i++)
+		k->accumulate(actual, src, 1024);
+	accumulate_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	for (int i = 0; i < BENCH_ITERATIONS; i++)
+		k->scale(actual, 0.999f, 1024);
+	scale_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	for (int i = 0; i < BENCH_ITERATIONS; i++)
+		k->scale_ramp(actual, vol, 1024);
+	ramp_ns = os_gettime_ns() - start;
+
+	start = os_gettime_ns();
+	for (int i = 0; i < BENCH_ITERATIONS; i++)
+		k->clamp(actual, 1024);
+	clamp_ns = os_gettime_ns() - start;
+
+	printf("%-8s accumulate: %6.1f ns, scale: %6.1f ns, "
+	       "scale_ramp: %6.1f ns, clamp: %6.1f ns (per 1024 samples)\n",
+	       k->name, (double)accumulate_ns / BENCH_ITERATIONS,
+	       (double)scale_ns / BENCH_ITERATIONS,
+	       (double)ramp_ns / BENCH_ITERATIONS,
+	       (double)clamp_ns / BENCH_ITERATIONS);
+}
+
+static void kernels_benchmark(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	/* keep repeated passes out of denormal range */
+	fill_test_data();
+	src[3] = 0.0f;
+	src[NUM_SAMPLES - 1] = 0.0f;
+	for (size_t i = 0; i < NUM_SAMPLES; i++)
+		vol[i] = 1.0f;
+
+	for (int type = AUDIO_KERNEL_SCALAR; type <= AUDIO_KERNEL_AVX; type++) {
+		const struct audio_kernels *k = audio_kernels_get(type);
+		if (k)
+			benchmark_kernels(k);
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(kernels_match_scalar_test),
+		cmocka_unit_test(clamp_values_test),
+		cmocka_unit_test(kernels_benchmark),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,203 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <cmocka.h>
+
+#include <util/merge-queue.h>
+#include <util/darray.h>
+#include <util/platform.h>
+
+/* mimics interleaved encoder packets: one video track at 60 fps and several
+ * audio tracks at 48 kHz / 1024 samples, all slightly out of phase */
+
+#define NUM_LANES 7
+#define NUM_ITEMS 200000
+
+struct item {
+	int64_t ts;
+	size_t lane;
+	uint8_t payload[64];
+};
+
+static int item_compare(const void *a, const void *b)
+{
+	const struct item *ia = a;
+	const struct item *ib = b;
+
+	if (ia->ts != ib->ts)
+		return ia->ts < ib->ts ? -1 : 1;
+	if (ia->lane != ib->lane)
+		return ia->lane < ib->lane ? -1 : 1;
+	return 0;
+}
+
+static void generate_items(struct item *items, size_t num)
+{
+	int64_t next_ts[NUM_LANES];
+
+	for (size_t i = 0; i < NUM_LANES; i++)
+		next_ts[i] = (int64_t)i * 1000;
+
+	/* always emit from the lane that is furthest behind, then add some
+	 * jitter between lanes the way separate encoders would */
+	for (size_t i = 0; i < num; i++) {
+		size_t lane = (size_t)rand() % NUM_LANES;
+		int64_t interval = lane == 0 ? 16667 : 21333;
+
+		items[i].ts = next_ts[lane];
+		items[i].lane = lane;
+		next_ts[lane] += interval;
+	}
+}
+
+static uint64_t run_merge_queue(const struct item *items, size_t num,
+				size_t backlog, struct item *out)
+{
+	struct merge_queue mq;
+	struct item item;
+	size_t out_num = 0;
+	uint64_t start = os_gettime_ns();
+
+	merge_queue_init(&mq, sizeof(struct item), NUM_LANES, item_compare);
+
+	for (size_t i = 0; i < num; i++) {
+		merge_queue_push(&mq, items[i].lane, &items[i]);
+		if (merge_queue_size(&mq) > backlog) {
+			merge_queue_pop(&mq, &item);
+			out[out_num++] = item;
+		}
+	}
+
+	while (merge_queue_size(&mq)) {
+		merge_queue_pop(&mq, &item);
+		out[out_num++] = item;
+	}
+
+	uint64_t elapsed = os_gettime_ns() - start;
+	merge_queue_free(&mq);
+
+	assert_int_equal(out_num, num);
+	return elapsed;
+}
+
+/* the sorted array approach the interleaver used before */
+static uint64_t run_sorted_array(const struct item *items, size_t num,
+				 size_t backlog, struct item *out)
+{
+	DARRAY(struct item) array;
+	size_t out_num = 0;
+	uint64_t start = os_gettime_ns();
+
+	da_init(array);
+
+	for (size_t i = 0; i < num; i++) {
+		size_t idx;
+		for (idx = 0; idx < array.num; idx++) {
+			if (item_compare(&items[i], &array.array[idx]) < 0)
+				break;
+		}
+		da_insert(array, idx, &items[i]);
+
+		if (array.num > backlog) {
+			out[out_num++] = array.array[0];
+			da_erase(array, 0);
+		}
+	}
+
+	for (size_t i = 0; i < array.num; i++)
+		out[out_num++] = array.array[i];
+
+	uint64_t elapsed = os_gettime_ns() - start;
+	da_free(array);
+
+	assert_int_equal(out_num, num);
+	return elapsed;
+}
+
+static void order_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct item items[] = {
+		{30, 0}, {10, 1}, {20, 1}, {5, 2}, {15, 0}, {25, 2}, {40, 1},
+	};
+	int64_t expected[] = {5, 10, 15, 20, 25, 30, 40};
+	struct merge_queue mq;
+	struct item item;
+
+	merge_queue_init(&mq, sizeof(struct item), 3, item_compare);
+
+	/* lane 0 receives 15 after 30, which has to be sorted in */
+	for (size_t i = 0; i < sizeof(items) / sizeof(items[0]); i++)
+		merge_queue_push(&mq, items[i].lane, &items[i]);
+
+	assert_int_equal(merge_queue_size(&mq), 7);
+	assert_int_equal(merge_queue_lane_size(&mq, 1), 3);
+
+	for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+		assert_int_equal(((struct item *)merge_queue_peek(&mq))->ts,
+				 expected[i]);
+		merge_queue_pop(&mq, &item);
+		assert_int_equal(item.ts, expected[i]);
+	}
+
+	assert_null(merge_queue_peek(&mq));
+
+	/* in-place modification followed by a rebuild */
+	merge_queue_push(&mq, 0, &items[0]);
+	merge_queue_push(&mq, 1, &items[1]);
+	((struct item *)merge_queue_lane_front(&mq, 1))->ts = 100;
+	merge_queue_rebuild(&mq);
+	assert_int_equal(((struct item *)merge_queue_peek(&mq))->ts, 30);
+
+	merge_queue_pop_lane(&mq, 0, &item);
+	assert_int_equal(((struct item *)merge_queue_peek(&mq))->ts, 100);
+
+	merge_queue_free(&mq);
+}
+
+static void merge_queue_benchmark(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct item *items = bmalloc(sizeof(struct item) * NUM_ITEMS);
+	struct item *out_mq = bmalloc(sizeof(struct item) * NUM_ITEMS);
+	struct item *out_da = bmalloc(sizeof(struct item) * NUM_ITEMS);
+	size_t backlogs[] = {16, 256, 2048};
+
+	srand(1234);
+	generate_items(items, NUM_ITEMS);
+
+	for (size_t i = 0; i < sizeof(backlogs) / sizeof(backlogs[0]); i++) {
+		size_t backlog = backlogs[i];
+		uint64_t mq_ns =
+			run_merge_queue(items, NUM_ITEMS, backlog, out_mq);
+		uint64_t da_ns =
+			run_sorted_array(items, NUM_ITEMS, backlog, out_da);
+
+		for (size_t j = 0; j < NUM_ITEMS; j++) {
+			assert_int_equal(out_mq[j].ts, out_da[j].ts);
+			assert_int_equal(out_mq[j].lane, out_da[j].lane);
+		}
+
+		printf("backlog %5d: merge queue %7.1f ns/item, "
+		       "sorted array %8.1f ns/item\n",
+		       (int)backlog, (double)mq_ns / NUM_ITEMS,
+		       (double)da_ns / NUM_ITEMS);
+	}
+
+	bfree(items);
+	bfree(out_mq);
+	bfree(out_da);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(order_test),
+		cmocka_unit_test(merge_queue_benchmark),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,376 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <cmocka.h>
+
+#include <media-io/mp4-recover.h>
+#include <util/array-serializer.h>
+#include <util/platform.h>
+
+#define TEST_FILE "test_mp4_recover.mp4"
+
+#define NUM_FRAGMENTS 3
+#define SAMPLES_PER_FRAGMENT 5
+#define SAMPLE_DURATION 100
+
+#define BOX(a, b, c, d)                                                  \
+	((uint32_t)(a) << 24 | (uint32_t)(b) << 16 | (uint32_t)(c) << 8 | \
+	 (uint32_t)(d))
+
+static size_t begin_box(struct serializer *s, struct array_output_data *out,
+			uint32_t type)
+{
+	size_t pos = out->bytes.num;
+	s_wb32(s, 0);
+	s_wb32(s, type);
+	return pos;
+}
+
+static void end_box(struct array_output_data *out, size_t pos)
+{
+	uint32_t size = (uint32_t)(out->bytes.num - pos);
+	uint8_t *p = out->bytes.array + pos;
+
+	p[0] = (uint8_t)(size >> 24);
+	p[1] = (uint8_t)(size >> 16);
+	p[2] = (uint8_t)(size >> 8);
+	p[3] = (uint8_t)size;
+}
+
+static void write_full_box(struct serializer *s, struct array_output_data *out,
+			   uint32_t type, const uint32_t *fields, size_t count)
+{
+	size_t box = begin_box(s, out, type);
+	s_wb32(s, 0);
+	for (size_t i = 0; i < count; i++)
+		s_wb32(s, fields[i]);
+	end_box(out, box);
+}
+
+static uint32_t sample_size(size_t idx)
+{
+	return (uint32_t)(10 + idx * 3);
+}
+
+static void write_moov(struct serializer *s, struct array_output_data *out)
+{
+	size_t moov = begin_box(s, out, BOX('m', 'o', 'o', 'v'));
+
+	/* creation, modification, timescale, duration */
+	const uint32_t mvhd[] = {0, 0, 1000, 0};
+	write_full_box(s, out, BOX('m', 'v', 'h', 'd'), mvhd, 4);
+
+	size_t trak = begin_box(s, out, BOX('t', 'r', 'a', 'k'));
+	/* creation, modification, track id, reserved, duration */
+	const uint32_t tkhd[] = {0, 0, 1, 0, 0};
+	write_full_box(s, out, BOX('t', 'k', 'h', 'd'), tkhd, 5);
+
+	size_t mdia = begin_box(s, out, BOX('m', 'd', 'i', 'a'));
+	const uint32_t mdhd[] = {0, 0, 1000, 0, 0};
+	write_full_box(s, out, BOX('m', 'd', 'h', 'd'), mdhd, 5);
+
+	size_t minf = begin_box(s, out, BOX('m', 'i', 'n', 'f'));
+	size_t stbl = begin_box(s, out, BOX('s', 't', 'b', 'l'));
+	const uint32_t stsd[] = {0};
+	const uint32_t empty[] = {0};
+	const uint32_t stsz[] = {0, 0};
+	write_full_box(s, out, BOX('s', 't', 's', 'd'), stsd, 1);
+	write_full_box(s, out, BOX('s', 't', 't', 's'), empty, 1);
+	write_full_box(s, out, BOX('s', 't', 's', 'c'), empty, 1);
+	write_full_box(s, out, BOX('s', 't', 's', 'z'), stsz, 2);
+	write_full_box(s, out, BOX('s', 't', 'c', 'o'), empty, 1);
+	end_box(out, stbl);
+	end_box(out, minf);
+	end_box(out, mdia);
+	end_box(out, trak);
+
+	size_t mvex = begin_box(s, out, BOX('m', 'v', 'e', 'x'));
+	/* track id, description, duration, size, flags (non-sync) */
+	const uint32_t trex[] = {1, 1, SAMPLE_DURATION, 0, 0x10000};
+	write_full_box(s, out, BOX('t', 'r', 'e', 'x'), trex, 5);
+	end_box(out, mvex);
+
+	end_box(out, moov);
+}
+
+static void write_fragment(struct serializer *s, struct array_output_data *out,
+			   size_t first)
+{
+	size_t moof = begin_box(s, out, BOX('m', 'o', 'o', 'f'));
+	const uint32_t mfhd[] = {(uint32_t)(first / SAMPLES_PER_FRAGMENT + 1)};
+	write_full_box(s, out, BOX('m', 'f', 'h', 'd'), mfhd, 1);
+
+	size_t traf = begin_box(s, out, BOX('t', 'r', 'a', 'f'));
+	size_t tfhd = begin_box(s, out, BOX('t', 'f', 'h', 'd'));
+	s_wb32(s, 0x20000); /* default base is moof */
+	s_wb32(s, 1);
+	end_box(out, tfhd);
+
+	const uint32_t tfdt[] = {(uint32_t)(first * SAMPLE_DURATION)};
+	write_full_box(s, out, BOX('t', 'f', 'd', 't'), tfdt, 1);
+
+	/* data offset, first sample flags, sample sizes */
+	size_t trun = begin_box(s, out, BOX('t', 'r', 'u', 'n'));
+	s_wb32(s, 0x1 | 0x4 | 0x200);
+	s_wb32(s, SAMPLES_PER_FRAGMENT);
+	size_t data_offset = out->bytes.num;
+	s_wb32(s, 0);
+	s_wb32(s, 0); /* first sample is a sync sample */
+	for (size_t i = 0; i < SAMPLES_PER_FRAGMENT; i++)
+		s_wb32(s, sample_size(first + i));
+	end_box(out, trun);
+	end_box(out, traf);
+	end_box(out, moof);
+
+	uint32_t offset = (uint32_t)(out->bytes.num - moof + 8);
+	uint8_t *p = out->bytes.array + data_offset;
+	p[0] = (uint8_t)(offset >> 24);
+	p[1] = (uint8_t)(offset >> 16);
+	p[2] = (uint8_t)(offset >> 8);
+	p[3] = (uint8_t)offset;
+
+	size_t mdat = begin_box(s, out, BOX('m', 'd', 'a', 't'));
+	for (size_t i = 0; i < SAMPLES_PER_FRAGMENT; i++) {
+		for (uint32_t j = 0; j < sample_size(first + i); j++)
+			s_w8(s, (uint8_t)(first + i));
+	}
+	end_box(out, mdat);
+}
+
+static size_t fragment_size(size_t first)
+{
+	struct array_output_data out;
+	struct serializer s;
+
+	array_output_serializer_init(&s, &out);
+	write_fragment(&s, &out, first);
+	size_t size = out.bytes.num;
+	array_output_serializer_free(&out);
+	return size;
+}
+
+static void write_test_file(size_t truncate)
+{
+	struct array_output_data out;
+	struct serializer s;
+
+	array_output_serializer_init(&s, &out);
+
+	size_t ftyp = begin_box(&s, &out, BOX('f', 't', 'y', 'p'));
+	s_wb32(&s, BOX('i', 's', 'o', '5'));
+	s_wb32(&s, 0);
+	end_box(&out, ftyp);
+
+	write_moov(&s, &out);
+	for (size_t i = 0; i <= NUM_FRAGMENTS; i++)
+		write_fragment(&s, &out, i * SAMPLES_PER_FRAGMENT);
+
+	/* the last fragment was only partially written */
+	FILE *file = os_fopen(TEST_FILE, "wb");
+	assert_non_null(file);
+	fwrite(out.bytes.array, 1, out.bytes.num - truncate, file);
+	fclose(file);
+
+	array_output_serializer_free(&out);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint32_t rb32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+	       (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+static const uint8_t *find_box(const uint8_t *data, size_t size,
+			       uint32_t type, size_t *box_size)
+{
+	size_t pos = 0;
+
+	while (pos + 8 <= size) {
+		uint32_t len = rb32(data + pos);
+		if (len < 8 || pos + len > size)
+			return NULL;
+
+		if (rb32(data + pos + 4) == type) {
+			*box_size = len - 8;
+			return data + pos + 8;
+		}
+
+		pos += len;
+	}
+
+	return NULL;
+}
+
+static const uint8_t *find_path(const uint8_t *data, size_t size,
+				const uint32_t *path, size_t depth,
+				size_t *box_size)
+{
+	for (size_t i = 0; i < depth && data; i++)
+		data = find_box(data, size, path[i], &size);
+
+	*box_size = size;
+	return data;
+}
+
+static void check_recovered(size_t file_size, const uint8_t *data)
+{
+	const uint32_t top[] = {
+		BOX('f', 't', 'y', 'p'), BOX('f', 'r', 'e', 'e'),
+		BOX('f', 'r', 'e', 'e'), BOX('m', 'd', 'a', 't'),
+		BOX('f', 'r', 'e', 'e'), BOX('m', 'd', 'a', 't'),
+		BOX('f', 'r', 'e', 'e'), BOX('m', 'd', 'a', 't'),
+		BOX('m', 'o', 'o', 'v'),
+	};
+	size_t pos = 0;
+	size_t i = 0;
+
+	/* the whole file is covered with boxes */
+	while (pos < file_size) {
+		assert_true(pos + 8 <= file_size);
+		uint32_t len = rb32(data + pos);
+		assert_true(len >= 8 && pos + len <= file_size);
+
+		if (i < sizeof(top) / sizeof(top[0]))
+			assert_int_equal(rb32(data + pos + 4), top[i]);
+		else
+			assert_int_equal(rb32(data + pos + 4),
+					 BOX('f', 'r', 'e', 'e'));
+
+		pos += len;
+		i++;
+	}
+
+	assert_true(i >= sizeof(top) / sizeof(top[0]));
+
+	const size_t num = NUM_FRAGMENTS * SAMPLES_PER_FRAGMENT;
+	const uint32_t stbl_path[] = {
+		BOX('m', 'o', 'o', 'v'), BOX('t', 'r', 'a', 'k'),
+		BOX('m', 'd', 'i', 'a'), BOX('m', 'i', 'n', 'f'),
+		BOX('s', 't', 'b', 'l'),
+	};
+	const uint32_t mvhd_path[] = {
+		BOX('m', 'o', 'o', 'v'),
+		BOX('m', 'v', 'h', 'd'),
+	};
+	const uint32_t mvex_path[] = {
+		BOX('m', 'o', 'o', 'v'),
+		BOX('m', 'v', 'e', 'x'),
+	};
+	const uint8_t *box;
+	size_t size;
+
+	box = find_path(data, file_size, mvex_path, 2, &size);
+	assert_null(box);
+
+	box = find_path(data, file_size, mvhd_path, 2, &size);
+	assert_non_null(box);
+	assert_int_equal(rb32(box + 16), num * SAMPLE_DURATION);
+
+	const uint8_t *stbl = find_path(data, file_size, stbl_path, 5, &size);
+	size_t stbl_size = size;
+	assert_non_null(stbl);
+
+	/* every sample has the same duration */
+	box = find_box(stbl, stbl_size, BOX('s', 't', 't', 's'), &size);
+	assert_non_null(box);
+	assert_int_equal(rb32(box + 4), 1);
+	assert_int_equal(rb32(box + 8), num);
+	assert_int_equal(rb32(box + 12), SAMPLE_DURATION);
+
+	/* the first sample of each fragment is a sync sample */
+	box = find_box(stbl, stbl_size, BOX('s', 't', 's', 's'), &size);
+	assert_non_null(box);
+	assert_int_equal(rb32(box + 4), NUM_FRAGMENTS);
+	for (size_t j = 0; j < NUM_FRAGMENTS; j++)
+		assert_int_equal(rb32(box + 8 + j * 4),
+				 j * SAMPLES_PER_FRAGMENT + 1);
+
+	box = find_box(stbl, stbl_size, BOX('s', 't', 's', 'c'), &size);
+	assert_non_null(box);
+	assert_int_equal(rb32(box + 4), 1);
+	assert_int_equal(rb32(box + 12), SAMPLES_PER_FRAGMENT);
+
+	const uint8_t *stsz =
+		find_box(stbl, stbl_size, BOX('s', 't', 's', 'z'), &size);
+	assert_non_null(stsz);
+	assert_int_equal(rb32(stsz + 8), num);
+
+	const uint8_t *stco =
+		find_box(stbl, stbl_size, BOX('s', 't', 'c', 'o'), &size);
+	assert_non_null(stco);
+	assert_int_equal(rb32(stco + 4), NUM_FRAGMENTS);
+
+	/* the sample data is found where the new index says it is */
+	for (size_t j = 0; j < num; j++) {
+		size_t chunk = j / SAMPLES_PER_FRAGMENT;
+		uint32_t offset = rb32(stco + 8 + chunk * 4);
+
+		for (size_t k = chunk * SAMPLES_PER_FRAGMENT; k < j; k++)
+			offset += rb32(stsz + 12 + k * 4);
+
+		assert_int_equal(rb32(stsz + 12 + j * 4), sample_size(j));
+		assert_true(offset + sample_size(j) <= file_size);
+		for (uint32_t k = 0; k < sample_size(j); k++)
+			assert_int_equal(data[offset + k], j);
+	}
+}
+
+static void recover(size_t truncate)
+{
+	write_test_file(truncate);
+	assert_true(mp4_recover_fragmented(TEST_FILE));
+
+	FILE *file = os_fopen(TEST_FILE, "rb");
+	assert_non_null(file);
+	size_t size = (size_t)os_fgetsize(file);
+	uint8_t *data = bmalloc(size);
+	assert_int_equal(fread(data, 1, size, file), size);
+	fclose(file);
+
+	check_recovered(size, data);
+
+	/* a regular file cannot be recovered again */
+	assert_false(mp4_recover_fragmented(TEST_FILE));
+
+	bfree(data);
+	os_unlink(TEST_FILE);
+}
+
+static void recover_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	/* cut off anywhere in the last fragment, including leaving too little
+	 * behind the new index for a free box */
+	size_t size = fragment_size(NUM_FRAGMENTS * SAMPLES_PER_FRAGMENT);
+	for (size_t i = 1; i <= size; i++)
+		recover(i);
+}
+
+static void not_fragmented_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	assert_false(mp4_recover_fragmented("does-not-exist.mp4"));
+
+	FILE *file = os_fopen(TEST_FILE, "wb");
+	assert_non_null(file);
+	fwrite("not an mp4 file", 1, 15, file);
+	fclose(file);
+
+	assert_false(mp4_recover_fragmented(TEST_FILE));
+	os_unlink(TEST_FILE);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(recover_test),
+		cmocka_unit_test(not_fragmented_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,129 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <cmocka.h>
+
+#include <util/profiler.h>
+#include <util/threading.h>
+#include <util/platform.h>
+
+static const char *outer_name = "outer";
+static const char *inner_name = "inner \"quoted\"";
+static const char *counter_name = "counter";
+
+static void record(size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		profile_start(outer_name);
+		profile_start(inner_name);
+		profile_end(inner_name);
+		profile_end(outer_name);
+	}
+}
+
+static void *record_thread(void *param)
+{
+	record((size_t)(uintptr_t)param);
+	return NULL;
+}
+
+static volatile bool stop_recording = false;
+
+static void *record_until_stopped(void *param)
+{
+	UNUSED_PARAMETER(param);
+
+	while (!os_atomic_load_bool(&stop_recording))
+		record(1);
+	return NULL;
+}
+
+static void trace_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	pthread_t thread;
+	profiler_trace_t *trace;
+
+	/* nothing is recorded while tracing is off */
+	record(10);
+	trace = profiler_trace_capture(10000000000ULL);
+	assert_int_equal(profiler_trace_num_events(trace), 0);
+	profiler_trace_free(trace);
+
+	profiler_trace_start();
+	assert_true(profiler_trace_active());
+
+	record(10);
+	profile_counter(counter_name, -42);
+	pthread_create(&thread, NULL, record_thread, (void *)(uintptr_t)20);
+	pthread_join(thread, NULL);
+
+	trace = profiler_trace_capture(10000000000ULL);
+	assert_int_equal(profiler_trace_num_events(trace), (10 + 20) * 4 + 1);
+	assert_true(profiler_trace_dump_json(trace, "test_trace.json"));
+	profiler_trace_free(trace);
+
+	/* rings wrap around, only the newest events are kept */
+	record(100000);
+	trace = profiler_trace_capture(10000000000ULL);
+	size_t num = profiler_trace_num_events(trace);
+	assert_true(num > 1000);
+	assert_true(num <= 100000 * 4 + 20 * 4);
+	profiler_trace_free(trace);
+
+	/* events older than the capture window are dropped */
+	os_sleep_ms(20);
+	trace = profiler_trace_capture(1000000);
+	assert_int_equal(profiler_trace_num_events(trace), 0);
+	profiler_trace_free(trace);
+
+	profiler_trace_stop();
+	assert_false(profiler_trace_active());
+
+	char *json = os_quick_read_utf8_file("test_trace.json");
+	assert_non_null(json);
+	assert_non_null(strstr(json, "\"traceEvents\""));
+	assert_non_null(strstr(json, "\"inner \\\"quoted\\\"\""));
+	assert_non_null(strstr(json, "\"ph\":\"B\""));
+	assert_non_null(strstr(json, "\"ph\":\"E\""));
+	assert_non_null(strstr(json, "\"ph\":\"C\""));
+	assert_non_null(strstr(json, "\"args\":{\"value\":-42}"));
+	bfree(json);
+	os_unlink("test_trace.json");
+}
+
+static void free_while_recording_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	pthread_t threads[4];
+
+	profiler_trace_start();
+
+	for (size_t i = 0; i < 4; i++)
+		pthread_create(&threads[i], NULL, record_until_stopped, NULL);
+
+	os_sleep_ms(20);
+
+	/* the rings are freed while the threads keep recording */
+	profiler_free();
+	assert_false(profiler_trace_active());
+
+	os_sleep_ms(20);
+	os_atomic_set_bool(&stop_recording, true);
+
+	for (size_t i = 0; i < 4; i++)
+		pthread_join(threads[i], NULL);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(trace_test),
+		cmocka_unit_test(free_while_recording_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
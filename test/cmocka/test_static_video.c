@@ -0,0 +1,199 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/threading.h>
+#include <util/platform.h>
+
+#define TEST_SIZE 64
+
+#ifdef _WIN32
+#define TEST_GRAPHICS_MODULE "libobs-d3d11"
+#else
+#define TEST_GRAPHICS_MODULE "libobs-opengl"
+#endif
+
+static pthread_mutex_t pixel_mutex;
+static uint32_t last_pixel = 0;
+static uint64_t num_frames = 0;
+
+static const char *solid_get_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Static test source";
+}
+
+static void *solid_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void solid_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static uint32_t solid_get_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return TEST_SIZE;
+}
+
+static void solid_render(void *data, gs_effect_t *effect)
+{
+	gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+	gs_eparam_t *color = gs_effect_get_param_by_name(solid, "color");
+	struct vec4 white;
+
+	vec4_set(&white, 1.0f, 1.0f, 1.0f, 1.0f);
+	gs_effect_set_vec4(color, &white);
+
+	while (gs_effect_loop(solid, "Solid"))
+		gs_draw_sprite(NULL, 0, TEST_SIZE, TEST_SIZE);
+
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(effect);
+}
+
+static struct obs_source_info solid_source = {
+	.id = "test_static_video",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_STATIC_VIDEO,
+	.get_name = solid_get_name,
+	.create = solid_create,
+	.destroy = solid_destroy,
+	.get_width = solid_get_size,
+	.get_height = solid_get_size,
+	.video_render = solid_render,
+};
+
+/* keeps the bottom right pixel of each output frame */
+static void receive_video(void *param, struct video_data *frame)
+{
+	const uint8_t *row =
+		frame->data[0] + (TEST_SIZE - 1) * frame->linesize[0];
+	uint32_t pixel;
+
+	memcpy(&pixel, row + (TEST_SIZE - 1) * 4, sizeof(pixel));
+
+	pthread_mutex_lock(&pixel_mutex);
+	last_pixel = pixel;
+	num_frames++;
+	pthread_mutex_unlock(&pixel_mutex);
+
+	UNUSED_PARAMETER(param);
+}
+
+static bool wait_for_pixel(uint32_t pixel)
+{
+	pthread_mutex_lock(&pixel_mutex);
+	uint64_t start = num_frames;
+	pthread_mutex_unlock(&pixel_mutex);
+
+	for (size_t i = 0; i < 200; i++) {
+		bool match;
+
+		os_sleep_ms(10);
+
+		pthread_mutex_lock(&pixel_mutex);
+		match = num_frames > start + 2 && last_pixel == pixel;
+		pthread_mutex_unlock(&pixel_mutex);
+
+		if (match)
+			return true;
+	}
+
+	return false;
+}
+
+static int setup(void **state)
+{
+	struct obs_video_info ovi = {
+		.graphics_module = TEST_GRAPHICS_MODULE,
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = TEST_SIZE,
+		.base_height = TEST_SIZE,
+		.output_width = TEST_SIZE,
+		.output_height = TEST_SIZE,
+		.output_format = VIDEO_FORMAT_BGRA,
+		.adapter = 0,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_SRGB,
+		.range = VIDEO_RANGE_FULL,
+		.scale_type = OBS_SCALE_POINT,
+	};
+
+	pthread_mutex_init(&pixel_mutex, NULL);
+	obs_add_data_path(LIBOBS_DATA_PATH);
+
+	/* no display or graphics device, the test is skipped */
+	if (!obs_startup("en-US", NULL, NULL))
+		return 0;
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS)
+		return 0;
+
+	obs_register_source(&solid_source);
+	*state = (void *)1;
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (obs_initialized())
+		obs_shutdown();
+	pthread_mutex_destroy(&pixel_mutex);
+	return 0;
+}
+
+static void crop_static_scene_test(void **state)
+{
+	if (!*state)
+		skip();
+
+	obs_scene_t *scene = obs_scene_create_private("scene");
+	obs_source_t *source =
+		obs_source_create_private("test_static_video", "solid", NULL);
+	obs_sceneitem_t *item = obs_scene_add(scene, source);
+
+	obs_set_output_source(0, obs_scene_get_source(scene));
+	obs_add_raw_video_callback(NULL, receive_video, NULL);
+
+	/* the scene is static, its frames are reused */
+	assert_true(wait_for_pixel(0xFFFFFFFF));
+	uint32_t reused = obs_get_reused_frames();
+	assert_true(wait_for_pixel(0xFFFFFFFF));
+	assert_true(obs_get_reused_frames() > reused);
+
+	/* cropping reveals the transparent background */
+	struct obs_sceneitem_crop crop = {0, 0, TEST_SIZE / 2, TEST_SIZE / 2};
+	obs_sceneitem_set_crop(item, &crop);
+	assert_true(wait_for_pixel(0));
+
+	crop.right = crop.bottom = 0;
+	obs_sceneitem_set_crop(item, &crop);
+	assert_true(wait_for_pixel(0xFFFFFFFF));
+
+	/* removed sources are pruned from the scene */
+	obs_source_remove(source);
+	assert_true(wait_for_pixel(0));
+
+	obs_remove_raw_video_callback(receive_video, NULL);
+	obs_set_output_source(0, NULL);
+	obs_source_release(source);
+	obs_scene_release(scene);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(crop_static_scene_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
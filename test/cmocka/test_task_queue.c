@@ -0,0 +1,175 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <cmocka.h>
+
+#include <util/task.h>
+#include <util/threading.h>
+#include <util/platform.h>
+#include <util/bmem.h>
+
+#define MAX_PRODUCERS 16
+#define TASKS_PER_PRODUCER 100000
+#define BATCH_SIZE 32
+
+struct producer {
+	os_task_queue_t *tq;
+	pthread_t thread;
+	size_t index;
+	bool batch;
+	uint64_t enqueue_ns;
+};
+
+static long last_seen[MAX_PRODUCERS];
+static volatile long tasks_run;
+static volatile bool out_of_order;
+
+static inline void *encode_task(size_t producer, long seq)
+{
+	return (void *)(uintptr_t)(((uint64_t)producer << 32) | (uint64_t)seq);
+}
+
+static void counting_task(void *param)
+{
+	uint64_t val = (uint64_t)(uintptr_t)param;
+	size_t producer = (size_t)(val >> 32);
+	long seq = (long)(val & 0xFFFFFFFF);
+
+	/* tasks from a single producer have to run in the order queued */
+	if (seq != last_seen[producer] + 1)
+		os_atomic_set_bool(&out_of_order, true);
+	last_seen[producer] = seq;
+
+	os_atomic_inc_long(&tasks_run);
+}
+
+static void *producer_thread(void *param)
+{
+	struct producer *p = param;
+	uint64_t start = os_gettime_ns();
+
+	if (p->batch) {
+		struct os_task_info tasks[BATCH_SIZE];
+
+		for (long i = 0; i < TASKS_PER_PRODUCER; i += BATCH_SIZE) {
+			for (long j = 0; j < BATCH_SIZE; j++) {
+				tasks[j].task = counting_task;
+				tasks[j].param = encode_task(p->index, i + j);
+			}
+			os_task_queue_queue_tasks(p->tq, tasks, BATCH_SIZE);
+		}
+	} else {
+		for (long i = 0; i < TASKS_PER_PRODUCER; i++)
+			os_task_queue_queue_task(p->tq, counting_task,
+						 encode_task(p->index, i));
+	}
+
+	p->enqueue_ns = os_gettime_ns() - start;
+	return NULL;
+}
+
+static void run_producers(size_t num, bool batch)
+{
+	struct producer producers[MAX_PRODUCERS] = {0};
+	os_task_queue_t *tq = os_task_queue_create();
+	uint64_t total_ns = 0;
+	uint64_t start;
+
+	assert_non_null(tq);
+
+	for (size_t i = 0; i < MAX_PRODUCERS; i++)
+		last_seen[i] = -1;
+	tasks_run = 0;
+	out_of_order = false;
+
+	start = os_gettime_ns();
+
+	for (size_t i = 0; i < num; i++) {
+		producers[i].tq = tq;
+		producers[i].index = i;
+		producers[i].batch = batch;
+		pthread_create(&producers[i].thread, NULL, producer_thread,
+			       &producers[i]);
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		pthread_join(producers[i].thread, NULL);
+		total_ns += producers[i].enqueue_ns;
+	}
+
+	os_task_queue_wait(tq);
+
+	uint64_t drain_ns = os_gettime_ns() - start;
+	long total = (long)(num * TASKS_PER_PRODUCER);
+
+	assert_int_equal(os_atomic_load_long(&tasks_run), total);
+	assert_false(os_atomic_load_bool(&out_of_order));
+
+	printf("%2d producer(s)%s: %6.1f ns per enqueue, "
+	       "%5.2f M tasks/s end to end\n",
+	       (int)num, batch ? " (batched)" : "          ",
+	       (double)total_ns / (double)total,
+	       (double)total * 1000.0 / (double)drain_ns);
+
+	os_task_queue_destroy(tq);
+}
+
+static void task_queue_benchmark(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	run_producers(1, false);
+	run_producers(4, false);
+	run_producers(16, false);
+
+	run_producers(1, true);
+	run_producers(4, true);
+	run_producers(16, true);
+}
+
+static void blocking_task(void *param)
+{
+	os_event_wait(param);
+}
+
+static void overflow_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_task_queue_t *tq = os_task_queue_create();
+	os_event_t *unblock;
+	os_event_init(&unblock, OS_EVENT_TYPE_MANUAL);
+
+	for (size_t i = 0; i < MAX_PRODUCERS; i++)
+		last_seen[i] = -1;
+	tasks_run = 0;
+	out_of_order = false;
+
+	/* stall the task thread so that the ring fills up and spills into
+	 * the overflow queue */
+	os_task_queue_queue_task(tq, blocking_task, unblock);
+	for (long i = 0; i < 20000; i++)
+		os_task_queue_queue_task(tq, counting_task, encode_task(0, i));
+
+	os_event_signal(unblock);
+	os_task_queue_wait(tq);
+	assert_int_equal(os_atomic_load_long(&tasks_run), 20000);
+	assert_false(os_atomic_load_bool(&out_of_order));
+
+	/* nothing ran since the last wait */
+	assert_false(os_task_queue_wait(tq));
+
+	os_task_queue_destroy(tq);
+	os_event_destroy(unblock);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(overflow_test),
+		cmocka_unit_test(task_queue_benchmark),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
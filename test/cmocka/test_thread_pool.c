@@ -0,0 +1,156 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/thread-pool.h>
+#include <util/threading.h>
+#include <util/platform.h>
+
+static volatile long counter;
+
+static void count_task(void *param)
+{
+	UNUSED_PARAMETER(param);
+	os_atomic_inc_long(&counter);
+}
+
+static void group_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_thread_pool_t *pool = os_thread_pool_create("test pool", 4);
+	os_task_group_t *group = os_task_group_create();
+
+	assert_non_null(pool);
+	assert_non_null(group);
+	assert_int_equal(os_thread_pool_num_threads(pool), 4);
+	assert_false(os_thread_pool_inside(pool));
+
+	counter = 0;
+	for (int i = 0; i < 10000; i++)
+		os_thread_pool_submit(pool, count_task, NULL,
+				      (enum os_task_priority)(i % 3), group);
+
+	os_thread_pool_wait_for_group(pool, group);
+	assert_int_equal(os_atomic_load_long(&counter), 10000);
+	assert_int_equal(os_task_group_pending(group), 0);
+
+	os_task_group_destroy(group);
+	os_thread_pool_destroy(pool);
+}
+
+struct nested_data {
+	os_thread_pool_t *pool;
+	bool inside;
+};
+
+static void nested_task(void *param)
+{
+	struct nested_data *data = param;
+	os_task_group_t *group = os_task_group_create();
+
+	data->inside = os_thread_pool_inside(data->pool);
+
+	/* waiting from a worker must not deadlock, even with one thread */
+	for (int i = 0; i < 100; i++)
+		os_thread_pool_submit(data->pool, count_task, NULL,
+				      OS_TASK_PRIORITY_NORMAL, group);
+
+	os_thread_pool_wait_for_group(data->pool, group);
+	os_task_group_destroy(group);
+}
+
+static void nested_wait_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_thread_pool_t *pool = os_thread_pool_create("test pool", 1);
+	os_task_group_t *group = os_task_group_create();
+	struct nested_data data = {pool, false};
+
+	counter = 0;
+	os_thread_pool_submit(pool, nested_task, &data, OS_TASK_PRIORITY_NORMAL,
+			      group);
+	os_thread_pool_wait_for_group(pool, group);
+
+	assert_true(data.inside);
+	assert_int_equal(os_atomic_load_long(&counter), 100);
+
+	os_task_group_destroy(group);
+	os_thread_pool_destroy(pool);
+}
+
+static os_event_t *unblock;
+static int order[3];
+static volatile long order_idx;
+
+static void blocking_task(void *param)
+{
+	UNUSED_PARAMETER(param);
+	os_event_wait(unblock);
+}
+
+static void priority_task(void *param)
+{
+	order[os_atomic_inc_long(&order_idx) - 1] = (int)(intptr_t)param;
+}
+
+static void priority_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_thread_pool_t *pool = os_thread_pool_create("test pool", 1);
+	os_task_group_t *group = os_task_group_create();
+
+	os_event_init(&unblock, OS_EVENT_TYPE_MANUAL);
+	order_idx = 0;
+
+	os_thread_pool_submit(pool, blocking_task, NULL, OS_TASK_PRIORITY_HIGH,
+			      group);
+	os_sleep_ms(50);
+
+	for (int prio = 0; prio < OS_TASK_PRIORITY_COUNT; prio++) {
+		void *param = (void *)(intptr_t)prio;
+		os_thread_pool_submit(pool, priority_task, param,
+				      (enum os_task_priority)prio, group);
+	}
+
+	os_event_signal(unblock);
+	os_thread_pool_wait_for_group(pool, group);
+
+	assert_int_equal(order[0], OS_TASK_PRIORITY_HIGH);
+	assert_int_equal(order[1], OS_TASK_PRIORITY_NORMAL);
+	assert_int_equal(order[2], OS_TASK_PRIORITY_LOW);
+
+	os_event_destroy(unblock);
+	os_task_group_destroy(group);
+	os_thread_pool_destroy(pool);
+}
+
+static void destroy_runs_pending_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_thread_pool_t *pool = os_thread_pool_create("test pool", 2);
+
+	counter = 0;
+	for (int i = 0; i < 1000; i++)
+		os_thread_pool_submit(pool, count_task, NULL,
+				      OS_TASK_PRIORITY_LOW, NULL);
+
+	os_thread_pool_destroy(pool);
+	assert_int_equal(os_atomic_load_long(&counter), 1000);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(group_test),
+		cmocka_unit_test(nested_wait_test),
+		cmocka_unit_test(priority_test),
+		cmocka_unit_test(destroy_runs_pending_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}